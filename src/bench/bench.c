@@ -0,0 +1,1491 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * Microbenchmarks of the hot kernels of the signal path, from the SDR
+ * filters down to image post-processing. Each kernel is run on a signal
+ * from the synthetic LRPT generator, or on recorded soft symbols where
+ * given, for a minimum time and its throughput is printed as CSV so that
+ * runs can be compared
+ */
+
+/*****************************************************************************/
+
+#include "../common/common.h"
+#include "../decoder/correlator.h"
+#include "../decoder/dct.h"
+#include "../decoder/ecc.h"
+#include "../decoder/medet.h"
+#include "../decoder/met_jfif.h"
+#include "../decoder/met_jpg.h"
+#include "../decoder/viterbi27.h"
+#include "../demodulator/agc.h"
+#include "../demodulator/demod.h"
+#include "../demodulator/filters.h"
+#include "../demodulator/pll.h"
+#include "../glrpt/utils.h"
+#include "../image/clahe.h"
+#include "../image/image.h"
+#include "../image/rectify_meteor.h"
+#include "../sdr/filters.h"
+#include "../synth/awgn.h"
+#include "../synth/encoder.h"
+#include "../synth/modulator.h"
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <turbojpeg.h>
+#include <unistd.h>
+
+/*****************************************************************************/
+
+/* Demodulator parameters of the synthetic signal (Meteor-M2 defaults) */
+#define BENCH_SYMBOL_RATE   72000
+#define BENCH_INTERP        4
+#define BENCH_SAMPLERATE    (4.0 * BENCH_SYMBOL_RATE)
+#define BENCH_FILTER_BW     120000
+
+/* Eb/N0 (dB) of the synthetic signal, decodable with some errors */
+#define BENCH_EBN0          5.0
+
+/* Number of samples processed per batch by the DSP kernels */
+#define BENCH_SAMPLES       16384
+
+/* Number of synthetic soft frames to cycle through */
+#define BENCH_FRAMES        64
+
+/* Reed-Solomon codeword length and correctable byte errors */
+#define RS_BLOCK_LEN        255
+#define RS_ERRORS           8
+
+/* Number of RS codewords interleaved in a frame */
+#define RS_INTERLEAVE       4
+
+/* Blocks per IDCT batch, the first ones of typical coefficients */
+#define IDCT_BLOCKS         1024
+#define IDCT_TYPICAL        512
+
+/* Most error of a fixed point IDCT against the double precision one */
+#define IDCT_MAX_ERROR      1
+
+/* JPEG quality of the synthetic image packets */
+#define MCU_QUALITY         80
+
+/* JPEG quality of the packets saved as received, some entries of its
+ * quantization table go over the 8 bits of a baseline JPEG file */
+#define JFIF_QUALITY        22
+
+/* Size of a synthetic image packet, with room for the bit reader */
+#define MCU_PACKET_LEN      4096
+
+/* Number of synthetic image packets to cycle through */
+#define MCU_PACKETS         64
+
+/* Height (lines) of the synthetic channel images */
+#define IMAGE_LINES         1600
+
+/* One in this many packets of MCUs lost, for the gap filling kernel */
+#define GAPS_PACKETS        20
+
+/* Default minimum run time of each kernel (sec) */
+#define BENCH_MIN_TIME      1.0
+
+/*****************************************************************************/
+
+/* A kernel under test. run() processes one batch and returns the number
+ * of units processed, reset() is called before each batch untimed */
+typedef struct bench_t {
+    const char *name;
+    const char *unit;
+    bool (*init)(void);
+    void (*reset)(void);
+    uint64_t (*run)(void);
+    void (*deinit)(void);
+} bench_t;
+
+/*****************************************************************************/
+
+static void Usage(void);
+static bool Read_Recorded(const char *fname);
+static uint32_t Bench_Random(void);
+static double Bench_Time(void);
+static void Run_Bench(const bench_t *bench, double min_time);
+
+static void Synth_IQ(void);
+static void Synth_Soft(void);
+static bool Chebyshev_Init(void);
+static void Chebyshev_Reset(void);
+static uint64_t Chebyshev_Run(void);
+static void Chebyshev_Deinit(void);
+static bool Rrc_Init(void);
+static uint64_t Rrc_Run(void);
+static void Rrc_Deinit(void);
+static bool Agc_Bench_Init(void);
+static uint64_t Agc_Bench_Run(void);
+static void Agc_Bench_Deinit(void);
+static bool Costas_Bench_Init(void);
+static uint64_t Costas_Bench_Run(void);
+static void Costas_Bench_Deinit(void);
+static bool Demod_Bench_Init(void);
+static uint64_t Demod_Bench_Run(void);
+static void Demod_Bench_Deinit(void);
+static bool Soft_Init(void);
+static uint8_t *Soft_Frame(void);
+static void Soft_Deinit(void);
+static uint64_t Correlate_Run(void);
+static bool Viterbi_Init(void);
+static bool Viterbi_Impl_Init(vit_impl_t impl);
+static bool Viterbi_Scalar_Init(void);
+static bool Viterbi_SSE2_Init(void);
+static bool Viterbi_AVX2_Init(void);
+static uint64_t Viterbi_Run(void);
+static void Viterbi_Deinit(void);
+static void Ecc_Reset(void);
+static uint64_t Ecc_Run(void);
+static void Ecc_Frame_Reset(void);
+static void Ecc_Clean_Reset(void);
+static uint64_t Ecc_Frame_Run(void);
+static bool Decode_Init(void);
+static void Decode_Reset(void);
+static uint64_t Decode_Run(void);
+static void Decode_Deinit(void);
+static bool Idct_Init(void);
+static uint64_t Idct_Run(void);
+static void Idct_Deinit(void);
+static bool Idct_Impl_Init(idct_impl_t impl);
+static bool Idct_Auto_Init(void);
+static bool Idct_Float_Init(void);
+static bool Idct_Scalar_Init(void);
+static bool Idct_SSE2_Init(void);
+static bool Idct_AVX2_Init(void);
+static uint64_t Idct_Impl_Run(void);
+static void Idct_Impl_Deinit(void);
+static bool Mcu_Init(void);
+static uint64_t Mcu_Run(void);
+static void Mcu_Deinit(void);
+static double Dct_Basis(uint32_t p, int u);
+static bool Jfif_Init(void);
+static uint64_t Jfif_Run(void);
+static void Jfif_Deinit(void);
+static bool Image_Init(void);
+static void Image_Reset(void);
+static uint64_t Clahe_Run(void);
+static void Gaps_Reset(void);
+static uint64_t Fill_Gaps_Run(void);
+static uint64_t Rectify_W2RG_Run(void);
+static uint64_t Rectify_5B4AZ_Run(void);
+static void Image_Deinit(void);
+
+/*****************************************************************************/
+
+/* Recorded soft symbols, if given on the command line */
+static int8_t *recorded = NULL;
+static size_t recorded_len = 0;
+
+/* Soft symbols used by the decoder kernels and their length */
+static uint8_t *soft_data = NULL;
+static size_t soft_len = 0, soft_off = 0;
+
+static uint32_t random_state = 0x12345678;
+
+/* Set if a kernel fails its accuracy check */
+static bool bench_failed = false;
+
+/* Keeps the results of the kernels alive */
+static volatile double result_sink;
+
+/* Kernel states */
+static filter_data_t cheb_filter;
+static double *samples_i = NULL, *samples_q = NULL;
+static complex double *samples_iq = NULL;
+static Filter_t *rrc = NULL;
+static Agc_t *agc = NULL;
+static Costas_t *costas = NULL;
+static Demod_t *demod = NULL;
+static corr_rec_t corr;
+static viterbi27_rec_t *viterbi = NULL;
+static uint8_t hard_frame[FRAME_BITS / 4];
+static uint8_t rs_blocks[RS_INTERLEAVE][RS_BLOCK_LEN];
+static uint8_t rs_frame[RS_INTERLEAVE * RS_BLOCK_LEN];
+static medet_t *decoder = NULL;
+static channel_images_t images;
+static double *dct_in = NULL, *dct_out = NULL;
+static idct_8x8_t idct = NULL;
+static int16_t *idct_blk = NULL;
+static uint8_t *idct_pix = NULL, *idct_ref = NULL;
+static uint8_t *mcu_packets = NULL;
+static jfif_store_t jfif_store;
+static char jfif_fname[] = "/tmp/glrpt_bench_XXXXXX";
+static uint8_t *image_orig = NULL;
+
+static const bench_t benches[] = {
+    { "dsp_filter",     "sample",   Chebyshev_Init, Chebyshev_Reset,
+        Chebyshev_Run,     Chebyshev_Deinit },
+    { "filter_fwd",     "sample",   Rrc_Init,       NULL,
+        Rrc_Run,           Rrc_Deinit },
+    { "agc_apply",      "sample",   Agc_Bench_Init, NULL,
+        Agc_Bench_Run,     Agc_Bench_Deinit },
+    { "costas_mix",     "sample",   Costas_Bench_Init, NULL,
+        Costas_Bench_Run,  Costas_Bench_Deinit },
+    { "demod_qpsk",     "sample",   Demod_Bench_Init, NULL,
+        Demod_Bench_Run,   Demod_Bench_Deinit },
+    { "corr_correlate", "frame",    Soft_Init,      NULL,
+        Correlate_Run,     Soft_Deinit },
+    { "vit_decode",     "frame",    Viterbi_Init,   NULL,
+        Viterbi_Run,       Viterbi_Deinit },
+    { "vit_decode_scalar", "frame", Viterbi_Scalar_Init, NULL,
+        Viterbi_Run,       Viterbi_Deinit },
+    { "vit_decode_sse2", "frame",   Viterbi_SSE2_Init, NULL,
+        Viterbi_Run,       Viterbi_Deinit },
+    { "vit_decode_avx2", "frame",   Viterbi_AVX2_Init, NULL,
+        Viterbi_Run,       Viterbi_Deinit },
+    { "ecc_decode",     "frame",    NULL,           Ecc_Reset,
+        Ecc_Run,           NULL },
+    { "ecc_decode_frame", "frame",  NULL,           Ecc_Frame_Reset,
+        Ecc_Frame_Run,     NULL },
+    { "ecc_check_frame", "frame",   NULL,           Ecc_Clean_Reset,
+        Ecc_Frame_Run,     NULL },
+    { "decode_image",   "frame",    Decode_Init,    Decode_Reset,
+        Decode_Run,        Decode_Deinit },
+    { "flt_idct_8x8",   "block",    Idct_Init,      NULL,
+        Idct_Run,          Idct_Deinit },
+    { "idct_8x8",       "block",    Idct_Auto_Init, NULL,
+        Idct_Impl_Run,     Idct_Impl_Deinit },
+    { "idct_8x8_float", "block",    Idct_Float_Init, NULL,
+        Idct_Impl_Run,     Idct_Impl_Deinit },
+    { "idct_8x8_scalar", "block",   Idct_Scalar_Init, NULL,
+        Idct_Impl_Run,     Idct_Impl_Deinit },
+    { "idct_8x8_sse2",  "block",    Idct_SSE2_Init, NULL,
+        Idct_Impl_Run,     Idct_Impl_Deinit },
+    { "idct_8x8_avx2",  "block",    Idct_AVX2_Init, NULL,
+        Idct_Impl_Run,     Idct_Impl_Deinit },
+    { "mj_dec_mcus",    "mcu",      Mcu_Init,       NULL,
+        Mcu_Run,           Mcu_Deinit },
+    { "jfif_write",     "packet",   Jfif_Init,      NULL,
+        Jfif_Run,          Jfif_Deinit },
+    { "clahe",          "pixel",    Image_Init,     Image_Reset,
+        Clahe_Run,         Image_Deinit },
+    { "fill_gaps",      "pixel",    Image_Init,     Gaps_Reset,
+        Fill_Gaps_Run,     Image_Deinit },
+    { "rectify_w2rg",   "pixel",    Image_Init,     Image_Reset,
+        Rectify_W2RG_Run,  Image_Deinit },
+    { "rectify_5b4az",  "pixel",    Image_Init,     Image_Reset,
+        Rectify_5B4AZ_Run, Image_Deinit },
+};
+
+#define BENCH_NUM   (sizeof(benches) / sizeof(benches[0]))
+
+/*****************************************************************************/
+
+/* main()
+ *
+ * Runs the selected kernels and prints their throughput
+ */
+int main(int argc, char *argv[]) {
+    const char *filter = NULL;
+    double min_time = BENCH_MIN_TIME;
+    bool list = false;
+
+    /* Process command line options */
+    int option;
+
+    while ((option = getopt(argc, argv, "k:r:t:lhv")) != -1)
+        switch (option) {
+            case 'k': /* Run only kernels matching this name */
+                filter = optarg;
+
+                break;
+
+            case 'r': /* Recorded soft symbols file */
+                if (!Read_Recorded(optarg))
+                    exit(-1);
+
+                break;
+
+            case 't': /* Minimum run time of each kernel (sec) */
+                min_time = strtod(optarg, NULL);
+
+                if ((min_time <= 0.0) || (min_time > 3600.0)) {
+                    fprintf(stderr, "glrpt_bench: %s\n", "invalid run time");
+                    exit(-1);
+                }
+
+                break;
+
+            case 'l': /* List kernels and exit */
+                list = true;
+
+                break;
+
+            case 'h': /* Print help and exit */
+                Usage();
+                exit(0);
+
+                break;
+
+            case 'v': /* Print version info and exit */
+                puts(PACKAGE_STRING);
+                exit(0);
+
+                break;
+
+            default: /* Print help and exit */
+                Usage();
+                exit(-1);
+
+                break;
+        }
+
+    if (list) {
+        for (size_t i = 0; i < BENCH_NUM; i++)
+            printf("%s,%s\n", benches[i].name, benches[i].unit);
+
+        exit(0);
+    }
+
+    puts("kernel,unit,count,seconds,ns_per_unit,units_per_sec");
+
+    for (size_t i = 0; i < BENCH_NUM; i++) {
+        if (filter && !strstr(benches[i].name, filter))
+            continue;
+
+        Run_Bench(&benches[i], min_time);
+    }
+
+    free_ptr((void **)&recorded);
+
+    return bench_failed ? -1 : 0;
+}
+
+/*****************************************************************************/
+
+/* Usage()
+ *
+ * Prints usage information
+ */
+static void Usage(void) {
+    fprintf(stderr, "%s\n",
+            "Usage: glrpt_bench [-hlv] [-k kernel] [-r file] [-t seconds]");
+
+    fprintf(stderr, "%s\n",
+            "       -k: Run only the kernels whose name contains this string");
+
+    fprintf(stderr, "%s\n",
+            "       -r: Recorded 8-bit soft symbols to use in the decoder"
+            " kernels instead of synthetic ones");
+
+    fprintf(stderr, "%s\n",
+            "       -t: Minimum run time of each kernel (sec). Default is 1");
+
+    fprintf(stderr, "%s\n",
+            "       -l: List the kernels and their units and exit");
+
+    fprintf(stderr, "%s\n",
+            "       -h: Print this usage information and exit");
+
+    fprintf(stderr, "%s\n",
+            "       -v: Print version number and exit");
+
+    fprintf(stderr, "%s\n",
+            "Results are printed to stdout as CSV:"
+            " kernel,unit,count,seconds,ns_per_unit,units_per_sec");
+}
+
+/*****************************************************************************/
+
+/* Read_Recorded()
+ *
+ * Reads a file of recorded soft symbols
+ */
+static bool Read_Recorded(const char *fname) {
+    FILE *fp = NULL;
+
+    if (!Open_File(&fp, fname, "r"))
+        return false;
+
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if (len < 3 * SOFT_FRAME_LEN) {
+        fprintf(stderr, "glrpt_bench: %s is too short\n", fname);
+        fclose(fp);
+        return false;
+    }
+
+    mem_alloc((void **)&recorded, (size_t)len);
+    recorded_len = fread(recorded, 1, (size_t)len, fp);
+    fclose(fp);
+
+    return true;
+}
+
+/*****************************************************************************/
+
+/* Bench_Random()
+ *
+ * Reproducible pseudo-random numbers (xorshift32)
+ */
+static uint32_t Bench_Random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+
+    return random_state;
+}
+
+/*****************************************************************************/
+
+/* Bench_Time()
+ *
+ * Returns a monotonic time stamp (sec)
+ */
+static double Bench_Time(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/*****************************************************************************/
+
+/* Run_Bench()
+ *
+ * Runs a kernel in batches for at least min_time and prints its throughput
+ */
+static void Run_Bench(const bench_t *bench, double min_time) {
+    double elapsed = 0.0;
+    uint64_t count = 0;
+
+    if (bench->init && !bench->init())
+        return;
+
+    while (elapsed < min_time) {
+        if (bench->reset)
+            bench->reset();
+
+        double start = Bench_Time();
+        count += bench->run();
+        elapsed += Bench_Time() - start;
+    }
+
+    if (bench->deinit)
+        bench->deinit();
+
+    printf("%s,%s,%llu,%.6f,%.3f,%.1f\n",
+            bench->name, bench->unit, (unsigned long long)count, elapsed,
+            count ? elapsed * 1e9 / (double)count : 0.0,
+            (double)count / elapsed);
+    fflush(stdout);
+}
+
+/*****************************************************************************/
+
+/* Chebyshev_Init()
+ *
+ * Sets up the SDR I/Q low pass filter on noise samples
+ */
+static bool Chebyshev_Init(void) {
+    mem_alloc((void **)&samples_i, BENCH_SAMPLES * sizeof(double));
+
+    if (!Init_Chebyshev_Filter(&cheb_filter, BENCH_SAMPLES,
+                BENCH_FILTER_BW, BENCH_SAMPLERATE, 5.0, 6, FILTER_LOWPASS))
+        return false;
+
+    cheb_filter.samples_buf = samples_i;
+
+    return true;
+}
+
+/*****************************************************************************/
+
+/* Chebyshev_Reset()
+ *
+ * Refills the samples buffer, which is filtered in place
+ */
+static void Chebyshev_Reset(void) {
+    for (int i = 0; i < BENCH_SAMPLES; i++)
+        samples_i[i] = (double)(Bench_Random() & 0xFFFF) - 32768.0;
+}
+
+/*****************************************************************************/
+
+static uint64_t Chebyshev_Run(void) {
+    DSP_Filter(&cheb_filter);
+
+    return BENCH_SAMPLES;
+}
+
+/*****************************************************************************/
+
+static void Chebyshev_Deinit(void) {
+    Deinit_Chebyshev_Filter(&cheb_filter);
+    free_ptr((void **)&samples_i);
+}
+
+/*****************************************************************************/
+
+/* Synth_IQ()
+ *
+ * Fills the complex samples buffer with a noisy QPSK
+ * signal, slightly off the carrier frequency
+ */
+static void Synth_IQ(void) {
+    synth_encoder_params_t enc_params = {
+        .apid    = { 64, 65, 66 },
+        .quality = MCU_QUALITY
+    };
+
+    synth_mod_params_t mod_params = {
+        .mode        = QPSK,
+        .symbol_rate = BENCH_SYMBOL_RATE,
+        .samplerate  = BENCH_SAMPLERATE,
+        .rrc_alpha   = 0.6,
+        .noise       = true,
+        .ebn0        = BENCH_EBN0,
+        .doppler     = 500.0,
+        .amplitude   = 64.0,
+        .seed        = 1
+    };
+
+    uint8_t cadu[SYNTH_CADU_LEN];
+    int8_t soft[SYNTH_SOFT_LEN];
+    const double *sig_i, *sig_q;
+    size_t cnt = 0;
+
+    synth_encoder_t *encoder = Synth_Encoder_Init(&enc_params);
+    synth_mod_t *mod = Synth_Mod_Init(&mod_params);
+
+    mem_alloc((void **)&samples_iq, BENCH_SAMPLES * sizeof(complex double));
+
+    while (cnt < BENCH_SAMPLES) {
+        Synth_Cadu(encoder, cadu);
+        Synth_Convolve(encoder, cadu, soft);
+
+        size_t len = Synth_Modulate(mod, soft, SYNTH_SOFT_LEN, &sig_i, &sig_q);
+        for (size_t i = 0; (i < len) && (cnt < BENCH_SAMPLES); i++)
+            samples_iq[cnt++] = sig_i[i] + sig_q[i] * I;
+    }
+
+    Synth_Mod_Deinit(mod);
+    Synth_Encoder_Deinit(encoder);
+}
+
+/*****************************************************************************/
+
+/* Synth_Soft()
+ *
+ * Makes noisy soft symbol frames of the test pattern
+ */
+static void Synth_Soft(void) {
+    synth_encoder_params_t enc_params = {
+        .apid    = { 64, 65, 66 },
+        .quality = MCU_QUALITY
+    };
+
+    uint8_t cadu[SYNTH_CADU_LEN];
+    awgn_t awgn;
+
+    synth_encoder_t *encoder = Synth_Encoder_Init(&enc_params);
+    double sigma = Awgn_Soft_Sigma(BENCH_EBN0, SYNTH_SOFT_AMPL);
+
+    Awgn_Init(&awgn, 1);
+
+    soft_len = BENCH_FRAMES * SYNTH_SOFT_LEN;
+    mem_alloc((void **)&soft_data, soft_len);
+
+    for (size_t off = 0; off < soft_len; off += SYNTH_SOFT_LEN) {
+        int8_t *soft = (int8_t *)&soft_data[off];
+
+        Synth_Cadu(encoder, cadu);
+        Synth_Convolve(encoder, cadu, soft);
+        Awgn_Soft(&awgn, soft, SYNTH_SOFT_LEN, sigma);
+    }
+
+    Synth_Encoder_Deinit(encoder);
+}
+
+/*****************************************************************************/
+
+static bool Rrc_Init(void) {
+    Synth_IQ();
+    rrc = Filter_RRC(32, BENCH_INTERP,
+            BENCH_SAMPLERATE / BENCH_SYMBOL_RATE, 0.6);
+
+    return true;
+}
+
+/*****************************************************************************/
+
+static uint64_t Rrc_Run(void) {
+    complex double acc = 0.0;
+
+    for (int i = 0; i < BENCH_SAMPLES; i++)
+        acc += Filter_Fwd(rrc, samples_iq[i]);
+
+    result_sink = creal(acc);
+
+    return BENCH_SAMPLES;
+}
+
+/*****************************************************************************/
+
+static void Rrc_Deinit(void) {
+    Filter_Free(rrc);
+    free_ptr((void **)&samples_iq);
+}
+
+/*****************************************************************************/
+
+static bool Agc_Bench_Init(void) {
+    Synth_IQ();
+    agc = Agc_Init();
+
+    return true;
+}
+
+/*****************************************************************************/
+
+static uint64_t Agc_Bench_Run(void) {
+    complex double acc = 0.0;
+
+    for (int i = 0; i < BENCH_SAMPLES; i++)
+        acc += Agc_Apply(agc, samples_iq[i]);
+
+    result_sink = creal(acc);
+
+    return BENCH_SAMPLES;
+}
+
+/*****************************************************************************/
+
+static void Agc_Bench_Deinit(void) {
+    Agc_Free(agc);
+    free_ptr((void **)&samples_iq);
+}
+
+/*****************************************************************************/
+
+static bool Costas_Bench_Init(void) {
+    Synth_IQ();
+    costas = Costas_Init(M_2PI * 100.0 / BENCH_SYMBOL_RATE,
+            QPSK, 0.8, 0.824, BENCH_INTERP);
+
+    return true;
+}
+
+/*****************************************************************************/
+
+static uint64_t Costas_Bench_Run(void) {
+    complex double acc = 0.0;
+
+    for (int i = 0; i < BENCH_SAMPLES; i++)
+        acc += Costas_Mix(costas, samples_iq[i]);
+
+    result_sink = creal(acc);
+
+    return BENCH_SAMPLES;
+}
+
+/*****************************************************************************/
+
+static void Costas_Bench_Deinit(void) {
+    Costas_Free(costas);
+    free_ptr((void **)&samples_iq);
+}
+
+/*****************************************************************************/
+
+/* Demod_Bench_Init()
+ *
+ * Sets up the complete QPSK demodulator on a synthetic signal
+ */
+static bool Demod_Bench_Init(void) {
+    demod_params_t params = {
+        .psk_mode         = QPSK,
+        .symbol_rate      = BENCH_SYMBOL_RATE,
+        .interp_factor    = BENCH_INTERP,
+        .samplerate       = BENCH_SAMPLERATE,
+        .costas_bandwidth = 100.0,
+        .pll_locked       = 0.8,
+        .pll_unlocked     = 0.824,
+        .rrc_order        = 32,
+        .rrc_alpha        = 0.6
+    };
+
+    Synth_IQ();
+    mem_alloc((void **)&samples_i, BENCH_SAMPLES * sizeof(double));
+    mem_alloc((void **)&samples_q, BENCH_SAMPLES * sizeof(double));
+
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        samples_i[i] = creal(samples_iq[i]);
+        samples_q[i] = cimag(samples_iq[i]);
+    }
+
+    demod = Demod_Init(&params);
+
+    return true;
+}
+
+/*****************************************************************************/
+
+static uint64_t Demod_Bench_Run(void) {
+    Demod_Process(demod, samples_i, samples_q, BENCH_SAMPLES, NULL, NULL);
+
+    return BENCH_SAMPLES;
+}
+
+/*****************************************************************************/
+
+static void Demod_Bench_Deinit(void) {
+    Demod_Deinit(demod);
+    free_ptr((void **)&samples_i);
+    free_ptr((void **)&samples_q);
+    free_ptr((void **)&samples_iq);
+}
+
+/*****************************************************************************/
+
+/* Soft_Init()
+ *
+ * Sets up the soft symbols of the decoder kernels, either
+ * the recorded or synthetic ones, and the correlator
+ */
+static bool Soft_Init(void) {
+    if (recorded) {
+        soft_data = (uint8_t *)recorded;
+        soft_len  = recorded_len;
+    } else {
+        Synth_Soft();
+    }
+
+    soft_off = 0;
+
+    Init_Correlator_Tables();
+    Correlator_Init(&corr, (uint64_t)0xfca2b63db00d9794);
+
+    return true;
+}
+
+/*****************************************************************************/
+
+/* Soft_Frame()
+ *
+ * Returns the next frame's worth of soft symbols
+ */
+static uint8_t *Soft_Frame(void) {
+    if (soft_off + SOFT_FRAME_LEN > soft_len)
+        soft_off = 0;
+
+    uint8_t *frame = &soft_data[soft_off];
+    soft_off += SOFT_FRAME_LEN;
+
+    return frame;
+}
+
+/*****************************************************************************/
+
+static void Soft_Deinit(void) {
+    if (!recorded)
+        free_ptr((void **)&soft_data);
+
+    soft_data = NULL;
+}
+
+/*****************************************************************************/
+
+static uint64_t Correlate_Run(void) {
+    Corr_Correlate(&corr, Soft_Frame(), SOFT_FRAME_LEN);
+
+    return 1;
+}
+
+/*****************************************************************************/
+
+static bool Viterbi_Init(void) {
+    Soft_Init();
+
+    mem_alloc((void **)&viterbi, sizeof(viterbi27_rec_t));
+    Mk_Viterbi27(viterbi);
+
+    return true;
+}
+
+/*****************************************************************************/
+
+/* Viterbi_Impl_Init()
+ *
+ * Sets up the Viterbi decoder with the given add-compare-select step,
+ * or skips the kernel if the CPU does not support it
+ */
+static bool Viterbi_Impl_Init(vit_impl_t impl) {
+    Viterbi_Init();
+
+    if (!Vit_Set_Impl(viterbi, impl)) {
+        Viterbi_Deinit();
+        return false;
+    }
+
+    return true;
+}
+
+/*****************************************************************************/
+
+static bool Viterbi_Scalar_Init(void) {
+    return Viterbi_Impl_Init(VIT_IMPL_SCALAR);
+}
+
+/*****************************************************************************/
+
+static bool Viterbi_SSE2_Init(void) {
+    return Viterbi_Impl_Init(VIT_IMPL_SSE2);
+}
+
+/*****************************************************************************/
+
+static bool Viterbi_AVX2_Init(void) {
+    return Viterbi_Impl_Init(VIT_IMPL_AVX2);
+}
+
+/*****************************************************************************/
+
+static uint64_t Viterbi_Run(void) {
+    Vit_Decode(viterbi, Soft_Frame(), hard_frame);
+
+    return 1;
+}
+
+/*****************************************************************************/
+
+static void Viterbi_Deinit(void) {
+    free_ptr((void **)&viterbi);
+    Soft_Deinit();
+}
+
+/*****************************************************************************/
+
+/* Ecc_Reset()
+ *
+ * Injects correctable byte errors into all-zero codewords,
+ * which are valid ones, to exercise the complete decoder
+ */
+static void Ecc_Reset(void) {
+    for (int i = 0; i < RS_INTERLEAVE; i++) {
+        memset(rs_blocks[i], 0, RS_BLOCK_LEN);
+
+        for (int j = 0; j < RS_ERRORS; j++)
+            rs_blocks[i][Bench_Random() % RS_BLOCK_LEN] =
+                (uint8_t)(Bench_Random() | 1);
+    }
+}
+
+/*****************************************************************************/
+
+static uint64_t Ecc_Run(void) {
+    for (int i = 0; i < RS_INTERLEAVE; i++)
+        if (!Ecc_Decode(rs_blocks[i], 0))
+            Show_Message("Failed to correct codeword", "red");
+
+    return 1;
+}
+
+/*****************************************************************************/
+
+/* Ecc_Frame_Reset()
+ *
+ * As Ecc_Reset(), but the codewords are interleaved as in a frame
+ */
+static void Ecc_Frame_Reset(void) {
+    memset(rs_frame, 0, sizeof(rs_frame));
+
+    for (int i = 0; i < RS_INTERLEAVE; i++)
+        for (int j = 0; j < RS_ERRORS; j++)
+            rs_frame[(Bench_Random() % RS_BLOCK_LEN) * RS_INTERLEAVE + i] =
+                (uint8_t)(Bench_Random() | 1);
+}
+
+/*****************************************************************************/
+
+/* Ecc_Clean_Reset()
+ *
+ * A frame free of errors, the usual case of a good signal
+ */
+static void Ecc_Clean_Reset(void) {
+    memset(rs_frame, 0, sizeof(rs_frame));
+}
+
+/*****************************************************************************/
+
+static uint64_t Ecc_Frame_Run(void) {
+    bool ok[RS_INTERLEAVE];
+
+    if (!Ecc_Decode_Interleaved(rs_frame, ok))
+        Show_Message("Failed to correct frame", "red");
+
+    return 1;
+}
+
+/*****************************************************************************/
+
+static bool Decode_Init(void) {
+    Soft_Init();
+    memset(&images, 0, sizeof(images));
+
+    return true;
+}
+
+/*****************************************************************************/
+
+static void Decode_Reset(void) {
+    medet_params_t params = {
+        .apid = { 64, 65, 66 },
+        .invert_palette = { 0, 0, 0 }
+    };
+
+    Medet_Deinit(decoder);
+    decoder = Medet_Init(&params, &images);
+}
+
+/*****************************************************************************/
+
+/* Decode_Run()
+ *
+ * Decodes all soft symbols the way the demodulator feeds
+ * the decoder, a window of 3 frames advanced by one frame
+ */
+static uint64_t Decode_Run(void) {
+    uint64_t frames = 0;
+    size_t off;
+
+    for (off = 0; off + 3 * SOFT_FRAME_LEN <= soft_len;
+            off += SOFT_FRAME_LEN) {
+        Decode_Image(decoder, &soft_data[off], SOFT_FRAME_LEN);
+        frames++;
+    }
+
+    return frames;
+}
+
+/*****************************************************************************/
+
+static void Decode_Deinit(void) {
+    char mesg[MESG_SIZE];
+
+    snprintf(mesg, sizeof(mesg), "decode_image: %d of %d frames OK",
+            decoder->ok_cnt, decoder->total_cnt - 1);
+    fprintf(stderr, "glrpt_bench: %s\n", mesg);
+
+    Medet_Deinit(decoder);
+    decoder = NULL;
+    Channel_Images_Reset(&images);
+    Soft_Deinit();
+}
+
+/*****************************************************************************/
+
+static bool Idct_Init(void) {
+    mem_alloc((void **)&dct_in,  IDCT_BLOCKS * 64 * sizeof(double));
+    mem_alloc((void **)&dct_out, IDCT_BLOCKS * 64 * sizeof(double));
+
+    /* Dequantized coefficients, larger at low frequencies */
+    for (int i = 0; i < IDCT_BLOCKS * 64; i++)
+        dct_in[i] = (double)((int)(Bench_Random() % 256) - 128) /
+            (double)(1 + i % 64);
+
+    return true;
+}
+
+/*****************************************************************************/
+
+static uint64_t Idct_Run(void) {
+    for (int i = 0; i < IDCT_BLOCKS; i++)
+        Flt_Idct_8x8(&dct_out[i * 64], &dct_in[i * 64]);
+
+    return IDCT_BLOCKS;
+}
+
+/*****************************************************************************/
+
+static void Idct_Deinit(void) {
+    free_ptr((void **)&dct_in);
+    free_ptr((void **)&dct_out);
+}
+
+/*****************************************************************************/
+
+/* Idct_Impl_Init()
+ *
+ * Sets up blocks of dequantized coefficients for the given IDCT and
+ * their pixels by the double precision one, to check its accuracy
+ * against. Typical blocks come first, then full range 16 bit ones
+ * saturated as the decoder does, then ones of all coefficients at
+ * the limit with the signs that add up at each pixel, the worst
+ * case. Skips the kernel if the CPU does not support the IDCT
+ */
+static bool Idct_Impl_Init(idct_impl_t impl) {
+    idct = Idct_Select(impl);
+    if (!idct)
+        return false;
+
+    mem_alloc((void **)&idct_blk, IDCT_BLOCKS * 64 * sizeof(int16_t));
+    mem_alloc((void **)&idct_pix, IDCT_BLOCKS * 64);
+    mem_alloc((void **)&idct_ref, IDCT_BLOCKS * 64);
+
+    /* Full range DC, smaller AC coefficients at higher frequencies */
+    for (int i = 0; i < IDCT_TYPICAL * 64; i++) {
+        int amp = 1024 / (1 + (i % 64) / 2);
+
+        idct_blk[i] = (int16_t)((int)(Bench_Random() % (2 * amp + 1)) - amp);
+    }
+
+    /* Corrupt data, any 16 bit value saturated by Dequantize() */
+    for (int i = IDCT_TYPICAL * 64; i < (IDCT_BLOCKS - 128) * 64; i++) {
+        int val = (int16_t)Bench_Random();
+
+        if (val > IDCT_COEF_MAX)
+            val = IDCT_COEF_MAX;
+        if (val < IDCT_COEF_MIN)
+            val = IDCT_COEF_MIN;
+        idct_blk[i] = (int16_t)val;
+    }
+
+    /* Largest sums at each pixel, of either sign */
+    for (int b = 0; b < 128; b++) {
+        int16_t *blk = &idct_blk[(IDCT_BLOCKS - 128 + b) * 64];
+        uint32_t pix = (uint32_t)b / 2;
+
+        for (int i = 0; i < 64; i++) {
+            double basis = Dct_Basis(pix, i % 8) * Dct_Basis(pix / 8, i / 8);
+
+            blk[i] = ((basis < 0.0) == (b % 2 == 0)) ?
+                IDCT_COEF_MIN : IDCT_COEF_MAX;
+        }
+    }
+
+    Idct_Select(IDCT_IMPL_FLOAT)(
+            idct_ref, IDCT_BLOCKS * 8, idct_blk, IDCT_BLOCKS, false);
+
+    return true;
+}
+
+/*****************************************************************************/
+
+static bool Idct_Auto_Init(void) {
+    return Idct_Impl_Init(IDCT_IMPL_AUTO);
+}
+
+/*****************************************************************************/
+
+static bool Idct_Float_Init(void) {
+    return Idct_Impl_Init(IDCT_IMPL_FLOAT);
+}
+
+/*****************************************************************************/
+
+static bool Idct_Scalar_Init(void) {
+    return Idct_Impl_Init(IDCT_IMPL_SCALAR);
+}
+
+/*****************************************************************************/
+
+static bool Idct_SSE2_Init(void) {
+    return Idct_Impl_Init(IDCT_IMPL_SSE2);
+}
+
+/*****************************************************************************/
+
+static bool Idct_AVX2_Init(void) {
+    return Idct_Impl_Init(IDCT_IMPL_AVX2);
+}
+
+/*****************************************************************************/
+
+static uint64_t Idct_Impl_Run(void) {
+    idct(idct_pix, IDCT_BLOCKS * 8, idct_blk, IDCT_BLOCKS, false);
+
+    return IDCT_BLOCKS;
+}
+
+/*****************************************************************************/
+
+/* Idct_Impl_Deinit()
+ *
+ * Reports the error of the IDCT against the double precision
+ * one, failing the bench if any pixel is off by more than 1
+ */
+static void Idct_Impl_Deinit(void) {
+    int err, max_err = 0, sum_err = 0, bias = 0;
+
+    for (int i = 0; i < IDCT_BLOCKS * 64; i++) {
+        err = (int)idct_pix[i] - (int)idct_ref[i];
+        bias += err;
+        if (err < 0)
+            err = -err;
+        sum_err += err;
+        if (err > max_err)
+            max_err = err;
+    }
+
+    fprintf(stderr, "glrpt_bench: idct error against float: "
+            "max %d, mean %.5f, bias %.5f\n", max_err,
+            (double)sum_err / (IDCT_BLOCKS * 64),
+            (double)bias / (IDCT_BLOCKS * 64));
+
+    if (max_err > IDCT_MAX_ERROR) {
+        fprintf(stderr, "glrpt_bench: %s\n", "idct accuracy check failed");
+        bench_failed = true;
+    }
+
+    free_ptr((void **)&idct_blk);
+    free_ptr((void **)&idct_pix);
+    free_ptr((void **)&idct_ref);
+}
+
+/*****************************************************************************/
+
+/* Mcu_Init()
+ *
+ * Sets up a decoder context and JPEG compresses a line of image
+ * packets of a noisy test pattern, roughly like Meteor imagery
+ */
+static bool Mcu_Init(void) {
+    medet_params_t params = {
+        .apid = { 64, 65, 66 },
+        .invert_palette = { 0, 0, 0 }
+    };
+
+    uint8_t strip[SYNTH_STRIP_LINES * METEOR_IMAGE_WIDTH];
+
+    memset(&images, 0, sizeof(images));
+    decoder = Medet_Init(&params, &images);
+
+    for (uint32_t y = 0; y < SYNTH_STRIP_LINES; y++)
+        for (uint32_t x = 0; x < METEOR_IMAGE_WIDTH; x++)
+            strip[y * METEOR_IMAGE_WIDTH + x] = (uint8_t)dClamp(
+                    Synth_Pattern(GREEN, x, y) +
+                    (double)(Bench_Random() & 0x1F) - 16.0, 0.0, 255.0);
+
+    mem_alloc((void **)&mcu_packets, MCU_PACKETS * MCU_PACKET_LEN);
+
+    /* The end of each packet is left zero for the bit reader */
+    for (int p = 0; p < MCU_PACKETS; p++)
+        if (!Synth_Encode_Mcus(strip, (p % MCU_PER_PACKET) * MCU_PER_PACKET,
+                    MCU_QUALITY, &mcu_packets[p * MCU_PACKET_LEN],
+                    MCU_PACKET_LEN / 2)) {
+            fprintf(stderr, "glrpt_bench: %s\n", "image packet too large");
+            return false;
+        }
+
+    return true;
+}
+
+/*****************************************************************************/
+
+/* Mcu_Run()
+ *
+ * Decodes a line of packets into the top strip of the image,
+ * the packet count is kept constant so the image does not grow
+ */
+static uint64_t Mcu_Run(void) {
+    for (int p = 0; p < MCU_PACKETS; p++)
+        Mj_Dec_Mcus(decoder, &mcu_packets[p * MCU_PACKET_LEN],
+                MCU_PACKET_LEN, 64, 0,
+                (p % MCU_PER_PACKET) * MCU_PER_PACKET, MCU_QUALITY);
+    Medet_Flush(decoder);
+
+    return MCU_PACKETS * MCU_PER_PACKET;
+}
+
+/*****************************************************************************/
+
+static void Mcu_Deinit(void) {
+    Medet_Deinit(decoder);
+    decoder = NULL;
+    Channel_Images_Reset(&images);
+    free_ptr((void **)&mcu_packets);
+}
+
+/*****************************************************************************/
+
+/* Dct_Basis()
+ *
+ * Value at pixel p of an MCU of the DCT basis function of frequency u
+ */
+static double Dct_Basis(uint32_t p, int u) {
+    return cos((double)(2 * (p % 8) + 1) * u * M_PI / 16.0);
+}
+
+/*****************************************************************************/
+
+/* Jfif_Init()
+ *
+ * Decodes a line of image packets of fine detail, stored
+ * as received to be saved at JFIF_QUALITY, in a temp file
+ */
+static bool Jfif_Init(void) {
+    medet_params_t params = {
+        .apid = { 64, 65, 66 },
+        .invert_palette = { 0, 0, 0 },
+        .jfif = &jfif_store
+    };
+
+    uint8_t strip[SYNTH_STRIP_LINES * METEOR_IMAGE_WIDTH];
+    uint8_t packet[MCU_PACKET_LEN];
+    int fd;
+
+    fd = mkstemp(jfif_fname);
+    if (fd < 0) {
+        perror("glrpt_bench: mkstemp");
+        return false;
+    }
+    close(fd);
+
+    /* Coefficients (5, 6) and (6, 5) of each MCU, whose entries
+     * of the quantization table are the ones over 8 bits */
+    for (uint32_t y = 0; y < SYNTH_STRIP_LINES; y++)
+        for (uint32_t x = 0; x < METEOR_IMAGE_WIDTH; x++)
+            strip[y * METEOR_IMAGE_WIDTH + x] = (uint8_t)dClamp(128.0 +
+                    64.0 * (Dct_Basis(x, 5) * Dct_Basis(y, 6) +
+                        Dct_Basis(x, 6) * Dct_Basis(y, 5)), 0.0, 255.0);
+
+    memset(&images, 0, sizeof(images));
+    memset(&jfif_store, 0, sizeof(jfif_store));
+    decoder = Medet_Init(&params, &images);
+
+    for (int mcu_id = 0; mcu_id < METEOR_IMAGE_WIDTH / 8;
+            mcu_id += MCU_PER_PACKET) {
+        memset(packet, 0, sizeof(packet));
+        if (!Synth_Encode_Mcus(strip, mcu_id, JFIF_QUALITY,
+                    packet, MCU_PACKET_LEN / 2)) {
+            fprintf(stderr, "glrpt_bench: %s\n", "image packet too large");
+            return false;
+        }
+        Mj_Dec_Mcus(decoder, packet, MCU_PACKET_LEN,
+                64, 0, mcu_id, JFIF_QUALITY);
+    }
+    Medet_Flush(decoder);
+
+    return true;
+}
+
+/*****************************************************************************/
+
+static uint64_t Jfif_Run(void) {
+    if (!Jfif_Write(&jfif_store, jfif_fname))
+        Show_Message("JPEG file not written", "red");
+
+    return (uint64_t)jfif_store.lines * (METEOR_IMAGE_WIDTH / 8 / MCU_PER_PACKET);
+}
+
+/*****************************************************************************/
+
+/* Jfif_Deinit()
+ *
+ * Decodes the file saved back and reports its error
+ * against the image decoded, then removes it
+ */
+static void Jfif_Deinit(void) {
+    uint8_t *jpeg = NULL, *pixels = NULL;
+    const uint8_t *row;
+    int width, height, subsamp, colorspace, err, max_err = -1;
+    long len, sum_err = 0;
+    tjhandle tj;
+    FILE *fp;
+
+    fp = fopen(jfif_fname, "rb");
+    if (fp && (fseek(fp, 0, SEEK_END) == 0) && ((len = ftell(fp)) > 0)) {
+        mem_alloc((void **)&jpeg, (size_t)len);
+        rewind(fp);
+        if (fread(jpeg, 1, (size_t)len, fp) != (size_t)len)
+            len = 0;
+
+        tj = tjInitDecompress();
+        if (tj && (len > 0) &&
+                (tjDecompressHeader3(tj, jpeg, (unsigned long)len,
+                    &width, &height, &subsamp, &colorspace) == 0) &&
+                (width == METEOR_IMAGE_WIDTH) &&
+                (height == SYNTH_STRIP_LINES)) {
+            mem_alloc((void **)&pixels, (size_t)width * (size_t)height);
+            if (tjDecompress2(tj, jpeg, (unsigned long)len, pixels,
+                        width, 0, height, TJPF_GRAY, TJFLAG_ACCURATEDCT) == 0) {
+                max_err = 0;
+                for (int y = 0; y < height; y++) {
+                    row = Apid_Image_Row(&images, 64, (uint32_t)y);
+                    for (int x = 0; x < width; x++) {
+                        err = abs((int)pixels[y * width + x] - (int)row[x]);
+                        sum_err += err;
+                        if (err > max_err)
+                            max_err = err;
+                    }
+                }
+            }
+        }
+        if (tj)
+            tjDestroy(tj);
+    }
+    if (fp)
+        fclose(fp);
+
+    if (max_err < 0)
+        Show_Message("JPEG file saved could not be decoded", "red");
+    else
+        fprintf(stderr, "glrpt_bench: jfif error against decoder: "
+                "max %d, mean %.5f\n", max_err, (double)sum_err /
+                (METEOR_IMAGE_WIDTH * SYNTH_STRIP_LINES));
+
+    remove(jfif_fname);
+    strcpy(jfif_fname, "/tmp/glrpt_bench_XXXXXX");
+    free_ptr((void **)&pixels);
+    free_ptr((void **)&jpeg);
+    Medet_Deinit(decoder);
+    decoder = NULL;
+    Jfif_Store_Reset(&jfif_store);
+    Channel_Images_Reset(&images);
+}
+
+/*****************************************************************************/
+
+/* Image_Init()
+ *
+ * Makes a synthetic channel image, smooth
+ * gradients and noise like a cloudy scene
+ */
+static bool Image_Init(void) {
+    size_t size = (size_t)METEOR_IMAGE_WIDTH * IMAGE_LINES;
+
+    mem_alloc((void **)&image_orig, size);
+
+    for (uint32_t y = 0; y < IMAGE_LINES; y++)
+        for (uint32_t x = 0; x < METEOR_IMAGE_WIDTH; x++)
+            image_orig[y * METEOR_IMAGE_WIDTH + x] = (uint8_t)
+                ((x / 8 + y / 4 + (Bench_Random() & 0x1F)) & 0xFF);
+
+    memset(&images, 0, sizeof(images));
+
+    return true;
+}
+
+/*****************************************************************************/
+
+/* Image_Reset()
+ *
+ * Restores the channel images, which the kernels modify in place
+ */
+static void Image_Reset(void) {
+    images.width  = METEOR_IMAGE_WIDTH;
+    images.height = IMAGE_LINES;
+    images.size   = (size_t)METEOR_IMAGE_WIDTH * IMAGE_LINES;
+
+    /* Kernels take the images in one piece, as when saved */
+    images.exported = true;
+
+    for (int i = 0; i < CHANNEL_IMAGE_NUM; i++) {
+        mem_realloc((void **)&(images.image[i]), images.size);
+        memcpy(images.image[i], image_orig, images.size);
+    }
+}
+
+/*****************************************************************************/
+
+static uint64_t Clahe_Run(void) {
+    if (!CLAHE(images.image[0], NULL, images.width, images.height,
+                NORM_BLACK, MAX_WHITE, REGIONS_X, REGIONS_Y,
+                NUM_GREYBINS, CLIP_LIMIT))
+        Show_Message("C.L.A.H.E. failed", "red");
+
+    return images.size;
+}
+
+/*****************************************************************************/
+
+/* Gaps_Reset()
+ *
+ * Restores the channel images and marks a packet of
+ * MCUs in every GAPS_PACKETS as lost in their block maps
+ */
+static void Gaps_Reset(void) {
+    size_t map_size = (size_t)METEOR_IMAGE_WIDTH * IMAGE_LINES / BLOCK_MAP_LINES;
+    uint32_t mcu, num_mcus = (uint32_t)(map_size / 8);
+
+    Image_Reset();
+
+    for (int i = 0; i < CHANNEL_IMAGE_NUM; i++) {
+        mem_realloc((void **)&(images.block_map[i]), map_size);
+        memset(images.block_map[i], BLOCK_RECEIVED, map_size);
+
+        for (mcu = 0; mcu < num_mcus; mcu += MCU_PER_PACKET)
+            if ((Bench_Random() % GAPS_PACKETS) == 0)
+                memset(images.block_map[i] + (size_t)mcu * 8, BLOCK_MISSING,
+                        MCU_PER_PACKET * 8);
+    }
+}
+
+/*****************************************************************************/
+
+static uint64_t Fill_Gaps_Run(void) {
+    Fill_Image_Gaps(&images);
+
+    return images.size * CHANNEL_IMAGE_NUM;
+}
+
+/*****************************************************************************/
+
+static uint64_t Rectify_W2RG_Run(void) {
+    Rectify_Images(&images, R_W2RG);
+
+    return (uint64_t)METEOR_IMAGE_WIDTH * IMAGE_LINES * CHANNEL_IMAGE_NUM;
+}
+
+/*****************************************************************************/
+
+static uint64_t Rectify_5B4AZ_Run(void) {
+    Rectify_Images(&images, R_5B4AZ);
+
+    return (uint64_t)METEOR_IMAGE_WIDTH * IMAGE_LINES * CHANNEL_IMAGE_NUM;
+}
+
+/*****************************************************************************/
+
+static void Image_Deinit(void) {
+    Channel_Images_Reset(&images);
+    free_ptr((void **)&image_orig);
+}
+
+/*****************************************************************************/
+
+/* Show_Message()
+ *
+ * Only errors are printed, to keep the output machine readable
+ */
+void Show_Message(const char *mesg, const char *attr) {
+    if (strcmp(attr, "red") == 0)
+        fprintf(stderr, "glrpt_bench: error: %s\n", mesg);
+}
+
+/*****************************************************************************/
+
+/* Error_Dialog()
+ *
+ * Errors are already reported by Show_Message(), nothing to do here
+ */
+void Error_Dialog(void) {
+}
@@ -0,0 +1,358 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * Headless frontend of glrpt. Runs the same SDR -> demodulator ->
+ * decoder -> image pipeline as the GUI for a given time, without
+ * any display, and saves the images on exit. Intended for
+ * unattended ground stations, e.g. started by cron or systemd.
+ */
+
+/*****************************************************************************/
+
+#include "../common/common.h"
+#include "../common/receiver.h"
+#include "../common/shared.h"
+#include "../common/telemetry.h"
+#include "../demodulator/demod.h"
+#include "../glrpt/rc_config.h"
+#include "../glrpt/utils.h"
+#include "../sdr/SoapySDR.h"
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*****************************************************************************/
+
+/* Polling interval (msec) while waiting for the SDR to close */
+#define CLOSE_POLL_INTERVAL 50
+
+/* Number of polls before giving up on the SDR */
+#define CLOSE_POLL_MAX      100
+
+/* Interval (sec) between decoder status reports */
+#define STATUS_INTERVAL     30
+
+/*****************************************************************************/
+
+static void Usage(void);
+static const char *Find_Config(const char *name);
+static bool Start_Reception(void);
+static void Wait_Device_Closed(void);
+static void Show_Status(void);
+static void sig_handler(int signal);
+
+/*****************************************************************************/
+
+/* Set by signal handlers to stop reception */
+static volatile sig_atomic_t stop_request = 0;
+
+/*****************************************************************************/
+
+/* main()
+ *
+ * Headless program initialization and main loop
+ */
+int main(int argc, char *argv[]) {
+    const char *cfg_name = NULL, *cfg_path;
+    long duration = 0;
+
+    /* Process command line options */
+    int option;
+
+    while ((option = getopt(argc, argv, "c:t:hv")) != -1)
+        switch (option) {
+            case 'c': /* Satellite config file or name */
+                cfg_name = optarg;
+
+                break;
+
+            case 't': /* Decode duration (sec) */
+                duration = strtol(optarg, NULL, 10);
+
+                if ((duration <= 0) || (duration > 86400)) {
+                    fprintf(stderr, "glrpt-cli: %s\n",
+                            "invalid decode duration");
+                    exit(-1);
+                }
+
+                break;
+
+            case 'h': /* Print help and exit */
+                Usage();
+                exit(0);
+
+                break;
+
+            case 'v': /* Print version info and exit */
+                puts(PACKAGE_STRING);
+                exit(0);
+
+                break;
+
+            default: /* Print help and exit */
+                Usage();
+                exit(-1);
+
+                break;
+        }
+
+    /* Find and prepare program directories */
+    if (!prepareDirectories()) {
+        fprintf(stderr, "glrpt-cli: %s\n",
+                "error during preparing directories");
+        exit(-1);
+    }
+
+    /* Find and read the satellite's configuration */
+    if (!findConfigFiles() && !cfg_name) {
+        fprintf(stderr, "glrpt-cli: %s\n", "can't find config files!");
+        exit(-1);
+    }
+
+    cfg_path = Find_Config(cfg_name);
+    if (!cfg_path) {
+        fprintf(stderr, "glrpt-cli: can't find config \"%s\"\n", cfg_name);
+        exit(-1);
+    }
+
+    rc_data.decode_timer = 0;
+    if (!readConfig(cfg_path))
+        exit(-1);
+
+    if (duration > 0)
+        rc_data.decode_timer = (uint32_t)duration;
+
+    char mesg[MESG_SIZE];
+    snprintf(mesg, sizeof(mesg), "%s: decoding %s for %u sec",
+            PACKAGE_STRING, rc_data.sat_name, rc_data.decode_timer);
+    Show_Message(mesg, "bold");
+
+    if (!Start_Reception())
+        exit(-1);
+
+    /* Register function to handle signals, from
+     * now on reception is stopped and images saved */
+    struct sigaction sa_new;
+
+    sa_new.sa_handler = sig_handler;
+    sigemptyset(&sa_new.sa_mask);
+    sa_new.sa_flags = 0;
+
+    sigaction(SIGINT,  &sa_new, NULL);
+    sigaction(SIGTERM, &sa_new, NULL);
+    sigaction(SIGALRM, &sa_new, NULL);
+
+    /* Stop by timer or on user's request */
+    alarm(rc_data.decode_timer);
+
+    /* Run the demodulator and decoder until stopped.
+     * IDOQPSK needs to stop itself at a proper point */
+    bool stopping = false;
+    time_t status_time = time(NULL) + STATUS_INTERVAL;
+
+    while (true) {
+        if (time(NULL) >= status_time) {
+            status_time += STATUS_INTERVAL;
+            Show_Status();
+        }
+
+        if (stop_request && !stopping) {
+            stopping = true;
+
+            if (rc_data.psk_mode == IDOQPSK)
+                SetFlag(STATUS_IDOQPSK_STOP);
+            else
+                ClearFlag(STATUS_RECEIVING);
+        }
+
+        if (!Demodulator_Run())
+            break;
+    }
+
+    /* Images are saved by the demodulator on stop */
+    Wait_Device_Closed();
+    Cleanup();
+
+    return 0;
+}
+
+/*****************************************************************************/
+
+/* Usage()
+ *
+ * Prints usage information
+ */
+static void Usage(void) {
+    fprintf(stderr, "%s\n",
+            "Usage: glrpt-cli [-hv] [-c config] [-t seconds]");
+
+    fprintf(stderr, "%s\n",
+            "       -c: Satellite config file, or its name in the config"
+            " directories. Default is the first config found");
+
+    fprintf(stderr, "%s\n",
+            "       -t: Decode duration (sec). Default is set in config");
+
+    fprintf(stderr, "%s\n",
+            "       -h: Print this usage information and exit");
+
+    fprintf(stderr, "%s\n",
+            "       -v: Print version number and exit");
+}
+
+/*****************************************************************************/
+
+/* Find_Config()
+ *
+ * Returns the path to a config file given either as
+ * a path or by name, or the first config found if NULL
+ */
+static const char *Find_Config(const char *name) {
+    if (!name)
+        return (glrpt_cfg_num > 0) ? glrpt_cfg_list[0].path : NULL;
+
+    if (access(name, R_OK) == 0)
+        return name;
+
+    /* User's configs take precedence over system-wide ones */
+    for (int i = glrpt_cfg_num - 1; i >= 0; i--)
+        if (strcmp(glrpt_cfg_list[i].name, name) == 0)
+            return glrpt_cfg_list[i].path;
+
+    return NULL;
+}
+
+/*****************************************************************************/
+
+/* Start_Reception()
+ *
+ * Initializes the SDR, demodulator and decoder and starts streaming
+ */
+static bool Start_Reception(void) {
+    /* Initialize SoapySDR device and demodulator object */
+    if (!Receiver_Init()) {
+        Show_Message("Failed to Initialize SoapySDR", "red");
+        return false;
+    }
+
+    /* Init image decoder */
+    Receiver_Decoder_Start();
+    SetFlag(STATUS_DECODING);
+
+    /* Activate the SoapySDR Receive Stream */
+    SetFlag(STATUS_RECEIVING);
+    if (!SoapySDR_Activate_Stream()) {
+        ClearFlag(STATUS_RECEIVING);
+        ClearFlag(STATUS_DECODING);
+        Receiver_Decoder_Stop();
+        return false;
+    }
+
+    char mesg[MESG_SIZE];
+    snprintf(mesg, sizeof(mesg),
+            "Decoding from Device \"%s\"", SoapySDR_Driver());
+    Show_Message(mesg, "green");
+
+    return true;
+}
+
+/*****************************************************************************/
+
+/* Wait_Device_Closed()
+ *
+ * Waits for the streaming thread to close the SDR device
+ */
+static void Wait_Device_Closed(void) {
+    struct timespec ts = { 0, CLOSE_POLL_INTERVAL * 1000000L };
+
+    for (int i = 0; i < CLOSE_POLL_MAX; i++) {
+        if (isFlagClear(STATUS_STREAMING) &&
+                isFlagClear(STATUS_SOAPYSDR_INIT))
+            return;
+
+        nanosleep(&ts, NULL);
+    }
+
+    Show_Message("Timed out waiting for SDR device to close", "red");
+}
+
+/*****************************************************************************/
+
+/* Show_Status()
+ *
+ * Prints the live decoder stats that the GUI shows in its status frame
+ */
+static void Show_Status(void) {
+    telemetry_t snap;
+    char mesg[MESG_SIZE];
+
+    Telemetry_Snapshot(&snap);
+
+    snprintf(mesg, sizeof(mesg),
+            "Packets %d:%d%%  Image MCUs received %d:%d:%d%%",
+            snap.decoder.ok_cnt, snap.decoder.percent,
+            snap.decoder.mcu_percent[RED], snap.decoder.mcu_percent[GREEN],
+            snap.decoder.mcu_percent[BLUE]);
+    Show_Message(mesg, "black");
+}
+
+/*****************************************************************************/
+
+/* Show_Message()
+ *
+ * Prints a message string to the console, tagged with the local time
+ */
+void Show_Message(const char *mesg, const char *attr) {
+    char tstamp[16];
+    time_t now = time(NULL);
+    struct tm tm_now;
+
+    localtime_r(&now, &tm_now);
+    strftime(tstamp, sizeof(tstamp), "%H:%M:%S", &tm_now);
+
+    if (strcmp(attr, "red") == 0)
+        fprintf(stderr, "%s  error: %s\n", tstamp, mesg);
+    else
+        fprintf(stderr, "%s  %s\n", tstamp, mesg);
+}
+
+/*****************************************************************************/
+
+/* Error_Dialog()
+ *
+ * Errors are already reported by Show_Message(), nothing to do here
+ */
+void Error_Dialog(void) {
+}
+
+/*****************************************************************************/
+
+/* sig_handler()
+ *
+ * Signal action handler function. Requests a stop
+ * of reception, the images are saved on the way out
+ */
+static void sig_handler(int signal) {
+    stop_request = 1;
+
+    /* Unblock the demodulator if the SDR has stalled */
+    SoapySDR_Wakeup();
+}
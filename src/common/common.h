@@ -52,10 +52,16 @@
 #define IMAGE_SAVE_PPGM         0x01000000 /* Save channel image as PGM/PPM   */
 #define TUNER_GAIN_AUTO         0x02000000 /* Set tuner gain to auto mode     */
 #define AUTO_DETECT_SDR         0x04000000 /* Auto detect SDR device & driver */
+#define IMAGE_SAVE_ORIG         0x08000000 /* Save JPEG data as received      */
+#define IMAGE_FILL_GAPS         0x10000000 /* Fill in MCUs lost in images     */
 
 /* Number of APID image channels */
 #define CHANNEL_IMAGE_NUM   3
 
+/* Image APIDs Meteor may transmit, from APID_FIRST on */
+#define APID_FIRST  64
+#define APID_NUM    6
+
 /* Indices for normalization range black and white values */
 #define NORM_RANGE_BLACK    0
 #define NORM_RANGE_WHITE    1
@@ -67,6 +73,9 @@
 /* Size of char arrays (strings) for text messages */
 #define MESG_SIZE   128
 
+/* Length of soft symbol frames passed from demodulator to decoder */
+#define SOFT_FRAME_LEN  16384
+
 /* Neoklis Kyriazis' addition, width (in pixels) of image
  * METEOR_IMAGE_WIDTH = MCU_PER_LINE * 8; MCU_PER_LINE = 196
  */
@@ -0,0 +1,633 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * Receiver glue of the frontends. Sets up the SDR, demodulator and
+ * image decoder libraries from the satellite's config and the user's
+ * options, runs the signal path and publishes its status telemetry.
+ * The decoded channel images are owned here, so they outlive the
+ * decoder until saved or redisplayed. The image decoder runs in the
+ * worker thread of a frames queue fed by the demodulator, the images
+ * must be locked while it runs.
+ */
+
+/*****************************************************************************/
+
+#include "receiver.h"
+
+#include "../common/common.h"
+#include "../common/shared.h"
+#include "../common/telemetry.h"
+#include "../decoder/medet.h"
+#include "../demodulator/demod.h"
+#include "../demodulator/frame_queue.h"
+#include "../glrpt/utils.h"
+#include "../image/clahe.h"
+#include "../image/image.h"
+#include "../image/rectify_meteor.h"
+#include "../sdr/SoapySDR.h"
+#include "../sdr/spectrum.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/*****************************************************************************/
+
+static bool Receiver_Sdr_Running(void);
+static void Receiver_Sdr_State(uint32_t state, bool set);
+static void Receiver_Queue_Frame(int8_t *buffer, void *arg);
+static void Receiver_Frame(int8_t *buffer, void *arg);
+static void Publish_Demod_Telemetry(void);
+static void Publish_Decoder_Telemetry(void);
+static void Save_Images(int type);
+static void Save_Images_Orig(void);
+static void Report_Missing_Mcus(void);
+
+/*****************************************************************************/
+
+static Demod_t *demodulator = NULL;
+static medet_t *decoder = NULL;
+
+/* Soft frames on their way to the decoder thread */
+static frame_queue_t *frame_queue = NULL;
+
+/* Decoded channel images of the current pass */
+static channel_images_t images = {
+  .width = METEOR_IMAGE_WIDTH
+};
+static pthread_mutex_t images_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Image packets of the current pass as received, they
+ * outlive the decoder till the images are saved */
+static jfif_store_t jfif[CHANNEL_IMAGE_NUM];
+
+/*****************************************************************************/
+
+/* Receiver_Init()
+ *
+ * Initializes the SDR device and the Demodulator
+ */
+bool Receiver_Init(void) {
+  sdr_params_t sdr;
+  demod_params_t demod;
+
+  /* Initialize SoapySDR device */
+  memset( &sdr, 0, sizeof(sdr) );
+  Strlcpy( sdr.device_driver, rc_data.device_driver,
+      sizeof(sdr.device_driver) );
+  sdr.device_index    = rc_data.device_index;
+  sdr.auto_detect     = isFlagSet( AUTO_DETECT_SDR );
+  sdr.center_freq     = rc_data.sdr_center_freq;
+  sdr.freq_correction = rc_data.freq_correction;
+  sdr.symbol_rate     = rc_data.symbol_rate;
+  sdr.filter_bw       = rc_data.sdr_filter_bw;
+  sdr.gain_auto       = isFlagSet( TUNER_GAIN_AUTO );
+  sdr.tuner_gain      = rc_data.tuner_gain;
+  sdr.running_cb      = Receiver_Sdr_Running;
+  sdr.state_cb        = Receiver_Sdr_State;
+  sdr.closed_cb       = Cleanup;
+
+  if( !SoapySDR_Init(&sdr) )
+    return( false );
+
+  /* Init demodulator object */
+  demod.psk_mode         = rc_data.psk_mode;
+  demod.symbol_rate      = rc_data.symbol_rate;
+  demod.interp_factor    = rc_data.interp_factor;
+  demod.samplerate       = demod_samplerate;
+  demod.costas_bandwidth = rc_data.costas_bandwidth;
+  demod.pll_locked       = rc_data.pll_locked;
+  demod.pll_unlocked     = rc_data.pll_unlocked;
+  demod.rrc_order        = rc_data.rrc_order;
+  demod.rrc_alpha        = rc_data.rrc_alpha;
+
+  Demod_Deinit( demodulator );
+  demodulator = Demod_Init( &demod );
+
+  /* New images are to be processed again */
+  ClearFlag( IMAGES_PROCESSED );
+  ClearFlag( IMAGES_RECTIFIED );
+  images.colorized = false;
+
+  return( true );
+}
+
+/*****************************************************************************/
+
+/* Receiver_Decoder_Start()
+ *
+ * Initializes the Meteor Image Decoder, clearing the images
+ */
+void Receiver_Decoder_Start(void) {
+  medet_params_t params;
+  int idx;
+
+  for( idx = 0; idx < CHANNEL_IMAGE_NUM; idx++ )
+  {
+    params.apid[idx] = rc_data.apid[idx];
+    params.invert_palette[idx] = rc_data.invert_palette[idx];
+  }
+  params.jfif = isFlagSet( IMAGE_SAVE_ORIG ) ? jfif : NULL;
+  params.idct = (idct_impl_t)rc_data.idct_impl;
+
+  Frame_Queue_Deinit( frame_queue );
+  frame_queue = NULL;
+  Medet_Deinit( decoder );
+  for( idx = 0; idx < CHANNEL_IMAGE_NUM; idx++ )
+    Jfif_Store_Reset( &jfif[idx] );
+  decoder = Medet_Init( &params, &images );
+
+  /* Clear decoder status */
+  Telemetry_Reset_Decoder();
+
+  /* Decoder runs in the worker thread of the queue */
+  frame_queue = Frame_Queue_Init( Receiver_Frame, NULL );
+}
+
+/*****************************************************************************/
+
+/* Receiver_Decoder_Stop()
+ *
+ * De-initializes the Meteor Image Decoder once the frames
+ * still queued are decoded, images are kept
+ */
+void Receiver_Decoder_Stop(void) {
+  Frame_Queue_Deinit( frame_queue );
+  frame_queue = NULL;
+  Medet_Deinit( decoder );
+  decoder = NULL;
+}
+
+/*****************************************************************************/
+
+/* Receiver_Sdr_Running()
+ *
+ * Keeps the SDR streaming till reception is stopped
+ */
+static bool Receiver_Sdr_Running(void) {
+  return( isFlagSet(STATUS_RECEIVING) );
+}
+
+/*****************************************************************************/
+
+/* Receiver_Sdr_State()
+ *
+ * Mirrors the state of the SDR device in the status flags
+ */
+static void Receiver_Sdr_State(uint32_t state, bool set) {
+  int flag = 0;
+
+  if( state & SDR_STATE_INIT )      flag |= STATUS_SOAPYSDR_INIT;
+  if( state & SDR_STATE_STREAMING ) flag |= STATUS_STREAMING;
+
+  if( set )
+    SetFlag( flag );
+  else
+    ClearFlag( flag );
+}
+
+/*****************************************************************************/
+
+/* Receiver_Queue_Frame()
+ *
+ * Called by the Demodulator for each soft symbols frame.
+ * Queues it for the decoder when the PLL is locked
+ */
+static void Receiver_Queue_Frame(int8_t *buffer, void *arg) {
+  (void)arg;
+
+  if( !demodulator->costas->locked ||
+      isFlagClear(STATUS_DECODING) ||
+      !frame_queue )
+    return;
+
+  Frame_Queue_Push( buffer, frame_queue );
+}
+
+/*****************************************************************************/
+
+/* Receiver_Frame()
+ *
+ * Called in the decoder thread for each queued soft symbols
+ * frame. Tries to decode LRPT frames, the images are locked
+ */
+static void Receiver_Frame(int8_t *buffer, void *arg) {
+  (void)arg;
+
+  /* Try to decode one or more LRPT frames */
+  pthread_mutex_lock( &images_lock );
+  Decode_Image( decoder, (uint8_t *)buffer, SOFT_FRAME_LEN );
+  pthread_mutex_unlock( &images_lock );
+  Publish_Decoder_Telemetry();
+}
+
+/*****************************************************************************/
+
+/* Publish_Demod_Telemetry()
+ *
+ * Publishes Demodulator status (AGC gain, PLL freq etc)
+ * and soft symbols for the QPSK constellation display
+ */
+static void Publish_Demod_Telemetry(void) {
+  demod_telemetry_t *tlm = Telemetry_Demod();
+
+  /* AGC Gain and Signal Level */
+  tlm->agc_gain_gauge  = Agc_Gain( demodulator, &tlm->agc_gain );
+  tlm->sig_level_gauge = Signal_Level( demodulator, &tlm->sig_level );
+
+  /* Costas PLL Frequency */
+  tlm->pll_freq = Pll_Frequency( demodulator );
+
+  /* Costas PLL Lock Detect Level and lock state */
+  tlm->pll_ave       = demodulator->costas->moving_average;
+  tlm->pll_ave_gauge = Pll_Average( demodulator );
+  tlm->pll_locked    = demodulator->costas->locked;
+
+  memcpy( tlm->qpsk_const, demodulator->out_buffer, sizeof(tlm->qpsk_const) );
+
+  Telemetry_Publish_Demod();
+}
+
+/*****************************************************************************/
+
+/* Publish_Decoder_Telemetry()
+ *
+ * Publishes decoder status (signal quality, frames, onboard time)
+ */
+static void Publish_Decoder_Telemetry(void) {
+  decoder_telemetry_t *tlm = Telemetry_Decoder();
+  int idx, rows;
+
+  tlm->sig_q          = decoder->mtd.sig_q;
+  tlm->sig_qual_gauge = Sig_Quality( decoder );
+  tlm->frame_ok       = decoder->frame_ok;
+  tlm->ok_cnt         = decoder->ok_cnt;
+  tlm->percent        = ( 100 * decoder->ok_cnt ) / decoder->total_cnt;
+
+  tlm->ob_time_valid = decoder->ob_time_valid;
+  tlm->ob_hour       = decoder->ob_hour;
+  tlm->ob_min        = decoder->ob_min;
+  tlm->ob_sec        = decoder->ob_sec;
+
+  memcpy( tlm->image_lines, decoder->image_lines, sizeof(tlm->image_lines) );
+  memcpy( tlm->mcu_ok, decoder->mcu_ok, sizeof(tlm->mcu_ok) );
+  for( idx = 0; idx < CHANNEL_IMAGE_NUM; idx++ )
+  {
+    rows = decoder->image_lines[idx] / 8 + 1;
+    tlm->mcu_percent[idx] = iClamp( (100 * decoder->mcu_ok[idx]) /
+        (rows * (METEOR_IMAGE_WIDTH / 8)), 0, 100 );
+  }
+
+  Telemetry_Publish_Decoder();
+}
+
+/*****************************************************************************/
+
+/* Demodulator_Run()
+ *
+ * Runs the Demodulator functions and supplies
+ * soft symbols to the LRPT decoder functions
+ */
+bool Demodulator_Run(void) {
+  double *samples_i, *samples_q;
+  uint32_t len;
+
+  /* IDOQPSK needs a proper stop, its symbols are
+   * de-interleaved and decoded only at this point */
+  if( isFlagSet(STATUS_IDOQPSK_STOP) )
+  {
+    Demod_Flush( demodulator, Receiver_Queue_Frame, NULL );
+    ClearFlag( STATUS_RECEIVING );
+    ClearFlag( STATUS_IDOQPSK_STOP );
+  }
+
+  /* On user stop action */
+  if( isFlagClear(STATUS_RECEIVING) )
+  {
+    Receiver_Dump_Images();
+    Spectrum_Deinit();
+    Demod_Deinit( demodulator );
+    demodulator = NULL;
+    ClearFlag( STATUS_DEMODULATING );
+
+    /* Will de-initialize systems and free
+     * buffers only if (hopefully) its safe */
+    Cleanup();
+
+    /* Clear demodulator and decoder status */
+    Telemetry_Reset_Demod();
+    Telemetry_Reset_Decoder();
+
+    /* Stop the image decoder if still running */
+    if( isFlagSet(STATUS_DECODING) )
+    {
+      ClearFlag( STATUS_DECODING );
+      Receiver_Decoder_Stop();
+    }
+
+    Show_Message( "Receiving & Decoding Ended", "green" );
+    return( false );
+  }
+
+  SetFlag( STATUS_DEMODULATING );
+
+  /* Wait for filtered samples from the SDR receiver */
+  len = SoapySDR_Wait_Samples( &samples_i, &samples_q );
+  if( len == 0 ) return( true );
+
+  /* Feed the spectrum worker, it takes samples only when ready */
+  Spectrum_Tap( samples_i, samples_q, len );
+
+  /* Demodulate, frames are queued for the decoder by Receiver_Queue_Frame() */
+  Demod_Process( demodulator,
+      samples_i, samples_q, len, Receiver_Queue_Frame, NULL );
+
+  /* Publish QPSK constellation and Demodulator
+   * params (AGC gain, PLL freq etc) for display */
+  if( isFlagSet(STATUS_RECEIVING) )
+    Publish_Demod_Telemetry();
+
+  return( true );
+}
+
+/*****************************************************************************/
+
+/* Save_Images()
+ *
+ * My addition, separated code that saves images
+ */
+static void Save_Images(int type) {
+  char fname[MAX_FILE_NAME];
+  uint32_t idx;
+
+  /* Store APID images individually as PGM files */
+  if( isFlagSet(IMAGE_OUT_SPLIT) )
+  {
+    for( idx = 0; idx < CHANNEL_IMAGE_NUM; idx++ )
+    {
+      /* Save channel images as raw PGM */
+      if( isFlagSet(IMAGE_SAVE_PPGM) )
+      {
+        /* Save unprocessed image */
+        fname[0] = '\0';
+        if( type == IMAGE_RAW )
+          File_Name( fname, idx, "-raw.pgm" );
+        else
+          File_Name( fname, idx, ".pgm" );
+        Save_Image_Raw( fname, "P5",
+            images.width,
+            images.height,
+            255, images.image[idx] );
+      }
+
+      /* Save channel images as JPEG */
+      if( isFlagSet(IMAGE_SAVE_JPEG) )
+      {
+        /* Save unprocessed image */
+        fname[0] = '\0';
+        if( type == IMAGE_RAW )
+          File_Name( fname, idx, "-raw.jpg" );
+        else
+          File_Name( fname, idx, ".jpg" );
+        Save_Image_JPEG(fname,
+            (int)images.width,
+            (int)images.height,
+            true,
+            images.image[idx]);
+      }
+
+    } /* for( idx = 0; idx < CHANNEL_IMAGE_NUM; idx++ ) */
+  } /* if( isFlagSet(IMAGE_OUT_SPLIT) ) */
+
+  /* Create pseudo-color combo image */
+  if( isFlagSet(IMAGE_OUT_COMBO) )
+  {
+    combo_params_t params;
+    uint8_t *combo_image = NULL;
+
+    memcpy( params.color_channel, rc_data.color_channel,
+        sizeof(params.color_channel) );
+    memcpy( params.norm_range, rc_data.norm_range,
+        sizeof(params.norm_range) );
+    params.colorize          = isFlagSet( IMAGE_COLORIZE );
+    params.colorize_blue_max = rc_data.colorize_blue_max;
+    params.colorize_blue_min = rc_data.colorize_blue_min;
+    params.clouds_threshold  = rc_data.clouds_threshold;
+
+    mem_alloc( (void **)&combo_image, images.size * 3 );
+    Create_Combo_Image( &images, &params, combo_image );
+
+    /* Save combo image as raw PGM */
+    if( isFlagSet(IMAGE_SAVE_PPGM) )
+    {
+      /* Save unprocessed image */
+      fname[0] = '\0';
+      if( type == IMAGE_RAW )
+        File_Name( fname, 3, "-raw.ppm" ); /* TODO Use 3 here to specify that we want combo out */
+      else
+        File_Name( fname, 3, ".ppm" ); /* TODO Use 3 here to specify that we want combo out */
+      Save_Image_Raw( fname, "P6",
+          images.width,
+          images.height,
+          255, combo_image );
+    }
+
+    /* Save combo image as JPEG */
+    if( isFlagSet(IMAGE_SAVE_JPEG) )
+    {
+      /* Save unprocessed image */
+      fname[0] = '\0';
+      if( type == IMAGE_RAW )
+        File_Name( fname, 3, "-raw.jpg" ); /* TODO Use 3 here to specify that we want combo out */
+      else
+        File_Name( fname, 3, ".jpg" ); /* TODO Use 3 here to specify that we want combo out */
+      Save_Image_JPEG(fname,
+          (int)images.width,
+          (int)images.height,
+          false,
+          combo_image);
+    }
+
+    free_ptr( (void **)&combo_image );
+  } /* if( isFlagSet(IMAGE_OUT_COMBO) ) */
+}
+
+/*****************************************************************************/
+
+/* Save_Images_Orig()
+ *
+ * Saves the JPEG data of each channel as received,
+ * before any processing or loss of re-encoding. It is
+ * kept for the APIDs chosen when decoding started only
+ */
+static void Save_Images_Orig(void) {
+  char fname[MAX_FILE_NAME];
+  uint32_t idx;
+
+  for( idx = 0; idx < CHANNEL_IMAGE_NUM; idx++ )
+  {
+    if( jfif[idx].lines == 0 ) continue;
+    if( decoder && (decoder->params.apid[idx] != rc_data.apid[idx]) )
+      continue;
+
+    fname[0] = '\0';
+    File_Name( fname, idx, "-orig.jpg" );
+    Jfif_Write( &jfif[idx], fname );
+  }
+}
+
+/*****************************************************************************/
+
+/* Report_Missing_Mcus()
+ *
+ * Tells how much of each exported channel image was lost
+ */
+static void Report_Missing_Mcus(void) {
+  char mesg[MESG_SIZE];
+  double missing;
+
+  for (uint32_t idx = 0; idx < CHANNEL_IMAGE_NUM; idx++) {
+    missing = Channel_Image_Missing(&images, idx);
+    if (missing == 0.0) continue;
+
+    snprintf(mesg, sizeof(mesg), "APID %u image: %.1f%% of MCUs missing",
+        rc_data.apid[idx], 100.0 * missing);
+    Show_Message(mesg, "orange");
+  }
+}
+
+/*****************************************************************************/
+
+/* Receiver_Dump_Images()
+ *
+ * Post-processes and saves the decoded images when reception finished
+ */
+void Receiver_Dump_Images(void) {
+  uint32_t idx;
+
+  /* Frames already demodulated belong to the images */
+  Frame_Queue_Drain(frame_queue);
+  pthread_mutex_lock(&images_lock);
+  Medet_Flush(decoder);
+  pthread_mutex_unlock(&images_lock);
+
+  /* Abort if no images successfully decoded */
+  if (images.size == 0)
+    return;
+
+  /* My addition, process images when reception finished */
+  if (isFlagClear(STATUS_RECEIVING)) {
+    /* Images of the APIDs chosen, in one piece for processing
+     * and saving. Those of the other APIDs are kept aside, so
+     * if another config chooses them they are exported anew */
+    pthread_mutex_lock(&images_lock);
+    if (!images.exported ||
+        (memcmp(images.apid, rc_data.apid, sizeof(images.apid)) != 0)) {
+        Channel_Images_Export(&images, rc_data.apid);
+        Report_Missing_Mcus();
+        ClearFlag(IMAGES_PROCESSED);
+        ClearFlag(IMAGES_RECTIFIED);
+    }
+    pthread_mutex_unlock(&images_lock);
+
+    /* Save JPEG data as received, if enabled */
+    if (isFlagSet(IMAGE_SAVE_ORIG))
+        Save_Images_Orig();
+
+    /* Save images in Raw state first, if enabled */
+    if (isFlagSet(IMAGE_RAW))
+        Save_Images(IMAGE_RAW);
+
+    /* Process images if not already done */
+    if (isFlagClear(IMAGES_PROCESSED)) {
+      /* Fill in the MCUs lost from the lines around them */
+      if (isFlagSet(IMAGE_FILL_GAPS))
+        Fill_Image_Gaps(&images);
+
+      /* My addition, invert image (flip vertically) */
+      if (isFlagSet(IMAGE_INVERT)) {
+        for (idx = 0; idx < CHANNEL_IMAGE_NUM; idx++) {
+          Flip_Image(images.image[idx], (uint32_t)images.size);
+          Flip_Image(images.block_map[idx],
+              (uint32_t)(images.size / BLOCK_MAP_LINES));
+        }
+      }
+
+      /* Rectify (stretch) images to correct scan distortion */
+      if (isFlagSet(IMAGE_RECTIFY) && isFlagClear(IMAGES_RECTIFIED)) {
+        Rectify_Images(&images, rc_data.rectify_function);
+        SetFlag(IMAGES_RECTIFIED);
+      }
+
+      /* Normalize images if enabled */
+      if (isFlagSet(IMAGE_NORMALIZE)) {
+        for (idx = 0; idx < CHANNEL_IMAGE_NUM; idx++) {
+          /* Normalize (Equalize) histogram to cover full pixel value range */
+          Normalize_Image(images.image[idx], (uint32_t)images.size,
+              images.block_map[idx], images.width, NORM_BLACK, MAX_WHITE);
+
+          /* C.L.A.H.E. Normalization, see ../image/clahe.c */
+          if (isFlagSet(IMAGE_CLAHE)) {
+            if (!CLAHE(images.image[idx],
+                  images.block_map[idx],
+                  images.width,
+                  images.height,
+                  NORM_BLACK, MAX_WHITE,
+                  REGIONS_X, REGIONS_Y,
+                  NUM_GREYBINS, CLIP_LIMIT)) {
+              Show_Message(
+                  "Failed to perform C.L.A.H.E.\n"\
+                    "Image Contrast Enhancement", "red");
+            }
+          }
+        }
+      }
+
+      SetFlag(IMAGES_PROCESSED);
+    }
+
+    /* My addition, have LRPT images redisplayed when finished */
+    Telemetry_Images_Done();
+
+    /* Save processed images if enabled */
+    if (isFlagSet(IMAGES_PROCESSED))
+        Save_Images(!IMAGE_RAW);
+  }
+}
+
+/*****************************************************************************/
+
+/* Receiver_Images_Lock()
+ *
+ * Returns the decoded channel images, for display. They are not
+ * changed by the decoder thread till Receiver_Images_Unlock()
+ */
+const channel_images_t *Receiver_Images_Lock(void) {
+  pthread_mutex_lock( &images_lock );
+  return( &images );
+}
+
+/*****************************************************************************/
+
+/* Receiver_Images_Unlock()
+ *
+ * Releases the images to the decoder thread
+ */
+void Receiver_Images_Unlock(void) {
+  pthread_mutex_unlock( &images_lock );
+}
@@ -0,0 +1,38 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*****************************************************************************/
+
+#ifndef COMMON_RECEIVER_H
+#define COMMON_RECEIVER_H
+
+/*****************************************************************************/
+
+#include "../image/image.h"
+
+#include <stdbool.h>
+
+/*****************************************************************************/
+
+bool Receiver_Init(void);
+void Receiver_Decoder_Start(void);
+void Receiver_Decoder_Stop(void);
+bool Demodulator_Run(void);
+void Receiver_Dump_Images(void);
+const channel_images_t *Receiver_Images_Lock(void);
+void Receiver_Images_Unlock(void);
+
+/*****************************************************************************/
+
+#endif
@@ -0,0 +1,192 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * Status telemetry of the demodulator and decoder. Each side
+ * fills in its own working record and publishes it through a
+ * lock-free triple buffer, so neither the signal path nor the
+ * GUI ever waits for the other. The GUI polls a snapshot of
+ * the latest published records at a fixed refresh rate.
+ */
+
+/*****************************************************************************/
+
+#include "telemetry.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+/*****************************************************************************/
+
+/* Triple buffer state: index of middle buffer and new data flag */
+#define TB_INDEX    0x03
+#define TB_DIRTY    0x04
+
+/*****************************************************************************/
+
+/* Triple buffer indices. The back buffer belongs
+ * to the publisher and the front one to the reader */
+typedef struct triple_buf_t {
+    atomic_uint state;
+    unsigned    back, front;
+} triple_buf_t;
+
+/*****************************************************************************/
+
+static void Triple_Swap_Back(triple_buf_t *tb);
+static void Triple_Swap_Front(triple_buf_t *tb);
+
+/*****************************************************************************/
+
+static demod_telemetry_t demod_work, demod_buf[3];
+static triple_buf_t demod_tb = { 1, 0, 2 };
+
+static decoder_telemetry_t decoder_work, decoder_buf[3];
+static triple_buf_t decoder_tb = { 1, 0, 2 };
+
+/* Finished image sets. Counted apart from the decoder's record,
+ * as images are also finished outside of the decoder's thread */
+static atomic_uint images_done = 0;
+
+/*****************************************************************************/
+
+/* Triple_Swap_Back()
+ *
+ * Publishes the back buffer by swapping it with the middle one
+ */
+static void Triple_Swap_Back(triple_buf_t *tb) {
+  unsigned prev = atomic_exchange_explicit(
+      &tb->state, tb->back | TB_DIRTY, memory_order_acq_rel );
+  tb->back = prev & TB_INDEX;
+}
+
+/*****************************************************************************/
+
+/* Triple_Swap_Front()
+ *
+ * Takes the middle buffer as the front one if it holds new data
+ */
+static void Triple_Swap_Front(triple_buf_t *tb) {
+  if( !(atomic_load_explicit(&tb->state, memory_order_relaxed) & TB_DIRTY) )
+    return;
+
+  unsigned prev = atomic_exchange_explicit(
+      &tb->state, tb->front, memory_order_acq_rel );
+  tb->front = prev & TB_INDEX;
+}
+
+/*****************************************************************************/
+
+/* Telemetry_Demod()
+ *
+ * Returns the demodulator's working record. Only
+ * to be used by the demodulator (publisher) side
+ */
+demod_telemetry_t *Telemetry_Demod(void) {
+  return( &demod_work );
+}
+
+/*****************************************************************************/
+
+/* Telemetry_Publish_Demod()
+ *
+ * Publishes the demodulator's working record
+ */
+void Telemetry_Publish_Demod(void) {
+  demod_work.seq++;
+  demod_buf[demod_tb.back] = demod_work;
+  Triple_Swap_Back( &demod_tb );
+}
+
+/*****************************************************************************/
+
+/* Telemetry_Decoder()
+ *
+ * Returns the decoder's working record. Only to be used by
+ * the decoder (publisher) side, i.e. by the frame queue worker,
+ * or by a thread that has stopped or drained the frame queue
+ * while no more frames are queued. There must be one writer
+ */
+decoder_telemetry_t *Telemetry_Decoder(void) {
+  return( &decoder_work );
+}
+
+/*****************************************************************************/
+
+/* Telemetry_Publish_Decoder()
+ *
+ * Publishes the decoder's working record.
+ * Same single writer rule as Telemetry_Decoder()
+ */
+void Telemetry_Publish_Decoder(void) {
+  decoder_work.seq++;
+  decoder_buf[decoder_tb.back] = decoder_work;
+  Triple_Swap_Back( &decoder_tb );
+}
+
+/*****************************************************************************/
+
+/* Telemetry_Reset_Demod()
+ *
+ * Clears and publishes the demodulator's working record
+ */
+void Telemetry_Reset_Demod(void) {
+  uint32_t seq = demod_work.seq;
+
+  memset( &demod_work, 0, sizeof(demod_work) );
+  demod_work.seq = seq;
+  Telemetry_Publish_Demod();
+}
+
+/*****************************************************************************/
+
+/* Telemetry_Reset_Decoder()
+ *
+ * Clears and publishes the decoder's working record.
+ * Same single writer rule as Telemetry_Decoder()
+ */
+void Telemetry_Reset_Decoder(void) {
+  uint32_t seq = decoder_work.seq;
+
+  memset( &decoder_work, 0, sizeof(decoder_work) );
+  decoder_work.seq = seq;
+  Telemetry_Publish_Decoder();
+}
+
+/*****************************************************************************/
+
+/* Telemetry_Images_Done()
+ *
+ * Counts a finished image set. Safe to call from any thread
+ */
+void Telemetry_Images_Done(void) {
+  atomic_fetch_add_explicit( &images_done, 1, memory_order_release );
+}
+
+/*****************************************************************************/
+
+/* Telemetry_Snapshot()
+ *
+ * Copies the latest published records into snap.
+ * Only to be used by a single (GUI) reader thread
+ */
+void Telemetry_Snapshot(telemetry_t *snap) {
+  Triple_Swap_Front( &demod_tb );
+  snap->demod = demod_buf[demod_tb.front];
+
+  Triple_Swap_Front( &decoder_tb );
+  snap->decoder = decoder_buf[decoder_tb.front];
+  snap->decoder.images_done =
+    atomic_load_explicit( &images_done, memory_order_acquire );
+}
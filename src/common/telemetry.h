@@ -0,0 +1,105 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*****************************************************************************/
+
+#ifndef COMMON_TELEMETRY_H
+#define COMMON_TELEMETRY_H
+
+/*****************************************************************************/
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/* Number of QPSK constellation points to plot. Must be <= SYM_CHUNKSIZE / 2 */
+#define QPSK_CONST_POINTS   512
+
+/* Refresh interval (msec) of GUI telemetry polling */
+#define TELEMETRY_INTERVAL  100
+
+/*****************************************************************************/
+
+/* Demodulator status, published by the demodulator */
+typedef struct demod_telemetry_t {
+    /* Publish count, changes on every update */
+    uint32_t seq;
+
+    /* AGC gain and average signal level */
+    double   agc_gain;
+    uint32_t sig_level;
+
+    /* Costas PLL frequency (Hz), lock detect level and lock state */
+    double pll_freq, pll_ave;
+    bool   pll_locked;
+
+    /* Level gauges, in the range 0.0-1.0 */
+    double sig_level_gauge, agc_gain_gauge, pll_ave_gauge;
+
+    /* Soft symbols for the QPSK constellation display */
+    int8_t qpsk_const[2 * QPSK_CONST_POINTS];
+} demod_telemetry_t;
+
+/* Decoder status, published by the image decoder */
+typedef struct decoder_telemetry_t {
+    /* Publish count, changes on every update */
+    uint32_t seq;
+
+    /* Signal quality, its gauge level and status of the last frame */
+    int    sig_q;
+    double sig_qual_gauge;
+    bool   frame_ok;
+
+    /* Count and percentage of good frames */
+    int ok_cnt, percent;
+
+    /* Satellite's onboard time */
+    bool    ob_time_valid;
+    uint8_t ob_hour, ob_min, ob_sec;
+
+    /* Decoded image lines of each channel */
+    int image_lines[CHANNEL_IMAGE_NUM];
+
+    /* MCUs received of each channel, as the decoder's mcu_ok,
+     * and their percentage of the MCUs of its decoded lines */
+    int mcu_ok[CHANNEL_IMAGE_NUM], mcu_percent[CHANNEL_IMAGE_NUM];
+
+    /* Count of finished (post-processed) image sets, kept over
+     * resets. Only filled in by Telemetry_Snapshot() */
+    uint32_t images_done;
+} decoder_telemetry_t;
+
+/* Snapshot of the latest published status */
+typedef struct telemetry_t {
+    demod_telemetry_t   demod;
+    decoder_telemetry_t decoder;
+} telemetry_t;
+
+/*****************************************************************************/
+
+demod_telemetry_t *Telemetry_Demod(void);
+void Telemetry_Publish_Demod(void);
+decoder_telemetry_t *Telemetry_Decoder(void);
+void Telemetry_Publish_Decoder(void);
+void Telemetry_Reset_Demod(void);
+void Telemetry_Reset_Decoder(void);
+void Telemetry_Images_Done(void);
+void Telemetry_Snapshot(telemetry_t *snap);
+
+/*****************************************************************************/
+
+#endif
@@ -22,7 +22,7 @@
 
 /*****************************************************************************/
 
-static inline uint8_t NthByte(uint8_t *l, int n);
+static inline void Store_Word(uint8_t *p, uint64_t word);
 
 /*****************************************************************************/
 
@@ -63,8 +63,15 @@ static const int bitcnt[256] = {
 
 /*****************************************************************************/
 
-static inline uint8_t NthByte(uint8_t *l, int n) {
-    return *(l + n);
+/* Store_Word()
+ *
+ * Stores a word at p, most significant byte first
+ */
+static inline void Store_Word(uint8_t *p, uint64_t word) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    memcpy(p, &word, sizeof(word));
 }
 
 /*****************************************************************************/
@@ -79,72 +86,43 @@ void Bitop_WriterCreate(bit_io_rec_t *w, uint8_t *bytes, int len) {
 
 /*****************************************************************************/
 
-void Bitop_WriteBitlistReversed(bit_io_rec_t *w, uint8_t *l, int len) {
-    int i, byte_index, close_len, full_bytes;
-    uint16_t b;
-
-    l = &l[len - 1];
-    uint8_t *bytes = w->p;
-    byte_index = w->pos;
-
-    if (w->cur_len != 0) {
-        close_len = 8 - w->cur_len;
-
-        if (close_len >= len)
-            close_len = len;
-
-        b = w->cur;
-
-        for (i = 0; i < close_len; i++) {
-            b  |= l[0];
-            b <<= 1;
-            l  -= 1;
-        }
+/* Bitop_WriteBits()
+ *
+ * Appends the n (1 to 64) low bits of bits, most significant first.
+ * Bits are stored out a whole word at a time
+ */
+void Bitop_WriteBits(bit_io_rec_t *w, uint64_t bits, int n) {
+    int used = w->cur_len;
 
-        len -= close_len;
+    bits <<= 64 - n;
+    w->cur |= bits >> used;
 
-        if ((w->cur_len + close_len) == 8) {
-            b >>= 1;
-            bytes[byte_index] = (uint8_t)b;
-            byte_index++;
-        }
-        else {
-            w->cur = (uint8_t)b;
-            w->cur_len += close_len;
-            return;
-        }
+    if (used + n < 64) {
+        w->cur_len += n;
+        return;
     }
 
-    full_bytes = len / 8;
-
-    for (i = 0; i < full_bytes; i++) {
-        bytes[byte_index] = (uint8_t)
-            ((NthByte(l,  0) << 7) |
-             (NthByte(l, -1) << 6) |
-             (NthByte(l, -2) << 5) |
-             (NthByte(l, -3) << 4) |
-             (NthByte(l, -4) << 3) |
-             (NthByte(l, -5) << 2) |
-             (NthByte(l, -6) << 1) |
-             NthByte(l, -7));
-
-        byte_index++;
-        l -= 8;
-    }
+    Store_Word(&(w->p[w->pos]), w->cur);
+    w->pos += 8;
 
-    len -= 8 * full_bytes;
+    w->cur = used ? bits << (64 - used) : 0;
+    w->cur_len = used + n - 64;
+}
 
-    b = 0;
+/*****************************************************************************/
 
-    for (i = 0; i < len; i++) {
-        b |= l[0];
-        b <<= 1;
-        l--;
-    }
+/* Bitop_WriterFlush()
+ *
+ * Stores out the bytes of the bits written so far but not yet stored,
+ * the last one padded with zeros. Writing may go on after it
+ */
+void Bitop_WriterFlush(bit_io_rec_t *w) {
+    uint64_t cur = w->cur;
 
-    w->cur = (uint8_t)b;
-    w->pos = byte_index;
-    w->cur_len = len;
+    for (int i = 0; i < (w->cur_len + 7) / 8; i++) {
+        w->p[w->pos + i] = (uint8_t)(cur >> 56);
+        cur <<= 8;
+    }
 }
 
 /*****************************************************************************/
@@ -158,27 +136,3 @@ int Bitop_CountBits(uint32_t n) {
 
     return result;
 }
-
-/*****************************************************************************/
-
-uint32_t Bitop_PeekNBits(bit_io_rec_t *b, const int n) {
-    int bit, i, p;
-    uint32_t result = 0;
-
-    for (i = 0; i < n; i++) {
-        p = b->pos + i;
-        bit = (b->p[p >> 3] >> (7 - (p & 7))) & 0x01;
-        result = (result << 1) | (uint32_t)bit;
-    }
-
-    return result;
-}
-
-/*****************************************************************************/
-
-uint32_t Bitop_FetchNBits(bit_io_rec_t *b, const int n) {
-    uint32_t result = Bitop_PeekNBits(b, n);
-    Bitop_AdvanceNBits(b, n);
-
-    return result;
-}
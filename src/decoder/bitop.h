@@ -20,30 +20,121 @@
 /*****************************************************************************/
 
 #include <stdint.h>
+#include <string.h>
 
 /*****************************************************************************/
 
-/* Bit input-output data */
+/* Bit writer data. The bits not yet stored out are
+ * kept as a whole word left aligned in cur, with their number */
 typedef struct bit_io_rec_t {
     uint8_t *p;
     int pos, len;
-    uint8_t cur;
+    uint64_t cur;
     int cur_len;
 } bit_io_rec_t;
 
 /*****************************************************************************/
 
-static inline void Bitop_AdvanceNBits(bit_io_rec_t *b, const int n) {
-    b->pos += n;
+/* Buffered bit reader. The next bits are kept left aligned in buf,
+ * topped up 32 bits at a time, so a peek is a shift. Reading past the
+ * end of the data gives zeros, past counts the bytes of them */
+typedef struct bit_reader_t {
+    const uint8_t *p, *end;
+    uint64_t buf;
+    int cnt, past;
+} bit_reader_t;
+
+/*****************************************************************************/
+
+static inline void Bitop_ReaderCreate(
+        bit_reader_t *r, const uint8_t *bytes, int len) {
+    r->p   = bytes;
+    r->end = bytes + (len > 0 ? len : 0);
+    r->buf  = 0;
+    r->cnt  = 0;
+    r->past = 0;
+}
+
+/*****************************************************************************/
+
+/* Bitop_Refill()
+ *
+ * Tops up the reader to more than 32 bits, so that many
+ * can be peeked and consumed before the next refill
+ */
+static inline void Bitop_Refill(bit_reader_t *r) {
+    uint32_t word;
+
+    if (r->cnt > 32)
+        return;
+
+    if (r->end - r->p >= 4) {
+        memcpy(&word, r->p, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        word = __builtin_bswap32(word);
+#endif
+        r->buf |= (uint64_t)word << (32 - r->cnt);
+        r->p   += 4;
+        r->cnt += 32;
+        return;
+    }
+
+    /* The last bytes of the data, then zeros */
+    while (r->cnt <= 56) {
+        if (r->p < r->end)
+            r->buf |= (uint64_t)(*r->p++) << (56 - r->cnt);
+        else
+            r->past++;
+        r->cnt += 8;
+    }
+}
+
+/*****************************************************************************/
+
+/* Bitop_Peek()
+ *
+ * The next n (0 to 32) bits, after a refill
+ */
+static inline uint32_t Bitop_Peek(const bit_reader_t *r, const int n) {
+    return (uint32_t)((r->buf >> 1) >> (63 - n));
+}
+
+/*****************************************************************************/
+
+static inline void Bitop_Skip(bit_reader_t *r, const int n) {
+    r->buf <<= n;
+    r->cnt -= n;
+}
+
+/*****************************************************************************/
+
+static inline uint32_t Bitop_Read(bit_reader_t *r, const int n) {
+    uint32_t result;
+
+    Bitop_Refill(r);
+    result = Bitop_Peek(r, n);
+    Bitop_Skip(r, n);
+
+    return result;
+}
+
+/*****************************************************************************/
+
+/* Bitop_Tell()
+ *
+ * Number of bits consumed since the reader was created on bytes,
+ * more than there are if it ran past the end of them
+ */
+static inline long Bitop_Tell(const bit_reader_t *r, const uint8_t *bytes) {
+    return ((long)(r->p - bytes) + r->past) * 8 - r->cnt;
 }
 
 /*****************************************************************************/
 
 void Bitop_WriterCreate(bit_io_rec_t *w, uint8_t *bytes, int len);
-void Bitop_WriteBitlistReversed(bit_io_rec_t *w, uint8_t *l, int len);
+void Bitop_WriteBits(bit_io_rec_t *w, uint64_t bits, int n);
+void Bitop_WriterFlush(bit_io_rec_t *w);
 int Bitop_CountBits(uint32_t n);
-uint32_t Bitop_PeekNBits(bit_io_rec_t *b, const int n);
-uint32_t Bitop_FetchNBits(bit_io_rec_t *b, const int n);
 
 /*****************************************************************************/
 
@@ -19,6 +19,14 @@
 #include <stdint.h>
 #include <strings.h>
 
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define CORR_X86_POPCNT
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 /*****************************************************************************/
 
 #define CORR_LIMIT  55
@@ -30,33 +38,39 @@ static uint64_t Rotate_IQ_QW(uint64_t data, int shift);
 static uint64_t Flip_IQ_QW(uint64_t data);
 static void Corr_Set_Patt(corr_rec_t *c, int n, uint64_t p);
 static void Corr_Reset(corr_rec_t *c);
+static inline uint64_t Hard_Slice(const uint8_t *data, uint32_t len);
+static inline __attribute__((always_inline)) int Corr_Scan(
+        corr_rec_t *c, const uint8_t *data, uint32_t len);
+static int Corr_Scan_Generic(corr_rec_t *c, const uint8_t *data, uint32_t len);
+#ifdef CORR_X86_POPCNT
+static int Corr_Scan_Popcnt(corr_rec_t *c, const uint8_t *data, uint32_t len);
+#endif
 
 /*****************************************************************************/
 
 static uint8_t rotate_iq_tab[256];
 static uint8_t invert_iq_tab[256];
-static int corr_tab[256][256];
 
 /*****************************************************************************/
 
+/* Hard_Correlate()
+ *
+ * Correlation between a soft sample d and a hard value w,
+ * 1 if d is negative and w is 0 or d is positive and w is 255
+ */
 int Hard_Correlate(const uint8_t d, const uint8_t w) {
-    return corr_tab[d][w];
+    return( ((d > 127) && (w == 0)) || ((d <= 127) && (w == 255)) );
 }
 
 /*****************************************************************************/
 
 void Init_Correlator_Tables(void) {
-  int i, j;
+  int i;
 
   for( i = 0; i <= 255; i++ )
   {
     rotate_iq_tab[i] = (uint8_t)( (((i & 0x55) ^ 0x55) << 1) | ((i & 0xAA) >> 1) );
     invert_iq_tab[i] = (uint8_t)( ( (i & 0x55)         << 1) | ((i & 0xAA) >> 1) );
-
-    //Correlation between a soft sample i and a hard value j
-    for( j = 0; j <= 255; j++ )
-      corr_tab[i][j] =
-        (int)( ((i > 127) && (j == 0)) || ((i <= 127) && (j == 255)) );
   }
 }
 
@@ -155,12 +169,12 @@ void Fix_Packet(void *data, int len, int shift) {
 static void Corr_Set_Patt(corr_rec_t *c, int n, uint64_t p) {
   int i;
 
+  // First bit of the pattern is its MSB, reversed into the LSB
+  c->patts[n] = 0;
   for( i = 0; i < PATTERN_SIZE; i++ )
   {
     if( ((p >> (PATTERN_SIZE - i - 1)) & 1) != 0 )
-      c->patts[i][n] = 0xFF;
-    else
-      c->patts[i][n] = 0;
+      c->patts[n] |= (uint64_t)1 << i;
   }
 }
 
@@ -190,54 +204,140 @@ static void Corr_Reset(corr_rec_t *c) {
 
 /*****************************************************************************/
 
-int Corr_Correlate(corr_rec_t *c, uint8_t *data, uint32_t len) {
-  int i, n, k;
-  int *d;
-  uint8_t *p;
+/* Hard_Slice()
+ *
+ * Slices up to 64 soft symbols into a word of hard bits,
+ * bit k set if symbol k is positive like a 255 pattern bit
+ */
+static inline uint64_t Hard_Slice(const uint8_t *data, uint32_t len) {
+  uint64_t bits;
+  uint32_t k;
+
+#ifdef __SSE2__
+  if( len == PATTERN_SIZE )
+  {
+    bits =
+      (uint64_t)(uint16_t)_mm_movemask_epi8(
+          _mm_loadu_si128((const __m128i *)&data[0]) ) |
+      (uint64_t)(uint16_t)_mm_movemask_epi8(
+          _mm_loadu_si128((const __m128i *)&data[16]) ) << 16 |
+      (uint64_t)(uint16_t)_mm_movemask_epi8(
+          _mm_loadu_si128((const __m128i *)&data[32]) ) << 32 |
+      (uint64_t)(uint16_t)_mm_movemask_epi8(
+          _mm_loadu_si128((const __m128i *)&data[48]) ) << 48;
+
+    return( ~bits );
+  }
+#endif
+
+  bits = 0;
+  for( k = 0; k < len; k++ )
+    if( data[k] <= 127 ) bits |= (uint64_t)1 << k;
+
+  return( bits );
+}
+
+/*****************************************************************************/
+
+/* Corr_Scan()
+ *
+ * Slides the sync patterns over the soft symbols, scoring each offset
+ * by the hard bits that match. The window of 64 bits at an offset is
+ * shifted out of the current and next words of sliced symbols, so each
+ * pattern is one XOR and popcount. Returns the first pattern scoring
+ * over CORR_LIMIT, else the best one, or -1 if none matched at all.
+ * Inlined into each build of it, generic and for popcnt
+ */
+static inline __attribute__((always_inline)) int Corr_Scan(
+        corr_rec_t *c, const uint8_t *data, uint32_t len) {
+  uint64_t cur, next, window;
+  uint32_t i, shift, rest;
+  int n, k;
 
   int result = -1;
   Corr_Reset( c );
 
-  for( i = 0; (uint32_t)i < (len - PATTERN_SIZE); i++ )
+  if( len <= PATTERN_SIZE ) return( result );
+
+  cur  = Hard_Slice( data, PATTERN_SIZE );
+  next = 0;
+  for( i = 0; i < len - PATTERN_SIZE; i++ )
   {
-    for( n = 0; n < PATTERN_CNT; n++ )
-      c->tmp_corr[n] = 0;
-    for( k = 0; k < PATTERN_SIZE; k++ )
+    shift = i % PATTERN_SIZE;
+    if( shift == 0 )
     {
-      d = &(corr_tab[ data[i + k] ] [0]);
-      p = &(c->patts[k][0]);
-      //Unrolled to pattern_cnt times
-      c->tmp_corr[0] += d[p[0]];
-      c->tmp_corr[1] += d[p[1]];
-      c->tmp_corr[2] += d[p[2]];
-      c->tmp_corr[3] += d[p[3]];
-      c->tmp_corr[4] += d[p[4]];
-      c->tmp_corr[5] += d[p[5]];
-      c->tmp_corr[6] += d[p[6]];
-      c->tmp_corr[7] += d[p[7]];
+      // Symbols past the end slice to 0 bits which are never used
+      rest = len - i - PATTERN_SIZE;
+      if( rest > PATTERN_SIZE ) rest = PATTERN_SIZE;
+      next = Hard_Slice( &data[i + PATTERN_SIZE], rest );
+      window = cur;
     }
+    else window = (cur >> shift) | (next << (PATTERN_SIZE - shift));
+
+    for( n = 0; n < PATTERN_CNT; n++ )
+      c->tmp_corr[n] =
+        PATTERN_SIZE - __builtin_popcountll( window ^ c->patts[n] );
 
     for( n = 0; n < PATTERN_CNT; n++ )
       if( c->tmp_corr[n] > c->correlation[n] )
       {
         c->correlation[n] = c->tmp_corr[n];
-        c->position[n] = i;
-        c->tmp_corr[n] = 0;
+        c->position[n] = (int)i;
         if( c->correlation[n] > CORR_LIMIT )
         {
           result = n;
           return( result );
         }
       }
+
+    if( shift == PATTERN_SIZE - 1 ) cur = next;
   }
 
   k = 0;
-  for( i = 0; i < PATTERN_CNT; i++ )
-    if( c->correlation[i] > k )
+  for( n = 0; n < PATTERN_CNT; n++ )
+    if( c->correlation[n] > k )
     {
-      result = i;
-      k = c->correlation[i];
+      result = n;
+      k = c->correlation[n];
     }
 
   return( result );
 }
+
+/*****************************************************************************/
+
+static int Corr_Scan_Generic(corr_rec_t *c, const uint8_t *data, uint32_t len) {
+  return( Corr_Scan(c, data, len) );
+}
+
+/*****************************************************************************/
+
+#ifdef CORR_X86_POPCNT
+
+/* Corr_Scan_Popcnt()
+ *
+ * Corr_Scan() built for the popcnt instruction
+ * instead of the generic bit counting of the compiler
+ */
+__attribute__((target("popcnt")))
+static int Corr_Scan_Popcnt(corr_rec_t *c, const uint8_t *data, uint32_t len) {
+  return( Corr_Scan(c, data, len) );
+}
+
+#endif
+
+/*****************************************************************************/
+
+/* Corr_Correlate()
+ *
+ * Finds the sync pattern and position that best correlates
+ * with the first len soft symbols of data
+ */
+int Corr_Correlate(corr_rec_t *c, uint8_t *data, uint32_t len) {
+#ifdef CORR_X86_POPCNT
+  if( __builtin_cpu_supports("popcnt") )
+    return( Corr_Scan_Popcnt(c, data, len) );
+#endif
+
+  return( Corr_Scan_Generic(c, data, len) );
+}
@@ -30,7 +30,8 @@
 
 /* Decoder correlator data */
 typedef struct corr_rec_t {
-    uint8_t patts[PATTERN_SIZE][PATTERN_SIZE];
+    /* Sync patterns, bit k is the hard bit of soft symbol k */
+    uint64_t patts[PATTERN_CNT];
 
     int
         correlation[PATTERN_CNT],
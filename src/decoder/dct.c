@@ -17,28 +17,76 @@
 #include "dct.h"
 
 #include <math.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define IDCT_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/*****************************************************************************/
+
+/* Fixed point IDCT: fractional bits of the constants and extra bits
+ * kept between the passes, as in the IJG "islow" LLM algorithm */
+#define CONST_BITS  13
+#define PASS1_BITS  2
+
+/* Right shifts that descale the outputs of each pass */
+#define PASS1_SHIFT (CONST_BITS - PASS1_BITS)
+#define PASS2_SHIFT (CONST_BITS + PASS1_BITS + 3)
+
+/* LLM constants, FIX(x) = x * 2^CONST_BITS */
+#define FIX_0_541196100     4433
+#define FIX_0_765366865     6270
+#define FIX_1_847759065     15137
+
+/* Even part weights of inputs 2 and 6 */
+#define EVEN_2_3    (FIX_0_541196100 + FIX_0_765366865)
+#define EVEN_6_3    FIX_0_541196100
+#define EVEN_2_2    FIX_0_541196100
+#define EVEN_6_2    (FIX_0_541196100 - FIX_1_847759065)
+
 /*****************************************************************************/
 
 static void Init_Cos(void);
+static inline int16_t Sat_Int16(int32_t val);
+static inline void Idct_1D(int32_t *out, const int16_t *in, int stride);
+static void Idct_Float(
+        uint8_t *dst, int stride, const int16_t *blk, int count, bool invert);
+static void Idct_Scalar(
+        uint8_t *dst, int stride, const int16_t *blk, int count, bool invert);
+#ifdef IDCT_X86_SIMD
+static void Idct_SSE2(
+        uint8_t *dst, int stride, const int16_t *blk, int count, bool invert);
+static void Idct_AVX2(
+        uint8_t *dst, int stride, const int16_t *blk, int count, bool invert);
+#endif
 
 /*****************************************************************************/
 
 static double cosine[8][8];
 static double alpha[8];
 
-/*****************************************************************************/
+/* Cosine tables are shared by all decoder threads */
+static pthread_once_t cos_once = PTHREAD_ONCE_INIT;
 
-static void Init_Cos(void) {
-    static bool cos_inited = false;
+/* Odd part of the LLM IDCT with its z1..z5 products folded into one
+ * weight per input, so that no sum overflows 32 bits and the inputs
+ * pair up for multiply-add. Row k holds the weights of inputs 7, 1, 5
+ * and 3 in the odd term k that is added to and subtracted from the
+ * even terms for outputs 3 - k and 4 + k */
+static const int16_t odd_weight[4][4] = {
+    { -11363,   2260,   9633,  -6436 },
+    {   9633,   6437,   2261, -11362 },
+    {  -6436,   9633, -11362,  -2259 },
+    {   2260,  11363,   6437,   9633 }
+};
 
-    if (cos_inited)
-        return;
-
-    cos_inited = true;
+/*****************************************************************************/
 
+static void Init_Cos(void) {
     for (uint8_t y = 0; y < 8; y++)
         for (uint8_t x = 0; x < 8; x++)
             cosine[y][x] = cos(M_PI / 16.0 * (2.0 * (double)y + 1.0) * (double)x);
@@ -52,7 +100,7 @@ static void Init_Cos(void) {
 /*****************************************************************************/
 
 void Flt_Idct_8x8(double *res, const double *inpt) {
-    Init_Cos();
+    pthread_once(&cos_once, Init_Cos);
 
     for (uint8_t y = 0; y < 8; y++)
         for (uint8_t x = 0; x < 8; x++) {
@@ -80,3 +128,431 @@ void Flt_Idct_8x8(double *res, const double *inpt) {
             res[y * 8 + x] = s / 4.0;
         }
 }
+
+/*****************************************************************************/
+
+/* Sat_Int16()
+ *
+ * Saturates val to the range of int16_t
+ */
+static inline int16_t Sat_Int16(int32_t val) {
+    if (val > INT16_MAX)
+        return INT16_MAX;
+    if (val < INT16_MIN)
+        return INT16_MIN;
+
+    return (int16_t)val;
+}
+
+/*****************************************************************************/
+
+/* Idct_1D()
+ *
+ * 8 point LLM IDCT of the inputs stride apart into out,
+ * scaled up by 2^CONST_BITS and sqrt(8) and not rounded
+ */
+static inline void Idct_1D(int32_t *out, const int16_t *in, int stride) {
+    int32_t i0 = in[0],          i1 = in[stride];
+    int32_t i2 = in[2 * stride], i3 = in[3 * stride];
+    int32_t i4 = in[4 * stride], i5 = in[5 * stride];
+    int32_t i6 = in[6 * stride], i7 = in[7 * stride];
+    int32_t tmp0, tmp1, tmp2, tmp3, even[4], odd;
+
+    /* Even part */
+    tmp0 = (i0 + i4) * (1 << CONST_BITS);
+    tmp1 = (i0 - i4) * (1 << CONST_BITS);
+    tmp2 = i2 * EVEN_2_2 + i6 * EVEN_6_2;
+    tmp3 = i2 * EVEN_2_3 + i6 * EVEN_6_3;
+
+    even[0] = tmp0 - tmp3;
+    even[1] = tmp1 - tmp2;
+    even[2] = tmp1 + tmp2;
+    even[3] = tmp0 + tmp3;
+
+    /* Odd part and butterflies */
+    for (int k = 0; k < 4; k++) {
+        odd = i7 * odd_weight[k][0] + i1 * odd_weight[k][1] +
+              i5 * odd_weight[k][2] + i3 * odd_weight[k][3];
+
+        out[3 - k] = even[k] + odd;
+        out[4 + k] = even[k] - odd;
+    }
+}
+
+/*****************************************************************************/
+
+/* Idct_Float()
+ *
+ * IDCT with Flt_Idct_8x8(), the output of the decoder before
+ * the fixed point IDCTs. Slow, kept for comparison
+ */
+static void Idct_Float(
+        uint8_t *dst, int stride, const int16_t *blk, int count, bool invert) {
+    double inpt[64], res[64];
+    int t;
+
+    for (int n = 0; n < count; n++, blk += 64, dst += 8) {
+        for (int i = 0; i < 64; i++)
+            inpt[i] = (double)blk[i];
+
+        Flt_Idct_8x8(res, inpt);
+
+        for (int i = 0; i < 64; i++) {
+            t = (int)round(res[i] + 128.0);
+            if (t < 0)
+                t = 0;
+            if (t > 255)
+                t = 255;
+            if (invert)
+                t = 255 - t;
+            dst[(i / 8) * stride + i % 8] = (uint8_t)t;
+        }
+    }
+}
+
+/*****************************************************************************/
+
+/* Idct_Scalar()
+ *
+ * Fixed point IDCT, columns first then rows. The columns pass keeps
+ * PASS1_BITS extra bits in 16 bits, saturating as the SIMD ones do
+ */
+static void Idct_Scalar(
+        uint8_t *dst, int stride, const int16_t *blk, int count, bool invert) {
+    int16_t ws[64];
+    int32_t out[8];
+    int32_t t;
+
+    for (int n = 0; n < count; n++, blk += 64, dst += 8) {
+        for (int u = 0; u < 8; u++) {
+            Idct_1D(out, &blk[u], 8);
+            for (int y = 0; y < 8; y++)
+                ws[y * 8 + u] = Sat_Int16(
+                        (out[y] + (1 << (PASS1_SHIFT - 1))) >> PASS1_SHIFT);
+        }
+
+        for (int y = 0; y < 8; y++) {
+            Idct_1D(out, &ws[y * 8], 1);
+            for (int x = 0; x < 8; x++) {
+                t = Sat_Int16(
+                        (out[x] + (1 << (PASS2_SHIFT - 1))) >> PASS2_SHIFT);
+                t += 128;
+                if (t < 0)
+                    t = 0;
+                if (t > 255)
+                    t = 255;
+                if (invert)
+                    t = 255 - t;
+                dst[y * stride + x] = (uint8_t)t;
+            }
+        }
+    }
+}
+
+/*****************************************************************************/
+
+#ifdef IDCT_X86_SIMD
+
+/* Weights a and b of a pair of interleaved int16 inputs, for pmaddwd */
+#define IDCT_PAIR(a, b) \
+    ((int32_t)(((uint32_t)(uint16_t)(b) << 16) | (uint16_t)(a)))
+
+/* Idct_Pass_SSE2()
+ *
+ * Idct_1D() across the eight rows r, for all eight columns at once,
+ * descaled by shift and saturated back to 16 bits
+ */
+__attribute__((target("sse2")))
+static inline void Idct_Pass_SSE2(__m128i *r, int shift) {
+    const __m128i round = _mm_set1_epi32(1 << (shift - 1));
+    const __m128i w04_0 = _mm_set1_epi32(
+            IDCT_PAIR(1 << CONST_BITS, 1 << CONST_BITS));
+    const __m128i w04_1 = _mm_set1_epi32(
+            IDCT_PAIR(1 << CONST_BITS, -(1 << CONST_BITS)));
+    const __m128i w26_2 = _mm_set1_epi32(IDCT_PAIR(EVEN_2_2, EVEN_6_2));
+    const __m128i w26_3 = _mm_set1_epi32(IDCT_PAIR(EVEN_2_3, EVEN_6_3));
+    __m128i p04, p26, p71, p53, tmp0, tmp1, tmp2, tmp3, even[4], odd;
+    __m128i res[2][8];
+
+    /* Low and high four columns, in 32 bits */
+    for (int h = 0; h < 2; h++) {
+        if (h == 0) {
+            p04 = _mm_unpacklo_epi16(r[0], r[4]);
+            p26 = _mm_unpacklo_epi16(r[2], r[6]);
+            p71 = _mm_unpacklo_epi16(r[7], r[1]);
+            p53 = _mm_unpacklo_epi16(r[5], r[3]);
+        }
+        else {
+            p04 = _mm_unpackhi_epi16(r[0], r[4]);
+            p26 = _mm_unpackhi_epi16(r[2], r[6]);
+            p71 = _mm_unpackhi_epi16(r[7], r[1]);
+            p53 = _mm_unpackhi_epi16(r[5], r[3]);
+        }
+
+        tmp0 = _mm_madd_epi16(p04, w04_0);
+        tmp1 = _mm_madd_epi16(p04, w04_1);
+        tmp2 = _mm_madd_epi16(p26, w26_2);
+        tmp3 = _mm_madd_epi16(p26, w26_3);
+
+        even[0] = _mm_add_epi32(_mm_sub_epi32(tmp0, tmp3), round);
+        even[1] = _mm_add_epi32(_mm_sub_epi32(tmp1, tmp2), round);
+        even[2] = _mm_add_epi32(_mm_add_epi32(tmp1, tmp2), round);
+        even[3] = _mm_add_epi32(_mm_add_epi32(tmp0, tmp3), round);
+
+        for (int k = 0; k < 4; k++) {
+            odd = _mm_add_epi32(
+                    _mm_madd_epi16(p71, _mm_set1_epi32(
+                            IDCT_PAIR(odd_weight[k][0], odd_weight[k][1]))),
+                    _mm_madd_epi16(p53, _mm_set1_epi32(
+                            IDCT_PAIR(odd_weight[k][2], odd_weight[k][3]))));
+
+            res[h][3 - k] = _mm_srai_epi32(_mm_add_epi32(even[k], odd), shift);
+            res[h][4 + k] = _mm_srai_epi32(_mm_sub_epi32(even[k], odd), shift);
+        }
+    }
+
+    for (int y = 0; y < 8; y++)
+        r[y] = _mm_packs_epi32(res[0][y], res[1][y]);
+}
+
+/*****************************************************************************/
+
+/* Idct_Transpose_SSE2()
+ *
+ * Transposes the 8x8 block of 16 bit values in rows r
+ */
+__attribute__((target("sse2")))
+static inline void Idct_Transpose_SSE2(__m128i *r) {
+    __m128i a[8], b[8];
+
+    for (int i = 0; i < 8; i += 2) {
+        a[i / 2]     = _mm_unpacklo_epi16(r[i], r[i + 1]);
+        a[i / 2 + 4] = _mm_unpackhi_epi16(r[i], r[i + 1]);
+    }
+
+    /* Columns 0..3 from a[0..3] into b[0..3], 4..7 from a[4..7] */
+    for (int i = 0; i < 8; i += 4) {
+        b[i]     = _mm_unpacklo_epi32(a[i],     a[i + 1]);
+        b[i + 1] = _mm_unpackhi_epi32(a[i],     a[i + 1]);
+        b[i + 2] = _mm_unpacklo_epi32(a[i + 2], a[i + 3]);
+        b[i + 3] = _mm_unpackhi_epi32(a[i + 2], a[i + 3]);
+    }
+
+    for (int i = 0; i < 8; i += 4) {
+        r[i]     = _mm_unpacklo_epi64(b[i],     b[i + 2]);
+        r[i + 1] = _mm_unpackhi_epi64(b[i],     b[i + 2]);
+        r[i + 2] = _mm_unpacklo_epi64(b[i + 1], b[i + 3]);
+        r[i + 3] = _mm_unpackhi_epi64(b[i + 1], b[i + 3]);
+    }
+}
+
+/*****************************************************************************/
+
+/* Idct_SSE2()
+ *
+ * Fixed point IDCT of a block at a time, same output as Idct_Scalar()
+ */
+__attribute__((target("sse2")))
+static void Idct_SSE2(
+        uint8_t *dst, int stride, const int16_t *blk, int count, bool invert) {
+    const __m128i level = _mm_set1_epi16(128);
+    const __m128i flip  = _mm_set1_epi8(invert ? -1 : 0);
+    __m128i r[8], p;
+
+    for (int n = 0; n < count; n++, blk += 64, dst += 8) {
+        for (int y = 0; y < 8; y++)
+            r[y] = _mm_loadu_si128((const __m128i *)&blk[y * 8]);
+
+        Idct_Pass_SSE2(r, PASS1_SHIFT);
+        Idct_Transpose_SSE2(r);
+        Idct_Pass_SSE2(r, PASS2_SHIFT);
+        Idct_Transpose_SSE2(r);
+
+        /* Level shift, clamp and invert two rows at a time */
+        for (int y = 0; y < 8; y += 2) {
+            p = _mm_xor_si128(flip, _mm_packus_epi16(
+                        _mm_adds_epi16(r[y], level),
+                        _mm_adds_epi16(r[y + 1], level)));
+            _mm_storel_epi64((__m128i *)&dst[y * stride], p);
+            _mm_storel_epi64((__m128i *)&dst[(y + 1) * stride],
+                    _mm_srli_si128(p, 8));
+        }
+    }
+}
+
+/*****************************************************************************/
+
+/* Idct_Pass_AVX2()
+ *
+ * Idct_Pass_SSE2() of two blocks, one in each 128 bit lane
+ */
+__attribute__((target("avx2")))
+static inline void Idct_Pass_AVX2(__m256i *r, int shift) {
+    const __m256i round = _mm256_set1_epi32(1 << (shift - 1));
+    const __m256i w04_0 = _mm256_set1_epi32(
+            IDCT_PAIR(1 << CONST_BITS, 1 << CONST_BITS));
+    const __m256i w04_1 = _mm256_set1_epi32(
+            IDCT_PAIR(1 << CONST_BITS, -(1 << CONST_BITS)));
+    const __m256i w26_2 = _mm256_set1_epi32(IDCT_PAIR(EVEN_2_2, EVEN_6_2));
+    const __m256i w26_3 = _mm256_set1_epi32(IDCT_PAIR(EVEN_2_3, EVEN_6_3));
+    __m256i p04, p26, p71, p53, tmp0, tmp1, tmp2, tmp3, even[4], odd;
+    __m256i res[2][8];
+
+    for (int h = 0; h < 2; h++) {
+        if (h == 0) {
+            p04 = _mm256_unpacklo_epi16(r[0], r[4]);
+            p26 = _mm256_unpacklo_epi16(r[2], r[6]);
+            p71 = _mm256_unpacklo_epi16(r[7], r[1]);
+            p53 = _mm256_unpacklo_epi16(r[5], r[3]);
+        }
+        else {
+            p04 = _mm256_unpackhi_epi16(r[0], r[4]);
+            p26 = _mm256_unpackhi_epi16(r[2], r[6]);
+            p71 = _mm256_unpackhi_epi16(r[7], r[1]);
+            p53 = _mm256_unpackhi_epi16(r[5], r[3]);
+        }
+
+        tmp0 = _mm256_madd_epi16(p04, w04_0);
+        tmp1 = _mm256_madd_epi16(p04, w04_1);
+        tmp2 = _mm256_madd_epi16(p26, w26_2);
+        tmp3 = _mm256_madd_epi16(p26, w26_3);
+
+        even[0] = _mm256_add_epi32(_mm256_sub_epi32(tmp0, tmp3), round);
+        even[1] = _mm256_add_epi32(_mm256_sub_epi32(tmp1, tmp2), round);
+        even[2] = _mm256_add_epi32(_mm256_add_epi32(tmp1, tmp2), round);
+        even[3] = _mm256_add_epi32(_mm256_add_epi32(tmp0, tmp3), round);
+
+        for (int k = 0; k < 4; k++) {
+            odd = _mm256_add_epi32(
+                    _mm256_madd_epi16(p71, _mm256_set1_epi32(
+                            IDCT_PAIR(odd_weight[k][0], odd_weight[k][1]))),
+                    _mm256_madd_epi16(p53, _mm256_set1_epi32(
+                            IDCT_PAIR(odd_weight[k][2], odd_weight[k][3]))));
+
+            res[h][3 - k] = _mm256_srai_epi32(
+                    _mm256_add_epi32(even[k], odd), shift);
+            res[h][4 + k] = _mm256_srai_epi32(
+                    _mm256_sub_epi32(even[k], odd), shift);
+        }
+    }
+
+    for (int y = 0; y < 8; y++)
+        r[y] = _mm256_packs_epi32(res[0][y], res[1][y]);
+}
+
+/*****************************************************************************/
+
+/* Idct_Transpose_AVX2()
+ *
+ * Idct_Transpose_SSE2() of two blocks, one in each 128 bit lane
+ */
+__attribute__((target("avx2")))
+static inline void Idct_Transpose_AVX2(__m256i *r) {
+    __m256i a[8], b[8];
+
+    for (int i = 0; i < 8; i += 2) {
+        a[i / 2]     = _mm256_unpacklo_epi16(r[i], r[i + 1]);
+        a[i / 2 + 4] = _mm256_unpackhi_epi16(r[i], r[i + 1]);
+    }
+
+    for (int i = 0; i < 8; i += 4) {
+        b[i]     = _mm256_unpacklo_epi32(a[i],     a[i + 1]);
+        b[i + 1] = _mm256_unpackhi_epi32(a[i],     a[i + 1]);
+        b[i + 2] = _mm256_unpacklo_epi32(a[i + 2], a[i + 3]);
+        b[i + 3] = _mm256_unpackhi_epi32(a[i + 2], a[i + 3]);
+    }
+
+    for (int i = 0; i < 8; i += 4) {
+        r[i]     = _mm256_unpacklo_epi64(b[i],     b[i + 2]);
+        r[i + 1] = _mm256_unpackhi_epi64(b[i],     b[i + 2]);
+        r[i + 2] = _mm256_unpacklo_epi64(b[i + 1], b[i + 3]);
+        r[i + 3] = _mm256_unpackhi_epi64(b[i + 1], b[i + 3]);
+    }
+}
+
+/*****************************************************************************/
+
+/* Idct_AVX2()
+ *
+ * Fixed point IDCT of two blocks at a time, the one left
+ * of an odd count by Idct_SSE2(). Same output as Idct_Scalar()
+ */
+__attribute__((target("avx2")))
+static void Idct_AVX2(
+        uint8_t *dst, int stride, const int16_t *blk, int count, bool invert) {
+    const __m256i level = _mm256_set1_epi16(128);
+    const __m256i flip  = _mm256_set1_epi8(invert ? -1 : 0);
+    __m256i r[8], p;
+    __m128i lo, hi;
+    int n;
+
+    for (n = 0; n + 1 < count; n += 2, blk += 128, dst += 16) {
+        for (int y = 0; y < 8; y++)
+            r[y] = _mm256_inserti128_si256(_mm256_castsi128_si256(
+                        _mm_loadu_si128((const __m128i *)&blk[y * 8])),
+                    _mm_loadu_si128((const __m128i *)&blk[64 + y * 8]), 1);
+
+        Idct_Pass_AVX2(r, PASS1_SHIFT);
+        Idct_Transpose_AVX2(r);
+        Idct_Pass_AVX2(r, PASS2_SHIFT);
+        Idct_Transpose_AVX2(r);
+
+        /* Rows of the two blocks side by side, 16 pixels each */
+        for (int y = 0; y < 8; y += 2) {
+            p = _mm256_xor_si256(flip, _mm256_packus_epi16(
+                        _mm256_adds_epi16(r[y], level),
+                        _mm256_adds_epi16(r[y + 1], level)));
+            lo = _mm256_castsi256_si128(p);
+            hi = _mm256_extracti128_si256(p, 1);
+            _mm_storeu_si128((__m128i *)&dst[y * stride],
+                    _mm_unpacklo_epi64(lo, hi));
+            _mm_storeu_si128((__m128i *)&dst[(y + 1) * stride],
+                    _mm_unpackhi_epi64(lo, hi));
+        }
+    }
+
+    if (n < count)
+        Idct_SSE2(dst, stride, blk, 1, invert);
+}
+
+#endif
+
+/*****************************************************************************/
+
+/* Idct_Select()
+ *
+ * Returns the IDCT of the given implementation, by default the
+ * fastest one the CPU supports. The fixed point ones all give the
+ * same output, within 1 of the double precision one for coefficients
+ * within IDCT_COEF_MIN..MAX. Returns NULL
+ * if impl is not supported
+ */
+idct_8x8_t Idct_Select(idct_impl_t impl) {
+    idct_8x8_t idct;
+
+    switch (impl) {
+        case IDCT_IMPL_AUTO:
+            if ((idct = Idct_Select(IDCT_IMPL_AVX2)))
+                return idct;
+            if ((idct = Idct_Select(IDCT_IMPL_SSE2)))
+                return idct;
+            return Idct_Select(IDCT_IMPL_SCALAR);
+
+        case IDCT_IMPL_FLOAT:
+            return Idct_Float;
+
+        case IDCT_IMPL_SCALAR:
+            return Idct_Scalar;
+
+#ifdef IDCT_X86_SIMD
+        case IDCT_IMPL_SSE2:
+            return __builtin_cpu_supports("sse2") ? Idct_SSE2 : NULL;
+
+        case IDCT_IMPL_AVX2:
+            return __builtin_cpu_supports("avx2") ? Idct_AVX2 : NULL;
+#endif
+
+        default:
+            return NULL;
+    }
+}
@@ -19,7 +19,38 @@
 
 /*****************************************************************************/
 
+#include <stdbool.h>
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/* Range of the coefficients an IDCT takes, that of 8 bit baseline JPEG */
+#define IDCT_COEF_MIN   (-1024)
+#define IDCT_COEF_MAX   1023
+
+/*****************************************************************************/
+
+/* Inverse DCT of count blocks of dequantized coefficients, 64 each in
+ * natural (row by row) order and within IDCT_COEF_MIN..MAX, into pixels
+ * level shifted by 128 and clamped to 0..255, inverted (255 - pixel)
+ * if invert is set. Blocks go side by side, block n to dst + 8 * n
+ * with rows stride apart */
+typedef void (*idct_8x8_t)(
+        uint8_t *dst, int stride, const int16_t *blk, int count, bool invert);
+
+/* Inverse DCT implementations */
+typedef enum idct_impl_t {
+    IDCT_IMPL_AUTO = 0,   // Fastest one the CPU supports
+    IDCT_IMPL_FLOAT,      // Direct double precision IDCT, the reference
+    IDCT_IMPL_SCALAR,     // Fixed point separable (LLM) IDCT
+    IDCT_IMPL_SSE2,       // Same output as the scalar one
+    IDCT_IMPL_AVX2        // Same output, two blocks at a time
+} idct_impl_t;
+
+/*****************************************************************************/
+
 void Flt_Idct_8x8(double *res, const double *inpt);
+idct_8x8_t Idct_Select(idct_impl_t impl);
 
 /*****************************************************************************/
 
@@ -16,11 +16,40 @@
 
 #include "ecc.h"
 
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 #include <strings.h>
 
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define ECC_X86_SSSE3
+#include <immintrin.h>
+#endif
+
+/*****************************************************************************/
+
+/* Length and number of parity symbols of the RS(255,223) code */
+#define ECC_BLOCK_LEN   255
+#define ECC_PARITY_LEN  32
+
+/* 16 byte chunks of an interleaved frame that hold four symbols of each
+ * codeword, the SIMD syndromes take those and leave the last three */
+#define ECC_CHUNKS      ( ECC_BLOCK_LEN / 4 )
+
+/*****************************************************************************/
+
+static void Ecc_Make_Genpoly(void);
+static void Ecc_Init_Tables(void);
+static inline uint8_t Gf_Mul(uint8_t a, int log_b);
+static void Ecc_Syndromes_Generic(
+    const uint8_t *data, uint8_t s[ECC_INTERLEAVE][ECC_PARITY_LEN]);
+#ifdef ECC_X86_SSSE3
+static void Ecc_Syndromes_SSSE3(
+    const uint8_t *data, uint8_t s[ECC_INTERLEAVE][ECC_PARITY_LEN]);
+#endif
+static bool Ecc_Correct(uint8_t *s, uint8_t *data, int stride, int pad);
+
 /*****************************************************************************/
 
 static const uint8_t alpha[256] = {
@@ -93,25 +122,187 @@ static const uint8_t indx[256] = {
     246, 135, 165, 23, 58, 163, 60, 183
 };
 
+/* Generator polynomial of the code (index form), built once */
+static uint8_t genpoly[ECC_PARITY_LEN + 1];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+/* alpha[] twice over, so a sum of two logs needs no % 255 */
+static uint8_t alpha2[2 * 255];
+
+/* Log of the root each syndrome is evaluated at */
+static int syn_root[ECC_PARITY_LEN];
+
+/* Products of the low and high nibbles of a byte by the 4th power
+ * of each syndrome's root, as pshufb tables of the SIMD syndromes */
+static uint8_t syn_mul_lo[ECC_PARITY_LEN][16];
+static uint8_t syn_mul_hi[ECC_PARITY_LEN][16];
+
 /*****************************************************************************/
 
-bool Ecc_Decode(uint8_t *idata, int pad) {
+/* Ecc_Make_Genpoly()
+ *
+ * Builds the generator polynomial, the product of (x + root)
+ * for the 32 roots the decoder computes the syndromes at
+ */
+static void Ecc_Make_Genpoly(void) {
+  uint8_t poly[ECC_PARITY_LEN + 1];
+  int i, j, root;
+
+  bzero( poly, sizeof(poly) );
+  poly[0] = 1;
+
+  for( i = 0; i < ECC_PARITY_LEN; i++ )
+  {
+    root = ( (112 + i) * 11 ) % 255;
+
+    /* Multiply by (x + alpha^root), coefficients in ascending order */
+    poly[i + 1] = poly[i];
+    for( j = i; j > 0; j-- )
+    {
+      if( poly[j] != 0 )
+        poly[j] = poly[j - 1] ^ alpha[ (indx[poly[j]] + root) % 255 ];
+      else
+        poly[j] = poly[j - 1];
+    }
+    poly[0] = alpha[ (indx[poly[0]] + root) % 255 ];
+  }
+
+  for( i = 0; i <= ECC_PARITY_LEN; i++ )
+    genpoly[i] = indx[ poly[i] ];
+}
+
+/*****************************************************************************/
+
+/* Ecc_Init_Tables()
+ *
+ * Builds the generator polynomial and the tables of the syndromes
+ */
+static void Ecc_Init_Tables(void) {
+  int i, n, root4;
+
+  Ecc_Make_Genpoly();
+
+  for( i = 0; i < 2 * 255; i++ )
+    alpha2[i] = alpha[ i % 255 ];
+
+  for( i = 0; i < ECC_PARITY_LEN; i++ )
+  {
+    syn_root[i] = ( (112 + i) * 11 ) % 255;
+    root4 = ( 4 * syn_root[i] ) % 255;
+    for( n = 0; n < 16; n++ )
+    {
+      syn_mul_lo[i][n] = Gf_Mul( (uint8_t)n, root4 );
+      syn_mul_hi[i][n] = Gf_Mul( (uint8_t)(n << 4), root4 );
+    }
+  }
+}
+
+/*****************************************************************************/
+
+/* Gf_Mul()
+ *
+ * Product of a and the field element of log log_b ( < 255 )
+ */
+static inline uint8_t Gf_Mul(uint8_t a, int log_b) {
+  return( a ? alpha2[ indx[a] + log_b ] : 0 );
+}
+
+/*****************************************************************************/
+
+/* Ecc_Syndromes_Generic()
+ *
+ * Syndromes of the ECC_INTERLEAVE codewords interleaved in data
+ */
+static void Ecc_Syndromes_Generic(
+    const uint8_t *data, uint8_t s[ECC_INTERLEAVE][ECC_PARITY_LEN]) {
+  int c, i, j;
+  uint8_t syn;
+
+  for( c = 0; c < ECC_INTERLEAVE; c++ )
+    for( i = 0; i < ECC_PARITY_LEN; i++ )
+    {
+      syn = 0;
+      for( j = 0; j < ECC_BLOCK_LEN; j++ )
+        syn = Gf_Mul( syn, syn_root[i] ) ^ data[ j * ECC_INTERLEAVE + c ];
+      s[c][i] = syn;
+    }
+}
+
+/*****************************************************************************/
+
+#ifdef ECC_X86_SSSE3
+
+/* Ecc_Syndromes_SSSE3()
+ *
+ * Ecc_Syndromes_Generic() with SSSE3. Each 16 byte chunk of the
+ * frame holds 4 consecutive symbols of each of the 4 codewords, so
+ * a lane of a chunk accumulates every 4th symbol of one codeword,
+ * multiplied by the 4th power of the root with split nibble pshufb
+ * lookups. The 4 lanes of each codeword are then folded together
+ * and the last 3 symbols added in, as by the generic Horner's rule
+ */
+__attribute__((target("ssse3")))
+static void Ecc_Syndromes_SSSE3(
+    const uint8_t *data, uint8_t s[ECC_INTERLEAVE][ECC_PARITY_LEN]) {
+  __m128i acc[ECC_PARITY_LEN];
+  const __m128i nibble = _mm_set1_epi8( 0x0f );
+  uint8_t lanes[16];
+  uint8_t syn;
+  int c, i, j, k;
+
+  for( i = 0; i < ECC_PARITY_LEN; i++ )
+    acc[i] = _mm_setzero_si128();
+
+  for( k = 0; k < ECC_CHUNKS; k++ )
+  {
+    __m128i chunk = _mm_loadu_si128( (const __m128i *)(data + 16 * k) );
+
+    for( i = 0; i < ECC_PARITY_LEN; i++ )
+    {
+      __m128i lo = _mm_and_si128( acc[i], nibble );
+      __m128i hi = _mm_and_si128( _mm_srli_epi16(acc[i], 4), nibble );
+
+      lo = _mm_shuffle_epi8(
+          _mm_loadu_si128((const __m128i *)syn_mul_lo[i]), lo );
+      hi = _mm_shuffle_epi8(
+          _mm_loadu_si128((const __m128i *)syn_mul_hi[i]), hi );
+      acc[i] = _mm_xor_si128( _mm_xor_si128(lo, hi), chunk );
+    }
+  }
+
+  for( i = 0; i < ECC_PARITY_LEN; i++ )
+  {
+    _mm_storeu_si128( (__m128i *)lanes, acc[i] );
+    for( c = 0; c < ECC_INTERLEAVE; c++ )
+    {
+      syn = 0;
+      for( j = 0; j < 4; j++ )
+        syn = Gf_Mul( syn, syn_root[i] ) ^ lanes[ j * ECC_INTERLEAVE + c ];
+      for( j = 4 * ECC_CHUNKS; j < ECC_BLOCK_LEN; j++ )
+        syn = Gf_Mul( syn, syn_root[i] ) ^ data[ j * ECC_INTERLEAVE + c ];
+      s[c][i] = syn;
+    }
+  }
+}
+
+#endif
+
+/*****************************************************************************/
+
+/* Ecc_Correct()
+ *
+ * Corrects the errors of a codeword from its syndromes s, which are
+ * turned into log form. Symbols of the codeword are stride apart in
+ * data. Returns false, leaving data alone, if they can't be corrected
+ */
+static bool Ecc_Correct(uint8_t *s, uint8_t *data, int stride, int pad) {
   int i, j, r, k, deg_lambda, el, deg_omega;
   int syn_error;
   uint8_t q, tmp, num1, num2, den, discr_r;
   uint8_t lambda[33], b[33], reg[33], t[33], omega[33];
-  uint8_t root[32], s[32], loc[32];
-  uint8_t *data;
+  uint8_t root[32], loc[32];
   int result = 0; /* holds amount of errors fixed */
 
-  data = idata;
-  for( i = 0; i < 32; i++ )
-    s[i] = data[0];
-  for( j = 1; j < 255 - pad; j++ )
-    for( i = 0; i < 32; i++ )
-      if( s[i] == 0 ) s[i] = data[j];
-      else s[i] = data[j] ^ alpha[ (indx[s[i]] + (112 + i) * 11) % 255 ];
-
   syn_error = 0;
   for( i = 0; i < 32; i++ )
   {
@@ -135,7 +326,7 @@ bool Ecc_Decode(uint8_t *idata, int pad) {
     discr_r = 0;
     for( i = 0; i < r; i++ )
       if( (lambda[i] != 0) && (s[r - i - 1] != 255) )
-        discr_r ^= alpha[ (indx[lambda[i]] + s[r - i - 1]) % 255 ];
+        discr_r ^= alpha2[ indx[lambda[i]] + s[r - i - 1] ];
 
     discr_r = indx[discr_r];
     if( discr_r == 255 )
@@ -149,7 +340,7 @@ bool Ecc_Decode(uint8_t *idata, int pad) {
       for( i = 0; i < 32; i++ )
       {
         if( b[i] != 255 )
-          t[i + 1] = lambda[i + 1] ^ alpha[ (discr_r + b[i]) % 255 ];
+          t[i + 1] = lambda[i + 1] ^ alpha2[ discr_r + b[i] ];
         else
           t[i + 1] = lambda[i + 1];
       }
@@ -225,7 +416,7 @@ bool Ecc_Decode(uint8_t *idata, int pad) {
     tmp = 0;
     for( j = i; j >= 0; j-- )
       if( (s[i - j] != 255) && (lambda[j] != 255) )
-        tmp ^= alpha[ (s[i - j] + lambda[j]) % 255 ];
+        tmp ^= alpha2[ s[i - j] + lambda[j] ];
     omega[i] = indx[tmp];
   }
 
@@ -250,7 +441,8 @@ bool Ecc_Decode(uint8_t *idata, int pad) {
     }
 
     if( (num1 != 0) && (loc[j] >= pad) )
-      data[loc[j] - pad] ^= alpha[ (indx[num1] + indx[num2] + 255 - indx[den]) % 255 ];
+      data[(loc[j] - pad) * stride] ^=
+        alpha[ (indx[num1] + indx[num2] + 255 - indx[den]) % 255 ];
   }
 
   return true;
@@ -258,6 +450,98 @@ bool Ecc_Decode(uint8_t *idata, int pad) {
 
 /*****************************************************************************/
 
+/* Ecc_Decode()
+ *
+ * Corrects a (255 - pad) long codeword in place,
+ * false if it has more errors than can be corrected
+ */
+bool Ecc_Decode(uint8_t *idata, int pad) {
+  uint8_t s[ECC_PARITY_LEN];
+  int i, j;
+
+  pthread_once( &tables_once, Ecc_Init_Tables );
+
+  for( i = 0; i < ECC_PARITY_LEN; i++ )
+  {
+    s[i] = idata[0];
+    for( j = 1; j < ECC_BLOCK_LEN - pad; j++ )
+      s[i] = Gf_Mul( s[i], syn_root[i] ) ^ idata[j];
+  }
+
+  return( Ecc_Correct(s, idata, 1, pad) );
+}
+
+/*****************************************************************************/
+
+/* Ecc_Decode_Interleaved()
+ *
+ * Corrects in place the ECC_INTERLEAVE codewords interleaved symbol
+ * by symbol in data, as they are in a frame, without copying them out.
+ * ok[] tells which ones were corrected, true if all of them were.
+ * Codewords free of errors, with all syndromes zero, cost no more
+ */
+bool Ecc_Decode_Interleaved(uint8_t *data, bool *ok) {
+  uint8_t s[ECC_INTERLEAVE][ECC_PARITY_LEN];
+  bool result = true;
+  int c;
+
+  pthread_once( &tables_once, Ecc_Init_Tables );
+
+#ifdef ECC_X86_SSSE3
+  if( __builtin_cpu_supports("ssse3") )
+    Ecc_Syndromes_SSSE3( data, s );
+  else
+#endif
+    Ecc_Syndromes_Generic( data, s );
+
+  for( c = 0; c < ECC_INTERLEAVE; c++ )
+  {
+    ok[c] = Ecc_Correct( s[c], data + c, ECC_INTERLEAVE, 0 );
+    result = result && ok[c];
+  }
+
+  return( result );
+}
+
+/*****************************************************************************/
+
+/* Ecc_Encode()
+ *
+ * Systematic RS(255,223) encoder, the counterpart of Ecc_Decode().
+ * Computes the 32 parity bytes of the (255 - pad) long codeword in
+ * data from the data bytes in front of them and stores them at its end
+ */
+void Ecc_Encode(uint8_t *data, int pad) {
+  uint8_t parity[ECC_PARITY_LEN];
+  uint8_t fb;
+  int i, j;
+
+  pthread_once( &tables_once, Ecc_Init_Tables );
+
+  bzero( parity, sizeof(parity) );
+  for( i = 0; i < 255 - ECC_PARITY_LEN - pad; i++ )
+  {
+    fb = indx[ data[i] ^ parity[0] ];
+
+    /* Shift the remainder and add the feedback times the generator */
+    for( j = 0; j < ECC_PARITY_LEN - 1; j++ )
+    {
+      parity[j] = parity[j + 1];
+      if( fb != 255 )
+        parity[j] ^= alpha[ (fb + genpoly[ECC_PARITY_LEN - 1 - j]) % 255 ];
+    }
+
+    if( fb != 255 )
+      parity[ECC_PARITY_LEN - 1] = alpha[ (fb + genpoly[0]) % 255 ];
+    else
+      parity[ECC_PARITY_LEN - 1] = 0;
+  }
+
+  memcpy( &data[255 - ECC_PARITY_LEN - pad], parity, ECC_PARITY_LEN );
+}
+
+/*****************************************************************************/
+
 void Ecc_Deinterleave(uint8_t *data, uint8_t *output, int pos, int n) {
   int i;
   for( i = 0; i < 255; i++ )
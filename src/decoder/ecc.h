@@ -22,9 +22,14 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+/* RS codewords interleaved symbol by symbol in a frame */
+#define ECC_INTERLEAVE  4
+
 /*****************************************************************************/
 
 bool Ecc_Decode(uint8_t *idata, int pad);
+bool Ecc_Decode_Interleaved(uint8_t *data, bool *ok);
+void Ecc_Encode(uint8_t *data, int pad);
 void Ecc_Deinterleave(uint8_t *data, uint8_t *output, int pos, int n);
 void Ecc_Interleave(uint8_t *data, uint8_t *output, int pos, int n);
 
@@ -16,24 +16,46 @@
 
 #include "huffman.h"
 
-#include "../common/shared.h"
-#include "../glrpt/utils.h"
-
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 /*****************************************************************************/
 
-static int Get_AC_Real(const uint16_t w);
 static int Get_DC_Real(const uint16_t w);
+static void Add_AC_Code(uint32_t code, int len, int run, int size);
+
+/*****************************************************************************/
+
+/* Bits looked up by the primary AC table. Longer codes, up to 16 bits,
+ * link to a secondary table of their remaining bits. All DC codes fit */
+#define HUFF_PRIMARY_BITS   9
+#define HUFF_SECONDARY_BITS ( 16 - HUFF_PRIMARY_BITS )
+
+/* Primary entries that link to a secondary table, and how many
+ * of those there may be. The standard table needs 5 of them */
+#define AC_LINK             0x8000
+#define AC_LINK_MAX         8
 
 /*****************************************************************************/
 
-static int ac_lookup[65536];
-static int dc_lookup[65536];
+/* AC codes by their first bits, and by their last bits if longer */
+static ac_code_t ac_primary[1 << HUFF_PRIMARY_BITS];
+static ac_code_t ac_secondary[AC_LINK_MAX << HUFF_SECONDARY_BITS];
+static int ac_links;
 
-static uint8_t t_ac_0[178] = {
+/* DC category by the first bits of the code, -1 if there is none */
+static int8_t dc_lookup[1 << HUFF_PRIMARY_BITS];
+
+/* Standard JPEG luminance tables, as in a DHT segment: the number
+ * of codes of each length from 1 to 16 bits, then their symbols */
+const uint8_t t_dc_0[28] = {
+    0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11
+};
+
+const uint8_t t_ac_0[178] = {
     0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4,
     4, 0, 0, 1, 125, 1, 2, 3, 0, 4, 17,
     5, 18, 33, 49, 65, 6, 19, 81, 97, 7, 34,
@@ -55,29 +77,29 @@ static uint8_t t_ac_0[178] = {
 
 /*****************************************************************************/
 
-int Get_AC(const uint16_t w) {
-  return( ac_lookup[w] );
-}
+/* Get_AC()
+ *
+ * Returns the AC code at the top of w, 0 if there is no matching code
+ */
+ac_code_t Get_AC(const uint16_t w) {
+  ac_code_t code = ac_primary[ w >> HUFF_SECONDARY_BITS ];
 
-/*****************************************************************************/
+  if( code & AC_LINK )
+    code = ac_secondary[ (code & ~AC_LINK) +
+      (w & ((1 << HUFF_SECONDARY_BITS) - 1)) ];
 
-int Get_DC(const uint16_t w) {
-  return( dc_lookup[w] );
+  return( code );
 }
 
 /*****************************************************************************/
 
-static int Get_AC_Real(const uint16_t w) {
-  int i;
-
-  for( i = 0; (size_t)i < ac_table_len; i++ )
-  {
-    if( ((w >> (16 - ac_table[i].len)) &
-          ac_table[i].mask) == ac_table[i].code )
-      return( i );
-  }
-
-  return( -1 );
+/* Get_DC()
+ *
+ * Returns the DC category of the code at the top of w, -1 if none.
+ * The longest DC code has 9 bits, so the primary bits do
+ */
+int Get_DC(const uint16_t w) {
+  return( dc_lookup[ w >> HUFF_SECONDARY_BITS ] );
 }
 
 /*****************************************************************************/
@@ -105,6 +127,46 @@ static int Get_DC_Real(const uint16_t w) {
 
 /*****************************************************************************/
 
+/* Add_AC_Code()
+ *
+ * Enters an AC code of len bits into the lookup tables
+ */
+static void Add_AC_Code(uint32_t code, int len, int run, int size) {
+  ac_code_t entry;
+  uint32_t first, num, i;
+  int prefix;
+
+  entry = (ac_code_t)( (len << 8) | (run << 4) | size );
+
+  if( len <= HUFF_PRIMARY_BITS )
+  {
+    /* All primary entries that start with the code */
+    first = code << ( HUFF_PRIMARY_BITS - len );
+    num   = 1u << ( HUFF_PRIMARY_BITS - len );
+    for( i = 0; i < num; i++ )
+      ac_primary[first + i] = entry;
+    return;
+  }
+
+  /* Longer codes go to the secondary table of their primary bits */
+  prefix = (int)( code >> (len - HUFF_PRIMARY_BITS) );
+  if( !(ac_primary[prefix] & AC_LINK) )
+  {
+    if( ac_links == AC_LINK_MAX ) return;
+    ac_primary[prefix] =
+      (ac_code_t)( AC_LINK | (ac_links << HUFF_SECONDARY_BITS) );
+    ac_links++;
+  }
+
+  first = ( code & ((1u << (len - HUFF_PRIMARY_BITS)) - 1) ) << ( 16 - len );
+  first += ac_primary[prefix] & ~AC_LINK;
+  num    = 1u << ( 16 - len );
+  for( i = 0; i < num; i++ )
+    ac_secondary[first + i] = entry;
+}
+
+/*****************************************************************************/
+
 int Map_Range(const int cat, const int vl) {
   int maxval, result;
   bool sig;
@@ -123,9 +185,9 @@ int Map_Range(const int cat, const int vl) {
 /*****************************************************************************/
 
 void Default_Huffman_Table(void) {
-  int k, i, n;
+  int k, i;
   uint32_t code;
-  uint8_t *t;
+  const uint8_t *t;
   int p;
   uint8_t v[65536];
   uint16_t min_code[17], maj_code[17];
@@ -156,10 +218,10 @@ void Default_Huffman_Table(void) {
     }
   }
 
-  ac_table_len = 256;
-  mem_alloc( (void **)&ac_table, ac_table_len * sizeof(ac_table_rec_t)) ;
+  memset( ac_primary, 0, sizeof(ac_primary) );
+  memset( ac_secondary, 0, sizeof(ac_secondary) );
+  ac_links = 0;
 
-  n = 0;
   min_valn = 1;
   max_valn = 1;
   for( k = 1; k <= 16; k++ )
@@ -174,23 +236,13 @@ void Default_Huffman_Table(void) {
         size_val = v[(k << 8) + i - (int)min_val];
         run = size_val >> 4;
         size = size_val & 0x0F;
-        ac_table[n].run  = run;
-        ac_table[n].size = size;
-        ac_table[n].len  = k;
-        ac_table[n].mask = (1 << k) - 1;
-        ac_table[n].code = (uint32_t)i;
-        n++;
+        Add_AC_Code( (uint32_t)i, k, run, size );
       }
     }
     min_valn++;
     max_valn++;
   }
 
-  ac_table_len = (size_t)n;
-  mem_realloc( (void **)&ac_table, ac_table_len * sizeof(ac_table_rec_t) );
-
-  for( i = 0; i <= 65535; i++ )
-    ac_lookup[i] = Get_AC_Real((uint16_t)i);
-  for( i = 0; i <= 65535; i++ )
-    dc_lookup[i] = Get_DC_Real((uint16_t)i);
+  for( i = 0; i < (1 << HUFF_PRIMARY_BITS); i++ )
+    dc_lookup[i] = (int8_t)Get_DC_Real( (uint16_t)(i << HUFF_SECONDARY_BITS) );
 }
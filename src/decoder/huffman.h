@@ -23,15 +23,23 @@
 
 /*****************************************************************************/
 
-/* Decoder AC table data */
-typedef struct ac_table_rec_t {
-  int run, size, len;
-  uint32_t mask, code;
-} ac_table_rec_t;
+/* AC code found by Get_AC(), packed in 16 bits: the length of the
+ * code, the run of zeros before the value and the size of the value.
+ * 0 if there is no such code */
+typedef uint16_t ac_code_t;
+
+#define AC_CODE_LEN(c)      ( ((c) >> 8) & 0x1F )
+#define AC_CODE_RUN(c)      ( ((c) >> 4) & 0x0F )
+#define AC_CODE_SIZE(c)     ( (c) & 0x0F )
+
+/*****************************************************************************/
+
+extern const uint8_t t_dc_0[28];
+extern const uint8_t t_ac_0[178];
 
 /*****************************************************************************/
 
-int Get_AC(const uint16_t w);
+ac_code_t Get_AC(const uint16_t w);
 int Get_DC(const uint16_t w);
 int Map_Range(const int cat, const int vl);
 void Default_Huffman_Table(void);
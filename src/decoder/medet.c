@@ -17,20 +17,17 @@
 #include "medet.h"
 
 #include "../common/common.h"
-#include "../common/shared.h"
-#include "../glrpt/display.h"
 #include "../glrpt/utils.h"
+#include "../image/image.h"
 #include "correlator.h"
+#include "huffman.h"
 #include "met_jpg.h"
 #include "met_packet.h"
 #include "met_to_data.h"
 
-#include <glib.h>
-#include <gtk/gtk.h>
-
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
-#include <stdio.h>
 
 /*****************************************************************************/
 
@@ -38,82 +35,121 @@
 
 /*****************************************************************************/
 
-static int ok_cnt, total_cnt;
+static void Medet_Init_Tables(void);
 
 /*****************************************************************************/
 
-void Medet_Init(void) {
-  int idx;
+/* Lookup tables are shared by all decoder contexts */
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
 
-  /* Initialize things */
+/*****************************************************************************/
+
+/* Medet_Init_Tables()
+ *
+ * Builds the correlator and Huffman lookup tables
+ */
+static void Medet_Init_Tables(void) {
   Init_Correlator_Tables();
-  Mj_Init();
-  Mtd_Init( &mtd_record );
-
-  /* Channel_image[idx] is free'd and set to NULL if
-   * already allocated, otherwise it is only set to NULL */
-  for( idx = 0; idx < CHANNEL_IMAGE_NUM; idx++ )
-    free_ptr( (void **)&channel_image[idx] );
-  channel_image_size = 0;
-  channel_image_width = METEOR_IMAGE_WIDTH;
-
-  ok_cnt    = 0;
-  total_cnt = 1;
+  Default_Huffman_Table();
+}
+
+/*****************************************************************************/
+
+/* Medet_Init()
+ *
+ * Creates an image decoder context that decodes
+ * into the given set of channel images
+ */
+medet_t *Medet_Init(const medet_params_t *params, channel_images_t *images) {
+  medet_t *ctx = NULL;
+
+  pthread_once( &tables_once, Medet_Init_Tables );
+
+  mem_alloc( (void **)&ctx, sizeof(medet_t) );
+  ctx->params = *params;
+  ctx->images = images;
+
+  /* Initialize things */
+  Mj_Init( &(ctx->jpeg) );
+  Mj_Set_Idct( &(ctx->jpeg), params->idct );
+  Mtd_Init( &(ctx->mtd) );
+  ctx->packet.partial    = false;
+  ctx->packet.last_frame = 0;
+  ctx->packet.off        = 0;
+
+  /* Channel images are free'd if already allocated */
+  Channel_Images_Reset( images );
+
+  /* Clear decoder status */
+  ctx->ok_cnt    = 0;
+  ctx->total_cnt = 1;
+  ctx->frame_ok  = false;
+  ctx->ob_time_valid = false;
+  for( int idx = 0; idx < CHANNEL_IMAGE_NUM; idx++ )
+  {
+    ctx->image_lines[idx] = 0;
+    ctx->mcu_ok[idx]      = 0;
+  }
+
+  return( ctx );
 }
 
 /*****************************************************************************/
 
 /* Medet_Deinit()
  *
- * My addition, de-inits the met decoder (free's buffer pointers)
+ * My addition, de-inits the met decoder (free's its context).
+ * The channel images are left to the caller, complete
+ */
+void Medet_Deinit(medet_t *ctx) {
+  if( ctx == NULL ) return;
+
+  Mj_Flush( ctx );
+  Mtd_Deinit( &(ctx->mtd) );
+  free_ptr( (void **)&ctx );
+}
+
+/*****************************************************************************/
+
+/* Medet_Flush()
+ *
+ * Completes the channel images with all image packets decoded
+ * so far, the last of which may still wait for their IDCT
  */
-void Medet_Deinit(void) {
-  free_ptr( (void **)&(mtd_record.v.pair_distances) );
-  free_ptr( (void **)&ac_table );
-  uint8_t **dec = ret_decoded();
-  free_ptr( (void **)dec );
+void Medet_Flush(medet_t *ctx) {
+  if( ctx == NULL ) return;
+
+  Mj_Flush( ctx );
 }
 
 /*****************************************************************************/
 
 /* Decode_Image()
  *
- * Decodes images from soft symbols supplied by the demodulator
+ * Decodes images from soft symbols supplied by the demodulator.
+ * in_buffer holds soft symbols of which the frames that start in
+ * the first buf_len are decoded, reading up to 2 * buf_len ahead.
+ * The demodulator then shifts the buffer up by buf_len for the
+ * next call, so the frame positions are rebased here to match
  */
-void Decode_Image(uint8_t *in_buffer, int buf_len) {
+void Decode_Image(medet_t *ctx, uint8_t *in_buffer, int buf_len) {
+  mtd_rec_t *mtd = &(ctx->mtd);
   bool ok;
-  gchar txt[16];
 
-  while( mtd_record.pos < buf_len )
+  while( mtd->pos < buf_len )
   {
-    ok = Mtd_One_Frame( &mtd_record, in_buffer );
+    ok = Mtd_One_Frame( mtd, in_buffer );
     if (ok) {
-      Parse_Cvcdu( mtd_record.ecced_data, HARD_FRAME_LEN - 132 );
-      ok_cnt++;
-
-      if( isFlagClear(FRAME_OK_ICON) )
-      {
-        Display_Icon( frame_icon, "gtk-yes" );
-        SetFlag( FRAME_OK_ICON );
-      }
-    }
-    else {
-      if( isFlagSet(FRAME_OK_ICON) )
-      {
-        Display_Icon( frame_icon, "gtk-no" );
-        ClearFlag( FRAME_OK_ICON );
-      }
+      Parse_Cvcdu( ctx, mtd->ecced_data, HARD_FRAME_LEN - 132 );
+      ctx->ok_cnt++;
     }
 
-    total_cnt++;
+    ctx->frame_ok = ok;
+    ctx->total_cnt++;
   }
 
-  /* Print decoder status data */
-  snprintf( txt, sizeof(txt), "%d", mtd_record.sig_q );
-  gtk_entry_set_text( GTK_ENTRY(sig_quality_entry), txt );
-  int percent = ( 100 * ok_cnt ) / total_cnt;
-  snprintf( txt, sizeof(txt), "%d:%d%%", ok_cnt, percent );
-  gtk_entry_set_text( GTK_ENTRY(packet_cnt_entry), txt );
+  mtd->pos      -= buf_len;
+  mtd->prev_pos -= buf_len;
 }
 
 /*****************************************************************************/
@@ -122,8 +158,8 @@ void Decode_Image(uint8_t *in_buffer, int buf_len) {
  *
  * Returns the signal quality in the range 0.0--1.0
  */
-double Sig_Quality(void) {
-    double ret = (double)mtd_record.sig_q / SIG_QUAL_RANGE;
+double Sig_Quality(const medet_t *ctx) {
+    double ret = (double)ctx->mtd.sig_q / SIG_QUAL_RANGE;
 
     return dClamp(ret, 0.0, 1.0);
 }
@@ -19,14 +19,71 @@
 
 /*****************************************************************************/
 
+#include "../common/common.h"
+#include "../image/image.h"
+#include "met_jfif.h"
+#include "met_jpg.h"
+#include "met_packet.h"
+#include "met_to_data.h"
+
+#include <stdbool.h>
 #include <stdint.h>
 
 /*****************************************************************************/
 
-void Medet_Init(void);
-void Medet_Deinit(void);
-void Decode_Image(uint8_t *in_buffer, int buf_len);
-double Sig_Quality(void);
+/* Image decoder parameters, from the satellite's config */
+typedef struct medet_params_t {
+    /* APIDs of the red, green and blue channel images */
+    uint32_t apid[CHANNEL_IMAGE_NUM];
+
+    /* APIDs of channels to be palette inverted */
+    uint32_t invert_palette[CHANNEL_IMAGE_NUM];
+
+    /* Stores of each channel's image packets as received, owned
+     * by the caller. NULL if the packets are not to be kept */
+    jfif_store_t *jfif;
+
+    /* Inverse DCT of the JPEG decoder, IDCT_IMPL_AUTO for the fastest */
+    idct_impl_t idct;
+} medet_params_t;
+
+/* Image decoder context, one per decoded stream of soft symbols */
+typedef struct medet_t {
+    medet_params_t params;
+
+    /* Frame synchronizer, Viterbi and Reed-Solomon decoder */
+    mtd_rec_t mtd;
+
+    /* Packet reassembly and JPEG decoder state */
+    packet_rec_t packet;
+    mj_rec_t jpeg;
+
+    /* Decoded channel images, owned by the caller */
+    channel_images_t *images;
+
+    /* Count of good and total frames, status of the last one */
+    int  ok_cnt, total_cnt;
+    bool frame_ok;
+
+    /* Satellite's onboard time */
+    bool    ob_time_valid;
+    uint8_t ob_hour, ob_min, ob_sec;
+
+    /* Decoded image lines of each channel */
+    int image_lines[CHANNEL_IMAGE_NUM];
+
+    /* MCUs received of each channel, out of METEOR_IMAGE_WIDTH / 8
+     * in each MCU row up to its decoded image lines */
+    int mcu_ok[CHANNEL_IMAGE_NUM];
+} medet_t;
+
+/*****************************************************************************/
+
+medet_t *Medet_Init(const medet_params_t *params, channel_images_t *images);
+void Medet_Deinit(medet_t *ctx);
+void Medet_Flush(medet_t *ctx);
+void Decode_Image(medet_t *ctx, uint8_t *in_buffer, int buf_len);
+double Sig_Quality(const medet_t *ctx);
 
 /*****************************************************************************/
 
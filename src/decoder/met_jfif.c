@@ -0,0 +1,553 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * Saves a channel image as the JPEG data Meteor sends, without decoding
+ * it. Each image packet holds 14 MCUs, Huffman coded with the standard
+ * JPEG tables and their DC predicted from the packet's first MCU only,
+ * so it makes a restart interval of a baseline JPEG file as it is.
+ * If the whole image has the same quality, with a quantization table
+ * of 8 bit entries, the packets are copied bit for bit under it.
+ * Otherwise, or to invert the palette, their coefficients are dequantized and Huffman coded again
+ * under a table of ones. Either way no IDCT is done and nothing of the
+ * received image is lost. Missing packets are filled with black.
+ */
+
+/*****************************************************************************/
+
+#include "met_jfif.h"
+
+#include "../common/common.h"
+#include "../glrpt/utils.h"
+#include "bitop.h"
+#include "huffman.h"
+#include "met_jpg.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/*****************************************************************************/
+
+/* JPEG markers */
+#define JFIF_SOI    0xD8
+#define JFIF_EOI    0xD9
+#define JFIF_APP0   0xE0
+#define JFIF_DQT    0xDB
+#define JFIF_SOF0   0xC0
+#define JFIF_DHT    0xC4
+#define JFIF_DRI    0xDD
+#define JFIF_SOS    0xDA
+#define JFIF_RST0   0xD0
+
+/* Largest DC and AC values of 8 bit baseline JPEG */
+#define JFIF_DC_MIN (-1024)
+#define JFIF_DC_MAX 1023
+#define JFIF_AC_MAX 1023
+
+/* Most lines a JPEG file can hold, 65535 pixels high */
+#define JFIF_LINES_MAX  ( 65535 / 8 )
+
+/*****************************************************************************/
+
+/* Huffman code of a JPEG symbol */
+typedef struct jfif_code_t {
+    uint16_t code;
+    uint8_t  len;
+} jfif_code_t;
+
+/* Entropy coded data writer, stuffs a zero after each 0xFF byte */
+typedef struct jfif_writer_t {
+    FILE *fp;
+
+    /* Bits not yet written, right aligned, and their number */
+    uint64_t acc;
+    int cnt;
+} jfif_writer_t;
+
+/*****************************************************************************/
+
+static void Jfif_Make_Codes(const uint8_t *table, jfif_code_t *codes);
+static void Jfif_Make_Tables(void);
+static void Put_Byte(jfif_writer_t *w, int byte);
+static void Put_Word(jfif_writer_t *w, int word);
+static void Put_Bits(jfif_writer_t *w, uint32_t bits, int n);
+static void Put_Pad(jfif_writer_t *w);
+static void Put_Value(jfif_writer_t *w, const jfif_code_t *code, int value, int cat);
+static int Value_Category(int value);
+static void Put_Block(jfif_writer_t *w, const int16_t *blk, int *prev_dc);
+static void Put_Headers(jfif_writer_t *w, const int *dqt, int lines);
+static void Put_Packet_Copy(jfif_writer_t *w, const uint8_t *data, uint32_t bits);
+static void Put_Packet_Recoded(
+        jfif_writer_t *w, const uint8_t *data, uint32_t bits, uint8_t q, bool invert);
+static void Put_Packet_Black(jfif_writer_t *w, const int *dqt);
+
+/*****************************************************************************/
+
+/* Huffman codes of the DC categories and AC symbols */
+static jfif_code_t dc_codes[16];
+static jfif_code_t ac_codes[256];
+static pthread_once_t codes_once = PTHREAD_ONCE_INIT;
+
+/*****************************************************************************/
+
+/* Jfif_Make_Codes()
+ *
+ * Assigns the canonical Huffman codes of a
+ * table, laid out as in DHT, to its symbols
+ */
+static void Jfif_Make_Codes(const uint8_t *table, jfif_code_t *codes) {
+  const uint8_t *vals = table + 16;
+  uint16_t code = 0;
+  int len, i;
+
+  for( len = 1; len <= 16; len++ )
+  {
+    for( i = 0; i < table[len - 1]; i++ )
+    {
+      codes[*vals++] = (jfif_code_t){ code, (uint8_t)len };
+      code++;
+    }
+    code <<= 1;
+  }
+}
+
+/*****************************************************************************/
+
+static void Jfif_Make_Tables(void) {
+  Jfif_Make_Codes( t_dc_0, dc_codes );
+  Jfif_Make_Codes( t_ac_0, ac_codes );
+}
+
+/*****************************************************************************/
+
+/* Put_Byte()
+ *
+ * Writes a byte of a marker segment as it is
+ */
+static void Put_Byte(jfif_writer_t *w, int byte) {
+  putc( byte, w->fp );
+}
+
+/*****************************************************************************/
+
+static void Put_Word(jfif_writer_t *w, int word) {
+  putc( (word >> 8) & 0xFF, w->fp );
+  putc( word & 0xFF, w->fp );
+}
+
+/*****************************************************************************/
+
+/* Put_Bits()
+ *
+ * Writes the n (up to 32) low bits of bits to entropy coded data
+ */
+static void Put_Bits(jfif_writer_t *w, uint32_t bits, int n) {
+  int byte;
+
+  if( n == 0 ) return;
+
+  w->acc = ( w->acc << n ) | ( bits & (0xFFFFFFFFu >> (32 - n)) );
+  w->cnt += n;
+  while( w->cnt >= 8 )
+  {
+    w->cnt -= 8;
+    byte = (int)( (w->acc >> w->cnt) & 0xFF );
+    putc( byte, w->fp );
+    if( byte == 0xFF ) putc( 0x00, w->fp );
+  }
+}
+
+/*****************************************************************************/
+
+/* Put_Pad()
+ *
+ * Pads entropy coded data with ones to a whole byte
+ */
+static void Put_Pad(jfif_writer_t *w) {
+  if( w->cnt ) Put_Bits( w, 0x7F, 8 - w->cnt );
+}
+
+/*****************************************************************************/
+
+/* Value_Category()
+ *
+ * JPEG magnitude category of a value, its number of bits
+ */
+static int Value_Category(int value) {
+  int cat = 0;
+
+  if( value < 0 ) value = -value;
+  while( value )
+  {
+    cat++;
+    value >>= 1;
+  }
+
+  return( cat );
+}
+
+/*****************************************************************************/
+
+/* Put_Value()
+ *
+ * Writes the Huffman code of a symbol and the
+ * cat bits of a value, the inverse of Map_Range()
+ */
+static void Put_Value(jfif_writer_t *w, const jfif_code_t *code, int value, int cat) {
+  Put_Bits( w, code->code, code->len );
+  if( value < 0 ) value += ( 1 << cat ) - 1;
+  Put_Bits( w, (uint32_t)value, cat );
+}
+
+/*****************************************************************************/
+
+/* Put_Block()
+ *
+ * Huffman codes an MCU of coefficients in natural order, clamped
+ * to the range of baseline JPEG. prev_dc is that of the MCU before
+ */
+static void Put_Block(jfif_writer_t *w, const int16_t *blk, int *prev_dc) {
+  int dc, value, run, cat, k;
+
+  dc = blk[0];
+  if( dc < JFIF_DC_MIN ) dc = JFIF_DC_MIN;
+  if( dc > JFIF_DC_MAX ) dc = JFIF_DC_MAX;
+  cat = Value_Category( dc - *prev_dc );
+  Put_Value( w, &dc_codes[cat], dc - *prev_dc, cat );
+  *prev_dc = dc;
+
+  run = 0;
+  for( k = 1; k < 64; k++ )
+  {
+    value = blk[ mj_unzigzag[k] ];
+    if( value == 0 )
+    {
+      run++;
+      continue;
+    }
+    if( value >  JFIF_AC_MAX ) value =  JFIF_AC_MAX;
+    if( value < -JFIF_AC_MAX ) value = -JFIF_AC_MAX;
+
+    /* Runs of 16 zeros */
+    for( ; run > 15; run -= 16 )
+      Put_Bits( w, ac_codes[0xF0].code, ac_codes[0xF0].len );
+
+    cat = Value_Category( value );
+    Put_Value( w, &ac_codes[(run << 4) | cat], value, cat );
+    run = 0;
+  }
+
+  /* End of block */
+  if( run ) Put_Bits( w, ac_codes[0x00].code, ac_codes[0x00].len );
+}
+
+/*****************************************************************************/
+
+/* Put_Headers()
+ *
+ * Writes the marker segments up to the start of the scan: a single
+ * component image of the given lines of MCUs, quantization table dqt
+ * (in zigzag order), the standard Huffman tables and a restart
+ * interval of an image packet
+ */
+static void Put_Headers(jfif_writer_t *w, const int *dqt, int lines) {
+  static const char jfif_id[5] = { 'J', 'F', 'I', 'F', '\0' };
+  int i;
+
+  Put_Byte( w, 0xFF );
+  Put_Byte( w, JFIF_SOI );
+
+  /* JFIF 1.01, no density units, no thumbnail */
+  Put_Byte( w, 0xFF );
+  Put_Byte( w, JFIF_APP0 );
+  Put_Word( w, 16 );
+  for( i = 0; i < 5; i++ ) Put_Byte( w, jfif_id[i] );
+  Put_Word( w, 0x0101 );
+  Put_Byte( w, 0 );
+  Put_Word( w, 1 );
+  Put_Word( w, 1 );
+  Put_Byte( w, 0 );
+  Put_Byte( w, 0 );
+
+  /* 8 bit table 0 */
+  Put_Byte( w, 0xFF );
+  Put_Byte( w, JFIF_DQT );
+  Put_Word( w, 2 + 1 + 64 );
+  Put_Byte( w, 0x00 );
+  for( i = 0; i < 64; i++ ) Put_Byte( w, dqt[i] );
+
+  /* Baseline, 8 bit grayscale */
+  Put_Byte( w, 0xFF );
+  Put_Byte( w, JFIF_SOF0 );
+  Put_Word( w, 2 + 6 + 3 );
+  Put_Byte( w, 8 );
+  Put_Word( w, lines * 8 );
+  Put_Word( w, METEOR_IMAGE_WIDTH );
+  Put_Byte( w, 1 );
+  Put_Byte( w, 1 );
+  Put_Byte( w, 0x11 );
+  Put_Byte( w, 0 );
+
+  /* DC table 0 and AC table 0 */
+  Put_Byte( w, 0xFF );
+  Put_Byte( w, JFIF_DHT );
+  Put_Word( w, 2 + 1 + (int)sizeof(t_dc_0) + 1 + (int)sizeof(t_ac_0) );
+  Put_Byte( w, 0x00 );
+  for( i = 0; i < (int)sizeof(t_dc_0); i++ ) Put_Byte( w, t_dc_0[i] );
+  Put_Byte( w, 0x10 );
+  for( i = 0; i < (int)sizeof(t_ac_0); i++ ) Put_Byte( w, t_ac_0[i] );
+
+  Put_Byte( w, 0xFF );
+  Put_Byte( w, JFIF_DRI );
+  Put_Word( w, 4 );
+  Put_Word( w, MCU_PER_PACKET );
+
+  /* All coefficients of the component in one scan */
+  Put_Byte( w, 0xFF );
+  Put_Byte( w, JFIF_SOS );
+  Put_Word( w, 2 + 1 + 2 + 3 );
+  Put_Byte( w, 1 );
+  Put_Byte( w, 1 );
+  Put_Byte( w, 0x00 );
+  Put_Byte( w, 0 );
+  Put_Byte( w, 63 );
+  Put_Byte( w, 0 );
+}
+
+/*****************************************************************************/
+
+/* Put_Packet_Copy()
+ *
+ * Copies the Huffman coded MCUs of a packet bit for bit
+ */
+static void Put_Packet_Copy(jfif_writer_t *w, const uint8_t *data, uint32_t bits) {
+  bit_reader_t b;
+  int n;
+
+  Bitop_ReaderCreate( &b, data, (int)((bits + 7) / 8) );
+  while( bits )
+  {
+    n = bits > 16 ? 16 : (int)bits;
+    Put_Bits( w, Bitop_Read(&b, n), n );
+    bits -= (uint32_t)n;
+  }
+}
+
+/*****************************************************************************/
+
+/* Put_Packet_Recoded()
+ *
+ * Huffman codes the MCUs of a packet again, dequantized for a
+ * table of ones, inverted (255 - pixel) if invert is set
+ */
+static void Put_Packet_Recoded(
+        jfif_writer_t *w, const uint8_t *data, uint32_t bits, uint8_t q, bool invert) {
+  bit_reader_t b;
+  int16_t blk[64];
+  int dqt[64];
+  int prev_dc = 0, out_dc = 0;
+  int m, i;
+
+  Fill_Dqt_by_Q( dqt, q );
+  Bitop_ReaderCreate( &b, data, (int)((bits + 7) / 8) );
+
+  for( m = 0; m < MCU_PER_PACKET; m++ )
+  {
+    /* Decoded before it was stored, so it cannot fail */
+    memset( blk, 0, sizeof(blk) );
+    Mj_Dec_Block( &b, blk, &prev_dc, dqt );
+
+    /* A DC of 8 is a level of 1 */
+    if( invert )
+    {
+      for( i = 0; i < 64; i++ ) blk[i] = (int16_t)( -blk[i] );
+      blk[0] = (int16_t)( blk[0] - 8 );
+    }
+
+    Put_Block( w, blk, &out_dc );
+  }
+}
+
+/*****************************************************************************/
+
+/* Put_Packet_Black()
+ *
+ * Writes MCUs of black for a packet not received
+ */
+static void Put_Packet_Black(jfif_writer_t *w, const int *dqt) {
+  int16_t blk[64];
+  int prev_dc = 0, m;
+
+  memset( blk, 0, sizeof(blk) );
+  blk[0] = (int16_t)( (JFIF_DC_MIN - dqt[0] / 2) / dqt[0] );
+  for( m = 0; m < MCU_PER_PACKET; m++ )
+    Put_Block( w, blk, &prev_dc );
+}
+
+/*****************************************************************************/
+
+/* Jfif_Store_Packet()
+ *
+ * Stores the Huffman coded MCUs of an image packet, bits long, at
+ * its place in the given line. The channel's palette is inverted
+ * if invert is set. Packets that do not start a restart interval
+ * of the image, 14 MCUs apart, are left out
+ */
+void Jfif_Store_Packet(
+        jfif_store_t *st,
+        int line,
+        int mcu_id,
+        const uint8_t *p,
+        uint32_t bits,
+        uint8_t q,
+        bool invert) {
+  jfif_pck_t *pck;
+  size_t len = ( bits + 7 ) / 8;
+  int lines;
+
+  if( (line < 0) || (line >= JFIF_LINES_MAX) || (bits == 0) ||
+      (mcu_id % MCU_PER_PACKET) ||
+      (mcu_id / MCU_PER_PACKET >= JFIF_PCK_PER_LINE) )
+    return;
+
+  /* New lines start with no packets */
+  if( line >= st->lines )
+  {
+    lines = line + 1;
+    mem_realloc( (void **)&(st->pcks),
+        (size_t)lines * JFIF_PCK_PER_LINE * sizeof(jfif_pck_t) );
+    memset( &(st->pcks[st->lines * JFIF_PCK_PER_LINE]), 0,
+        (size_t)(lines - st->lines) * JFIF_PCK_PER_LINE * sizeof(jfif_pck_t) );
+    st->lines = lines;
+  }
+
+  if( st->len + len > st->size )
+  {
+    st->size = 2 * ( st->len + len );
+    mem_realloc( (void **)&(st->data), st->size );
+  }
+
+  pck = &( st->pcks[line * JFIF_PCK_PER_LINE + mcu_id / MCU_PER_PACKET] );
+  pck->off  = (uint32_t)st->len;
+  pck->bits = bits;
+  pck->q    = q;
+  memcpy( st->data + st->len, p, len );
+  st->len += len;
+  st->invert = invert;
+}
+
+/*****************************************************************************/
+
+/* Jfif_Store_Reset()
+ *
+ * Frees the packets of a store, leaving it empty
+ */
+void Jfif_Store_Reset(jfif_store_t *st) {
+  free_ptr( (void **)&(st->data) );
+  free_ptr( (void **)&(st->pcks) );
+  st->len    = 0;
+  st->size   = 0;
+  st->lines  = 0;
+  st->invert = false;
+}
+
+/*****************************************************************************/
+
+/* Jfif_Write()
+ *
+ * Writes the stored packets of a channel as a baseline JPEG file.
+ * Returns false if there are none or the file fails to be written
+ */
+bool Jfif_Write(const jfif_store_t *st, const char *fname) {
+  jfif_writer_t w;
+  const jfif_pck_t *pck;
+  char mesg[MESG_SIZE];
+  int dqt[64];
+  int q = -1, idx, num, i;
+  bool copy = !st->invert, ok;
+
+  if( st->lines == 0 ) return( false );
+
+  pthread_once( &codes_once, Jfif_Make_Tables );
+
+  /* Packets are copied if all have the same quality */
+  num = st->lines * JFIF_PCK_PER_LINE;
+  for( idx = 0; idx < num; idx++ )
+  {
+    pck = &( st->pcks[idx] );
+    if( pck->bits == 0 ) continue;
+    if( q < 0 ) q = pck->q;
+    else if( pck->q != q ) copy = false;
+  }
+
+  /* Baseline DQT entries are 8 bit, some low qualities go over */
+  if( copy )
+  {
+    Fill_Dqt_by_Q( dqt, q );
+    for( i = 0; i < 64; i++ )
+      if( dqt[i] > 255 ) copy = false;
+  }
+  if( !copy )
+    for( i = 0; i < 64; i++ ) dqt[i] = 1;
+
+  w.fp = fopen( fname, "wb" );
+  if( w.fp == NULL )
+  {
+    snprintf( mesg, sizeof(mesg), "Failed saving image: %s", fname );
+    Show_Message( mesg, "red" );
+    return( false );
+  }
+  w.acc = 0;
+  w.cnt = 0;
+
+  Put_Headers( &w, dqt, st->lines );
+
+  /* A restart interval for each packet, markers in between */
+  for( idx = 0; idx < num; idx++ )
+  {
+    if( idx > 0 )
+    {
+      Put_Pad( &w );
+      Put_Byte( &w, 0xFF );
+      Put_Byte( &w, JFIF_RST0 + ((idx - 1) & 7) );
+    }
+
+    pck = &( st->pcks[idx] );
+    if( pck->bits == 0 )
+      Put_Packet_Black( &w, dqt );
+    else if( copy )
+      Put_Packet_Copy( &w, st->data + pck->off, pck->bits );
+    else
+      Put_Packet_Recoded( &w, st->data + pck->off,
+          pck->bits, pck->q, st->invert );
+  }
+
+  Put_Pad( &w );
+  Put_Byte( &w, 0xFF );
+  Put_Byte( &w, JFIF_EOI );
+
+  ok = !ferror( w.fp );
+  if( fclose(w.fp) != 0 ) ok = false;
+  if( !ok )
+  {
+    snprintf( mesg, sizeof(mesg), "Failed saving image: %s", fname );
+    Show_Message( mesg, "red" );
+  }
+
+  return( ok );
+}
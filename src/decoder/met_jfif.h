@@ -0,0 +1,72 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*****************************************************************************/
+
+#ifndef DECODER_MET_JFIF_H
+#define DECODER_MET_JFIF_H
+
+/*****************************************************************************/
+
+#include "../common/common.h"
+#include "met_jpg.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/* Image packets in a line of a channel */
+#define JFIF_PCK_PER_LINE   ( METEOR_IMAGE_WIDTH / 8 / MCU_PER_PACKET )
+
+/*****************************************************************************/
+
+/* A received image packet: offset of its Huffman coded MCUs
+ * in the store, their length in bits and the JPEG quality */
+typedef struct jfif_pck_t {
+    uint32_t off, bits;
+    uint8_t  q;
+} jfif_pck_t;
+
+/* Image packets of a channel as received, to save as a JPEG file */
+typedef struct jfif_store_t {
+    /* Huffman coded MCUs of the packets, back to back */
+    uint8_t *data;
+    size_t len, size;
+
+    /* Packets of each line, bits is 0 for those not received */
+    jfif_pck_t *pcks;
+    int lines;
+
+    /* Palette of the channel is inverted */
+    bool invert;
+} jfif_store_t;
+
+/*****************************************************************************/
+
+void Jfif_Store_Packet(
+        jfif_store_t *st,
+        int line,
+        int mcu_id,
+        const uint8_t *p,
+        uint32_t bits,
+        uint8_t q,
+        bool invert);
+void Jfif_Store_Reset(jfif_store_t *st);
+bool Jfif_Write(const jfif_store_t *st, const char *fname);
+
+/*****************************************************************************/
+
+#endif
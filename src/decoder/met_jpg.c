@@ -17,38 +17,27 @@
 #include "met_jpg.h"
 
 #include "../common/common.h"
-#include "../common/shared.h"
-#include "../glrpt/clahe.h"
-#include "../glrpt/image.h"
 #include "../glrpt/utils.h"
+#include "../image/image.h"
 #include "bitop.h"
 #include "dct.h"
 #include "huffman.h"
-#include "rectify_meteor.h"
+#include "medet.h"
+#include "met_jfif.h"
+#include "work_pool.h"
 
 #include <math.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 /*****************************************************************************/
 
-#define MCU_PER_PACKET  14
-
-/*****************************************************************************/
-
-static void Save_Images(int type);
-static void Fill_Dqt_by_Q(int *dqt, int q);
-static void Fill_Pix(double *img_dct, uint32_t apid, int mcu_id, int m);
-static bool Progress_Image(uint32_t apid, int mcu_id, int pck_cnt);
-
-/*****************************************************************************/
-
-static int last_mcu  = -1;
-static int cur_y     = 0;
-static int last_y    = -1;
-static int first_pck = 0;
-static int prev_pck  = 0;
+static inline int16_t Dequantize(int coef, int dqt);
+static int Channel_Of(medet_t *ctx, uint32_t apid, bool *invert);
+static bool Progress_Image(medet_t *ctx, uint32_t apid, int mcu_id, int pck_cnt);
+static void Mj_Idct_Job(void *arg, int idx);
 
 static const uint8_t standard_quantization_table[64] = {
     16,  11,  10,  16,  24,  40,  51,  61,
@@ -61,182 +50,28 @@ static const uint8_t standard_quantization_table[64] = {
     72,  92,  95,  98, 112, 100, 103,  99
 };
 
-static const uint8_t zigzag[64] = {
-    0,  1,  5,  6, 14, 15, 27, 28,
-    2,  4,  7, 13, 16, 26, 29, 42,
-    3,  8, 12, 17, 25, 30, 41, 43,
-    9, 11, 18, 24, 31, 40, 44, 53,
-    10, 19, 23, 32, 39, 45, 52, 54,
-    20, 22, 33, 38, 46, 51, 55, 60,
-    21, 34, 37, 47, 50, 56, 59, 61,
-    35, 36, 48, 49, 57, 58, 62, 63
+/* Natural (row by row) order index of each zigzag order coefficient */
+const uint8_t mj_unzigzag[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10,
+    17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63
 };
 
 static const int dc_cat_off[12] = { 2, 3, 3, 3, 3, 3, 4, 5, 6, 7, 8, 9 };
 
 /*****************************************************************************/
 
-/* Save_Images()
+/* Fill_Dqt_by_Q()
  *
- * My addition, separated code that saves images
+ * Scales the standard quantization table for quality q,
+ * into dqt in zigzag order as the coefficients come
  */
-static void Save_Images(int type) {
-  char fname[MAX_FILE_NAME];
-  uint32_t idx;
-
-  /* Store APID images individually as PGM files */
-  if( isFlagSet(IMAGE_OUT_SPLIT) )
-  {
-    for( idx = 0; idx < CHANNEL_IMAGE_NUM; idx++ )
-    {
-      /* Save channel images as raw PGM */
-      if( isFlagSet(IMAGE_SAVE_PPGM) )
-      {
-        /* Save unprocessed image */
-        fname[0] = '\0';
-        if( type == IMAGE_RAW )
-          File_Name( fname, idx, "-raw.pgm" );
-        else
-          File_Name( fname, idx, ".pgm" );
-        Save_Image_Raw( fname, "P5",
-            channel_image_width,
-            channel_image_height,
-            255, channel_image[idx] );
-      }
-
-      /* Save channel images as JPEG */
-      if( isFlagSet(IMAGE_SAVE_JPEG) )
-      {
-        /* Save unprocessed image */
-        fname[0] = '\0';
-        if( type == IMAGE_RAW )
-          File_Name( fname, idx, "-raw.jpg" );
-        else
-          File_Name( fname, idx, ".jpg" );
-        Save_Image_JPEG(fname,
-            (int)channel_image_width,
-            (int)channel_image_height,
-            true,
-            channel_image[idx]);
-      }
-
-    } /* for( idx = 0; idx < CHANNEL_IMAGE_NUM; idx++ ) */
-  } /* if( isFlagSet(IMAGE_OUT_SPLIT) ) */
-
-  /* Create pseudo-color combo image */
-  if( isFlagSet(IMAGE_OUT_COMBO) )
-  {
-    uint8_t *combo_image = NULL;
-    mem_alloc( (void **)&combo_image, channel_image_size * 3 );
-    Create_Combo_Image( combo_image );
-
-    /* Save combo image as raw PGM */
-    if( isFlagSet(IMAGE_SAVE_PPGM) )
-    {
-      /* Save unprocessed image */
-      fname[0] = '\0';
-      if( type == IMAGE_RAW )
-        File_Name( fname, 3, "-raw.ppm" ); /* TODO Use 3 here to specify that we want combo out */
-      else
-        File_Name( fname, 3, ".ppm" ); /* TODO Use 3 here to specify that we want combo out */
-      Save_Image_Raw( fname, "P6",
-          channel_image_width,
-          channel_image_height,
-          255, combo_image );
-    }
-
-    /* Save combo image as JPEG */
-    if( isFlagSet(IMAGE_SAVE_JPEG) )
-    {
-      /* Save unprocessed image */
-      fname[0] = '\0';
-      if( type == IMAGE_RAW )
-        File_Name( fname, 3, "-raw.jpg" ); /* TODO Use 3 here to specify that we want combo out */
-      else
-        File_Name( fname, 3, ".jpg" ); /* TODO Use 3 here to specify that we want combo out */
-      Save_Image_JPEG(fname,
-          (int)channel_image_width,
-          (int)channel_image_height,
-          false,
-          combo_image);
-    }
-
-    free_ptr( (void **)&combo_image );
-  } /* if( isFlagSet(IMAGE_OUT_COMBO) ) */
-}
-
-/*****************************************************************************/
-
-void Mj_Dump_Image(void) {
-  uint32_t idx;
-
-  /* Abort if no images successfully decoded */
-  if (channel_image_size == 0)
-    return;
-
-  /* My addition, process images when reception finished */
-  if (isFlagClear(STATUS_RECEIVING)) {
-    /* Save images in Raw state first, if enabled */
-    if (isFlagSet(IMAGE_RAW))
-        Save_Images(IMAGE_RAW);
-
-    /* Process images if not already done */
-    if (isFlagClear(IMAGES_PROCESSED)) {
-      /* My addition, invert image (flip vertically) */
-      if (isFlagSet(IMAGE_INVERT)) {
-        for (idx = 0; idx < CHANNEL_IMAGE_NUM; idx++)
-          Flip_Image(channel_image[idx], (uint32_t)channel_image_size);
-      }
-
-      /* Rectify (stretch) images to correct scan distortion */
-      if (isFlagSet(IMAGE_RECTIFY) && isFlagClear(IMAGES_RECTIFIED))
-        Rectify_Images();
-
-      /* Normalize images if enabled */
-      if (isFlagSet(IMAGE_NORMALIZE)) {
-        for (idx = 0; idx < CHANNEL_IMAGE_NUM; idx++) {
-          /* Normalize (Equalize) histogram to cover full pixel value range */
-          Normalize_Image(channel_image[idx],
-              (uint32_t)channel_image_size, NORM_BLACK, MAX_WHITE);
-
-          /* C.L.A.H.E. Normalization, see ../glrpt/clahe.c */
-          if (isFlagSet(IMAGE_CLAHE)) {
-            if (!CLAHE(channel_image[idx],
-                  channel_image_width,
-                  channel_image_height,
-                  NORM_BLACK, MAX_WHITE,
-                  REGIONS_X, REGIONS_Y,
-                  NUM_GREYBINS, CLIP_LIMIT)) {
-              Show_Message(
-                  "Failed to perform C.L.A.H.E.\n"\
-                    "Image Contrast Enhancement", "red");
-            }
-          }
-        }
-      }
-
-      SetFlag(IMAGES_PROCESSED);
-    }
-
-    /* My addition, reset and display LRPT images when finished */
-    if( isFlagClear(STATUS_RECEIVING) )
-    {
-      Display_Scaled_Image( NULL, 0, 0 );
-      for( idx = 0; idx < CHANNEL_IMAGE_NUM; idx++ )
-        Display_Scaled_Image(
-            channel_image, rc_data.apid[idx],
-            (int)channel_image_height );
-    }
-
-    /* Save processed images if enabled */
-    if (isFlagSet(IMAGES_PROCESSED))
-        Save_Images(!IMAGE_RAW);
-  }
-}
-
-/*****************************************************************************/
-
-static void Fill_Dqt_by_Q(int *dqt, int q) {
+void Fill_Dqt_by_Q(int *dqt, int q) {
   double f;
   int i;
 
@@ -247,97 +82,149 @@ static void Fill_Dqt_by_Q(int *dqt, int q) {
 
   for( i = 0; i <= 63; i++ )
   {
-    dqt[i] = (int)( round(f / 100.0 * (double)standard_quantization_table[i]) );
+    dqt[i] = (int)( round(f / 100.0 *
+          (double)standard_quantization_table[ mj_unzigzag[i] ]) );
     if( dqt[i] < 1 ) dqt[i] = 1;
   }
 }
 
 /*****************************************************************************/
 
-static void Fill_Pix(double *img_dct, uint32_t apid, int mcu_id, int m) {
-  int i, j, t, x, y, off = 0, inv = 0;
+/* Dequantize()
+ *
+ * Dequantized coefficient, saturated to the 11 bits of 8 bit baseline
+ * JPEG. Only corrupt data or a coarse quantizer's rounding go over.
+ * The fixed point IDCTs overflow from some 1100 on, with pixels at
+ * the wrong extreme, and stay within 1 of the double precision one
+ * in this range
+ */
+static inline int16_t Dequantize(int coef, int dqt) {
+  int val = coef * dqt;
 
-  for( i = 0; i <= 63; i++ )
+  if( val > IDCT_COEF_MAX ) return( IDCT_COEF_MAX );
+  if( val < IDCT_COEF_MIN ) return( IDCT_COEF_MIN );
+  return( (int16_t)val );
+}
+
+/*****************************************************************************/
+
+/* Mj_Dec_Block()
+ *
+ * Decodes the Huffman coded coefficients of an MCU straight
+ * into blk, dequantized and in natural order. blk must be
+ * cleared beforehand. Returns false on a bad Huffman code
+ */
+bool Mj_Dec_Block(bit_reader_t *b, int16_t *blk, int *prev_dc, const int *dqt) {
+  int dc_cat, dc, k;
+  ac_code_t ac;
+  int ac_run, ac_size, ac_len;
+  uint16_t n;
+
+  /* A refill holds a Huffman code and its value */
+  Bitop_Refill( b );
+  dc_cat = Get_DC( (uint16_t)(Bitop_Peek(b, 16)) );
+  if( dc_cat == -1 )
   {
-    t = (int)( round(img_dct[i] + 128.0) );
-    if( t < 0 )   t = 0;
-    if( t > 255 ) t = 255;
-    x = ( mcu_id + m ) * 8 + i % 8;
-    y = cur_y + i / 8;
-    off = x + y * METEOR_IMAGE_WIDTH;
-
-    /* Invert image palette if APID matches */
-    for( j = 0; j < 3; j++ )
-      if( apid == rc_data.invert_palette[j] ) inv = 1;
-    if( inv )
+    Show_Message( "Bad DC huffman code!", "red" );
+    return( false );
+  }
+  Bitop_Skip( b, dc_cat_off[dc_cat] );
+  n = (uint16_t)( Bitop_Peek(b, dc_cat) );
+  Bitop_Skip( b, dc_cat );
+
+  dc = Map_Range( dc_cat, n ) + *prev_dc;
+  *prev_dc = dc;
+  blk[0] = Dequantize( dc, dqt[0] );
+
+  k = 1;
+  while( k < 64 )
+  {
+    Bitop_Refill( b );
+    ac = Get_AC( (uint16_t)(Bitop_Peek(b, 16)) );
+    if( ac == 0 )
     {
-      if( apid == rc_data.apid[RED] )
-        channel_image[RED][off]   = 255 - (uint8_t)t;
-      else if( apid == rc_data.apid[GREEN] )
-        channel_image[GREEN][off] = 255 - (uint8_t)t;
-      else if( apid == rc_data.apid[BLUE] )
-        channel_image[BLUE][off]  = 255 - (uint8_t)t;
+      Show_Message( "Bad DC huffman code!", "red" );
+      return( false );
     }
-    else /* Normal palette */
+    ac_len  = AC_CODE_LEN( ac );
+    ac_size = AC_CODE_SIZE( ac );
+    ac_run  = AC_CODE_RUN( ac );
+    Bitop_Skip( b, ac_len );
+
+    /* End of block, the rest is left zero */
+    if( (ac_run == 0) && (ac_size == 0) ) break;
+
+    k += ac_run;
+    if( ac_size != 0 )
     {
-      if( apid == rc_data.apid[RED] )
-        channel_image[RED][off]   = (uint8_t)t;
-      else if( apid == rc_data.apid[GREEN] )
-        channel_image[GREEN][off] = (uint8_t)t;
-      else if( apid == rc_data.apid[BLUE] )
-        channel_image[BLUE][off]  = (uint8_t)t;
+      n = (uint16_t)( Bitop_Peek(b, ac_size) );
+      Bitop_Skip( b, ac_size );
+
+      /* A run past the end of the block is corrupt, drop its value */
+      if( k < 64 )
+        blk[ mj_unzigzag[k] ] = Dequantize( Map_Range(ac_size, n), dqt[k] );
+      k++;
     }
+    else if( ac_run == 15 ) k++;
   }
+
+  return( true );
 }
 
 /*****************************************************************************/
 
-static bool Progress_Image(uint32_t apid, int mcu_id, int pck_cnt) {
-  static size_t prev_len = 0;
-  size_t delta_len = 0, i, s;
-  int j;
+/* Channel_Of()
+ *
+ * Channel image the APID is shown in, -1 if it is not shown.
+ * Sets invert if the APID's palette is inverted
+ */
+static int Channel_Of(medet_t *ctx, uint32_t apid, bool *invert) {
+  int ch, i;
+
+  *invert = false;
+  for( i = 0; i < CHANNEL_IMAGE_NUM; i++ )
+    if( apid == ctx->params.invert_palette[i] ) *invert = true;
+
+  for( ch = 0; ch < CHANNEL_IMAGE_NUM; ch++ )
+    if( apid == ctx->params.apid[ch] ) return( ch );
+
+  return( -1 );
+}
+
+/*****************************************************************************/
+
+static bool Progress_Image(medet_t *ctx, uint32_t apid, int mcu_id, int pck_cnt) {
+  mj_rec_t *mj = &(ctx->jpeg);
+  channel_images_t *images = ctx->images;
 
   if( (apid == 0) || (apid == 70) )
     return false;
 
-  if( last_mcu == -1 )
+  if( mj->last_mcu == -1 )
   {
     if (mcu_id != 0)
         return false;
-    prev_pck  = pck_cnt;
-    first_pck = pck_cnt;
-    if(  apid == 65 ) first_pck -= 14;
+    mj->prev_pck  = pck_cnt;
+    mj->first_pck = pck_cnt;
+    if(  apid == 65 ) mj->first_pck -= 14;
     if( (apid == 66) || (apid == 68) )
-      first_pck -= 28;
-    last_mcu = 0;
-    cur_y = -1;
-    prev_len = 0;
+      mj->first_pck -= 28;
+    mj->last_mcu = 0;
+    mj->cur_y = -1;
   }
 
-  if( pck_cnt < prev_pck ) first_pck -= 16384;
-  prev_pck = pck_cnt;
+  if( pck_cnt < mj->prev_pck ) mj->first_pck -= 16384;
+  mj->prev_pck = pck_cnt;
 
-  cur_y = 8 * ( (pck_cnt - first_pck) / 43 );
-  if( cur_y > last_y )
-  {
-    channel_image_height = (uint32_t)( cur_y + 8 );
-    channel_image_size = (size_t)
-      ( channel_image_width * channel_image_height );
-    for( i = 0; i < CHANNEL_IMAGE_NUM; i++ )
-      mem_realloc( (void **)&channel_image[i], channel_image_size );
+  mj->cur_y = 8 * ( (pck_cnt - mj->first_pck) / 43 );
+  if( mj->cur_y < 0 ) return false;
+  if( mj->cur_y > mj->last_y )
+    Channel_Images_Grow( images, (uint32_t)(mj->cur_y + 8) );
 
-    /* Clear new allocation */
-    delta_len = channel_image_size - prev_len;
-    for( i = 0; i < delta_len; i++ )
-    {
-      s = i + prev_len;
-      for( j = 0; j < CHANNEL_IMAGE_NUM; j++ )
-        channel_image[j][s] = 0;
-    }
+  /* Images exported for saving take no more lines */
+  if( images->exported ) return false;
 
-    prev_len = channel_image_size;
-  }
-  last_y = cur_y;
+  mj->last_y = mj->cur_y;
 
   return true;
 }
@@ -345,104 +232,161 @@ static bool Progress_Image(uint32_t apid, int mcu_id, int pck_cnt) {
 /*****************************************************************************/
 
 void Mj_Dec_Mcus(
+        medet_t *ctx,
         uint8_t *p,
+        int len,
         uint32_t apid,
         int pck_cnt,
         int mcu_id,
         uint8_t q) {
-  bit_io_rec_t b;
-  int i, m;
-  uint16_t k, n;
-  double prev_dc;
-  int dc_cat, ac;
-  double dct[64];
-  double zdct[64];
-  double img_dct[64];
+  mj_rec_t *mj = &(ctx->jpeg);
+  bit_reader_t b;
+  int i, m, prev_dc;
   int dqt[64];
-  int ac_run, ac_size, ac_len;
+  int16_t (*blk)[64];
+  uint8_t *dst, *map;
+  bool invert;
+  long bits;
+  int ch, c;
+
+  Bitop_ReaderCreate( &b, p, len );
 
-  b.p = p;
-  b.pos = 0;
+  if( !Progress_Image(ctx, apid, mcu_id, pck_cnt) )
+    return;
 
-  if( !Progress_Image(apid, mcu_id, pck_cnt) )
+  /* The packet's MCUs must fit in a line, starting at a packet
+   * boundary, so that packets in a batch either share MCUs
+   * with a pending one in full or not at all */
+  if( (mcu_id < 0) || (mcu_id % MCU_PER_PACKET != 0) ||
+      ((mcu_id + MCU_PER_PACKET) * 8 > METEOR_IMAGE_WIDTH) )
     return;
 
+  /* Images of all APIDs are kept, shown in a channel or not */
+  if( !Channel_Images_Add_Apid(ctx->images, apid) ) return;
+  ch  = Channel_Of( ctx, apid, &invert );
+  dst = Apid_Image_Row( ctx->images, apid,
+      (uint32_t)mj->cur_y ) + (size_t)mcu_id * 8;
+
+  /* A packet over the MCUs of a pending one is stored after it */
+  for( i = 0; i < mj->num_pending; i++ )
+    if( mj->pending[i].dst == dst )
+    {
+      Mj_Flush( ctx );
+      break;
+    }
+
   Fill_Dqt_by_Q( dqt, q );
 
+  /* Coefficients of all MCUs now, their IDCT with the batch */
+  blk = mj->blks[ mj->num_pending ];
+  memset( blk, 0, sizeof(mj->blks[0]) );
   prev_dc = 0;
-  m = 0;
-  while( m < MCU_PER_PACKET )
+  for( m = 0; m < MCU_PER_PACKET; m++ )
+    if( !Mj_Dec_Block(&b, blk[m], &prev_dc, dqt) ) break;
+
+  mj->pending[ mj->num_pending ] = (mj_pending_t){ dst, m, invert };
+  mj->num_pending++;
+
+  /* Mark the MCUs decoded as received, counting the new ones */
+  map = Apid_Block_Map_Row( ctx->images, apid,
+      (uint32_t)mj->cur_y ) + (size_t)mcu_id * 8;
+  for( i = 0; i < m; i++, map += 8 )
   {
-    dc_cat = Get_DC( (uint16_t)(Bitop_PeekNBits(&b, 16)) );
-    if( dc_cat == -1 )
-    {
-      Show_Message( "Bad DC huffman code!", "red" );
-      return;
-    }
-    Bitop_AdvanceNBits(&b, dc_cat_off[dc_cat]);
-    n = (uint16_t)(Bitop_FetchNBits(&b, dc_cat));
+    if( *map == BLOCK_RECEIVED ) continue;
+    memset( map, BLOCK_RECEIVED, 8 );
+    for( c = 0; c < CHANNEL_IMAGE_NUM; c++ )
+      if( apid == ctx->params.apid[c] )
+        ctx->mcu_ok[c]++;
+  }
 
-    zdct[0] = Map_Range( dc_cat, n ) + prev_dc;
-    prev_dc = zdct[0];
+  /* MCUs after a bad Huffman code are lost */
+  if( m == MCU_PER_PACKET )
+  {
+    /* Keep the packet as received if all of it was there */
+    bits = Bitop_Tell( &b, p );
+    if( ctx->params.jfif && (ch >= 0) && (bits <= 8L * len) )
+      Jfif_Store_Packet( &(ctx->params.jfif[ch]),
+          mj->cur_y / 8, mcu_id, p, (uint32_t)bits, q, invert );
+
+    /* My addition, incrementally display LRPT images.
+     * Report decoded lines of channel, GUI will display them */
+    for( i = 0; i < CHANNEL_IMAGE_NUM; i++ )
+      if( apid == ctx->params.apid[i] )
+        mj->batch_lines[i] = mj->cur_y;
+  }
 
-    k = 1;
-    while( k < 64 )
-    {
-      ac = Get_AC( (uint16_t)(Bitop_PeekNBits(&b, 16)) );
-      if( ac == -1 )
-      {
-        Show_Message( "Bad DC huffman code!", "red" );
-        return;
-      }
-      ac_len  = ac_table[ac].len;
-      ac_size = ac_table[ac].size;
-      ac_run  = ac_table[ac].run;
-      Bitop_AdvanceNBits(&b, ac_len);
-
-      if( (ac_run == 0) && (ac_size == 0) )
-      {
-        for( i = k; i <= 63; i++ ) zdct[i] = 0;
-        break;
-      }
-
-      for( i = 0; i < ac_run; i++ )
-      {
-        zdct[k] = 0;
-        k++;
-      }
-
-      if( ac_size != 0 )
-      {
-        n = (uint16_t)(Bitop_FetchNBits(&b, ac_size));
-        zdct[k] = Map_Range( ac_size, n );
-        k++;
-      }
-      else if( ac_run == 15 )
-      {
-        zdct[k] = 0;
-        k++;
-      }
-    }
+  if( mj->num_pending == MJ_BATCH_PACKETS )
+    Mj_Flush( ctx );
+}
+
+/*****************************************************************************/
+
+/* Mj_Idct_Job()
+ *
+ * Job of the worker pool, stores the pixels of
+ * its share of the pending packets by the IDCT
+ */
+static void Mj_Idct_Job(void *arg, int idx) {
+  mj_rec_t *mj = (mj_rec_t *)arg;
+  int first = idx * mj->num_pending / mj->num_jobs;
+  int last  = ( idx + 1 ) * mj->num_pending / mj->num_jobs;
+  int i;
+
+  for( i = first; i < last; i++ )
+    mj->idct( mj->pending[i].dst, METEOR_IMAGE_WIDTH,
+        mj->blks[i][0], mj->pending[i].count, mj->pending[i].invert );
+}
 
-    for( i = 0; i <= 63; i++ )
-      dct[i] = zdct[ zigzag[i] ] * dqt[i];
+/*****************************************************************************/
 
-    Flt_Idct_8x8( img_dct, dct );
-    Fill_Pix( img_dct, apid, mcu_id, m );
-    m++;
+/* Mj_Flush()
+ *
+ * Stores the pixels of the pending packets, sharing their IDCT
+ * out on the decoder's worker pool, then reports the lines done
+ */
+void Mj_Flush(medet_t *ctx) {
+  mj_rec_t *mj = &(ctx->jpeg);
+
+  if( mj->num_pending > 0 )
+  {
+    mj->num_jobs = Work_Pool_Size( ctx->mtd.pool );
+    if( mj->num_jobs > mj->num_pending )
+      mj->num_jobs = mj->num_pending;
+    Work_Pool_Run( ctx->mtd.pool, Mj_Idct_Job, mj, mj->num_jobs );
+    mj->num_pending = 0;
   }
 
-  /* My addition, incrementally display LRPT images */
-  Display_Scaled_Image( channel_image, apid, cur_y );
+  memcpy( ctx->image_lines, mj->batch_lines, sizeof(ctx->image_lines) );
 }
 
 /*****************************************************************************/
 
-void Mj_Init(void) {
-  Default_Huffman_Table();
-  last_mcu  = -1;
-  cur_y     = 0;
-  last_y    = -1;
-  first_pck = 0;
-  prev_pck  = 0;
+void Mj_Init(mj_rec_t *mj) {
+  mj->last_mcu  = -1;
+  mj->cur_y     = 0;
+  mj->last_y    = -1;
+  mj->first_pck = 0;
+  mj->prev_pck  = 0;
+  mj->num_pending = 0;
+  mj->num_jobs    = 0;
+  for( int idx = 0; idx < CHANNEL_IMAGE_NUM; idx++ )
+    mj->batch_lines[idx] = 0;
+  Mj_Set_Idct( mj, IDCT_IMPL_AUTO );
+}
+
+/*****************************************************************************/
+
+/* Mj_Set_Idct()
+ *
+ * Selects the inverse DCT, the fastest one the CPU supports
+ * by default, or as set by the decoder's "idct" config option.
+ * IDCT_IMPL_FLOAT gives the images of older versions. Returns
+ * false, leaving the IDCT unchanged, if impl is not supported
+ */
+bool Mj_Set_Idct(mj_rec_t *mj, idct_impl_t impl) {
+  idct_8x8_t idct = Idct_Select( impl );
+
+  if( !idct ) return( false );
+  mj->idct = idct;
+  return( true );
 }
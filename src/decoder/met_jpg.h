@@ -19,13 +19,74 @@
 
 /*****************************************************************************/
 
+#include "../common/common.h"
+#include "bitop.h"
+#include "dct.h"
+
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /*****************************************************************************/
 
-void Mj_Dump_Image(void);
-void Mj_Dec_Mcus(uint8_t *p, uint32_t apid, int pck_cnt, int mcu_id, uint8_t q);
-void Mj_Init(void);
+/* MCUs (8x8 blocks) per image packet */
+#define MCU_PER_PACKET  14
+
+/* Image packets whose IDCT is done in one batch on the worker pool */
+#define MJ_BATCH_PACKETS    32
+
+/*****************************************************************************/
+
+/* Image packet waiting for the IDCT: where its pixels go,
+ * its number of MCUs decoded and its palette inverted */
+typedef struct mj_pending_t {
+    uint8_t *dst;
+    int count;
+    bool invert;
+} mj_pending_t;
+
+/* JPEG decoder progress data */
+typedef struct mj_rec_t {
+    int last_mcu, cur_y, last_y;
+    int first_pck, prev_pck;
+
+    /* Inverse DCT in use */
+    idct_8x8_t idct;
+
+    /* Packets entropy decoded but not yet stored, their
+     * coefficients and the batch's share of each pool job */
+    mj_pending_t pending[MJ_BATCH_PACKETS];
+    int16_t blks[MJ_BATCH_PACKETS][MCU_PER_PACKET][64];
+    int num_pending, num_jobs;
+
+    /* Decoded lines of each channel once the batch is stored */
+    int batch_lines[CHANNEL_IMAGE_NUM];
+} mj_rec_t;
+
+/*****************************************************************************/
+
+struct medet_t;
+
+/*****************************************************************************/
+
+extern const uint8_t mj_unzigzag[64];
+
+/*****************************************************************************/
+
+void Fill_Dqt_by_Q(int *dqt, int q);
+bool Mj_Dec_Block(bit_reader_t *b, int16_t *blk, int *prev_dc, const int *dqt);
+
+void Mj_Dec_Mcus(
+        struct medet_t *ctx,
+        uint8_t *p,
+        int len,
+        uint32_t apid,
+        int pck_cnt,
+        int mcu_id,
+        uint8_t q);
+void Mj_Flush(struct medet_t *ctx);
+void Mj_Init(mj_rec_t *mj);
+bool Mj_Set_Idct(mj_rec_t *mj, idct_impl_t impl);
 
 /*****************************************************************************/
 
@@ -16,16 +16,12 @@
 
 #include "met_packet.h"
 
-#include "../common/shared.h"
+#include "medet.h"
 #include "met_jpg.h"
 
-#include <glib.h>
-#include <gtk/gtk.h>
-
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
-#include <stdio.h>
 #include <string.h>
 
 /*****************************************************************************/
@@ -34,45 +30,37 @@
 
 /*****************************************************************************/
 
-static void Parse_70(uint8_t *p);
-static void Act_Apd(uint8_t *p, uint32_t apid, int pck_cnt);
-static void Parse_Apd(uint8_t *p);
-static int Parse_Partial(uint8_t *p, int len);
-
-/*****************************************************************************/
-
-static bool partial_packet = false;
-static int last_frame = 0;
+static void Parse_70(medet_t *ctx, uint8_t *p);
+static void Act_Apd(
+    medet_t *ctx, uint8_t *p, int len, uint32_t apid, int pck_cnt);
+static void Parse_Apd(medet_t *ctx, uint8_t *p, int len);
+static int Parse_Partial(medet_t *ctx, uint8_t *p, int len);
 
 /*****************************************************************************/
 
-static void Parse_70(uint8_t *p) {
-  int h, m, s;
-  gchar txt[12];
-
-  h  = p[8];
-  m  = p[9];
-  s  = p[10];
-
-  /* Display the Satellite's onboard time */
-  snprintf( txt, sizeof(txt), "%02d:%02d:%02d", h, m, s );
-  gtk_entry_set_text( GTK_ENTRY(ob_time_entry), txt );
+static void Parse_70(medet_t *ctx, uint8_t *p) {
+  /* Report the Satellite's onboard time */
+  ctx->ob_hour = p[8];
+  ctx->ob_min  = p[9];
+  ctx->ob_sec  = p[10];
+  ctx->ob_time_valid = true;
 }
 
 /*****************************************************************************/
 
-static void Act_Apd(uint8_t *p, uint32_t apid, int pck_cnt) {
+static void Act_Apd(
+    medet_t *ctx, uint8_t *p, int len, uint32_t apid, int pck_cnt) {
   int mcu_id, q;
 
   mcu_id   = p[0];
   q = p[5];
 
-  Mj_Dec_Mcus( &p[6], apid, pck_cnt, mcu_id, (uint8_t)q );
+  Mj_Dec_Mcus( ctx, &p[6], len - 6, apid, pck_cnt, mcu_id, (uint8_t)q );
 }
 
 /*****************************************************************************/
 
-static void Parse_Apd(uint8_t *p) {
+static void Parse_Apd(medet_t *ctx, uint8_t *p, int len) {
   uint16_t w;
   int pck_cnt;
   uint32_t apid;
@@ -89,47 +77,46 @@ static void Parse_Apd(uint8_t *p) {
   pck_cnt &= 0x3FFF;
 
   if( apid == 70 )
-    Parse_70( &p[14] );
+    Parse_70( ctx, &p[14] );
   else
-    Act_Apd( &p[14], apid, pck_cnt );
+    Act_Apd( ctx, &p[14], len - 14, apid, pck_cnt );
 }
 
 /*****************************************************************************/
 
-static int Parse_Partial(uint8_t *p, int len) {
+static int Parse_Partial(medet_t *ctx, uint8_t *p, int len) {
+  packet_rec_t *pk = &(ctx->packet);
   int len_pck;
 
   if( len < 6 )
   {
-    partial_packet = true;
+    pk->partial = true;
     return( 0 );
   }
 
   len_pck = ( p[4] << 8 ) | p[5];
   if( len_pck >= len - 6 )
   {
-    partial_packet = true;
+    pk->partial = true;
     return( 0 );
   }
 
-  Parse_Apd( p );
+  Parse_Apd( ctx, p, len_pck + 7 );
 
-  partial_packet = false;
+  pk->partial = false;
   return( len_pck + 6 + 1 );
 }
 
 /*****************************************************************************/
 
-void Parse_Cvcdu(uint8_t *p, int len) {
+void Parse_Cvcdu(medet_t *ctx, uint8_t *p, int len) {
+  packet_rec_t *pk = &(ctx->packet);
   int n, data_len, off;
   int ver, fid;
   int frame_cnt;
   uint16_t hdr_off;
   uint16_t w;
 
-  static uint8_t packet_buf[2048];
-  static int packet_off = 0;
-
   w = (uint16_t)( (p[0] << 8) | p[1] );
   ver = w >> 14;
   fid = w & 0x3F;
@@ -142,20 +129,20 @@ void Parse_Cvcdu(uint8_t *p, int len) {
   if( (ver == 0) | (fid == 0) ) return; //Empty packet
 
   data_len = len - 10;
-  if( frame_cnt == last_frame + 1 )
+  if( frame_cnt == pk->last_frame + 1 )
   {
-    if( partial_packet )
+    if( pk->partial )
     {
       if( hdr_off == PACKET_FULL_MARK ) //Packet could be larger than one frame
       {
         hdr_off = (uint16_t)( len - 10 );
-        memmove( &packet_buf[packet_off], &p[10], hdr_off );
-        packet_off += hdr_off;
+        memmove( &pk->buf[pk->off], &p[10], hdr_off );
+        pk->off += hdr_off;
       }
       else
       {
-        memmove( &packet_buf[packet_off], &p[10], hdr_off );
-        Parse_Partial( packet_buf, packet_off + hdr_off );
+        memmove( &pk->buf[pk->off], &p[10], hdr_off );
+        Parse_Partial( ctx, pk->buf, pk->off + hdr_off );
       }
     }
   }
@@ -163,20 +150,20 @@ void Parse_Cvcdu(uint8_t *p, int len) {
   {
     if( hdr_off == PACKET_FULL_MARK ) //Packet could be larger than one frame
       return;
-    partial_packet = false;
-    packet_off = 0;
+    pk->partial = false;
+    pk->off = 0;
   }
-  last_frame = frame_cnt;
+  pk->last_frame = frame_cnt;
 
   data_len -= hdr_off;
   off = hdr_off;
   while( data_len > 0 )
   {
-    n = Parse_Partial( &p[10 + off], data_len );
-    if( partial_packet )
+    n = Parse_Partial( ctx, &p[10 + off], data_len );
+    if( pk->partial )
     {
-      packet_off = data_len;
-      memmove( packet_buf, &p[10 + off], (size_t)packet_off );
+      pk->off = data_len;
+      memmove( pk->buf, &p[10 + off], (size_t)pk->off );
       break;
     }
     else
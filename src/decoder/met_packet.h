@@ -19,11 +19,26 @@
 
 /*****************************************************************************/
 
+#include <stdbool.h>
 #include <stdint.h>
 
 /*****************************************************************************/
 
-void Parse_Cvcdu(uint8_t *p, int len);
+/* Partial packet reassembly data */
+typedef struct packet_rec_t {
+    uint8_t buf[2048];
+    int  off;
+    bool partial;
+    int  last_frame;
+} packet_rec_t;
+
+/*****************************************************************************/
+
+struct medet_t;
+
+/*****************************************************************************/
+
+void Parse_Cvcdu(struct medet_t *ctx, uint8_t *p, int len);
 
 /*****************************************************************************/
 
@@ -16,27 +16,51 @@
 
 #include "met_to_data.h"
 
-#include "../glrpt/utils.h"
 #include "bitop.h"
 #include "correlator.h"
 #include "ecc.h"
 #include "viterbi27.h"
+#include "work_pool.h"
 
 #include <math.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 /*****************************************************************************/
 
 #define MIN_CORRELATION 45
 
+/* Length of a frame after its sync word, 4 periods of the PN sequence */
+#define PRAND_MASK_LEN      ( HARD_FRAME_LEN - 4 )
+
+/* Symbols searched either side of the expected sync position while
+ * tracking, and frames lost in a row before searching again */
+#define SYNC_TRACK_WINDOW   64
+#define SYNC_MAX_MISSES     8
+
+/* BER (%) gauged by Vit_Decode_Head() above which a frame is taken
+ * for noise and not decoded further. Measured on synthetic frames at
+ * 1.0-1.75 dB Eb/N0, the 8881 of 16000 that pass RS gauged 22-26% on
+ * average and at most 28.8%, only 2 of them over 28.5%. Pure noise
+ * gauged 31.7-39%, 35% on average. Set midway between the two */
+#define MAX_HEAD_BER        30.5
+
 /*****************************************************************************/
 
-static void Do_Full_Correlate(mtd_rec_t *mtd, uint8_t *raw, uint8_t *aligned);
-static void Do_Next_Correlate(mtd_rec_t *mtd, uint8_t *raw, uint8_t *aligned);
-static bool Try_Frame(mtd_rec_t *mtd, uint8_t *aligned);
+static void Do_Full_Correlate(mtd_rec_t *mtd, uint8_t *raw);
+static bool Do_Track_Correlate(mtd_rec_t *mtd, uint8_t *raw);
+static void Mtd_Init_Masks(void);
+static void Mtd_Apply_Mask(uint8_t *data, const uint8_t *mask, int len);
+static bool Try_Frame(mtd_try_t *t);
+static void Try_Candidate(void *arg, int idx);
+static void Take_Candidate(mtd_rec_t *mtd, int idx);
 
 /*****************************************************************************/
 
@@ -75,135 +99,344 @@ static const uint8_t prand[255] = {
     0x08, 0x78, 0xc4, 0x4a, 0x66, 0xf5, 0x58
 };
 
-static uint8_t *decoded = NULL;
+/* The PN sequence over a whole frame and its complement, which also
+ * flips back all the bits of a frame decoded with them flipped */
+static uint8_t prand_mask[2][PRAND_MASK_LEN];
+static pthread_once_t masks_once = PTHREAD_ONCE_INIT;
+
+/*****************************************************************************/
+
+/* Mtd_Init_Masks()
+ *
+ * Unrolls the PN sequence over a frame
+ */
+static void Mtd_Init_Masks(void) {
+  int j;
+
+  for( j = 0; j < PRAND_MASK_LEN; j++ )
+  {
+    prand_mask[0][j] = prand[j % 255];
+    prand_mask[1][j] = prand[j % 255] ^ 0xFF;
+  }
+}
+
+/*****************************************************************************/
+
+/* Mtd_Apply_Mask()
+ *
+ * XORs len (at most PRAND_MASK_LEN) bytes of data with mask
+ */
+static void Mtd_Apply_Mask(uint8_t *data, const uint8_t *mask, int len) {
+  int j = 0;
+
+#ifdef __SSE2__
+  for( ; j + 16 <= len; j += 16 )
+  {
+    __m128i d = _mm_loadu_si128( (const __m128i *)(data + j) );
+    __m128i m = _mm_loadu_si128( (const __m128i *)(mask + j) );
+    _mm_storeu_si128( (__m128i *)(data + j), _mm_xor_si128(d, m) );
+  }
+#endif
+
+  for( ; j < len; j++ )
+    data[j] ^= mask[j];
+}
+
+/*****************************************************************************/
+
+/* Mtd_Randomize()
+ *
+ * (De)randomizes data by XOR'ing it with the CCSDS pseudo-random
+ * sequence, which starts right after the attached sync marker
+ */
+void Mtd_Randomize(uint8_t *data, int len) {
+  int j;
+
+  pthread_once( &masks_once, Mtd_Init_Masks );
+
+  /* The mask spans whole periods of the sequence, so it repeats */
+  for( j = 0; j < len; j += PRAND_MASK_LEN )
+    Mtd_Apply_Mask( data + j, prand_mask[0],
+        (len - j < PRAND_MASK_LEN) ? len - j : PRAND_MASK_LEN );
+}
 
 /*****************************************************************************/
 
 void Mtd_Init(mtd_rec_t *mtd) {
+  int idx;
+
+  pthread_once( &masks_once, Mtd_Init_Masks );
+
   //sync is $1ACFFC1D,  00011010 11001111 11111100 00011101
   Correlator_Init( &(mtd->c), (uint64_t)0xfca2b63db00d9794 );
-  Mk_Viterbi27( &(mtd->v) );
+  for( idx = 0; idx < PATTERN_CNT; idx++ )
+    Mk_Viterbi27( &(mtd->tries[idx].v) );
+  mtd->ntries = 0;
+  mtd->pool = Work_Pool_Init( PATTERN_CNT - 1 );
   mtd->pos  = 0;
   mtd->cpos = 0;
   mtd->word = 0;
   mtd->corr = 64;
+  mtd->sync = MTD_SYNC_SEARCH;
+  mtd->sync_misses = 0;
 }
 
 /*****************************************************************************/
 
-static void Do_Full_Correlate(mtd_rec_t *mtd, uint8_t *raw, uint8_t *aligned) {
-  mtd->word = (uint16_t)
-    ( Corr_Correlate(&(mtd->c), &(raw[mtd->pos]), SOFT_FRAME_LEN) );
-  mtd->cpos = (uint16_t)( mtd->c.position[mtd->word] );
-  mtd->corr = (uint16_t)( mtd->c.correlation[mtd->word] );
+/* Mtd_Deinit()
+ *
+ * Stops the threads that decode the candidate frames
+ */
+void Mtd_Deinit(mtd_rec_t *mtd) {
+  Work_Pool_Deinit( mtd->pool );
+  mtd->pool = NULL;
+}
 
-  if( mtd->corr < MIN_CORRELATION )
+/*****************************************************************************/
+
+/* Do_Full_Correlate()
+ *
+ * Searches the whole window at mtd->pos for the sync word. The best
+ * phase is the first candidate, followed by the other phases that
+ * also correlate well, as many as the pool decodes at once. If the
+ * sync word is not found the frame is taken as it is at mtd->pos
+ */
+static void Do_Full_Correlate(mtd_rec_t *mtd, uint8_t *raw) {
+  mtd_try_t *t = &(mtd->tries[0]);
+  int best, word, max_tries;
+  uint32_t corr;
+
+  best = Corr_Correlate( &(mtd->c), &(raw[mtd->pos]), SOFT_FRAME_LEN );
+  t->word = (uint32_t)best;
+  t->corr = (uint32_t)( mtd->c.correlation[best] );
+  mtd->ntries = 1;
+
+  if( t->corr < MIN_CORRELATION )
   {
-    mtd->prev_pos = mtd->pos;
-    memmove( aligned, &(raw[mtd->pos]), SOFT_FRAME_LEN );
-    mtd->pos += SOFT_FRAME_LEN / 4;
+    t->synced = false;
+    t->start  = mtd->pos;
+    t->next   = mtd->pos + SOFT_FRAME_LEN / 4;
+    memcpy( t->aligned, &(raw[t->start]), SOFT_FRAME_LEN );
+    return;
   }
-  else
+
+  t->synced = true;
+  t->start  = mtd->pos + mtd->c.position[best];
+  t->next   = t->start + SOFT_FRAME_LEN;
+  memcpy( t->aligned, &(raw[t->start]), SOFT_FRAME_LEN );
+
+  /* The other phase peaks, in order of correlation */
+  max_tries = Work_Pool_Size( mtd->pool );
+  while( mtd->ntries < max_tries )
   {
-    mtd->prev_pos = mtd->pos + (int)mtd->cpos;
-
-    memmove(
-        aligned,
-        &(raw[mtd->pos + (int)mtd->cpos]),
-        SOFT_FRAME_LEN - mtd->cpos );
-    memmove(
-        &(aligned[SOFT_FRAME_LEN - mtd->cpos]),
-        &(raw[mtd->pos + SOFT_FRAME_LEN]),
-        mtd->cpos );
-    mtd->pos += SOFT_FRAME_LEN + mtd->cpos;
-
-    Fix_Packet( aligned, SOFT_FRAME_LEN, (int)mtd->word );
+    best = -1;
+    corr = 0;
+    for( word = 0; word < PATTERN_CNT; word++ )
+    {
+      int idx;
+
+      if( mtd->c.correlation[word] < MIN_CORRELATION ) continue;
+      if( mtd->c.correlation[word] <= corr ) continue;
+      for( idx = 0; idx < mtd->ntries; idx++ )
+        if( mtd->tries[idx].word == (uint32_t)word ) break;
+      if( idx < mtd->ntries ) continue;
+
+      best = word;
+      corr = mtd->c.correlation[word];
+    }
+    if( best < 0 ) break;
+
+    t = &(mtd->tries[mtd->ntries++]);
+    t->word   = (uint32_t)best;
+    t->corr   = corr;
+    t->synced = true;
+    t->start  = mtd->pos + mtd->c.position[best];
+    t->next   = t->start + SOFT_FRAME_LEN;
+    memcpy( t->aligned, &(raw[t->start]), SOFT_FRAME_LEN );
   }
 }
 
 /*****************************************************************************/
 
-static void Do_Next_Correlate(mtd_rec_t *mtd, uint8_t *raw, uint8_t *aligned) {
-  mtd->cpos = 0;
-  memmove( aligned, &(raw[mtd->pos]), SOFT_FRAME_LEN );
-  mtd->prev_pos = mtd->pos;
-  mtd->pos += SOFT_FRAME_LEN;
+/* Do_Track_Correlate()
+ *
+ * Aligns the frame expected at mtd->pos. The sync word is checked there
+ * first, then searched for only SYNC_TRACK_WINDOW symbols either side
+ * of it. If not found the frame is taken at mtd->pos, in the phase of
+ * the last sync word, and false is returned
+ */
+static bool Do_Track_Correlate(mtd_rec_t *mtd, uint8_t *raw) {
+  mtd_try_t *t = &(mtd->tries[0]);
+  int start, word;
+
+  start = mtd->pos;
+  word  = Corr_Correlate( &(mtd->c), &(raw[start]), PATTERN_SIZE + 1 );
+  if( (word < 0) || (mtd->c.correlation[word] < MIN_CORRELATION) )
+  {
+    start = mtd->pos - SYNC_TRACK_WINDOW;
+    if( start < 0 ) start = 0;
+
+    word = Corr_Correlate( &(mtd->c), &(raw[start]),
+        (uint32_t)(mtd->pos + SYNC_TRACK_WINDOW - start + PATTERN_SIZE + 1) );
+    if( (word < 0) || (mtd->c.correlation[word] < MIN_CORRELATION) )
+    {
+      /* Flywheel over the frame where it should be */
+      t->word   = mtd->word;
+      t->corr   = 0;
+      t->synced = true;
+      t->start  = mtd->pos;
+      t->next   = t->start + SOFT_FRAME_LEN;
+      memcpy( t->aligned, &(raw[t->start]), SOFT_FRAME_LEN );
+      mtd->ntries = 1;
+
+      return( false );
+    }
+  }
+
+  t->word   = (uint32_t)word;
+  t->corr   = (uint32_t)( mtd->c.correlation[word] );
+  t->synced = true;
+  t->start  = start + mtd->c.position[word];
+  t->next   = t->start + SOFT_FRAME_LEN;
+  memcpy( t->aligned, &(raw[t->start]), SOFT_FRAME_LEN );
+  mtd->ntries = 1;
 
-  Fix_Packet( aligned, SOFT_FRAME_LEN, (int)mtd->word );
+  return( true );
 }
 
 /*****************************************************************************/
 
-static bool Try_Frame(mtd_rec_t *mtd, uint8_t *aligned) {
+/* Try_Frame()
+ *
+ * Decodes a candidate frame, true if it passes ECC
+ */
+static bool Try_Frame(mtd_try_t *t) {
   int j;
-  uint8_t ecc_buf[256];
+  bool inverted;
   uint32_t temp;
+  uint8_t *decoded = t->decoded;
 
-  if( decoded == NULL )
-    mem_alloc( (void **)&decoded, HARD_FRAME_LEN );
+  if( t->synced )
+    Fix_Packet( t->aligned, SOFT_FRAME_LEN, (int)t->word );
 
-  Vit_Decode( &(mtd->v), aligned, decoded );
+  //Decoding the whole block is wasted if its first
+  //bits are already as bad as noise
+  Vit_Decode_Head( &(t->v), t->aligned, decoded );
+  if( Vit_Get_Percent_BER(&(t->v)) > MAX_HEAD_BER )
+  {
+    t->sig_q = (int)(round(100.0 - Vit_Get_Percent_BER(&(t->v))));
+    for( j = 0; j <= 3; j++ )
+      t->r[j] = false;
+    return( false );
+  }
+  Vit_Decode_Rest( &(t->v), t->aligned, decoded );
 
   temp =
     ((uint32_t)decoded[3] << 24) +
     ((uint32_t)decoded[2] << 16) +
     ((uint32_t)decoded[1] <<  8) +
     (uint32_t)decoded[0];
-  mtd->last_sync = temp;
-  mtd->sig_q = (int)(round(100.0 - Vit_Get_Percent_BER(&(mtd->v))));
+  t->last_sync = temp;
+  t->sig_q = (int)(round(100.0 - Vit_Get_Percent_BER(&(t->v))));
 
   //Curiously enough, you can flip all bits in a packet
-  //and get a correct ECC anyway. Check for that case
-  if( Bitop_CountBits(mtd->last_sync ^ 0xE20330E5) <
-      Bitop_CountBits(mtd->last_sync ^ 0x1DFCCF1A) )
-  {
-    for( j = 0; j < HARD_FRAME_LEN; j++ )
-      decoded[j] ^= 0xFF;
-    temp =
-      ((uint32_t)decoded[3] << 24) +
-      ((uint32_t)decoded[2] << 16) +
-      ((uint32_t)decoded[1] <<  8) +
-      (uint32_t)decoded[0];
-    mtd->last_sync = temp;
-  }
+  //and get a correct ECC anyway. Check for that case.
+  //Flipping them back is done along with derandomizing
+  inverted = Bitop_CountBits( temp ^ 0xE20330E5 ) <
+             Bitop_CountBits( temp ^ 0x1DFCCF1A );
+  if( inverted ) t->last_sync = ~temp;
 
-  for( j = 0; j < HARD_FRAME_LEN - 4; j++ )
-    decoded[4 + j] ^= prand[j % 255];
+  Mtd_Apply_Mask( &decoded[4], prand_mask[inverted], PRAND_MASK_LEN );
 
-  for( j = 0; j <= 3; j++ )
-  {
-    Ecc_Deinterleave( &(decoded[4]), ecc_buf, j, 4 );
-    mtd->r[j] = Ecc_Decode( ecc_buf, 0 );
-    Ecc_Interleave( ecc_buf, mtd->ecced_data, j, 4 );
-  }
+  return( Ecc_Decode_Interleaved(&decoded[4], t->r) );
+}
+
+/*****************************************************************************/
 
-  return (mtd->r[0] && mtd->r[1] && mtd->r[2] && mtd->r[3]);
+/* Try_Candidate()
+ *
+ * Job of the pool, decodes candidate idx of the mtd in arg
+ */
+static void Try_Candidate(void *arg, int idx) {
+  mtd_try_t *t = &( ((mtd_rec_t *)arg)->tries[idx] );
+
+  t->ok = Try_Frame( t );
+}
+
+/*****************************************************************************/
+
+/* Take_Candidate()
+ *
+ * Makes candidate idx the decoded frame and moves on past it
+ */
+static void Take_Candidate(mtd_rec_t *mtd, int idx) {
+  mtd_try_t *t = &(mtd->tries[idx]);
+  int j;
+
+  mtd->word = t->word;
+  mtd->corr = t->corr;
+  mtd->cpos = (uint32_t)( t->start - mtd->pos );
+  mtd->prev_pos = t->start;
+  mtd->pos      = t->next;
+
+  mtd->last_sync = t->last_sync;
+  mtd->sig_q     = t->sig_q;
+  for( j = 0; j <= 3; j++ )
+    mtd->r[j] = t->r[j];
+  if( t->ok )
+    memcpy( mtd->ecced_data, &(t->decoded[4]), HARD_FRAME_LEN - 4 );
 }
 
 /*****************************************************************************/
 
+/* Mtd_One_Frame()
+ *
+ * Aligns and decodes the next frame. Once a frame decodes, the sync
+ * words of the frames that follow are only looked for near where they
+ * should be. Frames whose sync word is not found there are decoded
+ * where they should be, and frames that fail to decode are flywheeled
+ * over. The whole window is searched again only after SYNC_MAX_MISSES
+ * of them in a row. A noisy frame costs one decode instead of a search
+ * and two decodes.
+ * A search decodes the other phases that correlate well along with
+ * the best one, on other cores, and takes the best that passes ECC
+ */
 bool Mtd_One_Frame(mtd_rec_t *mtd, uint8_t *raw) {
-    uint8_t aligned[SOFT_FRAME_LEN];
-    bool result = false;
+    bool result;
+    int idx;
 
-    if (mtd->cpos == 0) {
-        Do_Next_Correlate(mtd, raw, aligned);
-        result = Try_Frame(mtd, aligned);
+    if (mtd->sync == MTD_SYNC_TRACK) {
+        /* A sync word not found counts as a miss too */
+        bool found = Do_Track_Correlate(mtd, raw);
 
-        if (!result)
-            mtd->pos -= SOFT_FRAME_LEN;
-    }
+        Try_Candidate(mtd, 0);
+        Take_Candidate(mtd, 0);
+        result = mtd->tries[0].ok;
 
-    if (!result) {
-        Do_Full_Correlate(mtd, raw, aligned);
-        result = Try_Frame(mtd, aligned);
+        if (result && found)
+            mtd->sync_misses = 0;
+        else if (++mtd->sync_misses >= SYNC_MAX_MISSES)
+            mtd->sync = MTD_SYNC_SEARCH;
+
+        return result;
     }
 
-    return result;
-}
+    Do_Full_Correlate(mtd, raw);
+    Work_Pool_Run(mtd->pool, Try_Candidate, mtd, mtd->ntries);
 
-/*****************************************************************************/
+    for (idx = 0; idx < mtd->ntries; idx++)
+        if (mtd->tries[idx].ok)
+            break;
+    if (idx == mtd->ntries)
+        idx = 0;
+
+    Take_Candidate(mtd, idx);
+    result = mtd->tries[idx].ok;
 
-uint8_t ** ret_decoded(void) {
-  return( &decoded );
+    if (result && (mtd->corr >= MIN_CORRELATION)) {
+        mtd->sync = MTD_SYNC_TRACK;
+        mtd->sync_misses = 0;
+    }
+
+    return result;
 }
@@ -19,36 +19,74 @@
 
 /*****************************************************************************/
 
+#include "../common/common.h"
 #include "correlator.h"
 #include "viterbi27.h"
+#include "work_pool.h"
 
 #include <stdbool.h>
 #include <stdint.h>
 
 /*****************************************************************************/
 
-#define SOFT_FRAME_LEN  16384
 #define HARD_FRAME_LEN  1024
 
 /*****************************************************************************/
 
+/* Frame sync states. Searching correlates the whole frame window,
+ * tracking only a few symbols around where the next frame should be */
+typedef enum mtd_sync_t {
+    MTD_SYNC_SEARCH = 0,
+    MTD_SYNC_TRACK
+} mtd_sync_t;
+
+/* A candidate alignment of a frame and its decoding. Each one has
+ * its own Viterbi decoder and buffers so they can decode at once.
+ * The RS codewords are corrected in place in decoded */
+typedef struct mtd_try_t {
+    uint8_t aligned[SOFT_FRAME_LEN];
+    viterbi27_rec_t v;
+    uint8_t decoded[HARD_FRAME_LEN];
+
+    /* Phase word and its correlation, whether the sync word was found,
+     * where the frame starts and where the next one is looked for */
+    uint32_t word, corr;
+    bool synced;
+    int start, next;
+
+    uint32_t last_sync;
+    int sig_q;
+    bool r[4], ok;
+} mtd_try_t;
+
 /* Decoder MTD data */
 typedef struct mtd_rec_t {
     corr_rec_t c;
-    viterbi27_rec_t v;
+
+    /* Candidates of the frame, best correlation first, and
+     * the pool of threads that decodes them at the same time */
+    mtd_try_t tries[PATTERN_CNT];
+    int ntries;
+    work_pool_t *pool;
 
     int pos, prev_pos;
     uint8_t ecced_data[HARD_FRAME_LEN];
 
     uint32_t word, cpos, corr, last_sync;
+
+    /* Sync state and consecutive frames lost while tracking */
+    mtd_sync_t sync;
+    int sync_misses;
+
     int sig_q;
     bool r[4];
 } mtd_rec_t;
 
 /*****************************************************************************/
 
+void Mtd_Randomize(uint8_t *data, int len);
 void Mtd_Init(mtd_rec_t *mtd);
-uint8_t **ret_decoded(void);
+void Mtd_Deinit(mtd_rec_t *mtd);
 bool Mtd_One_Frame(mtd_rec_t *mtd, uint8_t *raw);
 
 /*****************************************************************************/
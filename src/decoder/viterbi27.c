@@ -25,24 +25,32 @@
 #include <stdlib.h>
 #include <strings.h>
 
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define VIT_X86_SIMD
+#include <immintrin.h>
+#endif
+
 /*****************************************************************************/
 
-#define VITERBI27_POLYA     79      // 1001111
-#define VITERBI27_POLYB     109     // 1101101
 #define SOFT_MAX            255
 #define DISTANCE_MAX        65535
 #define HIGH_BIT            64
 #define NUM_ITER            128     // HIGH_BIT << 1
-#define RENORM_INTERVAL     128     // DISTANCE_MAX / (2 * SOFT_MAX) (TODO: rounded?)
+/* Branch metrics are up to 2 * (SOFT_MAX + 128) and the metrics of the
+ * states spread by up to 6 of them, so renormalizing every 64 bits keeps
+ * the saturating path metrics below DISTANCE_MAX */
+#define RENORM_INTERVAL     64
 
 /*****************************************************************************/
 
-static uint16_t Metric_Soft_Distance(
-        uint8_t hard,
-        uint8_t soft_y0,
-        uint8_t soft_y1);
-static void Pair_Lookup_Create(viterbi27_rec_t *v);
-static void Pair_Lookup_Fill_Distance(viterbi27_rec_t *v);
+static inline void Metric_Branch(viterbi27_rec_t *v, const uint8_t *soft);
+static inline uint16_t Metric_Add(uint16_t metric, uint16_t dist);
+static void Vit_Acs_Scalar(viterbi27_rec_t *v, uint64_t *history);
+#ifdef VIT_X86_SIMD
+static void Vit_Acs_SSE2(viterbi27_rec_t *v, uint64_t *history);
+static void Vit_Acs_AVX2(viterbi27_rec_t *v, uint64_t *history);
+#endif
+static bool Vit_Acs_Symmetric(const viterbi27_rec_t *v);
 static uint32_t History_Buffer_Search(viterbi27_rec_t *v, int search_every);
 static void History_Buffer_Renormalize(
         viterbi27_rec_t *v,
@@ -53,8 +61,10 @@ static void History_Buffer_Traceback(
         uint32_t min_traceback_length);
 static void History_Buffer_Process_Skip(viterbi27_rec_t *v, int skip);
 static void Error_Buffer_Swap(viterbi27_rec_t *v);
-static void Vit_Inner(viterbi27_rec_t *v, uint8_t *soft);
+static void Vit_Start(viterbi27_rec_t *v, uint8_t *soft);
+static void Vit_Inner(viterbi27_rec_t *v, uint8_t *soft, int start, int end);
 static void Vit_Tail(viterbi27_rec_t *v, uint8_t *soft);
+static void Vit_Conv_Reset(viterbi27_rec_t *v, uint8_t *msg);
 static void Vit_Conv_Decode(
         viterbi27_rec_t *v,
         uint8_t *msg,
@@ -62,102 +72,255 @@ static void Vit_Conv_Decode(
 static void Vit_Conv_Encode(
         viterbi27_rec_t *v,
         uint8_t *input,
-        uint8_t *output);
+        uint8_t *output,
+        int len);
+static void Vit_Gauge_BER(
+        viterbi27_rec_t *v,
+        uint8_t *input,
+        uint8_t *output,
+        int len);
 
 /*****************************************************************************/
 
-static uint16_t Metric_Soft_Distance(
-        uint8_t hard,
-        uint8_t soft_y0,
-        uint8_t soft_y1) {
-  const int mag = 255;
-  int soft_x0, soft_x1;
-  uint16_t result;
+/* Metric_Branch()
+ *
+ * Sets the branch metrics of the 4 outputs for a pair of soft symbols,
+ * their linear distance from the symbols of the hard bits, SOFT_MAX for
+ * a 0 bit and -SOFT_MAX for a 1. As |y| < SOFT_MAX, |y - SOFT_MAX| is
+ * SOFT_MAX - y and |y + SOFT_MAX| is SOFT_MAX + y, so no table is needed
+ */
+static inline void Metric_Branch(viterbi27_rec_t *v, const uint8_t *soft) {
+  int y0, y1;
 
-  switch( hard & 0x03 )
-  {
-    case 0:
-      soft_x0 = mag;
-      soft_x1 = mag;
-      break;
-
-    case 1:
-      soft_x0 = -mag;
-      soft_x1 =  mag;
-      break;
-
-    case 2:
-      soft_x0 =  mag;
-      soft_x1 = -mag;
-      break;
-
-    case 3:
-      soft_x0 = -mag;
-      soft_x1 = -mag;
-      break;
+  y0 = (int8_t)soft[0];
+  y1 = (int8_t)soft[1];
 
-    default:
-      soft_x0 = 0;
-      soft_x1 = 0; //Dewarning
-  }
+  v->distances[0] = (uint16_t)( 2 * SOFT_MAX - y0 - y1 );
+  v->distances[1] = (uint16_t)( 2 * SOFT_MAX + y0 - y1 );
+  v->distances[2] = (uint16_t)( 2 * SOFT_MAX - y0 + y1 );
+  v->distances[3] = (uint16_t)( 2 * SOFT_MAX + y0 + y1 );
+}
 
-  //Linear distance
-  result = (uint16_t)
-    ( abs((int8_t)soft_y0 - soft_x0) +
-      abs((int8_t)soft_y1 - soft_x1) );
+/*****************************************************************************/
 
-  //Quadratic distance, not much better or worse.
-  //result = round(sqrt(sqr(shortint(soft_y0)-soft_x0)+
-  //sqr(shortint(soft_y1)-soft_x1)));
+/* Metric_Add()
+ *
+ * Adds a branch metric to a path metric, saturating at DISTANCE_MAX
+ * like the paddusw instruction of the SIMD versions
+ */
+static inline uint16_t Metric_Add(uint16_t metric, uint16_t dist) {
+  uint32_t sum = (uint32_t)metric + dist;
 
-  return( result );
+  // All ones if the sum overflowed, without a branch
+  return( (uint16_t)(sum | (0U - (sum >> 16))) );
 }
 
 /*****************************************************************************/
 
-static void Pair_Lookup_Create(viterbi27_rec_t *v) {
-  uint32_t inv_outputs[16];
-  uint32_t output_counter, o;
-  int i;
-
-  for( i = 0; i <= 15; i++ ) inv_outputs[i] = 0;
-  output_counter = 1;
+/* Vit_Acs_Scalar()
+ *
+ * Add-compare-select of one bit over the 64 states of the trellis.
+ * State s has the low and high predecessors s >> 1 and (s >> 1) + 32,
+ * the low one wins ties. Sets bit s of *history if the high one won
+ */
+static void Vit_Acs_Scalar(viterbi27_rec_t *v, uint64_t *history) {
+  uint32_t low, successor;
+  uint16_t low_past_error, high_past_error, low_error, high_error;
+  uint64_t decisions, high_won;
 
-  for( i = 0; i <= 63; i++ )
+  decisions = 0;
+  for( low = 0; low < NUM_STATES / 4; low++ )
   {
-    o = (uint32_t)( (v->table[i * 2 + 1] << 2) | v->table[i * 2] );
+    low_past_error  = v->read_errors[low];
+    high_past_error = v->read_errors[low + NUM_STATES / 4];
 
-    if( inv_outputs[o] == 0  )
+    for( successor = low << 1; successor <= ((low << 1) | 1); successor++ )
     {
-      inv_outputs[o] = output_counter;
-      v->pair_outputs[output_counter] = (uint32_t)o;
-      output_counter++;
+      low_error = Metric_Add(
+          low_past_error, v->distances[v->table[successor]] );
+      high_error = Metric_Add(
+          high_past_error, v->distances[v->table[successor | HIGH_BIT]] );
+
+      high_won = high_error < low_error;
+      v->write_errors[successor] = high_won ? high_error : low_error;
+      decisions |= high_won << successor;
     }
-    v->pair_keys[i] = (uint32_t)( inv_outputs[o] );
   }
 
-  v->pair_outputs_len = output_counter;
+  *history = decisions;
+}
 
-  v->pair_distances_len = (size_t)v->pair_outputs_len;
-  mem_realloc( (void **)&(v->pair_distances),
-      v->pair_distances_len * sizeof(uint32_t) );
+/*****************************************************************************/
+
+#ifdef VIT_X86_SIMD
+
+/* Vit_Acs_SSE2()
+ *
+ * Add-compare-select of one bit like Vit_Acs_Scalar(), 8 butterflies
+ * at a time. The branch metric of each low predecessor's even successor
+ * is selected from the 4 distances by the acs_mask lanes, the other
+ * three branches of the butterfly use its complement
+ */
+__attribute__((target("sse2")))
+static void Vit_Acs_SSE2(viterbi27_rec_t *v, uint64_t *history) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i d0, d1, d2, d3, d01, d23, mask_a, mask_b;
+  __m128i lo, hi, metric, comp, low_past, high_past;
+  __m128i even_low, even_high, odd_low, odd_high;
+  __m128i even_keep, odd_keep, even, odd, keep;
+  uint64_t decisions;
+  int g;
+
+  d0  = _mm_set1_epi16( (short)v->distances[0] );
+  d1  = _mm_set1_epi16( (short)v->distances[1] );
+  d2  = _mm_set1_epi16( (short)v->distances[2] );
+  d3  = _mm_set1_epi16( (short)v->distances[3] );
+  d01 = _mm_xor_si128( d0, d1 );
+  d23 = _mm_xor_si128( d2, d3 );
+
+  decisions = 0;
+  for( g = 0; g < NUM_STATES / 4; g += 8 )
+  {
+    mask_a = _mm_loadu_si128( (const __m128i *)&(v->acs_mask[0][g]) );
+    mask_b = _mm_loadu_si128( (const __m128i *)&(v->acs_mask[1][g]) );
+
+    lo = _mm_xor_si128( d0, _mm_and_si128(d01, mask_a) );
+    hi = _mm_xor_si128( d2, _mm_and_si128(d23, mask_a) );
+    metric = _mm_xor_si128( lo, _mm_and_si128(_mm_xor_si128(lo, hi), mask_b) );
+    lo = _mm_xor_si128( d3, _mm_and_si128(d23, mask_a) );
+    hi = _mm_xor_si128( d1, _mm_and_si128(d01, mask_a) );
+    comp = _mm_xor_si128( lo, _mm_and_si128(_mm_xor_si128(lo, hi), mask_b) );
+
+    low_past  = _mm_loadu_si128( (const __m128i *)&(v->read_errors[g]) );
+    high_past = _mm_loadu_si128(
+        (const __m128i *)&(v->read_errors[g + NUM_STATES / 4]) );
+
+    even_low  = _mm_adds_epu16( low_past,  metric );
+    even_high = _mm_adds_epu16( high_past, comp );
+    odd_low   = _mm_adds_epu16( low_past,  comp );
+    odd_high  = _mm_adds_epu16( high_past, metric );
+
+    // low <= high where the saturated difference is 0, min is low - that
+    even_keep = _mm_subs_epu16( even_low, even_high );
+    odd_keep  = _mm_subs_epu16( odd_low,  odd_high );
+    even = _mm_sub_epi16( even_low, even_keep );
+    odd  = _mm_sub_epi16( odd_low,  odd_keep );
+    even_keep = _mm_cmpeq_epi16( even_keep, zero );
+    odd_keep  = _mm_cmpeq_epi16( odd_keep,  zero );
+
+    // Interleave to successor order 2 * low, 2 * low + 1
+    _mm_storeu_si128( (__m128i *)&(v->write_errors[2 * g]),
+        _mm_unpacklo_epi16(even, odd) );
+    _mm_storeu_si128( (__m128i *)&(v->write_errors[2 * g + 8]),
+        _mm_unpackhi_epi16(even, odd) );
+
+    keep = _mm_packs_epi16(
+        _mm_unpacklo_epi16(even_keep, odd_keep),
+        _mm_unpackhi_epi16(even_keep, odd_keep) );
+    decisions |=
+      (uint64_t)( ~_mm_movemask_epi8(keep) & 0xFFFF ) << (2 * g);
+  }
+
+  *history = decisions;
 }
 
 /*****************************************************************************/
 
-static void Pair_Lookup_Fill_Distance(viterbi27_rec_t *v) {
+/* Vit_Acs_AVX2()
+ *
+ * Add-compare-select of one bit like Vit_Acs_SSE2(), 16 butterflies
+ * at a time. The in-lane unpacks leave the successors in two 128-bit
+ * halves which are swapped back into order for the path metrics, while
+ * packing the decisions restores their order by itself
+ */
+__attribute__((target("avx2")))
+static void Vit_Acs_AVX2(viterbi27_rec_t *v, uint64_t *history) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i d0, d1, d2, d3, d01, d23, mask_a, mask_b;
+  __m256i lo, hi, metric, comp, low_past, high_past;
+  __m256i even_low, even_high, odd_low, odd_high;
+  __m256i even_keep, odd_keep, even, odd;
+  uint64_t decisions;
+  uint32_t keep;
+  int g;
+
+  d0  = _mm256_set1_epi16( (short)v->distances[0] );
+  d1  = _mm256_set1_epi16( (short)v->distances[1] );
+  d2  = _mm256_set1_epi16( (short)v->distances[2] );
+  d3  = _mm256_set1_epi16( (short)v->distances[3] );
+  d01 = _mm256_xor_si256( d0, d1 );
+  d23 = _mm256_xor_si256( d2, d3 );
+
+  decisions = 0;
+  for( g = 0; g < NUM_STATES / 4; g += 16 )
+  {
+    mask_a = _mm256_loadu_si256( (const __m256i *)&(v->acs_mask[0][g]) );
+    mask_b = _mm256_loadu_si256( (const __m256i *)&(v->acs_mask[1][g]) );
+
+    lo = _mm256_xor_si256( d0, _mm256_and_si256(d01, mask_a) );
+    hi = _mm256_xor_si256( d2, _mm256_and_si256(d23, mask_a) );
+    metric = _mm256_xor_si256(
+        lo, _mm256_and_si256(_mm256_xor_si256(lo, hi), mask_b) );
+    lo = _mm256_xor_si256( d3, _mm256_and_si256(d23, mask_a) );
+    hi = _mm256_xor_si256( d1, _mm256_and_si256(d01, mask_a) );
+    comp = _mm256_xor_si256(
+        lo, _mm256_and_si256(_mm256_xor_si256(lo, hi), mask_b) );
+
+    low_past  = _mm256_loadu_si256( (const __m256i *)&(v->read_errors[g]) );
+    high_past = _mm256_loadu_si256(
+        (const __m256i *)&(v->read_errors[g + NUM_STATES / 4]) );
+
+    even_low  = _mm256_adds_epu16( low_past,  metric );
+    even_high = _mm256_adds_epu16( high_past, comp );
+    odd_low   = _mm256_adds_epu16( low_past,  comp );
+    odd_high  = _mm256_adds_epu16( high_past, metric );
+
+    even_keep = _mm256_subs_epu16( even_low, even_high );
+    odd_keep  = _mm256_subs_epu16( odd_low,  odd_high );
+    even = _mm256_sub_epi16( even_low, even_keep );
+    odd  = _mm256_sub_epi16( odd_low,  odd_keep );
+    even_keep = _mm256_cmpeq_epi16( even_keep, zero );
+    odd_keep  = _mm256_cmpeq_epi16( odd_keep,  zero );
+
+    // Successors 0-7 and 16-23, 8-15 and 24-31 of this group
+    lo = _mm256_unpacklo_epi16( even, odd );
+    hi = _mm256_unpackhi_epi16( even, odd );
+    _mm256_storeu_si256( (__m256i *)&(v->write_errors[2 * g]),
+        _mm256_permute2x128_si256(lo, hi, 0x20) );
+    _mm256_storeu_si256( (__m256i *)&(v->write_errors[2 * g + 16]),
+        _mm256_permute2x128_si256(lo, hi, 0x31) );
+
+    keep = (uint32_t)_mm256_movemask_epi8( _mm256_packs_epi16(
+          _mm256_unpacklo_epi16(even_keep, odd_keep),
+          _mm256_unpackhi_epi16(even_keep, odd_keep)) );
+    decisions |= (uint64_t)( ~keep ) << (2 * g);
+  }
+
+  *history = decisions;
+}
+
+#endif
+
+/*****************************************************************************/
+
+/* Vit_Acs_Symmetric()
+ *
+ * Checks that the branch outputs of a butterfly are complementary,
+ * as the SIMD versions assume. True for any code whose polynomials
+ * have their first and last taps set, like those of LRPT
+ */
+static bool Vit_Acs_Symmetric(const viterbi27_rec_t *v) {
   int i;
-  uint32_t c, i0, i1;
 
-  for( i = 1; i < (int)v->pair_outputs_len; i++ )
+  for( i = 0; i < NUM_STATES / 2; i += 2 )
   {
-    c = v->pair_outputs[i];
-    i0 = c & 3;
-    i1 = c >> 2;
-
-    v->pair_distances[i] = (uint32_t)
-      ( (v->distances[i1] << 16) | v->distances[i0] );
+    if( (v->table[i + 1] != (v->table[i] ^ 3)) ||
+        (v->table[i | HIGH_BIT] != (v->table[i] ^ 3)) ||
+        (v->table[(i + 1) | HIGH_BIT] != v->table[i]) )
+      return( false );
   }
+
+  return( true );
 }
 
 /*****************************************************************************/
@@ -198,15 +361,22 @@ static void History_Buffer_Renormalize(
 
 /*****************************************************************************/
 
+/* History_Buffer_Traceback()
+ *
+ * Traces the best path back from the newest decisions and writes out
+ * the bits older than min_traceback_length. They come out newest first,
+ * so they are shifted down into words from the top, the last word
+ * filled first, and the words written in order once the trace is over
+ */
 static void History_Buffer_Traceback(
         viterbi27_rec_t *v,
         uint32_t bestpath,
         uint32_t min_traceback_length) {
-  int j;
-  uint32_t index, fetched_index, pathbit, prefetch_index, len;
-  uint8_t history;
+  uint64_t words[(MIN_TRACEBACK + TRACEBACK_LENGTH + 63) / 64];
+  uint64_t acc, pathbit;
+  int j, len, cnt, word;
+  uint32_t index;
 
-  fetched_index = 0;
   index = (uint32_t)(v->hist_index);
   for( j = 0; j < (int)min_traceback_length; j++ )
   {
@@ -214,38 +384,40 @@ static void History_Buffer_Traceback(
       index = MIN_TRACEBACK + TRACEBACK_LENGTH - 1;
     else index--;
 
-    history = v->history[index][bestpath];
-    if( history != 0 ) pathbit = HIGH_BIT;
-    else pathbit = 0;
-    bestpath = (bestpath | pathbit) >> 1;
+    pathbit  = (v->history[index] >> bestpath) & 1;
+    bestpath = ( bestpath | ((uint32_t)pathbit * HIGH_BIT) ) >> 1;
   }
 
-  prefetch_index = index;
-  if( prefetch_index == 0 )
-    prefetch_index = MIN_TRACEBACK + TRACEBACK_LENGTH - 1;
-  else prefetch_index--;
-
-  len = (uint32_t)(v->len);
-  for( j = (int)min_traceback_length; j < (int)len; j++ )
+  len  = v->len - (int)min_traceback_length;
+  word = ( len + 63 ) / 64 - 1;
+  acc  = 0;
+  cnt  = 0;
+  for( j = 0; j < len; j++ )
   {
-    index = prefetch_index;
-    if( prefetch_index == 0 )
-      prefetch_index = MIN_TRACEBACK + TRACEBACK_LENGTH - 1;
-    else prefetch_index--;
-
-    history = v->history[index][bestpath];
-    if( history != 0 ) pathbit = HIGH_BIT;
-    else pathbit = 0;
-    bestpath = (bestpath | pathbit) >> 1;
-
-    if( pathbit != 0 ) v->fetched[fetched_index] = 1;
-    else v->fetched[fetched_index] = 0;
-    fetched_index++;
+    if( index == 0 )
+      index = MIN_TRACEBACK + TRACEBACK_LENGTH - 1;
+    else index--;
+
+    pathbit  = (v->history[index] >> bestpath) & 1;
+    bestpath = ( bestpath | ((uint32_t)pathbit * HIGH_BIT) ) >> 1;
+
+    acc = ( acc >> 1 ) | ( pathbit << 63 );
+    if( ++cnt == 64 )
+    {
+      words[word--] = acc;
+      acc = 0;
+      cnt = 0;
+    }
   }
 
-  Bitop_WriteBitlistReversed(
-      &(v->bit_writer), v->fetched, (int)fetched_index );
-  v->len -= fetched_index;
+  /* The oldest bits are left over in a part word */
+  if( cnt != 0 )
+    Bitop_WriteBits( &(v->bit_writer), acc >> (64 - cnt), cnt );
+  for( word = (cnt != 0); word < (len + 63) / 64; word++ )
+    Bitop_WriteBits( &(v->bit_writer), words[word], 64 );
+
+  Bitop_WriterFlush( &(v->bit_writer) );
+  v->len -= len;
 }
 
 /*****************************************************************************/
@@ -285,101 +457,34 @@ static void Error_Buffer_Swap(viterbi27_rec_t *v) {
 
 /*****************************************************************************/
 
-static void Vit_Inner(viterbi27_rec_t *v, uint8_t *soft) {
-  uint32_t highbase, low, high, base, offset, base_offset;
+static void Vit_Start(viterbi27_rec_t *v, uint8_t *soft) {
   int i, j;
-  uint8_t *history;
-  uint32_t low_key, high_key, low_concat_dist, high_concat_dist;
-  uint32_t successor, low_plus_one, plus_one_successor;
-  uint16_t low_past_error, high_past_error, low_error, high_error, error;
-  uint16_t low_plus_one_error, high_plus_one_error, plus_one_error;
-  uint8_t history_mask, plus_one_history_mask;
 
   for( i = 0; i <= 5; i++ )
   {
+    Metric_Branch( v, &soft[i * 2] );
     for( j = 0; j < (1 << (i + 1)); j++ )
     {
-      int idx = (soft[i * 2 + 1] << 8) + soft[i * 2];
       v->write_errors[j] =
-        v->dist_table[v->table[j]][idx] + v->read_errors[j >> 1];
+        v->distances[v->table[j]] + v->read_errors[j >> 1];
     }
     Error_Buffer_Swap( v );
   }
+}
 
-  for( i = 6; i <= FRAME_BITS - 7; i++ )
-  {
-    for( j = 0; j <= 3; j++ )
-    {
-      int idx = (soft[i * 2 + 1] << 8) + soft[i * 2];
-      v->distances[j] = v->dist_table[j][idx];
-    }
-    history = &(v->history[v->hist_index][0]);
-
-    Pair_Lookup_Fill_Distance( v );
+/*****************************************************************************/
 
-    highbase = HIGH_BIT >> 1;
-    low = 0;
-    high = HIGH_BIT;
-    base = 0;
-    while( high < NUM_ITER )
-    {
-      offset = 0;
-      base_offset = 0;
-      while( base_offset < 4 )
-      {
-        low_key  = v->pair_keys[base + base_offset];
-        high_key = v->pair_keys[highbase + base + base_offset];
-
-        low_concat_dist  = v->pair_distances[low_key];
-        high_concat_dist = v->pair_distances[high_key];
-
-        low_past_error  = v->read_errors[base + base_offset];
-        high_past_error = v->read_errors[highbase + base + base_offset];
-
-        low_error  = (low_concat_dist  & 0xFFFF) + low_past_error;
-        high_error = (high_concat_dist & 0xFFFF) + high_past_error;
-
-        successor = low + offset;
-        if( low_error <= high_error )
-        {
-          error = low_error;
-          history_mask = 0;
-        }
-        else
-        {
-          error = high_error;
-          history_mask = 1;
-        }
-        v->write_errors[successor] = error;
-        history[successor] = history_mask;
-
-        low_plus_one = low + offset + 1;
-
-        low_plus_one_error  = (low_concat_dist  >> 16) + low_past_error;
-        high_plus_one_error = (high_concat_dist >> 16) + high_past_error;
-
-        plus_one_successor = low_plus_one;
-        if( low_plus_one_error <= high_plus_one_error )
-        {
-          plus_one_error = low_plus_one_error;
-          plus_one_history_mask = 0;
-        }
-        else
-        {
-          plus_one_error = high_plus_one_error;
-          plus_one_history_mask = 1;
-        }
-        v->write_errors[plus_one_successor] = plus_one_error;
-        history[plus_one_successor] = plus_one_history_mask;
-
-        offset += 2;
-        base_offset++;
-      }
+/* Vit_Inner()
+ *
+ * Runs the trellis over bits start to end - 1, after Vit_Start()
+ */
+static void Vit_Inner(viterbi27_rec_t *v, uint8_t *soft, int start, int end) {
+  int i;
 
-      low  += 8;
-      high += 8;
-      base += 4;
-    }
+  for( i = start; i < end; i++ )
+  {
+    Metric_Branch( v, &soft[i * 2] );
+    v->acs( v, &(v->history[v->hist_index]) );
 
     History_Buffer_Process_Skip( v, 1 );
     Error_Buffer_Swap( v );
@@ -389,25 +494,20 @@ static void Vit_Inner(viterbi27_rec_t *v, uint8_t *soft) {
 /*****************************************************************************/
 
 static void Vit_Tail(viterbi27_rec_t *v, uint8_t *soft) {
-  int i, j;
-  uint8_t *history;
+  int i;
+  uint64_t *history;
   uint32_t skip, base_skip, highbase, low, high;
   uint32_t base, low_output, high_output;
   uint16_t low_dist, high_dist, low_past_error;
   uint16_t high_past_error, low_error, high_error;
   uint32_t successor;
   uint16_t error;
-  uint8_t history_mask;
 
 
   for( i = FRAME_BITS - 6; i < FRAME_BITS; i++ )
   {
-    for( j = 0; j <= 3; j++ )
-    {
-      int idx = (soft[i * 2 + 1] << 8) + soft[i * 2];
-      v->distances[j] = v->dist_table[j][idx];
-    }
-    history = &(v->history[v->hist_index][0]);
+    Metric_Branch( v, &soft[i * 2] );
+    history = &(v->history[v->hist_index]);
 
     skip = 1 << ( 7 - (FRAME_BITS - i) );
     base_skip = skip >> 1;
@@ -427,22 +527,22 @@ static void Vit_Tail(viterbi27_rec_t *v, uint8_t *soft) {
       low_past_error  = v->read_errors[base];
       high_past_error = v->read_errors[highbase + base];
 
-      low_error  = low_dist  + low_past_error;
-      high_error = high_dist + high_past_error;
+      low_error  = Metric_Add( low_past_error,  low_dist );
+      high_error = Metric_Add( high_past_error, high_dist );
 
+      // Only the states on the way to 0 are updated
       successor = low;
       if( low_error < high_error  )
       {
         error = low_error;
-        history_mask = 0;
+        *history &= ~( (uint64_t)1 << successor );
       }
       else
       {
         error = high_error;
-        history_mask = 1;
+        *history |= (uint64_t)1 << successor;
       }
       v->write_errors[successor] = error;
-      history[successor] = history_mask;
 
       low += skip;
       high += skip;
@@ -456,10 +556,7 @@ static void Vit_Tail(viterbi27_rec_t *v, uint8_t *soft) {
 
 /*****************************************************************************/
 
-static void Vit_Conv_Decode(
-        viterbi27_rec_t *v,
-        uint8_t *msg,
-        uint8_t *soft_encoded) {
+static void Vit_Conv_Reset(viterbi27_rec_t *v, uint8_t *msg) {
   Bitop_WriterCreate( &(v->bit_writer), msg, (FRAME_BITS * 2) / 8 );
 
   //history_buffer
@@ -473,8 +570,18 @@ static void Vit_Conv_Decode(
   v->err_index = 0;
   v->read_errors  = &(v->errors[0][0]);
   v->write_errors = &(v->errors[1][0]);
+}
+
+/*****************************************************************************/
+
+static void Vit_Conv_Decode(
+        viterbi27_rec_t *v,
+        uint8_t *msg,
+        uint8_t *soft_encoded) {
+  Vit_Conv_Reset( v, msg );
 
-  Vit_Inner( v, soft_encoded );
+  Vit_Start( v, soft_encoded );
+  Vit_Inner( v, soft_encoded, 6, FRAME_BITS - 6 );
   Vit_Tail(  v, soft_encoded );
   History_Buffer_Traceback( v, 0, 0 );
 }
@@ -484,18 +591,18 @@ static void Vit_Conv_Decode(
 static void Vit_Conv_Encode(
         viterbi27_rec_t *v,
         uint8_t *input,
-        uint8_t *output) {
+        uint8_t *output,
+        int len) {
   uint32_t sh;
   int i;
-  bit_io_rec_t b;
+  bit_reader_t b;
 
-  b.p = input;
-  b.pos = 0;
+  Bitop_ReaderCreate( &b, input, (len + 7) / 8 );
 
   sh = 0;
-  for( i = 0; i < FRAME_BITS; i++ )
+  for( i = 0; i < len; i++ )
   {
-    sh = ( (sh << 1) | Bitop_FetchNBits(&b, 1) ) & 0x7F;
+    sh = ( (sh << 1) | Bitop_Read(&b, 1) ) & 0x7F;
 
     if( (v->table[sh] & 1) != 0 ) output[i * 2 + 0] = 0;
     else output[i * 2 + 0] = 255;
@@ -507,35 +614,71 @@ static void Vit_Conv_Encode(
 
 /*****************************************************************************/
 
-void Vit_Decode(viterbi27_rec_t *v, uint8_t *input, uint8_t *output) {
-  int i;
+/* Vit_Gauge_BER()
+ *
+ * Gauges error level by re-encoding the first len decoded bits
+ * and comparing them to the soft symbols, scaled up to a frame
+ */
+static void Vit_Gauge_BER(
+        viterbi27_rec_t *v,
+        uint8_t *input,
+        uint8_t *output,
+        int len) {
+  int i, ber;
   uint8_t corrected[FRAME_BITS * 2];
 
+  Vit_Conv_Encode( v, output, corrected, len );
+  ber = 0;
+  for( i = 0; i < len * 2; i++ )
+    ber += Hard_Correlate( input[i], corrected[i] ^ 0xFF );
+  v->BER = ber * FRAME_BITS / len;
+}
+
+/*****************************************************************************/
+
+void Vit_Decode(viterbi27_rec_t *v, uint8_t *input, uint8_t *output) {
   Vit_Conv_Decode( v, output, input );
+  Vit_Gauge_BER( v, input, output, FRAME_BITS );
+}
 
-  //Gauge error level
-  Vit_Conv_Encode( v, output, corrected );
-  v->BER = 0;
-  for( i = 0; i < FRAME_BITS * 2; i++ )
-    v->BER += Hard_Correlate( input[i], corrected[i] ^ 0xFF );
+/*****************************************************************************/
+
+/* Vit_Decode_Head()
+ *
+ * Decodes the first VIT_HEAD_BITS bits of a frame and gauges BER on
+ * them only, for a fraction of the cost of Vit_Decode(). The decoder
+ * is left where it stopped so Vit_Decode_Rest() can finish the frame.
+ * VIT_HEAD_BITS is a whole number of tracebacks, so all of them are
+ * already in output and the same as Vit_Decode() would give
+ */
+void Vit_Decode_Head(viterbi27_rec_t *v, uint8_t *input, uint8_t *output) {
+  Vit_Conv_Reset( v, output );
+
+  Vit_Start( v, input );
+  Vit_Inner( v, input, 6, VIT_HEAD_BITS + MIN_TRACEBACK + 6 );
+  Vit_Gauge_BER( v, input, output, VIT_HEAD_BITS );
+}
+
+/*****************************************************************************/
+
+/* Vit_Decode_Rest()
+ *
+ * Finishes decoding a frame started by Vit_Decode_Head()
+ */
+void Vit_Decode_Rest(viterbi27_rec_t *v, uint8_t *input, uint8_t *output) {
+  Vit_Inner( v, input, VIT_HEAD_BITS + MIN_TRACEBACK + 6, FRAME_BITS - 6 );
+  Vit_Tail(  v, input );
+  History_Buffer_Traceback( v, 0, 0 );
+
+  Vit_Gauge_BER( v, input, output, FRAME_BITS );
 }
 
 /*****************************************************************************/
 
 void Mk_Viterbi27(viterbi27_rec_t *v) {
-  int i, j;
+  int i;
 
   v->BER = 0;
-  v->pair_distances = NULL; // My addition, for alloc's
-
-  // Metric lookup table
-  for( i = 0; i <= 3; i++ )
-    for( j = 0; j <= 65535; j++ )
-    {
-      v->dist_table[i][j] =
-        Metric_Soft_Distance(
-            (uint8_t)i, (uint8_t)(j & 0xFF), (uint8_t)(j >> 8) );
-    }
 
   // Polynomial table
   for( i = 0; i <= 127; i++ )
@@ -547,5 +690,51 @@ void Mk_Viterbi27(viterbi27_rec_t *v) {
       v->table[i] = v->table[i] | 2;
   }
 
-  Pair_Lookup_Create( v );
+  // Output bits of the low predecessors' even branches, per SIMD lane
+  for( i = 0; i < NUM_STATES / 4; i++ )
+  {
+    v->acs_mask[0][i] = (v->table[i * 2] & 1) ? 0xFFFF : 0;
+    v->acs_mask[1][i] = (v->table[i * 2] & 2) ? 0xFFFF : 0;
+  }
+
+  Vit_Set_Impl( v, VIT_IMPL_AUTO );
+}
+
+/*****************************************************************************/
+
+/* Vit_Set_Impl()
+ *
+ * Selects the add-compare-select step, the fastest one the CPU
+ * supports by default. All give the same output. Returns false,
+ * leaving the step unchanged, if impl is not supported
+ */
+bool Vit_Set_Impl(viterbi27_rec_t *v, vit_impl_t impl) {
+  switch( impl )
+  {
+    case VIT_IMPL_AUTO:
+      if( Vit_Set_Impl(v, VIT_IMPL_AVX2) ) return( true );
+      if( Vit_Set_Impl(v, VIT_IMPL_SSE2) ) return( true );
+      return( Vit_Set_Impl(v, VIT_IMPL_SCALAR) );
+
+    case VIT_IMPL_SCALAR:
+      v->acs = Vit_Acs_Scalar;
+      return( true );
+
+#ifdef VIT_X86_SIMD
+    case VIT_IMPL_SSE2:
+      if( !Vit_Acs_Symmetric(v) || !__builtin_cpu_supports("sse2") )
+        return( false );
+      v->acs = Vit_Acs_SSE2;
+      return( true );
+
+    case VIT_IMPL_AVX2:
+      if( !Vit_Acs_Symmetric(v) || !__builtin_cpu_supports("avx2") )
+        return( false );
+      v->acs = Vit_Acs_AVX2;
+      return( true );
+#endif
+
+    default:
+      return( false );
+  }
 }
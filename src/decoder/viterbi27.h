@@ -21,37 +21,49 @@
 
 #include "bitop.h"
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 /*****************************************************************************/
 
 #define FRAME_BITS          8192
+#define VITERBI27_POLYA     79      // 1001111
+#define VITERBI27_POLYB     109     // 1101101
 #define NUM_STATES          128
 #define MIN_TRACEBACK       35      // 5*7
 #define TRACEBACK_LENGTH    105     // 15*7
 
+/* Bits decoded by Vit_Decode_Head(), whole tracebacks */
+#define VIT_HEAD_BITS       (10 * TRACEBACK_LENGTH)
+
 /*****************************************************************************/
 
+/* Implementations of the add-compare-select step */
+typedef enum vit_impl_t {
+  VIT_IMPL_AUTO = 0,  // Fastest one the CPU supports
+  VIT_IMPL_SCALAR,
+  VIT_IMPL_SSE2,
+  VIT_IMPL_AVX2
+} vit_impl_t;
+
 /* Viterbi decoder data */
 typedef struct viterbi27_rec_t {
   int BER;
 
-  uint16_t dist_table[4][65536];
   uint8_t  table[NUM_STATES];
-  uint16_t distances[4];
+  uint16_t distances[4];  // Branch metrics of the current bit
 
   bit_io_rec_t bit_writer;
 
-  //pair_lookup
-  uint32_t pair_keys[64];      //1 shl (order-1)
-  uint32_t *pair_distances;
-  size_t   pair_distances_len; // My addition, size of above pointer's alloc
-  uint32_t pair_outputs[16];   //1 shl (2*rate)
-  uint32_t pair_outputs_len;
+  /* Add-compare-select step of one bit and the lane masks of the
+   * output bits of the low predecessors, used by the SIMD versions */
+  void (*acs)(struct viterbi27_rec_t *v, uint64_t *history);
+  uint16_t acs_mask[2][NUM_STATES / 4];
 
-  uint8_t history[MIN_TRACEBACK + TRACEBACK_LENGTH][NUM_STATES];
-  uint8_t fetched[MIN_TRACEBACK + TRACEBACK_LENGTH];
+  /* Decisions of each bit, bit n set if state n came from its high
+   * predecessor. Only the NUM_STATES / 2 states of K=7 are used */
+  uint64_t history[MIN_TRACEBACK + TRACEBACK_LENGTH];
   int hist_index, len, renormalize_counter;
 
   int err_index;
@@ -68,7 +80,10 @@ static inline double Vit_Get_Percent_BER(const viterbi27_rec_t *v) {
 /*****************************************************************************/
 
 void Vit_Decode(viterbi27_rec_t *v, uint8_t *input, uint8_t *output);
+void Vit_Decode_Head(viterbi27_rec_t *v, uint8_t *input, uint8_t *output);
+void Vit_Decode_Rest(viterbi27_rec_t *v, uint8_t *input, uint8_t *output);
 void Mk_Viterbi27(viterbi27_rec_t *v);
+bool Vit_Set_Impl(viterbi27_rec_t *v, vit_impl_t impl);
 
 /*****************************************************************************/
 
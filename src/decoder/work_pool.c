@@ -0,0 +1,201 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * Small pool of worker threads for the decoder. A batch of independent
+ * jobs is shared out between the workers and the calling thread, which
+ * returns only when all of them are finished. With a single CPU no
+ * worker is started and the caller runs the whole batch by itself.
+ */
+
+/*****************************************************************************/
+
+#include "work_pool.h"
+
+#include "../common/common.h"
+#include "../glrpt/utils.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <unistd.h>
+
+/*****************************************************************************/
+
+static void *Work_Pool_Worker(void *arg);
+
+/*****************************************************************************/
+
+/* Work_Pool_Worker()
+ *
+ * Runs in a thread of its own, taking jobs
+ * of each batch till the pool is stopped
+ */
+static void *Work_Pool_Worker(void *arg) {
+  work_pool_t *self = (work_pool_t *)arg;
+  work_pool_job_t job;
+  void *job_arg;
+  int idx;
+  sigset_t mask;
+
+  /* Signal handlers stop the decoder, leave them to the main thread */
+  sigfillset( &mask );
+  pthread_sigmask( SIG_BLOCK, &mask, NULL );
+
+  pthread_mutex_lock( &self->lock );
+  while( true )
+  {
+    while( (self->next >= self->count) && self->running )
+      pthread_cond_wait( &self->started, &self->lock );
+    if( !self->running ) break;
+
+    job     = self->job;
+    job_arg = self->arg;
+    idx     = self->next++;
+
+    pthread_mutex_unlock( &self->lock );
+    job( job_arg, idx );
+    pthread_mutex_lock( &self->lock );
+
+    if( ++self->done == self->count )
+      pthread_cond_signal( &self->finished );
+  } /* while( true ) */
+  pthread_mutex_unlock( &self->lock );
+
+  return( NULL );
+}
+
+/*****************************************************************************/
+
+/* Work_Pool_Init()
+ *
+ * Starts a worker for each CPU but the caller's, at most max_workers.
+ * Workers that fail to start are done without, down to none at all
+ */
+work_pool_t *Work_Pool_Init(int max_workers) {
+  work_pool_t *pool = NULL;
+  long cpus;
+  int num;
+
+  cpus = sysconf( _SC_NPROCESSORS_ONLN );
+  num  = (cpus > 1) ? (int)cpus - 1 : 0;
+  if( num > max_workers ) num = max_workers;
+
+  mem_alloc( (void **)&pool, sizeof(*pool) );
+  if( num > 0 )
+    mem_alloc( (void **)&(pool->workers), (size_t)num * sizeof(pthread_t) );
+
+  pool->nworkers = 0;
+  pool->job      = NULL;
+  pool->arg      = NULL;
+  pool->count    = 0;
+  pool->next     = 0;
+  pool->done     = 0;
+  pool->running  = true;
+
+  pthread_mutex_init( &pool->lock, NULL );
+  pthread_cond_init( &pool->started, NULL );
+  pthread_cond_init( &pool->finished, NULL );
+
+  while( pool->nworkers < num )
+  {
+    if( pthread_create(&pool->workers[pool->nworkers],
+          NULL, Work_Pool_Worker, pool) != SUCCESS )
+      break;
+    pool->nworkers++;
+  }
+
+  return( pool );
+}
+
+/*****************************************************************************/
+
+/* Work_Pool_Deinit()
+ *
+ * Stops the worker threads and frees the pool
+ */
+void Work_Pool_Deinit(work_pool_t *self) {
+  int idx;
+
+  if( !self ) return;
+
+  pthread_mutex_lock( &self->lock );
+  self->running = false;
+  pthread_cond_broadcast( &self->started );
+  pthread_mutex_unlock( &self->lock );
+
+  for( idx = 0; idx < self->nworkers; idx++ )
+    pthread_join( self->workers[idx], NULL );
+
+  pthread_cond_destroy( &self->finished );
+  pthread_cond_destroy( &self->started );
+  pthread_mutex_destroy( &self->lock );
+  free_ptr( (void **)&(self->workers) );
+  free_ptr( (void **)&self );
+}
+
+/*****************************************************************************/
+
+/* Work_Pool_Size()
+ *
+ * Number of jobs the pool runs at once, the caller included
+ */
+int Work_Pool_Size(const work_pool_t *self) {
+  return( self ? self->nworkers + 1 : 1 );
+}
+
+/*****************************************************************************/
+
+/* Work_Pool_Run()
+ *
+ * Runs job( arg, idx ) for idx from 0 to count - 1 on the workers and
+ * the calling thread, returning when all of them are finished. Jobs
+ * may run in any order, so each must only touch data of its own idx
+ */
+void Work_Pool_Run(work_pool_t *self, work_pool_job_t job, void *arg, int count) {
+  int idx;
+
+  if( !self || (self->nworkers == 0) || (count < 2) )
+  {
+    for( idx = 0; idx < count; idx++ )
+      job( arg, idx );
+    return;
+  }
+
+  pthread_mutex_lock( &self->lock );
+  self->job   = job;
+  self->arg   = arg;
+  self->count = count;
+  self->next  = 0;
+  self->done  = 0;
+  pthread_cond_broadcast( &self->started );
+
+  /* Take a share of the jobs, then wait for the workers' ones */
+  while( self->next < self->count )
+  {
+    idx = self->next++;
+    pthread_mutex_unlock( &self->lock );
+    job( arg, idx );
+    pthread_mutex_lock( &self->lock );
+    self->done++;
+  }
+  while( self->done < self->count )
+    pthread_cond_wait( &self->finished, &self->lock );
+
+  /* Batch over, workers are left waiting for the next one */
+  self->count = 0;
+  self->next  = 0;
+  pthread_mutex_unlock( &self->lock );
+}
@@ -0,0 +1,59 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*****************************************************************************/
+
+#ifndef DECODER_WORK_POOL_H
+#define DECODER_WORK_POOL_H
+
+/*****************************************************************************/
+
+#include <pthread.h>
+#include <stdbool.h>
+
+/*****************************************************************************/
+
+/* A job of a batch, idx is its index in the batch */
+typedef void (*work_pool_job_t)(void *arg, int idx);
+
+/* Worker threads that run the jobs of a batch along with the caller */
+typedef struct work_pool_t {
+    pthread_t *workers;
+    int nworkers;
+
+    /* Batch being run: job, its argument and number of jobs */
+    work_pool_job_t job;
+    void *arg;
+    int count;
+
+    /* Index of the next job to take and jobs finished */
+    int next, done;
+
+    /* Workers are to keep running */
+    bool running;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  started, finished;
+} work_pool_t;
+
+/*****************************************************************************/
+
+work_pool_t *Work_Pool_Init(int max_workers);
+void Work_Pool_Deinit(work_pool_t *self);
+int Work_Pool_Size(const work_pool_t *self);
+void Work_Pool_Run(work_pool_t *self, work_pool_job_t job, void *arg, int count);
+
+/*****************************************************************************/
+
+#endif
@@ -17,15 +17,7 @@
 #include "demod.h"
 
 #include "../common/common.h"
-#include "../common/shared.h"
-#include "../glrpt/callback_func.h"
-#include "../glrpt/display.h"
 #include "../glrpt/utils.h"
-#include "../decoder/medet.h"
-#include "../decoder/met_jpg.h"
-#include "../decoder/met_to_data.h"
-#include "../sdr/filters.h"
-#include "../sdr/SoapySDR.h"
 #include "agc.h"
 #include "doqpsk.h"
 #include "filters.h"
@@ -33,7 +25,6 @@
 
 #include <complex.h>
 #include <math.h>
-#include <semaphore.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -60,19 +51,12 @@
 /* TODO refer directly */
 #define RAW_BUF_REALLOC 73728 // INTLV_BASE_LEN
 
-#define IFFT_DECIMATE   2
-
 /*****************************************************************************/
 
 static inline int8_t Clamp_Int8(double x);
-static bool Demod_QPSK(complex double fdata, int8_t *buffer);
-static bool Demod_DOQPSK(complex double fdata, int8_t *buffer);
-static bool Demod_IDOQPSK(complex double fdata, int8_t *demod_buf);
-
-/*****************************************************************************/
-
-static Demod_t *demodulator = NULL;
-static bool (*Demod_PSK)(complex double, int8_t *);
+static bool Demod_QPSK(Demod_t *self, complex double fdata);
+static bool Demod_DOQPSK(Demod_t *self, complex double fdata);
+static bool Demod_IDOQPSK(Demod_t *self, complex double fdata);
 
 /*****************************************************************************/
 
@@ -99,71 +83,54 @@ static inline int8_t Clamp_Int8(double x) {
  *
  * Demodulate QPSK signal from Meteor
  */
-static bool Demod_QPSK(complex double fdata, int8_t *buffer) {
-  static complex double
-    before  = 0.0,
-    middle  = 0.0,
-    current = 0.0;
-
-  static double
-    resync_offset = 0.0,
-    sym_period    = 0.0,
-    sp2, sp2p1;
-
+static bool Demod_QPSK(Demod_t *self, complex double fdata) {
   double resync_error, delta;
 
-  static int buf_idx = 0;
-
-  int8_t *buf_lowr = buffer + DEMOD_BUF_LOWR;
-  int8_t *buf_midl = buffer + DEMOD_BUF_MIDL;
+  int8_t *buf_lowr = self->out_buffer + DEMOD_BUF_LOWR;
+  int8_t *buf_midl = self->out_buffer + DEMOD_BUF_MIDL;
 
 
-  /* Static values initialization */
-  if( sym_period == 0.0 )
-  {
-    sym_period = demodulator->sym_period;
-    sp2        = sym_period / 2.0;
-    sp2p1      = sp2 + 1.0;
-  }
-
   /* Symbol timing recovery (Gardner) */
-  if( (resync_offset >= sp2) && (resync_offset < sp2p1) )
+  if( (self->resync_offset >= self->sp2) &&
+      (self->resync_offset <  self->sp2p1) )
   {
-    middle = Agc_Apply( demodulator->agc, fdata );
+    self->middle = Agc_Apply( self->agc, fdata );
   }
-  else if( resync_offset >= sym_period )
+  else if( self->resync_offset >= self->sym_period )
   {
-    current = Agc_Apply( demodulator->agc, fdata );
-    resync_offset -= sym_period;
-    resync_error   = ( cimag(current) - cimag(before) ) * cimag(middle);
-    resync_offset += ( resync_error * sym_period / RESYNC_SCALE_QPSK );
-    before = current;
+    self->current = Agc_Apply( self->agc, fdata );
+    self->resync_offset -= self->sym_period;
+    resync_error =
+      ( cimag(self->current) - cimag(self->before) ) * cimag(self->middle);
+    self->resync_offset +=
+      ( resync_error * self->sym_period / RESYNC_SCALE_QPSK );
+    self->before = self->current;
 
     /* Costas loop frequency/phase tuning */
-    current = Costas_Mix( demodulator->costas, current );
-    delta   = Costas_Delta( current, current );
-    Costas_Correct_Phase( demodulator->costas, delta );
+    self->current = Costas_Mix( self->costas, self->current );
+    delta = Costas_Delta( self->costas, self->current, self->current );
+    Costas_Correct_Phase( self->costas, delta );
 
-    resync_offset += 1.0;
+    self->resync_offset += 1.0;
 
     /* Save result in demod buffer */
-    buf_lowr[buf_idx++] = Clamp_Int8( creal(current) / 2.0 );
-    buf_lowr[buf_idx++] = Clamp_Int8( cimag(current) / 2.0 );
+    buf_lowr[self->buf_idx++] = Clamp_Int8( creal(self->current) / 2.0 );
+    buf_lowr[self->buf_idx++] = Clamp_Int8( cimag(self->current) / 2.0 );
 
     /* Copy symbols in the local buffer to
      * the Demodulator buffer and return */
-    if( buf_idx >= SOFT_FRAME_LEN )
+    if( self->buf_idx >= SOFT_FRAME_LEN )
     {
       /* Move the 2 lower parts of Demodulator buffer to the top */
-      memmove( buffer, buf_midl, DEMOD_BUF_LOWR );
-      buf_idx = 0;
+      memmove( self->out_buffer, buf_midl, DEMOD_BUF_LOWR );
+      self->buf_idx = 0;
       return true;
     }
 
     return false;
   } /* else if( resync_offset >= sym_period ) */
 
-  resync_offset += 1.0;
+  self->resync_offset += 1.0;
   return false;
 }
 
@@ -173,82 +140,63 @@ static bool Demod_QPSK(complex double fdata, int8_t *buffer) {
  *
  * Demodulate DOQPSK signal from Meteor
  */
-static bool Demod_DOQPSK(complex double fdata, int8_t *buffer) {
+static bool Demod_DOQPSK(Demod_t *self, complex double fdata) {
   complex double quad, agc;
-
-  static complex double
-    inphase = 0.0,
-    before  = 0.0,
-    middle  = 0.0,
-    current = 0.0;
-
-  static double
-    resync_offset = 0.0,
-    prev_i        = 0.0,
-    sym_period    = 0.0,
-    sp2, sp2p1;
-
   double resync_error, delta;
-  static int buf_idx = 0;
 
-  int8_t *buf_lowr = buffer + DEMOD_BUF_LOWR;
-  int8_t *buf_midl = buffer + DEMOD_BUF_MIDL;
+  int8_t *buf_lowr = self->out_buffer + DEMOD_BUF_LOWR;
+  int8_t *buf_midl = self->out_buffer + DEMOD_BUF_MIDL;
 
 
-  /* Static values initialization */
-  if( sym_period != demodulator->sym_period )
-  {
-    sym_period = demodulator->sym_period;
-    sp2        = sym_period / 2.0;
-    sp2p1      = sp2 + 1.0;
-  }
-
   /* Symbol timing recovery (Gardner) */
-  if( (resync_offset >= sp2) && (resync_offset < sp2p1) )
+  if( (self->resync_offset >= self->sp2) &&
+      (self->resync_offset <  self->sp2p1) )
   {
-    agc     = Agc_Apply( demodulator->agc, fdata );
-    inphase = Costas_Mix( demodulator->costas, agc );
-    middle  = prev_i + (complex double)I * cimag( inphase );
-    prev_i  = creal( inphase );
+    agc = Agc_Apply( self->agc, fdata );
+    self->inphase = Costas_Mix( self->costas, agc );
+    self->middle  = self->prev_i + (complex double)I * cimag( self->inphase );
+    self->prev_i  = creal( self->inphase );
   }
-  else if( resync_offset >= sym_period )
+  else if( self->resync_offset >= self->sym_period )
   {
     /* Symbol timing recovery (Gardner) */
-    agc     = Agc_Apply( demodulator->agc, fdata );
-    quad    = Costas_Mix( demodulator->costas, agc );
-    current = prev_i + (complex double)I * cimag( quad );
-    prev_i = creal( quad );
-
-    resync_offset -= sym_period;
-    resync_error   = ( cimag(quad) - cimag(before) ) * cimag( middle );
-    resync_offset += resync_error * sym_period / RESYNC_SCALE_DOQPSK;
-    before = current;
+    agc  = Agc_Apply( self->agc, fdata );
+    quad = Costas_Mix( self->costas, agc );
+    self->current = self->prev_i + (complex double)I * cimag( quad );
+    self->prev_i  = creal( quad );
+
+    self->resync_offset -= self->sym_period;
+    resync_error =
+      ( cimag(quad) - cimag(self->before) ) * cimag( self->middle );
+    self->resync_offset +=
+      resync_error * self->sym_period / RESYNC_SCALE_DOQPSK;
+    self->before = self->current;
 
     /* Carrier tracking */
-    delta = Costas_Delta( inphase, quad );
-    Costas_Correct_Phase( demodulator->costas, delta );
+    delta = Costas_Delta( self->costas, self->inphase, quad );
+    Costas_Correct_Phase( self->costas, delta );
 
-    resync_offset += 1.0;
+    self->resync_offset += 1.0;
 
     /* Save result in demod buffer */
-    buf_lowr[buf_idx++] = Clamp_Int8( creal(current) / 2.0 );
-    buf_lowr[buf_idx++] = Clamp_Int8( cimag(current) / 2.0 );
+    buf_lowr[self->buf_idx++] = Clamp_Int8( creal(self->current) / 2.0 );
+    buf_lowr[self->buf_idx++] = Clamp_Int8( cimag(self->current) / 2.0 );
 
     /* Copy symbols in the local buffer to
      * the Demodulator buffer and return */
-    if( buf_idx >= SOFT_FRAME_LEN )
+    if( self->buf_idx >= SOFT_FRAME_LEN )
     {
       /* Move the 2 lower parts of Demodulator buffer to the top */
-      De_Diffcode( buf_lowr, SOFT_FRAME_LEN );
-      memmove( buffer, buf_midl, DEMOD_BUF_LOWR );
-      buf_idx = 0;
+      De_Diffcode( &(self->diffcode), buf_lowr, SOFT_FRAME_LEN );
+      memmove( self->out_buffer, buf_midl, DEMOD_BUF_LOWR );
+      self->buf_idx = 0;
       return true;
     }
 
     return false;
   } /* else if( resync_offset >= sym_period ) */
 
-  resync_offset += 1.0;
+  self->resync_offset += 1.0;
   return false;
 }
 
@@ -256,134 +204,111 @@ static bool Demod_DOQPSK(complex double fdata, int8_t *buffer) {
 
 /* Demod_IDOQPSK()
  *
- * Demodulate Interleaved DOQPSK signal from Meteor
+ * Demodulate Interleaved DOQPSK signal from Meteor. Symbols
+ * are only collected here, they are de-interleaved and passed
+ * to the decoder by Demod_Flush() when reception is stopped
  */
-static bool Demod_IDOQPSK(complex double fdata, int8_t *demod_buf) {
+static bool Demod_IDOQPSK(Demod_t *self, complex double fdata) {
   complex double quad, agc;
-
-  static complex double
-    inphase = 0.0,
-    before  = 0.0,
-    middle  = 0.0,
-    current = 0.0;
-
-  static double
-    resync_offset = 0.0,
-    prev_i        = 0.0,
-    sym_period    = 0.0,
-    sp2, sp2p1;
-
   double resync_error, delta;
 
-  static uint8_t *raw_buf = NULL;
-  static int raw_buf_size = RAW_BUF_REALLOC, raw_buf_idx = 0;
-
-  static uint8_t *resync_buf = NULL;
-  static int resync_siz = 0, resync_idx = 0, copy_siz = 0;
-
-  int8_t *demod_buf_lowr = demod_buf + DEMOD_BUF_LOWR;
-  int8_t *demod_buf_midl = demod_buf + DEMOD_BUF_MIDL;
-  static int demod_buf_idx = 0;
 
-  static bool deint_done = false;
-
-
-  /* Static values initialization */
-  if( sym_period != demodulator->sym_period )
+  /* Symbol timing recovery (Gardner) */
+  if( (self->resync_offset >= self->sp2) &&
+      (self->resync_offset <  self->sp2p1) )
   {
-    sym_period = demodulator->sym_period;
-    sp2        = sym_period / 2.0;
-    sp2p1      = sp2 + 1.0;
-
-    /* Allocate raw buffer */
-    mem_alloc( (void **)&raw_buf, (size_t)raw_buf_size );
+    agc = Agc_Apply( self->agc, fdata );
+    self->inphase = Costas_Mix( self->costas, agc );
+    self->middle  = self->prev_i + (complex double)I * cimag( self->inphase );
+    self->prev_i  = creal( self->inphase );
   }
-
-  if( isFlagClear(STATUS_IDOQPSK_STOP) )
+  else if( self->resync_offset >= self->sym_period )
   {
     /* Symbol timing recovery (Gardner) */
-    if( (resync_offset >= sp2) && (resync_offset < sp2p1) )
-    {
-      agc     = Agc_Apply( demodulator->agc, fdata );
-      inphase = Costas_Mix( demodulator->costas, agc );
-      middle  = prev_i + (complex double)I * cimag( inphase );
-      prev_i  = creal( inphase );
-    }
-    else if( resync_offset >= sym_period )
+    agc  = Agc_Apply( self->agc, fdata );
+    quad = Costas_Mix( self->costas, agc );
+    self->current = self->prev_i + (complex double)I * cimag( quad );
+    self->prev_i  = creal( quad );
+
+    self->resync_offset -= self->sym_period;
+    resync_error =
+      ( cimag(quad) - cimag(self->before) ) * cimag( self->middle );
+    self->resync_offset +=
+      resync_error * self->sym_period / RESYNC_SCALE_IDOQPSK;
+    self->before = self->current;
+
+    /* Carrier tracking */
+    delta = Costas_Delta( self->costas, self->inphase, quad );
+    Costas_Correct_Phase( self->costas, delta );
+
+    /* Save result in raw buffer */
+    self->raw_buf[self->raw_buf_idx++] =
+      (uint8_t)Clamp_Int8( creal(self->current) / 2.0 );
+    self->raw_buf[self->raw_buf_idx++] =
+      (uint8_t)Clamp_Int8( cimag(self->current) / 2.0 );
+
+    if( self->raw_buf_idx >= self->raw_buf_size )
     {
-      /* Symbol timing recovery (Gardner) */
-      agc     = Agc_Apply( demodulator->agc, fdata );
-      quad    = Costas_Mix( demodulator->costas, agc );
-      current = prev_i + (complex double)I * cimag( quad );
-      prev_i  = creal( quad );
-
-      resync_offset -= sym_period;
-      resync_error   = ( cimag(quad) - cimag(before) ) * cimag( middle );
-      resync_offset += resync_error * sym_period / RESYNC_SCALE_IDOQPSK;
-      before = current;
-
-      /* Carrier tracking */
-      delta = Costas_Delta( inphase, quad );
-      Costas_Correct_Phase( demodulator->costas, delta );
-
-      /* Save result in raw buffer */
-      raw_buf[raw_buf_idx++] = (uint8_t)Clamp_Int8( creal(current) / 2.0 );
-      raw_buf[raw_buf_idx++] = (uint8_t)Clamp_Int8( cimag(current) / 2.0 );
-
-      if( raw_buf_idx >= raw_buf_size )
-      {
-        raw_buf_size += RAW_BUF_REALLOC;
-        mem_realloc( (void **)&raw_buf, (size_t)raw_buf_size );
-      }
-
-      resync_offset += 1.0;
-      return false;
+      self->raw_buf_size += RAW_BUF_REALLOC;
+      mem_realloc( (void **)&(self->raw_buf), (size_t)self->raw_buf_size );
     }
 
-    resync_offset += 1.0;
+    self->resync_offset += 1.0;
     return false;
   }
 
+  self->resync_offset += 1.0;
+  return false;
+}
+
+/*****************************************************************************/
+
+/* Demod_Flush()
+ *
+ * De-interleaves the raw symbols collected in IDOQPSK
+ * mode and passes them to frame_cb() a frame at a time.
+ * Nothing to do for the other modes
+ */
+void Demod_Flush(Demod_t *self, demod_frame_cb_t frame_cb, void *arg) {
+  uint8_t *resync_buf = NULL;
+  int resync_siz = 0, resync_idx = 0, copy_siz;
+
+  int8_t *buf_lowr = self->out_buffer + DEMOD_BUF_LOWR;
+  int8_t *buf_midl = self->out_buffer + DEMOD_BUF_MIDL;
+
+  if( self->mode != IDOQPSK ) return;
+
   /* De-interleave raw symbols buffer */
-  if (!deint_done) {
-    De_Interleave( raw_buf, raw_buf_size, &resync_buf, &resync_siz );
-    raw_buf_idx = 0;
-    resync_idx  = 0;
-    deint_done  = true;
-  }
+  De_Interleave( self->raw_buf, self->raw_buf_size, &resync_buf, &resync_siz );
+  self->raw_buf_idx = 0;
 
-  /* Incrementally transfer data to the demod buffer */
-  if( resync_siz )
+  /* Transfer data to the demod buffer a frame at a time */
+  while( resync_buf && resync_siz )
   {
-    copy_siz = SOFT_FRAME_LEN - demod_buf_idx;
+    copy_siz = SOFT_FRAME_LEN - self->buf_idx;
     if( copy_siz > resync_siz ) copy_siz = resync_siz;
     memcpy(
-        demod_buf_lowr + demod_buf_idx,
-        resync_buf     + resync_idx,
+        buf_lowr   + self->buf_idx,
+        resync_buf + resync_idx,
         (size_t)copy_siz );
-    demod_buf_idx += copy_siz;
+    self->buf_idx += copy_siz;
     resync_siz    -= copy_siz;
     resync_idx    += copy_siz;
-  }
 
-  /* Copy symbols in the local buffer to
-   * the Demodulator buffer and return */
-  if( demod_buf_idx >= SOFT_FRAME_LEN )
-  {
-    /* Undo differential modulation */
-    De_Diffcode( demod_buf_lowr, SOFT_FRAME_LEN );
+    if( self->buf_idx >= SOFT_FRAME_LEN )
+    {
+      /* Undo differential modulation */
+      De_Diffcode( &(self->diffcode), buf_lowr, SOFT_FRAME_LEN );
+
+      /* Move the 2 lower parts of Demodulator buffer to the top */
+      memmove( self->out_buffer, buf_midl, DEMOD_BUF_LOWR );
+      self->buf_idx = 0;
 
-    /* Move the 2 lower parts of Demodulator buffer to the top */
-    memmove( demod_buf, demod_buf_midl, DEMOD_BUF_LOWR );
-    demod_buf_idx = 0;
-    return true;
+      if( frame_cb ) frame_cb( self->out_buffer, arg );
+    }
   }
 
-  /* TODO mlrpt doesn't contain such a line */
-  deint_done = false;
-  ClearFlag( STATUS_RECEIVING );
-  ClearFlag( STATUS_IDOQPSK_STOP );
-  return false;
+  free_ptr( (void **)&resync_buf );
 }
 
 /*****************************************************************************/
@@ -392,55 +317,64 @@ static bool Demod_IDOQPSK(complex double fdata, int8_t *demod_buf) {
  *
  * Initializes Demodulator Object
  */
-void Demod_Init(void) {
+Demod_t *Demod_Init(const demod_params_t *params) {
+  Demod_t *demod = NULL;
+
   /* Create and allocate a Demodulator object */
-  mem_alloc( (void **)&demodulator, sizeof(Demod_t) );
+  mem_alloc( (void **)&demod, sizeof(Demod_t) );
 
   /* Initialize the AGC */
-  demodulator->agc = Agc_Init();
+  demod->agc = Agc_Init();
 
   /* Initialize Costas loop */
   double pll_bw =
-    M_2PI * rc_data.costas_bandwidth / (double)rc_data.symbol_rate;
-  demodulator->costas = Costas_Init( pll_bw, rc_data.psk_mode );
-  demodulator->mode   = rc_data.psk_mode;
+    M_2PI * params->costas_bandwidth / (double)params->symbol_rate;
+  demod->costas = Costas_Init( pll_bw, params->psk_mode,
+      params->pll_locked, params->pll_unlocked, params->interp_factor );
+  demod->mode   = params->psk_mode;
 
   /* Initialize the timing recovery variables */
-  demodulator->sym_rate   = rc_data.symbol_rate;
-  demodulator->sym_period = (double)rc_data.interp_factor *
-    demod_samplerate / (double)rc_data.symbol_rate;
+  demod->interp_factor = params->interp_factor;
+  demod->sym_rate   = params->symbol_rate;
+  demod->sym_period = (double)params->interp_factor *
+    params->samplerate / (double)params->symbol_rate;
+  demod->sp2   = demod->sym_period / 2.0;
+  demod->sp2p1 = demod->sp2 + 1.0;
 
   /* Initialize RRC filter */
-  double osf = demod_samplerate / (double)rc_data.symbol_rate;
-  demodulator->rrc = Filter_RRC(
-      rc_data.rrc_order, rc_data.interp_factor, osf, rc_data.rrc_alpha );
+  double osf = params->samplerate / (double)params->symbol_rate;
+  demod->rrc = Filter_RRC(
+      params->rrc_order, params->interp_factor, osf, params->rrc_alpha );
+
+  /* Allocate output buffer. It is 3 sections of SOFT_FRAME_LEN
+   * size, top and middle sections are used by the image
+   * decoder and the lower for saving new data */
+  mem_alloc( (void **)&(demod->out_buffer), DEMOD_BUF_SIZE );
 
   /* Select demodulator (QPSK|DOQPSK|IDOQPSK) function */
-  switch( rc_data.psk_mode )
+  switch( params->psk_mode )
   {
     case QPSK:
-      Free_Isqrt_Table();
-      Demod_PSK = Demod_QPSK;
+      demod->demod_psk = Demod_QPSK;
       break;
 
     case DOQPSK:
-      /* Make 16k integer square root table
-       * and allocate demod buffer for OQPSK */
+      /* Make 16k integer square root table */
       Make_Isqrt_Table();
-      Demod_PSK = Demod_DOQPSK;
+      demod->demod_psk = Demod_DOQPSK;
       break;
 
     case IDOQPSK:
       /* Make 16k integer square root table
-       * and allocate demod buffer for OQPSK */
+       * and allocate raw symbols buffer */
       Make_Isqrt_Table();
-      Demod_PSK = Demod_IDOQPSK;
+      demod->raw_buf_size = RAW_BUF_REALLOC;
+      mem_alloc( (void **)&(demod->raw_buf), (size_t)demod->raw_buf_size );
+      demod->demod_psk = Demod_IDOQPSK;
       break;
   }
 
-  ClearFlag( IMAGES_PROCESSED );
-  ClearFlag( IMAGES_RECTIFIED );
-  ClearFlag( IMAGE_COLORIZED );  
+  return( demod );
 }
 
 /*****************************************************************************/
@@ -449,11 +383,51 @@ void Demod_Init(void) {
  *
  * De-initializes (frees) Demodulator Object
  */
-void Demod_Deinit(void) {
-  Agc_Free( demodulator->agc );
-  Costas_Free( demodulator->costas );
-  Filter_Free( demodulator->rrc );
-  free_ptr( (void **)&demodulator );
+void Demod_Deinit(Demod_t *self) {
+  if( !self ) return;
+
+  Agc_Free( self->agc );
+  Costas_Free( self->costas );
+  Filter_Free( self->rrc );
+  free_ptr( (void **)&(self->out_buffer) );
+  free_ptr( (void **)&(self->raw_buf) );
+  free_ptr( (void **)&self );
+}
+
+/*****************************************************************************/
+
+/* Demod_Process()
+ *
+ * Runs the Demodulator on a block of filtered I/Q samples and
+ * calls frame_cb() for each soft symbols frame it produces
+ */
+void Demod_Process(
+        Demod_t *self,
+        const double *samples_i,
+        const double *samples_q,
+        uint32_t len,
+        demod_frame_cb_t frame_cb,
+        void *arg) {
+  uint32_t count, idx;
+  complex double cdata, fdata;
+
+  for( count = 0; count < len; count++ )
+  {
+    /* Convert filtered samples to complex variable */
+    cdata = samples_i[count] + samples_q[count] * (complex double)I;
+
+    /* The interpolation and RRC filtering is now
+     * incorporated here in the demodulator code */
+    for( idx = 0; idx < self->interp_factor; idx++ )
+    {
+      /* Pass samples through interpolator RRC filter */
+      fdata = Filter_Fwd( self->rrc, cdata );
+
+      /* Demodulate using appropriate function (QPSK|DOQPSK|IDOQPSK) */
+      if( self->demod_psk(self, fdata) && frame_cb )
+        frame_cb( self->out_buffer, arg );
+    }
+  }
 }
 
 /*****************************************************************************/
@@ -462,15 +436,15 @@ void Demod_Deinit(void) {
  * These functions return Agc Gain, Signal Level and Costas PLL
  * Average Error in the range of 0.0-1.0 for the level gauges
  */
-double Agc_Gain(double *gain) {
+double Agc_Gain(const Demod_t *self, double *gain) {
   double ret = 0.0;
 
   /* Return gain if non-null argument */
-  if( demodulator )
+  if( self )
   {
-    ret = - log10( demodulator->agc->gain ) / AGC_RANGE1;
+    ret = - log10( self->agc->gain ) / AGC_RANGE1;
     ret = dClamp( ret, 0.0, 1.0 );
-    if( gain ) *gain = demodulator->agc->gain;
+    if( gain ) *gain = self->agc->gain;
   }
 
   return( ret );
@@ -478,28 +452,28 @@ double Agc_Gain(double *gain) {
 
 /*****************************************************************************/
 
-double Signal_Level(uint32_t *level) {
+double Signal_Level(const Demod_t *self, uint32_t *level) {
   double ret = 0.0;
 
   /* Return signal level if non-null argument */
-  if( demodulator )
+  if( self )
   {
-    ret = demodulator->agc->average / AGC_AVE_RANGE;
+    ret = self->agc->average / AGC_AVE_RANGE;
     ret = dClamp( ret, 0.0, 1.0 );
-    if( level ) *level = (uint32_t)demodulator->agc->average;
+    if( level ) *level = (uint32_t)self->agc->average;
   }
   return( ret );
 }
 
 /*****************************************************************************/
 
-double Pll_Average(void) {
+double Pll_Average(const Demod_t *self) {
   double ret = 0.0;
 
   /* We display a range of 0.1 to 0.5 */
-  if( demodulator )
+  if( self )
   {
-    ret = demodulator->costas->moving_average - PLL_AVE_RANGE1;
+    ret = self->costas->moving_average - PLL_AVE_RANGE1;
     ret = 1.0 - PLL_AVE_RANGE2 * ret;
     ret = dClamp( ret, 0.0, 1.0 );
   }
@@ -508,122 +482,19 @@ double Pll_Average(void) {
 
 /*****************************************************************************/
 
-/* Demodulator_Run()
+/* Pll_Frequency()
  *
- * Runs the Demodulator functions and supplies
- * soft symbols to the LRPT decoder functions
+ * Returns the Costas PLL frequency offset (Hz)
  */
-bool Demodulator_Run(void) {
-  uint32_t count, done, idx, buf_idx;
-  complex double  cdata, fdata;
-  static int8_t  *out_buffer = NULL;
-  uint32_t fft_decim_cnt, data_idx;
-  double sum_i, sum_q;
-
-  /* On user stop action */
-  if( isFlagClear(STATUS_RECEIVING) )
-  {
-    Mj_Dump_Image();
-    free_ptr( (void **)&out_buffer );
-    ClearFlag( STATUS_DEMODULATING );
-
-    /* Will de-initialize systems and free
-     * buffers only if (hopefully) its safe */
-    Cleanup();
-
-    Display_Icon( frame_icon, "gtk-no" );
-    ClearFlag( FRAME_OK_ICON );
-    Display_Icon( pll_lock_icon, "gtk-no" );
-    Show_Message( "Receiving & Decoding Ended", "green" );
-    Set_Check_Menu_Item( "decode_images_menuitem",  false );
-    return false;
-  }
+double Pll_Frequency(const Demod_t *self) {
+  double freq;
 
-  /* Allocate output buffer on first call. It is 3 sections
-   * of SOFT_FRAME_LEN size, top and middle sections are used
-   * by the image decoder and the lower for saving new data */
-  if( !out_buffer )
-  {
-    SetFlag( STATUS_DEMODULATING );
-    mem_alloc( (void **)&out_buffer, 3 * SOFT_FRAME_LEN );
-  }
-
-  /* Wait on DSP data to be ready for processing */
-  sem_wait( &demod_semaphore );
-
-  /* Filter samples from SDR receiver */
-  DSP_Filter( &filter_data_i );
-  DSP_Filter( &filter_data_q );
-
-  /* Save samples for carrier ifft and display waterfall */
-  buf_idx  = 0;
-  sum_i    = 0.0;
-  sum_q    = 0.0;
-  data_idx = 0;
-  fft_decim_cnt = 0;
-  for( idx = 0; idx < ifft_data_length; idx++ )
-  {
-    sum_i += filter_data_i.samples_buf[buf_idx];
-    sum_q += filter_data_q.samples_buf[buf_idx];
-    buf_idx++;
-
-    fft_decim_cnt++;
-    if( fft_decim_cnt >= IFFT_DECIMATE )
-    {
-      ifft_data[data_idx++] = (int16_t)sum_i;
-      ifft_data[data_idx++] = (int16_t)sum_q;
-      fft_decim_cnt = 0;
-      sum_i = 0.0;
-      sum_q = 0.0;
-    }
-  } /* for( idx = 0; idx < ifft_data_length; idx++ ) */
-  Display_Waterfall();
-
-  /* Process I/Q data from the SDR Receiver */
-  count = 0;
-  done  = filter_data_i.samples_buf_len;
-  while( count < done )
-  {
-    /* Convert filtered samples to complex variable */
-    cdata =
-      filter_data_i.samples_buf[count] +
-      filter_data_q.samples_buf[count] * (complex double)I;
+  if( !self ) return( 0.0 );
 
-    /* The interpolation and RRC filtering is now
-     * incorporated here in the demodulator code */
-    for( idx = 0; idx < rc_data.interp_factor; idx++ )
-    {
-      /* Pass samples through interpolator RRC filter */
-      fdata = Filter_Fwd( demodulator->rrc, cdata );
-
-      /* Demodulate using appropriate function (QPSK|DOQPSK|IDOQPSK).
-       * Try to decode one or more LRPT frames when PLL is locked */
-      if( Demod_PSK(fdata, out_buffer) &&
-          demodulator->costas->locked  &&
-          isFlagSet(STATUS_DECODING) )
-      {
-        /* Try to decode one or more LRPT frames */
-        Decode_Image( (uint8_t *)out_buffer, SOFT_FRAME_LEN );
-
-        /* The mtd_record.pos and mtd_record.prev_pos pointers must be
-         * decrimented to point back to the same data in the soft buffer */
-        mtd_record.pos      -= SOFT_FRAME_LEN;
-        mtd_record.prev_pos -= SOFT_FRAME_LEN;
-
-      } /* if( demodulator->costas->locked ... ) */
-    } /* for( idx = 0; idx < rc_data.interp_mult; idx++ ) */
-
-    count++;
-  } /* while( count < done ) */
-
-  if( isFlagSet(STATUS_RECEIVING) )
-  {
-    /* Display the QPSK constellation */
-    Display_QPSK_Const( out_buffer );
-
-    /* Display Demodulator params (AGC gain, PLL freq etc) */
-    Display_Demod_Params( demodulator );
-  }
+  /* FIXME */
+  freq = self->costas->nco_freq * self->sym_rate / M_2PI;
+  if( (self->mode == DOQPSK) || (self->mode == IDOQPSK) )
+    freq *= 2.0;
 
-  return true;
+  return( freq );
 }
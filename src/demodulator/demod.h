@@ -20,14 +20,39 @@
 /*****************************************************************************/
 
 #include "agc.h"
+#include "doqpsk.h"
 #include "filters.h"
 #include "pll.h"
 
+#include <complex.h>
 #include <stdbool.h>
 #include <stdint.h>
 
 /*****************************************************************************/
 
+/* Demodulator parameters, copied at init */
+typedef struct demod_params_t {
+    /* Demodulator type (QPSK/DOQPSK/IDOQPSK) and symbol rate (Sym/s) */
+    ModScheme psk_mode;
+    uint32_t  symbol_rate;
+
+    /* Interpolation multiplier and rate of the input samples */
+    uint32_t  interp_factor;
+    double    samplerate;
+
+    /* Costas PLL bandwidth and lock/unlock phase error thresholds */
+    double costas_bandwidth;
+    double pll_locked, pll_unlocked;
+
+    /* Raised root cosine filter order and alpha factor */
+    uint32_t rrc_order;
+    double   rrc_alpha;
+} demod_params_t;
+
+/* Called each time a new soft frame is demodulated. The output buffer
+ * has 3 * SOFT_FRAME_LEN soft symbols, the newest frame in the middle */
+typedef void (*demod_frame_cb_t)(int8_t *buffer, void *arg);
+
 typedef struct Demod_t {
     Agc_t    *agc;
     Costas_t *costas;
@@ -35,16 +60,44 @@ typedef struct Demod_t {
     uint32_t  sym_rate;
     ModScheme mode;
     Filter_t *rrc;
+    uint32_t  interp_factor;
+
+    /* Symbol timing recovery (Gardner) state */
+    complex double inphase, before, middle, current;
+    double resync_offset, prev_i;
+    double sp2, sp2p1;
+
+    /* Soft symbols output buffer and write index in its lower third */
+    int8_t *out_buffer;
+    int     buf_idx;
+
+    /* Differential decoder state (DOQPSK|IDOQPSK) */
+    diffcode_t diffcode;
+
+    /* Raw symbols of IDOQPSK, de-interleaved by Demod_Flush() */
+    uint8_t *raw_buf;
+    int raw_buf_size, raw_buf_idx;
+
+    /* Demodulator function (QPSK|DOQPSK|IDOQPSK) */
+    bool (*demod_psk)(struct Demod_t *self, complex double fdata);
 } Demod_t;
 
 /*****************************************************************************/
 
-void Demod_Init(void);
-void Demod_Deinit(void);
-double Agc_Gain(double *gain);
-double Signal_Level(uint32_t *level);
-double Pll_Average(void);
-bool Demodulator_Run(void);
+Demod_t *Demod_Init(const demod_params_t *params);
+void Demod_Deinit(Demod_t *self);
+void Demod_Process(
+        Demod_t *self,
+        const double *samples_i,
+        const double *samples_q,
+        uint32_t len,
+        demod_frame_cb_t frame_cb,
+        void *arg);
+void Demod_Flush(Demod_t *self, demod_frame_cb_t frame_cb, void *arg);
+double Agc_Gain(const Demod_t *self, double *gain);
+double Signal_Level(const Demod_t *self, uint32_t *level);
+double Pll_Average(const Demod_t *self);
+double Pll_Frequency(const Demod_t *self);
 
 /*****************************************************************************/
 
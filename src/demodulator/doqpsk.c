@@ -19,6 +19,7 @@
 #include "../glrpt/utils.h"
 
 #include <math.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -50,11 +51,16 @@ static bool Find_Sync(
         int *offset,
         uint8_t *sync);
 static void Resync_Stream(uint8_t *raw_buf, int raw_siz, int *resync_siz);
+static void Fill_Isqrt_Table(void);
 static inline int8_t Isqrt(int a);
 
 /*****************************************************************************/
 
-static uint8_t *isqrt_table = NULL;
+/* The table is shared by all demodulator instances */
+#define ISQRT_TABLE_LEN     16385
+
+static uint8_t isqrt_table[ISQRT_TABLE_LEN];
+static pthread_once_t isqrt_once = PTHREAD_ONCE_INIT;
 
 /*****************************************************************************/
 
@@ -238,20 +244,29 @@ void De_Interleave(
 
 /*****************************************************************************/
 
-/* Make_Isqrt_Table()
+/* Fill_Isqrt_Table()
  *
- * Makes the Integer square root table
+ * Fills the Integer square root table
  */
-void Make_Isqrt_Table(void) {
+static void Fill_Isqrt_Table(void) {
   uint16_t idx;
 
-  mem_alloc( (void **)&isqrt_table, sizeof(uint8_t) * 16385 );
-  for( idx = 0; idx < 16385; idx++ )
+  for( idx = 0; idx < ISQRT_TABLE_LEN; idx++ )
     isqrt_table[idx] = (uint8_t)( sqrt( (double)idx ) );
 }
 
 /*****************************************************************************/
 
+/* Make_Isqrt_Table()
+ *
+ * Makes the Integer square root table, only once
+ */
+void Make_Isqrt_Table(void) {
+  pthread_once( &isqrt_once, Fill_Isqrt_Table );
+}
+
+/*****************************************************************************/
+
 /* Isqrt()
  *
  * Integer square root function
@@ -270,18 +285,16 @@ static inline int8_t Isqrt(int a) {
  * "Fixes" a Differential Offset QPSK soft symbols
  * buffer so that it can be decoded by the LRPT decoder
  */
-void De_Diffcode(int8_t *buff, uint32_t length) {
+void De_Diffcode(diffcode_t *dc, int8_t *buff, uint32_t length) {
   uint32_t idx;
   int x, y;
   int tmp1, tmp2;
-  static int prev_i = 0;
-  static int prev_q = 0;
 
   tmp1 = buff[0];
   tmp2 = buff[1];
 
-  buff[0] = Isqrt(  buff[0] * prev_i );
-  buff[1] = Isqrt( -buff[1] * prev_q );
+  buff[0] = Isqrt(  buff[0] * dc->prev_i );
+  buff[1] = Isqrt( -buff[1] * dc->prev_q );
 
   length -= 2;
   for( idx = 2; idx <= length; idx += 2 )
@@ -297,14 +310,8 @@ void De_Diffcode(int8_t *buff, uint32_t length) {
   }
 
 
-  prev_i = tmp1;
-  prev_q = tmp2;
+  dc->prev_i = tmp1;
+  dc->prev_q = tmp2;
 
   return;
 }
-
-/*****************************************************************************/
-
-void Free_Isqrt_Table(void) {
-  free_ptr( (void **)&isqrt_table );
-}
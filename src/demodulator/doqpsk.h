@@ -23,10 +23,16 @@
 
 /*****************************************************************************/
 
+/* Last symbol of the previous buffer, needed to continue decoding */
+typedef struct diffcode_t {
+    int prev_i, prev_q;
+} diffcode_t;
+
+/*****************************************************************************/
+
 void De_Interleave(uint8_t *raw, int raw_siz, uint8_t **resync, int *resync_siz);
 void Make_Isqrt_Table(void);
-void De_Diffcode(int8_t *buff, uint32_t length);
-void Free_Isqrt_Table(void);
+void De_Diffcode(diffcode_t *dc, int8_t *buff, uint32_t length);
 
 /*****************************************************************************/
 
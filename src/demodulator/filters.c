@@ -17,7 +17,6 @@
 #include "filters.h"
 
 #include "../glrpt/utils.h"
-#include "demod.h"
 
 #include <complex.h>
 #include <math.h>
@@ -81,6 +80,7 @@ static Filter_t *Filter_New(uint32_t fwd_count, double *fwd_coeff) {
   mem_alloc( (void **)&flt, sizeof(*flt) );
   flt->fwd_count = fwd_count;
   flt->fwd_coeff = NULL;
+  flt->mem_idx   = 0;
 
   if( fwd_count )
   {
@@ -130,8 +130,8 @@ Filter_t *Filter_RRC(
  * Feed a signal through a filter, and output the result
  */
 complex double Filter_Fwd(Filter_t *const self, complex double in) {
-  uint32_t idc;       /* Coefficients index */
-  static int idm = 0; /* Ring buiffer (memory) index */
+  uint32_t idc;            /* Coefficients index */
+  int idm = self->mem_idx; /* Ring buffer (memory) index */
   complex double out;
 
   /* Update the memory nodes, save input to first node */
@@ -154,6 +154,7 @@ complex double Filter_Fwd(Filter_t *const self, complex double in) {
   /* Move back (left) in the ring buffer */
   idm--;
   if( idm < 0 ) idm += self->fwd_count;
+  self->mem_idx = idm;
 
   return( out );
 
@@ -29,6 +29,7 @@ typedef struct Filter_t {
     uint32_t fwd_count;
     uint32_t stage_no;
     double  *restrict fwd_coeff;
+    int      mem_idx; /* Ring buffer (memory) index */
 } Filter_t;
 
 /*****************************************************************************/
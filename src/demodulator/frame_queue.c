@@ -0,0 +1,196 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * Soft frames queue. Takes the place of a frame callback of the
+ * Demodulator and runs the real one in a worker thread of its own,
+ * so the image decoder works on one core while the Demodulator goes
+ * on with the next samples on another. Only the newest frame of the
+ * Demodulator's buffer is queued, the worker keeps a buffer of the
+ * same layout to pass on. The Demodulator waits only if the queue
+ * is full, so no frame is ever lost on a slow or busy decoder.
+ */
+
+/*****************************************************************************/
+
+#include "frame_queue.h"
+
+#include "../common/common.h"
+#include "../glrpt/utils.h"
+#include "demod.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*****************************************************************************/
+
+static void *Frame_Queue_Worker(void *arg);
+
+/*****************************************************************************/
+
+/* Frame_Queue_Worker()
+ *
+ * Runs in a thread of its own, passing queued frames to frame_cb()
+ * till the queue is stopped. Frames still queued are passed on first
+ */
+static void *Frame_Queue_Worker(void *arg) {
+  frame_queue_t *self = (frame_queue_t *)arg;
+  int8_t *frame;
+  sigset_t mask;
+
+  /* Signal handlers stop the decoder, leave them to the main thread */
+  sigfillset( &mask );
+  pthread_sigmask( SIG_BLOCK, &mask, NULL );
+
+  pthread_mutex_lock( &self->lock );
+  while( true )
+  {
+    /* Wait for a frame, or the order to stop */
+    self->busy = false;
+    while( (self->count == 0) && self->running )
+    {
+      pthread_cond_broadcast( &self->taken );
+      pthread_cond_wait( &self->queued, &self->lock );
+    }
+    if( self->count == 0 ) break;
+
+    /* Previous frame to the top and the oldest queued one
+     * below it, as the Demodulator leaves its own buffer */
+    frame = self->frames + (size_t)self->head * SOFT_FRAME_LEN;
+    memmove( self->window, self->window + SOFT_FRAME_LEN, SOFT_FRAME_LEN );
+    memcpy( self->window + SOFT_FRAME_LEN, frame, SOFT_FRAME_LEN );
+    memcpy( self->window + 2 * SOFT_FRAME_LEN, frame, SOFT_FRAME_LEN );
+    self->head = ( self->head + 1 ) % FRAME_QUEUE_LEN;
+    self->count--;
+    self->busy = true;
+    pthread_cond_broadcast( &self->taken );
+
+    pthread_mutex_unlock( &self->lock );
+    self->frame_cb( self->window, self->arg );
+    pthread_mutex_lock( &self->lock );
+  } /* while( true ) */
+  pthread_mutex_unlock( &self->lock );
+
+  return( NULL );
+}
+
+/*****************************************************************************/
+
+/* Frame_Queue_Init()
+ *
+ * Starts a worker thread that calls frame_cb() for each frame
+ * pushed to the queue. Returns NULL if the thread fails to start
+ */
+frame_queue_t *Frame_Queue_Init(demod_frame_cb_t frame_cb, void *arg) {
+  frame_queue_t *queue = NULL;
+
+  mem_alloc( (void **)&queue, sizeof(*queue) );
+  mem_alloc( (void **)&(queue->frames),
+      (size_t)FRAME_QUEUE_LEN * SOFT_FRAME_LEN );
+  mem_alloc( (void **)&(queue->window), 3 * SOFT_FRAME_LEN );
+
+  queue->head     = 0;
+  queue->count    = 0;
+  queue->frame_cb = frame_cb;
+  queue->arg      = arg;
+  queue->busy     = false;
+  queue->running  = true;
+
+  pthread_mutex_init( &queue->lock, NULL );
+  pthread_cond_init( &queue->queued, NULL );
+  pthread_cond_init( &queue->taken, NULL );
+
+  int ret = pthread_create(
+      &queue->worker_id, NULL, Frame_Queue_Worker, queue );
+  if( ret != SUCCESS )
+  {
+    Show_Message( "Failed to create Decoder thread", "red" );
+    pthread_cond_destroy( &queue->taken );
+    pthread_cond_destroy( &queue->queued );
+    pthread_mutex_destroy( &queue->lock );
+    free_ptr( (void **)&(queue->window) );
+    free_ptr( (void **)&(queue->frames) );
+    free_ptr( (void **)&queue );
+    return( NULL );
+  }
+
+  return( queue );
+}
+
+/*****************************************************************************/
+
+/* Frame_Queue_Deinit()
+ *
+ * Passes on the frames still queued, then stops
+ * the worker thread and frees the queue
+ */
+void Frame_Queue_Deinit(frame_queue_t *self) {
+  if( !self ) return;
+
+  pthread_mutex_lock( &self->lock );
+  self->running = false;
+  pthread_cond_signal( &self->queued );
+  pthread_mutex_unlock( &self->lock );
+  pthread_join( self->worker_id, NULL );
+
+  pthread_cond_destroy( &self->taken );
+  pthread_cond_destroy( &self->queued );
+  pthread_mutex_destroy( &self->lock );
+  free_ptr( (void **)&(self->window) );
+  free_ptr( (void **)&(self->frames) );
+  free_ptr( (void **)&self );
+}
+
+/*****************************************************************************/
+
+/* Frame_Queue_Push()
+ *
+ * Frame callback of the Demodulator, arg is the queue. Queues the
+ * newest frame of the buffer, waiting for room if the queue is full
+ */
+void Frame_Queue_Push(int8_t *buffer, void *arg) {
+  frame_queue_t *self = (frame_queue_t *)arg;
+  int tail;
+
+  pthread_mutex_lock( &self->lock );
+  while( self->count == FRAME_QUEUE_LEN )
+    pthread_cond_wait( &self->taken, &self->lock );
+
+  tail = ( self->head + self->count ) % FRAME_QUEUE_LEN;
+  memcpy( self->frames + (size_t)tail * SOFT_FRAME_LEN,
+      buffer + SOFT_FRAME_LEN, SOFT_FRAME_LEN );
+  self->count++;
+
+  pthread_cond_signal( &self->queued );
+  pthread_mutex_unlock( &self->lock );
+}
+
+/*****************************************************************************/
+
+/* Frame_Queue_Drain()
+ *
+ * Waits till all frames queued so far are passed to frame_cb()
+ */
+void Frame_Queue_Drain(frame_queue_t *self) {
+  if( !self ) return;
+
+  pthread_mutex_lock( &self->lock );
+  while( (self->count > 0) || self->busy )
+    pthread_cond_wait( &self->taken, &self->lock );
+  pthread_mutex_unlock( &self->lock );
+}
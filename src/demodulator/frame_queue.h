@@ -0,0 +1,65 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*****************************************************************************/
+
+#ifndef DEMODULATOR_FRAME_QUEUE_H
+#define DEMODULATOR_FRAME_QUEUE_H
+
+/*****************************************************************************/
+
+#include "demod.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/* Soft frames held by the queue, some 3.5 sec of symbols at 72 kSym/s */
+#define FRAME_QUEUE_LEN     32
+
+/*****************************************************************************/
+
+/* Queue of soft frames between the Demodulator and a worker thread */
+typedef struct frame_queue_t {
+    /* Ring of queued frames, index of the oldest one and their count */
+    int8_t *frames;
+    int     head, count;
+
+    /* Frames handed to frame_cb(), laid out as the Demodulator's buffer */
+    int8_t *window;
+
+    /* Called by the worker thread for each frame, as by the Demodulator */
+    demod_frame_cb_t frame_cb;
+    void *arg;
+
+    /* Worker is running frame_cb(), worker is to keep running */
+    bool busy, running;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  queued, taken;
+    pthread_t       worker_id;
+} frame_queue_t;
+
+/*****************************************************************************/
+
+frame_queue_t *Frame_Queue_Init(demod_frame_cb_t frame_cb, void *arg);
+void Frame_Queue_Deinit(frame_queue_t *self);
+void Frame_Queue_Push(int8_t *buffer, void *arg);
+void Frame_Queue_Drain(frame_queue_t *self);
+
+/*****************************************************************************/
+
+#endif
@@ -17,13 +17,11 @@
 #include "pll.h"
 
 #include "../common/common.h"
-#include "../common/shared.h"
-#include "../glrpt/display.h"
 #include "../glrpt/utils.h"
-#include "demod.h"
 
 #include <complex.h>
 #include <math.h>
+#include <pthread.h>
 #include <stddef.h>
 
 /*****************************************************************************/
@@ -47,11 +45,13 @@
 static inline double Clamp_Double(double x, double max_abs);
 static void Costas_Recompute_Coeffs(Costas_t *self, double damping, double bw);
 static double Lut_Tanh(double val);
+static void Make_Tanh_Table(void);
 
 /*****************************************************************************/
 
-static double *lut_tanh = NULL;
-static double costas_err_scale;
+/* The tanh table is shared by all Costas loops */
+static double lut_tanh[256];
+static pthread_once_t lut_tanh_once = PTHREAD_ONCE_INIT;
 
 /*****************************************************************************/
 
@@ -103,12 +103,29 @@ static double Lut_Tanh(double val) {
 
 /*****************************************************************************/
 
+/* Make_Tanh_Table()
+ *
+ * Makes the tanh table used in phase error calculation
+ */
+static void Make_Tanh_Table(void) {
+  int idx;
+
+  for( idx = 0; idx < 256; idx++ )
+    lut_tanh[idx] = tanh( (double)(idx - 128) );
+}
+
+/*****************************************************************************/
+
 /* Costas_Init()
  *
  * Initialize a Costas loop for carrier frequency/phase recovery
  */
-Costas_t *Costas_Init(double bw, ModScheme mode) {
-  int idx;
+Costas_t *Costas_Init(
+        double bw,
+        ModScheme mode,
+        double lock_thresh,
+        double unlock_thresh,
+        uint32_t interp_factor) {
   Costas_t *costas = NULL;
 
   mem_alloc( (void **)&costas, sizeof(*costas) );
@@ -129,25 +146,30 @@ Costas_t *Costas_Init(double bw, ModScheme mode) {
   /* Huge but needed to stop stray locks at startup */
   costas->moving_average = 1000000.0;
 
+  costas->lock_thresh   = lock_thresh;
+  costas->unlock_thresh = unlock_thresh;
+  costas->interp_factor = interp_factor;
+  costas->avg_winsize   = AVG_WINSIZE;
+  costas->avg_winsize_1 = AVG_WINSIZE - 1.0;
+  costas->delta         = 0.0;
+
   /* Error scaling depends on modulation mode */
   switch( mode )
   {
     case QPSK:
-    costas_err_scale = ERR_SCALE_QPSK;
+    costas->err_scale = ERR_SCALE_QPSK;
     break;
 
     case DOQPSK:
-    costas_err_scale = ERR_SCALE_DOQPSK;
+    costas->err_scale = ERR_SCALE_DOQPSK;
     break;
 
     case IDOQPSK:
-    costas_err_scale = ERR_SCALE_IDOQPSK;
+    costas->err_scale = ERR_SCALE_IDOQPSK;
     break;
   }
 
-  mem_alloc( (void **)&lut_tanh, sizeof(double) * 256 );
-  for( idx = 0; idx < 256; idx++ )
-    lut_tanh[idx] = tanh( (double)(idx - 128) );
+  pthread_once( &lut_tanh_once, Make_Tanh_Table );
 
   return( costas );
 }
@@ -177,52 +199,40 @@ complex double Costas_Mix(Costas_t *self, complex double samp) {
  * Corrects the phase angle of the Costas PLL
  */
 void Costas_Correct_Phase(Costas_t *self, double error) {
-  static double avg_winsize   = AVG_WINSIZE;
-  static double avg_winsize_1 = AVG_WINSIZE - 1.0;
-  static double delta = 0.0; /* Average phase error */
-
   error = Clamp_Double( error, 1.0 );
 
-  self->moving_average *= avg_winsize_1;
+  self->moving_average *= self->avg_winsize_1;
   self->moving_average += fabs( error );
-  self->moving_average /= avg_winsize;
+  self->moving_average /= self->avg_winsize;
 
   self->nco_phase += self->alpha * error;
   self->nco_phase  = fmod( self->nco_phase, M_2PI );
 
   /* Calculate sliding window average of phase error */
   if( self->locked ) error /= LOCKED_ERR_SCALE;
-  delta *= DELTA_WINSIZE_1;
-  delta += self->beta * error;
-  delta /= DELTA_WINSIZE;
-  self->nco_freq += delta;
+  self->delta *= DELTA_WINSIZE_1;
+  self->delta += self->beta * error;
+  self->delta /= DELTA_WINSIZE;
+  self->nco_freq += self->delta;
 
   /* Detect whether the PLL is locked, and decrease the BW if it is */
   if( !self->locked &&
-      (self->moving_average < rc_data.pll_locked) )
+      (self->moving_average < self->lock_thresh) )
   {
     Costas_Recompute_Coeffs(
         self, self->damping, self->bandwidth / LOCKED_BW_REDUCE );
-    self->locked  = 1;
-    avg_winsize   = AVG_WINSIZE * LOCKED_WINSIZEX / (double)rc_data.interp_factor;
-    avg_winsize_1 = avg_winsize - 1.0;
-
-    Display_Icon( pll_lock_icon, "gtk-yes" );
+    self->locked = 1;
+    self->avg_winsize =
+      AVG_WINSIZE * LOCKED_WINSIZEX / (double)self->interp_factor;
+    self->avg_winsize_1 = self->avg_winsize - 1.0;
   }
   else if( self->locked &&
-      (self->moving_average > rc_data.pll_unlocked) )
+      (self->moving_average > self->unlock_thresh) )
   {
     Costas_Recompute_Coeffs( self, self->damping, self->bandwidth );
-    self->locked  = 0;
-    avg_winsize   = AVG_WINSIZE / (double)rc_data.interp_factor;
-    avg_winsize_1 = avg_winsize - 1.0;
-
-    Display_Icon( pll_lock_icon, "gtk-no" );
-    Display_Icon( frame_icon, "gtk-no" );
-
-    /* Report zero signal quality */
-    mtd_record.sig_q = 0;
-    gtk_entry_set_text( GTK_ENTRY(sig_quality_entry), "0" );
+    self->locked = 0;
+    self->avg_winsize   = AVG_WINSIZE / (double)self->interp_factor;
+    self->avg_winsize_1 = self->avg_winsize - 1.0;
   }
 
   /* Limit frequency to a sensible range */
@@ -239,7 +249,6 @@ void Costas_Correct_Phase(Costas_t *self, double error) {
  */
 void Costas_Free(Costas_t *self) {
   free_ptr( (void **)&self );
-  free_ptr( (void **)& lut_tanh );
 }
 
 /*****************************************************************************/
@@ -249,12 +258,15 @@ void Costas_Free(Costas_t *self) {
  * Compute the delta phase value to use when
  * correcting the NCO frequency (OQPSK)
  */
-double Costas_Delta(complex double sample, complex double cosample) {
+double Costas_Delta(
+        Costas_t *self,
+        complex double sample,
+        complex double cosample) {
   double error;
 
   error  = ( Lut_Tanh(creal(sample))   * cimag(sample) ) -
            ( Lut_Tanh(cimag(cosample)) * creal(cosample) );
-  error /= costas_err_scale;
+  error /= self->err_scale;
 
   return( error );
 }
@@ -37,15 +37,33 @@ typedef struct Costas_t {
     uint8_t locked;
     double  moving_average;
     ModScheme mode; /* TODO is it actually needed? */
+
+    /* Lock detect thresholds of the phase error average */
+    double  lock_thresh, unlock_thresh;
+
+    /* Phase error average window, depends on interpolation factor */
+    double  avg_winsize, avg_winsize_1;
+    uint32_t interp_factor;
+
+    /* Average phase error and its scale factor for the mode */
+    double  delta, err_scale;
 } Costas_t;
 
 /*****************************************************************************/
 
-Costas_t *Costas_Init(double bw, ModScheme mode);
+Costas_t *Costas_Init(
+        double bw,
+        ModScheme mode,
+        double lock_thresh,
+        double unlock_thresh,
+        uint32_t interp_factor);
 complex double Costas_Mix(Costas_t *self, complex double samp);
 void Costas_Correct_Phase(Costas_t *self, double error);
 void Costas_Free(Costas_t *self);
-double Costas_Delta(complex double sample, complex double cosample);
+double Costas_Delta(
+        Costas_t *self,
+        complex double sample,
+        complex double cosample);
 
 /*****************************************************************************/
 
@@ -17,14 +17,15 @@
 #include "callback_func.h"
 
 #include "../common/common.h"
+#include "../common/receiver.h"
 #include "../common/shared.h"
-#include "../decoder/medet.h"
 #include "../demodulator/demod.h"
-#include "../sdr/ifft.h"
 #include "../sdr/SoapySDR.h"
+#include "../sdr/spectrum.h"
 #include "display.h"
-#include "image.h"
+#include "gui.h"
 #include "interface.h"
+#include "rc_config.h"
 #include "utils.h"
 
 #include <cairo.h>
@@ -34,7 +35,6 @@
 #include <glib-object.h>
 #include <gtk/gtk.h>
 
-#include <semaphore.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -66,6 +66,29 @@ void Error_Dialog(void) {
 
 /*****************************************************************************/
 
+/* loadConfig()
+ *
+ * Loads a per-satellite configuration file and sets up the
+ * top window accordingly. Runs as an idle callback
+ */
+gboolean loadConfig(gpointer f_path) {
+    if (!readConfig((const char *)f_path))
+        return FALSE;
+
+    /* Set Gain control buttons and slider */
+    GtkWidget *radiobtn = Builder_Get_Object(main_window_builder,
+            isFlagSet(TUNER_GAIN_AUTO) ?
+            "auto_agc_radiobutton" : "manual_agc_radiobutton");
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(radiobtn), TRUE);
+
+    /* (Re)initialize top window */
+    Initialize_Top_Window();
+
+    return FALSE;
+}
+
+/*****************************************************************************/
+
 /* Cancel_Timer()
  *
  * Handles cancellation of decoder timer
@@ -213,18 +236,20 @@ void Popup_Menu(void) {
  * Initialize Reception of signal from Satellite
  */
 static bool Init_Reception(void) {
-    /* Initialize semaphore */
-    sem_init(&demod_semaphore, 0, 0);
-
-    /* Initialize SoapySDR device */
-    if (!SoapySDR_Init()) {
+    /* Initialize SoapySDR device and demodulator object */
+    if (!Receiver_Init()) {
         Show_Message("Failed to Initialize SoapySDR", "red");
         Error_Dialog();
         return false;
     }
 
-    /* Init demodulator object */
-    Demod_Init();
+    /* Display Tuner Type */
+    GtkEntry *entry = GTK_ENTRY(
+            Builder_Get_Object(main_window_builder, "sdr_tuner_entry"));
+    gtk_entry_set_text(entry, SoapySDR_Hardware());
+
+    /* Start the waterfall spectrum worker */
+    Spectrum_Init(rc_data.wfall_fps, rc_data.wfall_avg, Waterfall_Row_Ready);
 
     return true;
 }
@@ -290,7 +315,7 @@ void Start_Receiver_Menuitem_Toggled(GtkCheckMenuItem *menuitem) {
     /* Display Device Driver in use */
     char mesg[MESG_SIZE];
     snprintf( mesg, sizeof(mesg),
-        "Decoding from Device \"%s\"", rc_data.device_driver );
+        "Decoding from Device \"%s\"", SoapySDR_Driver() );
     Show_Message( mesg, "green" );
   } /* if( gtk_check_menu_item_get_active(menuitem) && */
 
@@ -319,7 +344,7 @@ void Decode_Images_Menuitem_Toggled(GtkCheckMenuItem *menuitem) {
     Display_Scaled_Image( NULL, 0, 0 );
 
     /* Initialize Meteor Image Decoder */
-    Medet_Init();
+    Receiver_Decoder_Start();
 
     /* Start Timer if enabled */
     if( isFlagSet(ENABLE_DECODE_TIMER) )
@@ -347,7 +372,7 @@ void Decode_Images_Menuitem_Toggled(GtkCheckMenuItem *menuitem) {
     Show_Message( "Decoder Timer Cancelled", "orange" );
     alarm( 0 );
     ClearFlag( ALARM_ACTION_STOP );
-    Medet_Deinit();
+    Receiver_Decoder_Stop();
 
     Show_Message( "Decoding of LRPT Images Stopped", "black" );
     Display_Icon( frame_icon, "gtk-no" );
@@ -378,7 +403,7 @@ void Alarm_Action(void) {
     Display_Scaled_Image( NULL, 0, 0 );
 
     /* Initialize Meteor Image Decoder */
-    Medet_Init();
+    Receiver_Decoder_Start();
     SetFlag( STATUS_DECODING );
 
     /* Initialize SDR receiver and QPSK demodulator */
@@ -400,7 +425,7 @@ void Alarm_Action(void) {
     /* Display Device Driver in use */
     char mesg[MESG_SIZE];
     snprintf( mesg, sizeof(mesg),
-        "Decoding from %s Receiver", rc_data.device_driver );
+        "Decoding from %s Receiver", SoapySDR_Driver() );
     Show_Message( mesg, "black" );
 
     /* Start demodulator by idle callback */
@@ -425,7 +450,7 @@ void Alarm_Action(void) {
 
     ClearFlag( STATUS_RECEIVING );
     ClearFlag( STATUS_DECODING );
-    Medet_Deinit();
+    Receiver_Decoder_Stop();
 
     return;
   }
@@ -625,6 +650,21 @@ void Enter_Center_Freq(uint32_t freq) {
 
 /*****************************************************************************/
 
+/* Enter_Filter_BW()
+ *
+ * Enters the Low Pass Filter B/W to the relevant entry widget
+ */
+void Enter_Filter_BW(void) {
+  char text[10];
+  GtkEntry *entry = GTK_ENTRY(
+      Builder_Get_Object(main_window_builder, "sdr_bw_entry") );
+  uint32_t bw = rc_data.sdr_filter_bw / 1000;
+  snprintf( text, sizeof(text), "%4u", bw );
+  gtk_entry_set_text( entry, text );
+}
+
+/*****************************************************************************/
+
 /* Fft_Drawingarea_Size_Alloc()
  *
  * Initializes the waterfall drawing area pixbuf
@@ -655,11 +695,10 @@ void Fft_Drawingarea_Size_Alloc(GtkAllocation *allocation) {
   wfall_n_channels = gdk_pixbuf_get_n_channels( wfall_pixbuf );
   gdk_pixbuf_fill( wfall_pixbuf, 0 );
 
-  /* Initialize ifft. Waterfall with is an odd number
-   * to provide a center line. IFFT requires a width
+  /* Set spectrum (ifft) width. Waterfall with is an odd
+   * number to provide a center line. IFFT requires a width
    * that is a power of 2 */
-  if( ! Initialize_IFFT((int16_t)wfall_width + 1) )
-    return;
+  Spectrum_Set_Width( (int16_t)wfall_width + 1 );
 }
 
 /*****************************************************************************/
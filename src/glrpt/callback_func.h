@@ -27,7 +27,7 @@
 
 /*****************************************************************************/
 
-void Error_Dialog(void);
+gboolean loadConfig(gpointer f_path);
 gboolean Cancel_Timer(gpointer data);
 void Set_Check_Menu_Item(gchar *item_name, gboolean flag);
 void Popup_Menu(void);
@@ -40,6 +40,7 @@ void Auto_Timer_OK_Clicked(void);
 void Hours_Entry(GtkEditable *editable);
 void Minutes_Entry(GtkEditable *editable);
 void Enter_Center_Freq(uint32_t freq);
+void Enter_Filter_BW(void);
 void Fft_Drawingarea_Size_Alloc(GtkAllocation *allocation);
 void Qpsk_Drawingarea_Size_Alloc(GtkAllocation *allocation);
 void Qpsk_Drawingarea_Draw(cairo_t *cr);
@@ -16,13 +16,13 @@
 
 #include "callbacks.h"
 
+#include "../common/receiver.h"
 #include "../common/shared.h"
-#include "../decoder/medet.h"
-#include "../decoder/met_jpg.h"
-#include "../demodulator/demod.h"
+#include "../common/telemetry.h"
 #include "../sdr/SoapySDR.h"
 #include "callback_func.h"
 #include "display.h"
+#include "gui.h"
 #include "interface.h"
 #include "utils.h"
 
@@ -143,7 +143,7 @@ void on_decode_images_menuitem_toggled(
 /*****************************************************************************/
 
 void on_save_images_menuitem_activate(GtkMenuItem *menuitem, gpointer data) {
-  Mj_Dump_Image();
+  Receiver_Dump_Images();
 }
 
 /*****************************************************************************/
@@ -383,7 +383,10 @@ gboolean on_sig_level_drawingarea_draw(
         GtkWidget *widget,
         cairo_t *cr,
         gpointer data) {
-  Draw_Level_Gauge( widget, cr, Signal_Level(NULL) );
+  telemetry_t snap;
+
+  Telemetry_Snapshot( &snap );
+  Draw_Level_Gauge( widget, cr, snap.demod.sig_level_gauge );
   return( TRUE );
 }
 
@@ -393,7 +396,10 @@ gboolean on_sig_qual_drawingarea_draw(
         GtkWidget *widget,
         cairo_t *cr,
         gpointer data) {
-  Draw_Level_Gauge( widget, cr, Sig_Quality() );
+  telemetry_t snap;
+
+  Telemetry_Snapshot( &snap );
+  Draw_Level_Gauge( widget, cr, snap.decoder.sig_qual_gauge );
   return( TRUE );
 }
 
@@ -403,7 +409,10 @@ gboolean on_agc_gain_drawingarea_draw(
         GtkWidget *widget,
         cairo_t *cr,
         gpointer data) {
-  Draw_Level_Gauge( widget, cr, Agc_Gain(NULL) );
+  telemetry_t snap;
+
+  Telemetry_Snapshot( &snap );
+  Draw_Level_Gauge( widget, cr, snap.demod.agc_gain_gauge );
   return( TRUE );
 }
 
@@ -413,7 +422,10 @@ gboolean on_pll_ave_drawingarea_draw(
         GtkWidget *widget,
         cairo_t *cr,
         gpointer data) {
-  Draw_Level_Gauge( widget, cr, Pll_Average() );
+  telemetry_t snap;
+
+  Telemetry_Snapshot( &snap );
+  Draw_Level_Gauge( widget, cr, snap.demod.pll_ave_gauge );
   return( TRUE );
 }
 
@@ -444,7 +456,7 @@ void on_manual_agc_radiobutton_toggled(
     ClearFlag( TUNER_GAIN_AUTO );
 
     if( isFlagSet(STATUS_SOAPYSDR_INIT) )
-      SoapySDR_Set_Tuner_Gain_Mode();
+      SoapySDR_Set_Tuner_Gain_Mode( false, rc_data.tuner_gain );
 
     GtkWidget *hscale =
       Builder_Get_Object( main_window_builder, "sdr_gain_hscale");
@@ -461,6 +473,6 @@ void on_auto_agc_radiobutton_toggled(
   {
     SetFlag( TUNER_GAIN_AUTO );
     if( isFlagSet(STATUS_SOAPYSDR_INIT) )
-      SoapySDR_Set_Tuner_Gain_Mode();
+      SoapySDR_Set_Tuner_Gain_Mode( true, rc_data.tuner_gain );
   }
 }
@@ -16,27 +16,34 @@
 
 #include "display.h"
 
+#include "../common/common.h"
+#include "../common/receiver.h"
 #include "../common/shared.h"
-#include "../demodulator/demod.h"
-#include "../sdr/ifft.h"
+#include "../common/telemetry.h"
+#include "../sdr/SoapySDR.h"
+#include "../sdr/spectrum.h"
+#include "../image/image.h"
+#include "gui.h"
 #include "utils.h"
 
 #include <cairo.h>
 #include <glib.h>
 #include <gtk/gtk.h>
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 
 /*****************************************************************************/
 
-/* Number of QPSK constellation points to plot. Must be <= SYM_CHUNKSIZE / 2 */
-#define QPSK_CONST_POINTS   512
+/* Message passed on to the main thread by Show_Message() */
+typedef struct idle_mesg_t {
+    const char *attr;
+    char mesg[MESG_SIZE];
+} idle_mesg_t;
 
-/* IFFT signal amplitude averaging window */
-#define AMPL_AVE_WIN    4
-#define AMPL_AVE_MUL    3
+/*****************************************************************************/
 
 /* Parameters used in level bars coloring */
 #define TRANSITION_BAND 0.2
@@ -45,48 +52,10 @@
 
 /*****************************************************************************/
 
-static int IFFT_Bin_Value(int sum_i, int sum_q, gboolean reset);
 static void Colorize(guchar *pix, int pixel_val);
-
-/*****************************************************************************/
-
-/* IFFT_Bin_Value()
- *
- * Calculates IFFT bin values with auto level control
- */
-static int IFFT_Bin_Value(int sum_i, int sum_q, gboolean reset) {
-  /* Value of ifft output "bin" */
-  static int bin_val = 0;
-
-  /* Maximum value of ifft bins */
-  static int bin_max = 1000, max = 0;
-
-  /* Calculate sliding window average of max bin value */
-  if( reset )
-  {
-    bin_max = max;
-    if( !bin_max ) bin_max = 1;
-    max = 0;
-  }
-  else
-  {
-    /* Calculate average signal power at each frequency (bin) */
-    bin_val  = bin_val * AMPL_AVE_MUL;
-    bin_val += sum_i * sum_i + sum_q * sum_q;
-    bin_val /= AMPL_AVE_WIN;
-
-    /* Record max bin value */
-    if( max < bin_val )
-      max = bin_val;
-
-    /* Scale bin values to 255 depending on max value */
-    int ret = (255 * bin_val) / bin_max;
-    if( ret > 255 ) ret = 255;
-    return( ret );
-  }
-
-  return( 0 );
-}
+static gboolean Show_Message_Idle(gpointer data);
+static void Display_Decoder_Params(
+    const decoder_telemetry_t *decoder, bool pll_locked);
 
 /*****************************************************************************/
 
@@ -129,19 +98,28 @@ static void Colorize(guchar *pix, int pixel_val) {
 
 /* Display_Waterfall()
  *
- * Displays IFFT Spectrum as "waterfall"
+ * Displays IFFT Spectrum as "waterfall". Runs as an idle
+ * callback when the spectrum worker has a new row ready
  */
-void Display_Waterfall(void) {
+gboolean Display_Waterfall(gpointer data) {
   int
     vert_lim,  /* Limit of vertical index for copying lines */
     idh, idv,  /* Index to hor. and vert. position in warterfall */
-    pixel_val, /* Greyscale value of pixel derived from ifft o/p  */
-    idf,       /* Index to ifft output array */
-    i, len;
+    len;       /* Number of bin levels in spectrum row */
 
   /* Pointer to current pixel */
   static guchar *pix;
 
+  /* Row of bin levels from spectrum worker */
+  uint8_t *bins;
+
+
+  bins = Spectrum_Row_Lock( &len );
+  if( (bins == NULL) || (wfall_pixbuf == NULL) )
+  {
+    Spectrum_Row_Unlock();
+    return( FALSE );
+  }
 
   /* Copy each line of waterfall to next one */
   vert_lim = wfall_height - 2;
@@ -161,53 +139,30 @@ void Display_Waterfall(void) {
   /* Go to top left +1 hor. +1 vert. of pixbuf */
   pix = wfall_pixels + wfall_rowstride + wfall_n_channels;
 
-  /* IFFT produces an output of positive and negative
-   * frequencies and it output is handled accordingly */
-  IFFT( ifft_data );
-
-  /* Calculate bin values after IFFT */
-  len = ifft_data_length / 4;
-
-  /* Do the "positive" frequencies */
-  idf = ifft_data_length / 2;
-  for( i = 0; i < len; i++ )
-  {
-    /* Calculate vector magnitude of
-     * signal at each freq. ("bin") */
-    pixel_val = IFFT_Bin_Value(
-        ifft_data[idf], ifft_data[idf + 1], FALSE );
-    idf += 2;
-
-    /* Color code signal strength */
-    Colorize( pix, pixel_val );
-    pix += wfall_n_channels;
-
-  } /* for( i = 1; i < len; i++ ) */
-
-  /* Do the "negative" frequencies */
-  idf = 2;
-  for( i = 1; i < len; i++ )
+  /* Color code signal strength */
+  if( len > wfall_width ) len = wfall_width;
+  for( idh = 0; idh < len; idh++ )
   {
-    /* Calculate vector magnitude of
-     * signal at each freq. ("bin") */
-    pixel_val = IFFT_Bin_Value(
-        ifft_data[idf], ifft_data[idf + 1], FALSE );
-    idf += 2;
-
-    /* Color code signal strength */
-    Colorize( pix, pixel_val );
+    Colorize( pix, bins[idh] );
     pix += wfall_n_channels;
-
-  } /* for( i = 1; i < len; i++ ) */
-
-  /* Reset function */
-  IFFT_Bin_Value( ifft_data[0], ifft_data[0], TRUE );
+  }
+  Spectrum_Row_Unlock();
 
   /* At last draw waterfall */
   gtk_widget_queue_draw( ifft_drawingarea );
 
-  /* Wait for GTK to complete its tasks */
-  while( g_main_context_iteration(NULL, FALSE) );
+  return( FALSE );
+}
+
+/*****************************************************************************/
+
+/* Waterfall_Row_Ready()
+ *
+ * Called by the spectrum worker thread when it has a new
+ * row ready, hands the display over to the GUI thread
+ */
+void Waterfall_Row_Ready(void) {
+  g_idle_add( G_SOURCE_FUNC(Display_Waterfall), NULL );
 }
 
 /*****************************************************************************/
@@ -216,7 +171,7 @@ void Display_Waterfall(void) {
  *
  *  Displays the QPSK constellation
  */
-void Display_QPSK_Const(int8_t *buffer) {
+void Display_QPSK_Const(const int8_t *buffer) {
   /* Pointer to current pixel */
   static guchar *pix;
 
@@ -239,9 +194,7 @@ void Display_QPSK_Const(int8_t *buffer) {
     pix[2] = 0xff;
   }
 
-  /* Wait for GTK to complete its tasks */
   gtk_widget_queue_draw( qpsk_drawingarea );
-  while( g_main_context_iteration(NULL, FALSE) );
 }
 
 /*****************************************************************************/
@@ -254,9 +207,6 @@ void Display_Icon(GtkWidget *img, const gchar *name) {
   /* Set the icon in the image */
   gtk_image_set_from_icon_name(
       GTK_IMAGE(img), name, GTK_ICON_SIZE_BUTTON );
-
-  /* Wait for GTK to complete its tasks */
-  while( g_main_context_iteration(NULL, FALSE) );
 }
 
 /*****************************************************************************/
@@ -265,29 +215,21 @@ void Display_Icon(GtkWidget *img, const gchar *name) {
  *
  * Displays Demodulator parameters (AGC gain PLL freq etc)
  */
-void Display_Demod_Params(Demod_t *demod) {
+void Display_Demod_Params(const demod_telemetry_t *demod) {
   char txt[10];
-  double freq, gain;
-  uint32_t level;
 
   /* Display AGC Gain and Signal Level */
-  Agc_Gain( &gain );
-  snprintf( txt, sizeof(txt), "%6.3f", gain );
+  snprintf( txt, sizeof(txt), "%6.3f", demod->agc_gain );
   gtk_entry_set_text( GTK_ENTRY(agc_gain_entry), txt );
-  Signal_Level( &level );
-  snprintf( txt, sizeof(txt), "%6u", level );
+  snprintf( txt, sizeof(txt), "%6u", demod->sig_level );
   gtk_entry_set_text( GTK_ENTRY(sig_level_entry), txt );
 
-  /* Display Costas PLL Frequency FIXME */
-  freq = demod->costas->nco_freq * demod->sym_rate / M_2PI;
-  if( (rc_data.psk_mode == DOQPSK) ||
-      (rc_data.psk_mode == IDOQPSK) )
-    freq *= 2.0;
-  snprintf( txt, sizeof(txt), "%+8d", (int)freq );
+  /* Display Costas PLL Frequency */
+  snprintf( txt, sizeof(txt), "%+8d", (int)demod->pll_freq );
   gtk_entry_set_text( GTK_ENTRY(pll_freq_entry), txt );
 
   /* Display Costas PLL Lock Detect Level */
-  snprintf( txt, sizeof(txt), "%6.3f", demod->costas->moving_average );
+  snprintf( txt, sizeof(txt), "%6.3f", demod->pll_ave );
   gtk_entry_set_text( GTK_ENTRY(pll_ave_entry), txt );
 
   /* Draw the level gauges */
@@ -295,9 +237,308 @@ void Display_Demod_Params(Demod_t *demod) {
   gtk_widget_queue_draw( sig_qual_drawingarea );
   gtk_widget_queue_draw( agc_gain_drawingarea );
   gtk_widget_queue_draw( pll_ave_drawingarea );
+}
+
+/*****************************************************************************/
+
+/* Display_Decoder_Params()
+ *
+ * Displays Decoder status (signal quality, packet count etc)
+ */
+static void Display_Decoder_Params(
+    const decoder_telemetry_t *decoder, bool pll_locked) {
+  char txt[16];
+
+  /* Signal quality is zero while PLL is unlocked */
+  snprintf( txt, sizeof(txt), "%d", pll_locked ? decoder->sig_q : 0 );
+  gtk_entry_set_text( GTK_ENTRY(sig_quality_entry), txt );
+
+  snprintf( txt, sizeof(txt), "%d:%d%%", decoder->ok_cnt, decoder->percent );
+  gtk_entry_set_text( GTK_ENTRY(packet_cnt_entry), txt );
+
+  /* Share of the image MCUs received, per channel */
+  snprintf( txt, sizeof(txt), "%d:%d:%d", decoder->mcu_percent[RED],
+      decoder->mcu_percent[GREEN], decoder->mcu_percent[BLUE] );
+  gtk_entry_set_text( GTK_ENTRY(mcu_cnt_entry), txt );
+
+  /* Display the Satellite's onboard time */
+  if( decoder->ob_time_valid )
+  {
+    snprintf( txt, sizeof(txt), "%02u:%02u:%02u",
+        decoder->ob_hour, decoder->ob_min, decoder->ob_sec );
+    gtk_entry_set_text( GTK_ENTRY(ob_time_entry), txt );
+  }
+}
+
+/*****************************************************************************/
+
+/* Display_Scaled_Image
+ *
+ * Scales an LRPT image horizontal line by the scale
+ * factor and stores the result in the image pixbuf
+ */
+void Display_Scaled_Image(
+        const channel_images_t *images,
+        uint32_t apid,
+        int current_y) {
+  int chn, idx, idy, cnt, scale;
+  int scaled_width, scaled_x, scaled_idx;
+  static int
+    scaled_y[CHANNEL_IMAGE_NUM] = { 0, 0, 0 },
+    last_y  [CHANNEL_IMAGE_NUM] = { 0, 0, 0 };
+  uint16_t *pix_val = NULL;
+  const uint8_t *row;
+  guchar *pixel, val;
+
+
+  /* Signal to reset indices for new images */
+  if( current_y == 0 )
+  {
+    for( cnt = 0; cnt < CHANNEL_IMAGE_NUM; cnt++ )
+    {
+      scaled_y[cnt] = 0;
+      last_y[cnt]   = 0;
+    }
+
+    /* Fill pixbuf with background color */
+    gdk_pixbuf_fill( scaled_image_pixbuf, 0xaaaaaaff );
+
+    return;
+  }
+
+  /* Calculate scale factor for rectified images */
+  scale = (int)rc_data.image_scale;
+  if( isFlagSet(IMAGES_RECTIFIED) )
+  {
+    scaled_width = METEOR_IMAGE_WIDTH / scale;
+    scale = (int)images->width / scaled_width + 1;
+  }
+
+  /* Just in case the unscaled image height is too much */
+  if( (current_y / scale) > scaled_image_height )
+    current_y = scaled_image_height * scale;
+
+  /* Find the channel image buffer for the given apid */
+  for( chn = 0; chn < CHANNEL_IMAGE_NUM; chn++ )
+    if( rc_data.apid[chn] == apid ) break;
+  if( chn == CHANNEL_IMAGE_NUM ) return;
+
+  /* Abort if channel image vertical size not enough */
+  if( (current_y - last_y[chn]) < scale )
+    return;
+
+  /* Abort if the APID has not been received */
+  if( !images->exported && !Apid_Image_Row(images, apid, 0) )
+    return;
+
+  /* Length of pixel values buffer */
+  scaled_width = (int)images->width / scale;
+
+  /* Allocate pixel values buffer and clear */
+  size_t siz = (size_t)scaled_width * sizeof(uint16_t);
+  mem_alloc( (void **)&pix_val, siz );
+
+  /* Keep scaling image while image size is enough */
+  while( (current_y - last_y[chn]) >= scale )
+  {
+    /* Clear line buffer for next summation */
+    bzero( pix_val, siz );
+
+    /* Summate (scale * scale) pixel values from the channel image */
+    for( idy = 0; idy < scale; idy++ )
+    {
+      /* Line of channel image to start using pixel values */
+      if( images->exported )
+        row = images->image[chn] + (size_t)last_y[chn] * images->width;
+      else
+        row = Apid_Image_Row( images, apid, (uint32_t)last_y[chn] );
+      idx = 0;
+
+      for( scaled_x = 0; scaled_x < scaled_width; scaled_x++ )
+      {
+        for( cnt = 0; cnt < scale; cnt++ )
+          pix_val[scaled_x] += (uint16_t)row[idx++];
+      }
+      last_y[chn]++;
+    }
+
+    /* Fill scaled image buffer with scaled summed pixel values */
+    int y =
+      scaled_y[chn] * scaled_image_rowstride +
+      (chn * scaled_width + chn) * scaled_image_n_channels;
+    for( scaled_x = 0; scaled_x < scaled_width; scaled_x++ )
+    {
+      scaled_idx = scaled_x * scaled_image_n_channels + y;
+      pixel = &scaled_image_pixel_buf[scaled_idx];
+      val = (guchar)(pix_val[scaled_x] / (uint16_t)scale / (uint16_t)scale);
+      pixel[0] = val;
+      pixel[1] = val;
+      pixel[2] = val;
+    }
+
+    /* Draw a vertical white line between images */
+    scaled_idx = scaled_x * scaled_image_n_channels + y;
+    pixel = &scaled_image_pixel_buf[scaled_idx];
+    pixel[0] = 0xff;
+    pixel[1] = 0xff;
+    pixel[2] = 0xff;
+
+    /* Go down the scaled image buffer */
+    scaled_y[chn]++;
+
+  } /* while( (current_y - last_y) >= rc_data.image_scale ) */
+  free_ptr( (void **)&pix_val );
+
+  /* Set lrpt image from pixbuff */
+  gtk_image_set_from_pixbuf( GTK_IMAGE(lrpt_image), scaled_image_pixbuf );
+}
+
+/*****************************************************************************/
+
+/* Show_Message()
+ *
+ * Prints a message string in the Text View scroller
+ */
+void Show_Message(const char *mesg, const char *attr) {
+  GtkAdjustment *adjustment;
+  idle_mesg_t *idle = NULL;
+
+  static GtkTextIter iter;
+  static bool first_call = true;
+
+  /* Only the thread running the main loop may use GTK,
+   * messages of the decoder thread are passed on to it */
+  if( !g_main_context_acquire(NULL) )
+  {
+    mem_alloc( (void **)&idle, sizeof(*idle) );
+    idle->attr = attr;
+    Strlcpy( idle->mesg, mesg, sizeof(idle->mesg) );
+    g_idle_add( Show_Message_Idle, idle );
+    return;
+  }
+
+  /* Initialize */
+  if( first_call )
+  {
+    first_call = false;
+    gtk_text_buffer_get_iter_at_offset( text_buffer, &iter, 0 );
+  }
+
+  /* Print message */
+  gtk_text_buffer_insert_with_tags_by_name(
+      text_buffer, &iter, mesg, -1, attr, NULL );
+  gtk_text_buffer_insert( text_buffer, &iter, "\n", -1 );
+
+  /* Scroll Text View to bottom */
+  adjustment = gtk_scrolled_window_get_vadjustment
+    ( GTK_SCROLLED_WINDOW(text_scroller) );
+  gtk_adjustment_set_value( adjustment,
+      gtk_adjustment_get_upper(adjustment) -
+      gtk_adjustment_get_page_size(adjustment) );
 
   /* Wait for GTK to complete its tasks */
-  while( g_main_context_iteration(NULL, FALSE) );
+  while( g_main_context_iteration(NULL, false) );
+  g_main_context_release( NULL );
+}
+
+/*****************************************************************************/
+
+/* Show_Message_Idle()
+ *
+ * Shows a message of another thread, runs as an idle callback
+ */
+static gboolean Show_Message_Idle(gpointer data) {
+  idle_mesg_t *idle = (idle_mesg_t *)data;
+
+  Show_Message( idle->mesg, idle->attr );
+  free_ptr( (void **)&idle );
+
+  return( FALSE );
+}
+
+/*****************************************************************************/
+
+/* Display_Telemetry()
+ *
+ * Polls the demodulator and decoder status at a fixed
+ * rate and updates the GUI. Runs as a timeout callback
+ */
+gboolean Display_Telemetry(gpointer data) {
+  static uint32_t demod_seq = 0, decoder_seq = 0, images_done = 0;
+  static bool pll_icon = false, sdr_icon = false;
+  telemetry_t snap;
+  const channel_images_t *images;
+  bool pll_locked, frame_ok, sdr_ok;
+  int chn;
+
+  Telemetry_Snapshot( &snap );
+
+  /* Receiver status indicator icon */
+  sdr_ok = SoapySDR_Status();
+  if( sdr_ok != sdr_icon )
+  {
+    Display_Icon( status_icon, sdr_ok ? "gtk-yes" : "gtk-no" );
+    sdr_icon = sdr_ok;
+  }
+
+  /* PLL lock and Frame status indicator icons */
+  pll_locked = isFlagSet(STATUS_RECEIVING) && snap.demod.pll_locked;
+  if( pll_locked != pll_icon )
+  {
+    Display_Icon( pll_lock_icon, pll_locked ? "gtk-yes" : "gtk-no" );
+    pll_icon = pll_locked;
+  }
+
+  frame_ok = pll_locked &&
+    isFlagSet(STATUS_DECODING) && snap.decoder.frame_ok;
+  if( frame_ok != (isFlagSet(FRAME_OK_ICON) != 0) )
+  {
+    Display_Icon( frame_icon, frame_ok ? "gtk-yes" : "gtk-no" );
+    if( frame_ok )
+      SetFlag( FRAME_OK_ICON );
+    else
+      ClearFlag( FRAME_OK_ICON );
+  }
+
+  /* Display QPSK constellation and Demodulator params */
+  if( snap.demod.seq != demod_seq )
+  {
+    demod_seq = snap.demod.seq;
+    if( isFlagSet(STATUS_RECEIVING) && (qpsk_pixbuf != NULL) )
+      Display_QPSK_Const( snap.demod.qpsk_const );
+    Display_Demod_Params( &snap.demod );
+  }
+
+  /* Display Decoder status and incrementally display LRPT images */
+  if( snap.decoder.seq != decoder_seq )
+  {
+    decoder_seq = snap.decoder.seq;
+    Display_Decoder_Params( &snap.decoder, pll_locked );
+
+    if( isFlagSet(STATUS_DECODING) )
+    {
+      images = Receiver_Images_Lock();
+      for( chn = 0; chn < CHANNEL_IMAGE_NUM; chn++ )
+        if( snap.decoder.image_lines[chn] > 0 )
+          Display_Scaled_Image( images,
+              rc_data.apid[chn], snap.decoder.image_lines[chn] );
+      Receiver_Images_Unlock();
+    }
+  }
+
+  /* Redisplay LRPT images when processing of finished ones is done */
+  if( snap.decoder.images_done != images_done )
+  {
+    images_done = snap.decoder.images_done;
+    Display_Scaled_Image( NULL, 0, 0 );
+    images = Receiver_Images_Lock();
+    for( chn = 0; chn < CHANNEL_IMAGE_NUM; chn++ )
+      Display_Scaled_Image( images,
+          rc_data.apid[chn], (int)images->height );
+    Receiver_Images_Unlock();
+  }
+
+  return( TRUE );
 }
 
 /*****************************************************************************/
@@ -19,7 +19,8 @@
 
 /*****************************************************************************/
 
-#include "../demodulator/demod.h"
+#include "../common/telemetry.h"
+#include "../image/image.h"
 
 #include <cairo.h>
 #include <glib.h>
@@ -29,10 +30,16 @@
 
 /*****************************************************************************/
 
-void Display_Waterfall(void);
-void Display_QPSK_Const(int8_t *buffer);
+gboolean Display_Waterfall(gpointer data);
+void Waterfall_Row_Ready(void);
+void Display_QPSK_Const(const int8_t *buffer);
 void Display_Icon(GtkWidget *img, const gchar *name);
-void Display_Demod_Params(Demod_t *demod);
+void Display_Demod_Params(const demod_telemetry_t *demod);
+void Display_Scaled_Image(
+        const channel_images_t *images,
+        uint32_t apid,
+        int current_y);
+gboolean Display_Telemetry(gpointer data);
 void Draw_Level_Gauge(GtkWidget *widget, cairo_t *cr, double level);
 
 /*****************************************************************************/
@@ -18,8 +18,10 @@
 
 #include "../common/common.h"
 #include "../common/shared.h"
-#include "../sdr/filters.h"
 #include "callback_func.h"
+#include "callbacks.h"
+#include "gui.h"
+#include "rc_config.h"
 #include "utils.h"
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -29,7 +31,9 @@
 #include <gtk/gtk.h>
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 /*****************************************************************************/
 
@@ -94,6 +98,7 @@
     "sig_quality_entry", \
     "agc_gain_entry", \
     "packet_cnt_entry", \
+    "mcu_cnt_entry", \
     "ob_time_entry", \
     "sig_level_drawingarea", \
     "on_sig_qual_drawingarea", \
@@ -238,6 +243,42 @@ GtkWidget *create_quit_dialog(GtkBuilder **builder) {
 
 /*****************************************************************************/
 
+/* Create_Satellite_Menu()
+ *
+ * Sets up the "Select Satellite" menu item from the list of
+ * configuration files, separating system and user's configs
+ */
+void Create_Satellite_Menu(void) {
+  GtkWidget *sat_menu, *menu_item;
+  uint16_t idx;
+
+  if( !popup_menu )
+    popup_menu = create_popup_menu( &popup_menu_builder );
+  sat_menu = Builder_Get_Object( popup_menu_builder, "select_satellite" );
+
+  for( idx = 0; idx < glrpt_cfg_num; idx++ )
+  {
+    /* Add separator between system and user configs */
+    if( (idx > 0) && glrpt_cfg_list[idx].user &&
+        !glrpt_cfg_list[idx - 1].user )
+    {
+      menu_item = gtk_separator_menu_item_new();
+      gtk_widget_show( menu_item );
+      gtk_menu_shell_append( GTK_MENU_SHELL(sat_menu), menu_item );
+    }
+
+    /* Append new child items to "Select Satellite" menu */
+    menu_item = gtk_menu_item_new_with_label( glrpt_cfg_list[idx].name );
+    g_signal_connect( menu_item, "activate",
+        G_CALLBACK(on_satellite_menuitem_activate),
+        glrpt_cfg_list[idx].path );
+    gtk_widget_show( menu_item );
+    gtk_menu_shell_append( GTK_MENU_SHELL(sat_menu), menu_item );
+  }
+}
+
+/*****************************************************************************/
+
 /*  Initialize_Top_Window()
  *
  *  Initializes glrpt's top window
@@ -33,6 +33,7 @@ GtkWidget *create_timer_dialog(GtkBuilder **builder);
 GtkWidget *create_error_dialog(GtkBuilder **builder);
 GtkWidget *create_startstop_timer(GtkBuilder **builder);
 GtkWidget *create_quit_dialog(GtkBuilder **builder);
+void Create_Satellite_Menu(void);
 void Initialize_Top_Window(void);
 
 /*****************************************************************************/
@@ -15,9 +15,10 @@
 /*****************************************************************************/
 
 #include "../common/shared.h"
-#include "../sdr/filters.h"
-#include "../sdr/ifft.h"
+#include "../common/telemetry.h"
 #include "callback_func.h"
+#include "display.h"
+#include "gui.h"
 #include "interface.h"
 #include "rc_config.h"
 #include "utils.h"
@@ -33,6 +34,7 @@
 
 /*****************************************************************************/
 
+static void Usage(void);
 static void sig_handler(int signal);
 
 /*****************************************************************************/
@@ -140,6 +142,8 @@ int main(int argc, char *argv[]) {
             "sig_quality_entry");
     packet_cnt_entry      = Builder_Get_Object(main_window_builder,
             "packet_cnt_entry");
+    mcu_cnt_entry         = Builder_Get_Object(main_window_builder,
+            "mcu_cnt_entry");
     ob_time_entry         = Builder_Get_Object(main_window_builder,
             "ob_time_entry");
     sig_level_drawingarea = Builder_Get_Object(main_window_builder,
@@ -170,6 +174,9 @@ int main(int argc, char *argv[]) {
     gtk_widget_get_allocation(qpsk_drawingarea, &alloc);
     Qpsk_Drawingarea_Size_Alloc(&alloc);
 
+    /* Poll demodulator and decoder status at a fixed rate */
+    g_timeout_add(TELEMETRY_INTERVAL, G_SOURCE_FUNC(Display_Telemetry), NULL);
+
     char ver[32];
     snprintf(ver, sizeof(ver), "Welcome to %s", PACKAGE_STRING);
     Show_Message(ver, "bold");
@@ -182,6 +189,7 @@ int main(int argc, char *argv[]) {
         exit(-1);
     }
 
+    Create_Satellite_Menu();
     g_idle_add(G_SOURCE_FUNC(loadConfig), glrpt_cfg_list[0].path);
 
     /* Main loop */
@@ -192,6 +200,23 @@ int main(int argc, char *argv[]) {
 
 /*****************************************************************************/
 
+/* Usage()
+ *
+ * Prints usage information
+ */
+static void Usage(void) {
+  fprintf( stderr, "%s\n",
+      "Usage: glrpt [-hv]" );
+
+  fprintf( stderr, "%s\n",
+      "       -h: Print this usage information and exit");
+
+  fprintf( stderr, "%s\n",
+      "       -v: Print version number and exit");
+}
+
+/*****************************************************************************/
+
 /* sig_handler()
  *
  * Signal action handler function
@@ -18,16 +18,11 @@
 
 #include "../common/common.h"
 #include "../common/shared.h"
-#include "../decoder/rectify_meteor.h"
 #include "../demodulator/pll.h"
-#include "callback_func.h"
-#include "callbacks.h"
-#include "interface.h"
+#include "../decoder/dct.h"
+#include "../image/rectify_meteor.h"
 #include "utils.h"
 
-#include <glib.h>
-#include <glib-object.h>
-#include <gtk/gtk.h>
 #include <libconfig.h>
 
 #include <dirent.h>
@@ -44,6 +39,7 @@
 
 /* Accessible configs */
 rc_cfg_t *glrpt_cfg_list;
+uint16_t  glrpt_cfg_num = 0;
 
 /* Program-wide directories */
 char
@@ -68,13 +64,13 @@ static int cfgNameFilter(const struct dirent *entry) {
 
 /*****************************************************************************/
 
-/* loadConfig()
+/* readConfig()
  *
- * Loads the glrptrc configuration file
+ * Reads a per-satellite configuration file into rc_data
  * TODO more detailed error messages (using mesg)
  * TODO use DEFINEd default values
  */
-gboolean loadConfig(gpointer f_path) {
+bool readConfig(const char *f_path) {
     char mesg[MESG_SIZE];
 
     /* Initialize string config values */
@@ -89,7 +85,7 @@ gboolean loadConfig(gpointer f_path) {
     config_set_options(&cfg, CONFIG_OPTION_AUTOCONVERT);
 
     /* Try to parse config file */
-    if (!config_read_file(&cfg, (char *)f_path)) {
+    if (!config_read_file(&cfg, f_path)) {
         snprintf(mesg, sizeof(mesg),
                 "Failed to parse config file!\n%s:%d - %s\n",
                 config_error_file(&cfg), config_error_line(&cfg),
@@ -100,7 +96,7 @@ gboolean loadConfig(gpointer f_path) {
 
         config_destroy(&cfg);
 
-        return FALSE;
+        return false;
     }
 
     /* Begin settings readout. Raw values are checked against valid ranges.
@@ -156,7 +152,7 @@ gboolean loadConfig(gpointer f_path) {
             Show_Message("Can't find valid receiver frequency!", "red");
             Error_Dialog();
 
-            return FALSE;
+            return false;
         }
 
         if (config_setting_lookup_int(set_v, "bw", &int_v) &&
@@ -181,7 +177,7 @@ gboolean loadConfig(gpointer f_path) {
         Show_Message("Can't find SDR receiver settings!", "red");
         Error_Dialog();
 
-        return FALSE;
+        return false;
     }
 
     /* Demodulator settings */
@@ -231,14 +227,14 @@ gboolean loadConfig(gpointer f_path) {
                 Show_Message("QPSK mode is invalid!", "red");
                 Error_Dialog();
 
-                return FALSE;
+                return false;
             }
         }
         else {
             Show_Message("Can't find QPSK mode!", "red");
             Error_Dialog();
 
-            return FALSE;
+            return false;
         }
 
         if (config_setting_lookup_int(set_v, "rate", &int_v) &&
@@ -249,14 +245,14 @@ gboolean loadConfig(gpointer f_path) {
                     "red");
             Error_Dialog();
 
-            return FALSE;
+            return false;
         }
     }
     else {
         Show_Message("Can't find demodulator settings!", "red");
         Error_Dialog();
 
-        return FALSE;
+        return false;
     }
 
     /* Decoder settings */
@@ -275,7 +271,7 @@ gboolean loadConfig(gpointer f_path) {
                     Show_Message("APIDs are incorrect!", "red");
                     Error_Dialog();
 
-                    return FALSE;
+                    return false;
                 }
                 else
                     rc_data.apid[idx] = apid;
@@ -285,7 +281,7 @@ gboolean loadConfig(gpointer f_path) {
             Show_Message("Can't find valid APIDs!", "red");
             Error_Dialog();
 
-            return FALSE;
+            return false;
         }
 
         arr_v = config_setting_lookup(set_v, "apids_invert");
@@ -336,12 +332,32 @@ gboolean loadConfig(gpointer f_path) {
 
         if (!rc_data.decode_timer)
             rc_data.decode_timer = rc_data.default_timer;
+
+        if (config_setting_lookup_string(set_v, "idct", &str_v)) {
+            if (strncasecmp(str_v, "float", 5) == 0)
+                rc_data.idct_impl = IDCT_IMPL_FLOAT;
+            else if (strncasecmp(str_v, "scalar", 6) == 0)
+                rc_data.idct_impl = IDCT_IMPL_SCALAR;
+            else if (strncasecmp(str_v, "SSE2", 4) == 0)
+                rc_data.idct_impl = IDCT_IMPL_SSE2;
+            else if (strncasecmp(str_v, "AVX2", 4) == 0)
+                rc_data.idct_impl = IDCT_IMPL_AVX2;
+            else
+                rc_data.idct_impl = IDCT_IMPL_AUTO;
+        }
+        else
+            rc_data.idct_impl = IDCT_IMPL_AUTO;
+
+        if (!Idct_Select((idct_impl_t)rc_data.idct_impl)) {
+            Show_Message("IDCT not supported by CPU, using fastest", "orange");
+            rc_data.idct_impl = IDCT_IMPL_AUTO;
+        }
     }
     else {
         Show_Message("Can't find decoder settings!", "red");
         Error_Dialog();
 
-        return FALSE;
+        return false;
     }
 
     /* Post-processing settings */
@@ -474,6 +490,15 @@ gboolean loadConfig(gpointer f_path) {
         else
             SetFlag(IMAGE_CLAHE);
 
+        if (config_setting_lookup_bool(set_v, "fill_gaps", &int_v)) {
+            if (int_v)
+                SetFlag(IMAGE_FILL_GAPS);
+            else
+                ClearFlag(IMAGE_FILL_GAPS);
+        }
+        else
+            ClearFlag(IMAGE_FILL_GAPS);
+
         if (config_setting_lookup_string(set_v, "rectify", &str_v)) {
             if (strncasecmp(str_v, "no", 2) == 0)
                 rc_data.rectify_function = R_NO;
@@ -509,6 +534,7 @@ gboolean loadConfig(gpointer f_path) {
 
         SetFlag(IMAGE_NORMALIZE);
         SetFlag(IMAGE_CLAHE);
+        ClearFlag(IMAGE_FILL_GAPS);
 
         rc_data.rectify_function = R_5B4AZ;
         SetFlag(IMAGE_RECTIFY);
@@ -579,6 +605,15 @@ gboolean loadConfig(gpointer f_path) {
         }
         else
             ClearFlag(IMAGE_RAW);
+
+        if (config_setting_lookup_bool(set_v, "save_orig", &int_v)) {
+            if (int_v)
+                SetFlag(IMAGE_SAVE_ORIG);
+            else
+                ClearFlag(IMAGE_SAVE_ORIG);
+        }
+        else
+            ClearFlag(IMAGE_SAVE_ORIG);
     }
     else {
         SetFlag(IMAGE_OUT_COMBO);
@@ -590,6 +625,7 @@ gboolean loadConfig(gpointer f_path) {
         rc_data.jpeg_quality = 100;
 
         ClearFlag(IMAGE_RAW);
+        ClearFlag(IMAGE_SAVE_ORIG);
     }
 
     /* GUI settings */
@@ -600,33 +636,35 @@ gboolean loadConfig(gpointer f_path) {
             rc_data.image_scale = (uint32_t)int_v;
         else
             rc_data.image_scale = 4;
+
+        if (config_setting_lookup_int(set_v, "wfall_fps", &int_v) &&
+                (int_v >= 1) && (int_v <= 50))
+            rc_data.wfall_fps = (uint32_t)int_v;
+        else
+            rc_data.wfall_fps = 15;
+
+        if (config_setting_lookup_int(set_v, "wfall_avg", &int_v) &&
+                (int_v >= 1) && (int_v <= 16))
+            rc_data.wfall_avg = (uint32_t)int_v;
+        else
+            rc_data.wfall_avg = 4;
     }
     else {
             rc_data.image_scale = 4;
+            rc_data.wfall_fps = 15;
+            rc_data.wfall_avg = 4;
     }
 
     /* Cleanup */
     config_destroy(&cfg);
 
-    /* Set Gain control buttons and slider */
-    /* TODO should set flag ASAP */
-    if (rc_data.tuner_gain != 0.0) {
-        GtkWidget *radiobtn = Builder_Get_Object(
-                main_window_builder, "manual_agc_radiobutton");
-        gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(radiobtn), TRUE);
+    /* Tuner gain of 0 selects automatic gain control */
+    if (rc_data.tuner_gain != 0.0)
         ClearFlag(TUNER_GAIN_AUTO);
-    }
-    else {
-        GtkWidget *radiobtn = Builder_Get_Object(
-                main_window_builder, "auto_agc_radiobutton");
-        gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(radiobtn), TRUE);
+    else
         SetFlag(TUNER_GAIN_AUTO);
-    }
 
-    /* (Re)initialize top window */
-    Initialize_Top_Window();
-
-    return FALSE;
+    return true;
 }
 
 /*****************************************************************************/
@@ -634,7 +672,7 @@ gboolean loadConfig(gpointer f_path) {
 /* findConfigFiles()
  *
  * Searches system-wide and user's directory for per-satellite configuration
- * files and sets up the "Select Satellite" menu item accordingly
+ * files and lists them in glrpt_cfg_list, system-wide configs first
  */
 bool findConfigFiles(void) {
     struct dirent **s_cfg_list, **u_cfg_list;
@@ -650,13 +688,6 @@ bool findConfigFiles(void) {
     if ((n_s_cfgs + n_u_cfgs) == 0)
         return false;
 
-    /* Build "Select Satellite" popup menu item */
-    if (!popup_menu)
-        popup_menu = create_popup_menu(&popup_menu_builder);
-
-    GtkWidget *sat_menu =
-        Builder_Get_Object(popup_menu_builder, "select_satellite");
-
     glrpt_cfg_list =
         (rc_cfg_t *)malloc(sizeof(rc_cfg_t) * (n_s_cfgs + n_u_cfgs));
 
@@ -679,21 +710,7 @@ bool findConfigFiles(void) {
         snprintf(glrpt_cfg_list[i].path, prefix_len + fname_len + 6,
                 "%s/%s", w_dir, w_list[idx]->d_name);
 
-        /* Append new child items to "Select Satellite" menu */
-        GtkWidget *menu_item =
-            gtk_menu_item_new_with_label(glrpt_cfg_list[i].name);
-        g_signal_connect(menu_item, "activate",
-                G_CALLBACK(on_satellite_menuitem_activate),
-                glrpt_cfg_list[i].path);
-        gtk_widget_show(menu_item);
-        gtk_menu_shell_append(GTK_MENU_SHELL(sat_menu), menu_item);
-
-        /* Add separator between system and user configs */
-        if ((n_s_cfgs > 0) && (n_u_cfgs > 0) && (i == (n_s_cfgs - 1))) {
-            GtkWidget *separator = gtk_separator_menu_item_new();
-            gtk_widget_show(separator);
-            gtk_menu_shell_append(GTK_MENU_SHELL(sat_menu), separator);
-        }
+        glrpt_cfg_list[i].user = (i >= n_s_cfgs);
 
         free(w_list[idx]);
     }
@@ -701,5 +718,7 @@ bool findConfigFiles(void) {
     free(s_cfg_list);
     free(u_cfg_list);
 
+    glrpt_cfg_num = (uint16_t)(n_s_cfgs + n_u_cfgs);
+
     return true;
 }
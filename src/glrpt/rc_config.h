@@ -21,8 +21,6 @@
 
 #include "../common/common.h"
 
-#include <glib.h>
-
 #include <limits.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -37,6 +35,7 @@
 typedef struct rc_cfg_t {
     char *name;
     char *path;
+    bool  user; /* Found in user's config directory */
 } rc_cfg_t;
 
 /* Runtime config data storage type */
@@ -97,18 +96,25 @@ typedef struct rc_data_t {
     /* Image rectification algorithm (W2RG/5B4AZ) */
     uint8_t rectify_function;
 
+    /* Inverse DCT of the image decoder (IDCT_IMPL_*) */
+    uint8_t idct_impl;
+
     /* JPEG image quality */
     int jpeg_quality;
 
     /* Scale factor to fit images in glrpt live display */
     /* TODO do we need uint32_t? */
     uint32_t image_scale;
+
+    /* Waterfall frame rate (fps) and number of averaged (Welch) FFTs */
+    uint32_t wfall_fps, wfall_avg;
 } rc_data_t;
 
 /*****************************************************************************/
 
 /* Accessible configs */
 extern rc_cfg_t *glrpt_cfg_list;
+extern uint16_t  glrpt_cfg_num;
 
 /* Program-wide directories */
 extern char
@@ -118,7 +124,7 @@ extern char
 
 /*****************************************************************************/
 
-gboolean loadConfig(gpointer f_path);
+bool readConfig(const char *f_path);
 bool findConfigFiles(void);
 
 /*****************************************************************************/
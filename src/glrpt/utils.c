@@ -18,14 +18,8 @@
 
 #include "../common/common.h"
 #include "../common/shared.h"
-#include "../demodulator/demod.h"
-#include "../sdr/filters.h"
-#include "../sdr/ifft.h"
-#include "callback_func.h"
-#include "interface.h"
 #include "rc_config.h"
 
-#include <gtk/gtk.h>
 #include <turbojpeg.h>
 
 #include <errno.h>
@@ -205,56 +199,8 @@ static const char *Filename(const char *fpath) {
 
 /*****************************************************************************/
 
-/* Usage()
- *
- * Prints usage information
- */
-void Usage(void) {
-  fprintf( stderr, "%s\n",
-      "Usage: glrpt [-hv]" );
-
-  fprintf( stderr, "%s\n",
-      "       -h: Print this usage information and exit");
-
-  fprintf( stderr, "%s\n",
-      "       -v: Print version number and exit");
-}
-
 /*****************************************************************************/
 
-/* Show_Message()
- *
- * Prints a message string in the Text View scroller
- */
-void Show_Message(const char *mesg, const char *attr) {
-  GtkAdjustment *adjustment;
-
-  static GtkTextIter iter;
-  static bool first_call = true;
-
-  /* Initialize */
-  if( first_call )
-  {
-    first_call = false;
-    gtk_text_buffer_get_iter_at_offset( text_buffer, &iter, 0 );
-  }
-
-  /* Print message */
-  gtk_text_buffer_insert_with_tags_by_name(
-      text_buffer, &iter, mesg, -1, attr, NULL );
-  gtk_text_buffer_insert( text_buffer, &iter, "\n", -1 );
-
-  /* Scroll Text View to bottom */
-  adjustment = gtk_scrolled_window_get_vadjustment
-    ( GTK_SCROLLED_WINDOW(text_scroller) );
-  gtk_adjustment_set_value( adjustment,
-      gtk_adjustment_get_upper(adjustment) -
-      gtk_adjustment_get_page_size(adjustment) );
-
-  /* Wait for GTK to complete its tasks */
-  while( g_main_context_iteration(NULL, false) );
-}
-
 /*****************************************************************************/
 
 /*** Memory allocation/freeing utils ***/
@@ -426,19 +372,12 @@ void Save_Image_Raw(
  * Cleanup before quitting or stopping action
  */
 void Cleanup(void) {
-  /* Deinitialize and free buffers when safe */
+  /* Clear status when all systems are de-initialized */
   if( isFlagClear(STATUS_DEMODULATING) &&
       isFlagClear(STATUS_RECEIVING) &&
       isFlagClear(STATUS_SOAPYSDR_INIT) &&
       isFlagClear(STATUS_STREAMING) )
-  {
-    Deinit_Chebyshev_Filter( &filter_data_i );
-    Deinit_Chebyshev_Filter( &filter_data_q );
-    Deinit_Ifft();
-    Demod_Deinit();
-
     ClearFlag( STATUS_FLAGS_ALL );
-  }
 
   /* Cancel any alarms */
   alarm( 0 );
@@ -499,19 +438,3 @@ void Strlcpy(char *dest, const char *src, size_t n) {
   /* Terminate dest string */
   dest[idx] = '\0';
 }
-
-/*****************************************************************************/
-
-/* Enter_Filter_BW()
- *
- * Enters the Low Pass Filter B/W to the relevant entry widget
- */
-void Enter_Filter_BW(void) {
-  char text[10];
-  GtkEntry *entry = GTK_ENTRY(
-      Builder_Get_Object(main_window_builder, "sdr_bw_entry") );
-  uint32_t bw = rc_data.sdr_filter_bw / 1000;
-  snprintf( text, sizeof(text), "%4u", bw );
-  gtk_entry_set_text( entry, text );
-}
-
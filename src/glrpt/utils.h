@@ -52,8 +52,6 @@ static inline int iClamp(int i, int min, int max) {
 
 bool prepareDirectories(void);
 void File_Name(char *file_name, uint32_t chn, const char *ext);
-void Usage(void);
-void Show_Message(const char *mesg, const char *attr);
 /* TODO may be re-vise all functions below */
 void mem_alloc(void **ptr, size_t req);
 void mem_realloc(void **ptr, size_t req);
@@ -78,7 +76,10 @@ int isFlagClear(int flag);
 void SetFlag(int flag);
 void ClearFlag(int flag);
 void Strlcpy(char *dest, const char *src, size_t n);
-void Enter_Filter_BW(void);
+
+/* Implemented by each frontend, GUI (glrpt) or console (glrpt-cli) */
+void Show_Message(const char *mesg, const char *attr);
+void Error_Dialog(void);
 
 /*****************************************************************************/
 
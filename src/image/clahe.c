@@ -26,7 +26,8 @@
 
 #include "clahe.h"
 
-#include "utils.h"
+#include "../glrpt/utils.h"
+#include "image.h"
 
 #include <stdbool.h>
 #include <stddef.h>
@@ -46,8 +47,10 @@ static void ClipHistogram(
         unsigned long *pulHistogram,
         uint32_t uiNrGreylevels,
         unsigned long ulClipLimit);
-static void MakeHistogram(
+static unsigned long MakeHistogram(
         kz_pixel_t *pImage,
+        const kz_pixel_t *pBlockMap,
+        uint32_t uiY0,
         uint32_t uiXRes,
         uint32_t uiSizeX,
         uint32_t uiSizeY,
@@ -172,9 +175,13 @@ static void ClipHistogram(
  * a greylevel histogram. The pLookupTable specifies the relationship
  * between the greyvalue of the pixel (typically between 0 and 4095) and
  * the corresponding bin in the histogram (usually containing only 128 bins).
+ * If a block map is given, at the region's column of its first line uiY0,
+ * only the pixels of MCUs received are counted. Returns their number.
  */
-static void MakeHistogram(
+static unsigned long MakeHistogram(
         kz_pixel_t *pImage,
+        const kz_pixel_t *pBlockMap,
+        uint32_t uiY0,
         uint32_t uiXRes,
         uint32_t uiSizeX,
         uint32_t uiSizeY,
@@ -182,7 +189,9 @@ static void MakeHistogram(
         uint32_t uiNrGreylevels,
         kz_pixel_t *pLookupTable) {
   kz_pixel_t *pImagePointer;
-  uint32_t i;
+  const kz_pixel_t *pMap;
+  unsigned long ulNrPixels = 0;
+  uint32_t i, x;
 
   /* clear histogram */
   for( i = 0; i < uiNrGreylevels; i++ )
@@ -190,14 +199,30 @@ static void MakeHistogram(
 
   for( i = 0; i < uiSizeY; i++ )
   {
+    if( pBlockMap )
+    {
+      pMap = &pBlockMap[ ((uiY0 + i) / BLOCK_MAP_LINES) * uiXRes ];
+      for( x = 0; x < uiSizeX; x++ )
+        if( pMap[x] == BLOCK_RECEIVED )
+        {
+          pulHistogram[ pLookupTable[ pImage[x] ] ]++;
+          ulNrPixels++;
+        }
+      pImage += uiXRes;
+      continue;
+    }
+
     pImagePointer = &pImage[uiSizeX];
     while( pImage < pImagePointer )
       pulHistogram[ pLookupTable[ *pImage++ ] ]++;
     pImagePointer += uiXRes;
+    ulNrPixels += uiSizeX;
 
     /* go to bdeginning of next row */
     pImage = &pImagePointer[ -(int)uiSizeX ];
   }
+
+  return( ulNrPixels );
 }
 
 /*****************************************************************************/
@@ -342,6 +367,8 @@ static void Interpolate(
  * and maximum value as the input image. A clip limit smaller than 1 results
  * in standard (non-contrast limited) AHE.
  *   pImage - Pointer to the input/output image
+ *   pBlockMap - Block map of the image, only MCUs received are equalized by.
+ *     NULL to use all of the image
  *   uiXRes - Image resolution in the X direction
  *   uiYRes - Image resolution in the Y direction
  *   Min - Minimum greyvalue of input image (also becomes minimum of output image)
@@ -353,6 +380,7 @@ static void Interpolate(
  */
 bool CLAHE(
         kz_pixel_t *pImage,
+        const kz_pixel_t *pBlockMap,
         uint32_t uiXRes,
         uint32_t uiYRes,
         kz_pixel_t Min,
@@ -373,6 +401,9 @@ bool CLAHE(
   /* clip limit and region pixel count */
   unsigned long ulClipLimit, ulNrPixels;
 
+  /* pixels of a region in its histogram and their clip limit */
+  unsigned long ulRegPixels, ulRegClipLimit;
+
   /* pointer to image */
   kz_pixel_t* pImPointer;
 
@@ -425,9 +456,25 @@ bool CLAHE(
     for( uiX = 0; uiX < uiNrX; uiX++, pImPointer += uiXSize )
     {
       pulHist = &pulMapArray[uiNrBins * (uiY * uiNrX + uiX)];
-      MakeHistogram( pImPointer, uiXRes, uiXSize, uiYSize, pulHist, uiNrBins, aLUT );
-      ClipHistogram( pulHist, uiNrBins, ulClipLimit );
-      MapHistogram( pulHist, Min, Max, uiNrBins, ulNrPixels );
+      ulRegPixels = MakeHistogram(
+          pImPointer, pBlockMap ? &pBlockMap[uiX * uiXSize] : NULL,
+          uiY * uiYSize, uiXRes, uiXSize, uiYSize, pulHist, uiNrBins, aLUT );
+
+      /* region with no MCU received, all of it then */
+      if( ulRegPixels == 0 )
+        ulRegPixels = MakeHistogram( pImPointer, NULL, 0,
+            uiXRes, uiXSize, uiYSize, pulHist, uiNrBins, aLUT );
+
+      /* cliplimit is for the pixels counted */
+      ulRegClipLimit = ulClipLimit;
+      if( (fCliplimit > 0.0) && (ulRegPixels < ulNrPixels) )
+      {
+        ulRegClipLimit = ulClipLimit * ulRegPixels / ulNrPixels;
+        ulRegClipLimit = ( ulRegClipLimit < 1UL ) ? 1UL : ulRegClipLimit;
+      }
+
+      ClipHistogram( pulHist, uiNrBins, ulRegClipLimit );
+      MapHistogram( pulHist, Min, Max, uiNrBins, ulRegPixels );
     }
 
     /* skip lines, set pointer */
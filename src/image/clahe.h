@@ -14,8 +14,8 @@
 
 /*****************************************************************************/
 
-#ifndef GLRPT_CLAHE_H
-#define GLRPT_CLAHE_H
+#ifndef IMAGE_CLAHE_H
+#define IMAGE_CLAHE_H
 
 /*****************************************************************************/
 
@@ -42,6 +42,7 @@ typedef unsigned char kz_pixel_t;
 
 bool CLAHE(
         kz_pixel_t *pImage,
+        const kz_pixel_t *pBlockMap,
         uint32_t uiXRes,
         uint32_t uiYRes,
         kz_pixel_t Min,
@@ -0,0 +1,569 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*****************************************************************************/
+
+#include "image.h"
+
+#include "../common/common.h"
+#include "../glrpt/utils.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*****************************************************************************/
+
+#define BLACK_CUT_OFF   1 /* Black cut-off percentile for normalization */
+#define WHITE_CUT_OFF   1 /* White cut-off percentile for normalization */
+
+/* Size of a strip of the APID images and of its block map lines */
+#define STRIP_SIZE  ( (size_t)METEOR_IMAGE_WIDTH * \
+    (IMAGE_STRIP_LINES + IMAGE_STRIP_LINES / BLOCK_MAP_LINES) )
+
+/*****************************************************************************/
+
+/* Channel_Images_Reset()
+ *
+ * Frees the channel images, if allocated, and
+ * makes the set ready for a new pass
+ */
+void Channel_Images_Reset(channel_images_t *images) {
+  uint32_t idx, s;
+
+  for( idx = 0; idx < CHANNEL_IMAGE_NUM; idx++ )
+  {
+    free_ptr( (void **)&(images->image[idx]) );
+    free_ptr( (void **)&(images->block_map[idx]) );
+  }
+
+  for( idx = 0; idx < APID_NUM; idx++ )
+  {
+    if( images->strips[idx] == NULL ) continue;
+    for( s = 0; s < images->num_strips; s++ )
+      free_ptr( (void **)&(images->strips[idx][s]) );
+    free_ptr( (void **)&(images->strips[idx]) );
+  }
+
+  images->num_strips = 0;
+  images->max_strips = 0;
+  images->exported   = false;
+  memset( images->apid, 0, sizeof(images->apid) );
+  images->size       = 0;
+  images->width      = METEOR_IMAGE_WIDTH;
+  images->height     = 0;
+  images->colorized  = false;
+}
+
+/*****************************************************************************/
+
+/* Channel_Images_Grow()
+ *
+ * Makes the images of all APIDs received at least height lines
+ * high, adding cleared strips as needed, all of their MCUs missing.
+ * Lines already decoded are never moved
+ */
+void Channel_Images_Grow(channel_images_t *images, uint32_t height) {
+  uint32_t num, idx, s;
+
+  if( images->exported || (height <= images->height) ) return;
+
+  /* Indices double as they fill, only they are ever reallocated */
+  num = ( height + IMAGE_STRIP_LINES - 1 ) / IMAGE_STRIP_LINES;
+  if( num > images->max_strips )
+  {
+    images->max_strips = 2 * num;
+    for( idx = 0; idx < APID_NUM; idx++ )
+      if( images->strips[idx] )
+        mem_realloc( (void **)&(images->strips[idx]),
+            images->max_strips * sizeof(uint8_t *) );
+  }
+
+  for( idx = 0; idx < APID_NUM; idx++ )
+    if( images->strips[idx] )
+      for( s = images->num_strips; s < num; s++ )
+        mem_alloc( (void **)&(images->strips[idx][s]), STRIP_SIZE );
+  images->num_strips = num;
+
+  images->height = height;
+  images->size   = (size_t)METEOR_IMAGE_WIDTH * images->height;
+}
+
+/*****************************************************************************/
+
+/* Channel_Images_Add_Apid()
+ *
+ * Starts keeping the image of an APID, as high as the others,
+ * on its first packet. Returns false if it is no image APID
+ */
+bool Channel_Images_Add_Apid(channel_images_t *images, uint32_t apid) {
+  uint32_t idx = apid - APID_FIRST, s;
+
+  if( (apid < APID_FIRST) || (idx >= APID_NUM) ) return( false );
+  if( images->strips[idx] ) return( true );
+
+  mem_alloc( (void **)&(images->strips[idx]),
+      (images->max_strips ? images->max_strips : 1) * sizeof(uint8_t *) );
+  for( s = 0; s < images->num_strips; s++ )
+    mem_alloc( (void **)&(images->strips[idx][s]), STRIP_SIZE );
+
+  return( true );
+}
+
+/*****************************************************************************/
+
+/* Apid_Image_Row()
+ *
+ * Pixels of line y of an APID's image as decoded,
+ * NULL if the APID has not been received
+ */
+uint8_t *Apid_Image_Row(
+        const channel_images_t *images,
+        uint32_t apid,
+        uint32_t y) {
+  uint32_t idx = apid - APID_FIRST;
+
+  if( (apid < APID_FIRST) || (idx >= APID_NUM) ||
+      (images->strips[idx] == NULL) || (y >= images->height) )
+    return( NULL );
+
+  return( images->strips[idx][y / IMAGE_STRIP_LINES] +
+      (size_t)(y % IMAGE_STRIP_LINES) * METEOR_IMAGE_WIDTH );
+}
+
+/*****************************************************************************/
+
+/* Apid_Block_Map_Row()
+ *
+ * Block map line of the MCU row that has line y of an
+ * APID's image, NULL if the APID has not been received
+ */
+uint8_t *Apid_Block_Map_Row(
+        const channel_images_t *images,
+        uint32_t apid,
+        uint32_t y) {
+  uint32_t idx = apid - APID_FIRST;
+
+  if( (apid < APID_FIRST) || (idx >= APID_NUM) ||
+      (images->strips[idx] == NULL) || (y >= images->height) )
+    return( NULL );
+
+  return( images->strips[idx][y / IMAGE_STRIP_LINES] +
+      (size_t)(IMAGE_STRIP_LINES + (y % IMAGE_STRIP_LINES) / BLOCK_MAP_LINES) *
+      METEOR_IMAGE_WIDTH );
+}
+
+/*****************************************************************************/
+
+/* Channel_Images_Export()
+ *
+ * Gathers the strips of the APID chosen for each color channel
+ * into one piece in image[], and their block maps in block_map[], for
+ * processing and saving. Channels of APIDs not received are black,
+ * all of their MCUs missing. The APID images are kept, so
+ * channels may be exported again, from other APIDs and as yet
+ * unprocessed. Palette inversion is not undone though, it is
+ * done to the APID images as they are decoded
+ */
+void Channel_Images_Export(
+        channel_images_t *images,
+        const uint8_t apid[CHANNEL_IMAGE_NUM]) {
+  uint32_t chn, y;
+  const uint8_t *row;
+  uint8_t *dst;
+
+  images->exported  = true;
+  images->colorized = false;
+  memcpy( images->apid, apid, sizeof(images->apid) );
+  images->width     = METEOR_IMAGE_WIDTH;
+  images->size      = (size_t)images->width * images->height;
+  if( images->size == 0 ) return;
+
+  for( chn = 0; chn < CHANNEL_IMAGE_NUM; chn++ )
+  {
+    mem_realloc( (void **)&(images->image[chn]), images->size );
+    for( y = 0; y < images->height; y++ )
+    {
+      dst = images->image[chn] + (size_t)y * images->width;
+      row = Apid_Image_Row( images, apid[chn], y );
+      if( row )
+        memcpy( dst, row, images->width );
+      else
+        memset( dst, 0, images->width );
+    }
+
+    mem_realloc( (void **)&(images->block_map[chn]),
+        images->size / BLOCK_MAP_LINES );
+    for( y = 0; y < images->height; y += BLOCK_MAP_LINES )
+    {
+      dst = images->block_map[chn] +
+        (size_t)(y / BLOCK_MAP_LINES) * images->width;
+      row = Apid_Block_Map_Row( images, apid[chn], y );
+      if( row )
+        memcpy( dst, row, images->width );
+      else
+        memset( dst, BLOCK_MISSING, images->width );
+    }
+  }
+}
+
+/*****************************************************************************/
+
+/* Channel_Image_Missing()
+ *
+ * Fraction of an exported channel image whose MCUs were not received
+ */
+double Channel_Image_Missing(const channel_images_t *images, uint32_t chn) {
+  size_t map_size, idx, missing = 0;
+
+  map_size = images->size / BLOCK_MAP_LINES;
+  if( !images->exported || (images->block_map[chn] == NULL) ||
+      (map_size == 0) )
+    return( 0.0 );
+
+  for( idx = 0; idx < map_size; idx++ )
+    if( images->block_map[chn][idx] != BLOCK_RECEIVED ) missing++;
+
+  return( (double)missing / (double)map_size );
+}
+
+/*****************************************************************************/
+
+/* Fill_Image_Gaps()
+ *
+ * Fills in the lost MCUs of the exported channel images, in one pass
+ * down each column of MCUs. The pixels of a gap are interpolated from
+ * the line above it to the first one received below it, or copied
+ * from the one there is at the edges of the image. Filled MCUs are
+ * marked in the block maps, they stay out of the histograms
+ */
+void Fill_Image_Gaps(channel_images_t *images) {
+  uint32_t chn, rows, width, x, r, r2, lines, l, i;
+  uint8_t *img, *map, *dst;
+  const uint8_t *top, *bot;
+
+  /* MCU columns are lost to rectification */
+  if( !images->exported || (images->size == 0) ||
+      (images->width != METEOR_IMAGE_WIDTH) )
+    return;
+
+  width = images->width;
+  rows  = images->height / BLOCK_MAP_LINES;
+  for( chn = 0; chn < CHANNEL_IMAGE_NUM; chn++ )
+  {
+    img = images->image[chn];
+    map = images->block_map[chn];
+    if( (img == NULL) || (map == NULL) ) continue;
+
+    for( x = 0; x < width; x += 8 )
+    {
+      for( r = 0; r < rows; r = r2 )
+      {
+        r2 = r + 1;
+        if( map[(size_t)r * width + x] != BLOCK_MISSING ) continue;
+
+        /* Gap down to the next MCU received */
+        while( (r2 < rows) &&
+               (map[(size_t)r2 * width + x] == BLOCK_MISSING) )
+          r2++;
+
+        top = ( r > 0 ) ?
+          img + ((size_t)r * BLOCK_MAP_LINES - 1) * width + x : NULL;
+        bot = ( r2 < rows ) ?
+          img + (size_t)r2 * BLOCK_MAP_LINES * width + x : NULL;
+        if( (top == NULL) && (bot == NULL) ) continue;
+
+        /* Line l of the gap lies l + 1 of lines + 1 steps down */
+        lines = ( r2 - r ) * BLOCK_MAP_LINES;
+        for( l = 0; l < lines; l++ )
+        {
+          dst = img + ((size_t)r * BLOCK_MAP_LINES + l) * width + x;
+          for( i = 0; i < 8; i++ )
+          {
+            if( top && bot )
+              dst[i] = (uint8_t)( (top[i] * (lines - l) +
+                    bot[i] * (l + 1) + (lines + 1) / 2) / (lines + 1) );
+            else
+              dst[i] = top ? top[i] : bot[i];
+          }
+        }
+
+        for( l = r; l < r2; l++ )
+          memset( map + (size_t)l * width + x, BLOCK_FILLED, 8 );
+      } /* for( r = 0; r < rows; r = r2 ) */
+    } /* for( x = 0; x < width; x += 8 ) */
+  } /* for( chn = 0; chn < CHANNEL_IMAGE_NUM; chn++ ) */
+}
+
+/*****************************************************************************/
+
+/*  Normalize_Image()
+ *
+ *  Does histogram (linear) normalization of a pgm (P5) image file.
+ *  If a block map is given only the MCUs received go in the histogram
+ */
+void Normalize_Image(
+        uint8_t *image_buffer,
+        uint32_t image_size,
+        const uint8_t *block_map,
+        uint32_t width,
+        uint8_t range_low,
+        uint8_t range_high) {
+  uint32_t
+    hist[MAX_WHITE+1],  /* Intensity histogram of pgm image file  */
+    pixel_cnt,          /* Total pixels counter for cut-off point */
+    black_cutoff,       /* Count of pixels for black cutoff value */
+    white_cutoff,       /* Count of pixels for white cutoff value */
+    hist_cnt,           /* Count of pixels in the histogram       */
+    idx, x;
+
+  const uint8_t *map;
+
+  uint8_t
+    pixel_val_in,       /* Used for calculating normalized pixels */
+    black_min_in,       /* Black cut-off pixel intensity value */
+    white_max_in,       /* White cut-off pixel intensity value */
+    val_range_in,       /* Range of intensity values in input image  */
+    val_range_out;      /* Range of intensity values in output image */
+
+  /* Abort for "empty" image buffers */
+  if( image_size == 0 )
+  {
+    Show_Message(
+        "Image file seems empty\n"\
+          "Normalization not performed", "red" );
+    Error_Dialog();
+    return;
+  }
+
+  /* Clear histogram */
+  for( idx = 0; idx <= MAX_WHITE; idx++ )
+    hist[ idx ] = 0;
+
+  /* Build image intensity histogram, leaving out the MCUs lost */
+  hist_cnt = 0;
+  if( block_map && (width > 0) )
+  {
+    for( idx = 0; idx + width <= image_size; idx += width )
+    {
+      map = block_map + (idx / width / BLOCK_MAP_LINES) * width;
+      for( x = 0; x < width; x++ )
+        if( map[x] == BLOCK_RECEIVED )
+        {
+          hist[ image_buffer[idx + x] ]++;
+          hist_cnt++;
+        }
+    }
+  }
+
+  /* All of the image if there is no map or nothing was received */
+  if( hist_cnt == 0 )
+  {
+    for( idx = 0; idx < image_size; idx++ )
+      hist[ image_buffer[idx] ]++;
+    hist_cnt = image_size;
+  }
+
+  /* Determine black/white cut-off counts */
+  black_cutoff = (hist_cnt * BLACK_CUT_OFF) / 100;
+  white_cutoff = (hist_cnt * WHITE_CUT_OFF) / 100;
+
+  /* Find black cut-off intensity value. Values below
+   * MIN_BLACK are ignored to leave behind the black stripes
+   * that seem to be sent by the satellite occasionally */
+  pixel_cnt = 0;
+  for( black_min_in = MIN_BLACK; black_min_in != MAX_WHITE; black_min_in++ )
+  {
+    pixel_cnt += hist[ black_min_in ];
+    if( pixel_cnt >= black_cutoff ) break;
+  }
+
+  /* Find white cut-off intensity value */
+  pixel_cnt = 0;
+  for( white_max_in = MAX_WHITE; white_max_in != 0; white_max_in-- )
+  {
+    pixel_cnt += hist[ white_max_in ];
+    if( pixel_cnt >= white_cutoff ) break;
+  }
+
+  /* Rescale pixels in image for required intensity range */
+  val_range_in = white_max_in - black_min_in;
+  if( val_range_in == 0 )
+  {
+    Show_Message(
+        "Image seems flat\n"\
+          "Normalization not performed", "red" );
+    Error_Dialog();
+    return;
+  }
+
+  /* Perform histogram normalization on images */
+  Show_Message( "Performing Histogram Normalization", "black" );
+
+  val_range_out = range_high - range_low;
+  for( pixel_cnt = 0; pixel_cnt < image_size; pixel_cnt++ )
+  {
+    /* Input image pixel values relative to input black cut off.
+     * Clamp pixel values within black and white cut off values */
+    pixel_val_in  = (uint8_t)
+      iClamp( image_buffer[pixel_cnt], black_min_in, white_max_in );
+    pixel_val_in -= black_min_in;
+
+    /* Normalized pixel values are scaled according to the ratio
+     * of required pixel value range to input pixel value range */
+    image_buffer[ pixel_cnt ] =
+      range_low + ( pixel_val_in * val_range_out ) / val_range_in;
+  }
+}
+
+/*****************************************************************************/
+
+/*  Flip_Image()
+ *
+ *  Flips a pgm (P5) image by 180 degrees
+ */
+void Flip_Image(uint8_t *image_buffer, uint32_t image_size) {
+  uint32_t idx; /* Index for loops etc */
+
+  uint8_t
+    *idx_temp,  /* Buffer location to be saved in temp    */
+    *idx_swap;  /* Buffer location to be swaped with temp */
+
+  /* Holds a pixel value temporarily */
+  uint8_t temp;
+
+  /* Abort for "empty" image buffers */
+  if( image_size == 0 )
+  {
+    Show_Message(
+        "Image file empty\n"\
+          "Rotation not performed", "red" );
+    Error_Dialog();
+    return;
+  }
+
+  /* Rotate image 180 degrees */
+  Show_Message( "Rotating Image by 180 degrees", "black" );
+  for( idx = 0; idx < image_size / 2; idx++ )
+  {
+    idx_temp = image_buffer + idx;
+    idx_swap = image_buffer - 1 + image_size - idx;
+    temp = *( idx_temp );
+    *( idx_temp ) = *( idx_swap );
+    *( idx_swap ) = temp;
+  }
+}
+
+/*****************************************************************************/
+
+/* Create_Combo_Image()
+ *
+ * Combines channel images into one combined pseudo-color image.
+ * If enabled, it performs some speculative enhancement of watery
+ * areas and clouds.
+ */
+void Create_Combo_Image(
+        channel_images_t *images,
+        const combo_params_t *params,
+        uint8_t *combo_image) {
+    /* Color channels are 0 = red, 1 = green, 2 = blue
+     * but it all depends on the APID options in glrptrc */
+    uint32_t idx = 0, cnt;
+    uint8_t range_red, range_green, range_blue;
+    uint8_t
+        red   = params->color_channel[RED],
+        green = params->color_channel[GREEN],
+        blue  = params->color_channel[BLUE];
+
+    /* Perform speculative enhancement of watery areas and clouds */
+    if( params->colorize )
+    {
+        /* The Red channel image from the Meteor M2 satellite seems
+         * to have some excess luminance after Normalization so here
+         * the pixel value range is reduced to that specified in the
+         * ~/glrpt/glrptrc configuration file */
+        range_red =
+            params->norm_range[RED][NORM_RANGE_WHITE] -
+            params->norm_range[RED][NORM_RANGE_BLACK];
+
+        /* The Blue channel image from the Meteor M2 satellite looses
+         * pixel values (luminance) in the watery areas (seas and lakes)
+         * after Normalization. Here the pixel value range in the dark
+         * areas is enhanced according to values specified in the
+         * ~/glrpt/glrptrc configuration file */
+        range_blue = params->colorize_blue_max - params->colorize_blue_min;
+
+        for( cnt = 0; cnt < images->size; cnt++ )
+        {
+            /* Progressively raise the value of blue channel
+             * pixels in the dark areas to counteract the
+             * effects of histogram equalization, which darkens
+             * the parts of the image that are watery areas */
+            if( !images->colorized )
+            {
+                if( images->image[blue][cnt] < params->colorize_blue_min )
+                {
+                    images->image[blue][cnt] =
+                        params->colorize_blue_min  +
+                        ( images->image[blue][cnt] * range_blue ) /
+                        params->colorize_blue_max;
+                }
+
+                images->colorized = true;
+            }
+
+            /* Colorize cloudy areas white pseudocolor. This helps
+             * because the red channel does not render clouds right */
+            if( images->image[blue][cnt] > params->clouds_threshold )
+            {
+                combo_image[idx++] = images->image[blue][cnt];
+                combo_image[idx++] = images->image[blue][cnt];
+                combo_image[idx++] = images->image[blue][cnt];
+            }
+            else /* Just combine channels */
+            {
+                /* Reduce Red channel luminance as specified in config file */
+                combo_image[idx++] = params->norm_range[RED][NORM_RANGE_BLACK] +
+                    ( images->image[red][cnt] * range_red ) / MAX_WHITE;
+                combo_image[idx++] = images->image[green][cnt];
+                combo_image[idx++] = images->image[blue][cnt];
+            }
+        } /* for( cnt = 0; cnt < (int)images->size; cnt++ ) */
+
+    } /* if( params->colorize ) */
+    else
+    {
+        /* Else combine channel images after changing pixel
+         * value range to that specified in the config file */
+        range_red =
+            params->norm_range[RED][NORM_RANGE_WHITE] -
+            params->norm_range[RED][NORM_RANGE_BLACK];
+        range_green =
+            params->norm_range[GREEN][NORM_RANGE_WHITE] -
+            params->norm_range[GREEN][NORM_RANGE_BLACK];
+        range_blue =
+            params->norm_range[BLUE][NORM_RANGE_WHITE] -
+            params->norm_range[BLUE][NORM_RANGE_BLACK];
+
+        for( cnt = 0; cnt < images->size; cnt++ )
+        {
+            combo_image[idx++] = params->norm_range[RED][NORM_RANGE_BLACK] +
+                ( images->image[red][cnt] * range_red ) / MAX_WHITE;
+            combo_image[idx++] = params->norm_range[GREEN][NORM_RANGE_BLACK] +
+                ( images->image[green][cnt] * range_green ) / MAX_WHITE;
+            combo_image[idx++] = params->norm_range[BLUE][NORM_RANGE_BLACK] +
+                ( images->image[blue][cnt] * range_blue ) / MAX_WHITE;
+        } /* for( cnt = 0; cnt < (int)images->size; cnt++ ) */
+    }
+}
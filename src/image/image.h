@@ -0,0 +1,135 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*****************************************************************************/
+
+#ifndef IMAGE_IMAGE_H
+#define IMAGE_IMAGE_H
+
+/*****************************************************************************/
+
+#include "../common/common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/* Normalized black value */
+#define NORM_BLACK  0
+
+/* Min and max values required in histogram normalization to leave behind
+ * occasional black bands in images
+ */
+#define MIN_BLACK   2
+#define MAX_WHITE   255
+
+/* TODO seems like unused */
+/* Minimum black value in blue APID image */
+#define BLUE_MIN_BLACK  64
+
+/*****************************************************************************/
+
+/* Lines of a strip of the channel images as they are decoded,
+ * a whole number of MCU rows */
+#define IMAGE_STRIP_LINES   128
+
+/* Lines of the images per line of their block maps, those of an MCU */
+#define BLOCK_MAP_LINES     8
+
+/* Block map values: MCU lost, filled in from the lines
+ * around it by Fill_Image_Gaps(), or decoded as received */
+#define BLOCK_MISSING   0x00
+#define BLOCK_FILLED    0x80
+#define BLOCK_RECEIVED  0xFF
+
+/* Decoded channel images of a pass, one per color channel */
+typedef struct channel_images_t {
+    /* Images of the APIDs chosen for the color channels,
+     * in one piece once exported by Channel_Images_Export() */
+    uint8_t *image[CHANNEL_IMAGE_NUM];
+
+    /* Which MCUs of image[] were received, a line per MCU row
+     * with a value per pixel column, so they are flipped and
+     * rectified like the images. NULL if not exported */
+    uint8_t *block_map[CHANNEL_IMAGE_NUM];
+
+    /* Images of all APIDs as decoded, an index of each one's
+     * strips, each followed by its block map lines. NULL for
+     * APIDs not received (yet) */
+    uint8_t **strips[APID_NUM];
+    uint32_t num_strips, max_strips;
+
+    /* Channel images exported, no more lines are decoded,
+     * and the APIDs they were exported from */
+    bool exported;
+    uint8_t apid[CHANNEL_IMAGE_NUM];
+
+    /* Size (pixels) of each image and its dimensions */
+    size_t   size;
+    uint32_t width, height;
+
+    /* Blue channel has been enhanced for the combo image */
+    bool colorized;
+} channel_images_t;
+
+/* Combo (pseudo-color) image parameters, from the satellite's config */
+typedef struct combo_params_t {
+    /* Channels to combine to produce color image */
+    uint8_t color_channel[CHANNEL_IMAGE_NUM];
+
+    /* Image normalization pixel value ranges */
+    uint8_t norm_range[CHANNEL_IMAGE_NUM][2];
+
+    /* Speculative enhancement of watery areas and clouds */
+    bool colorize;
+    uint8_t colorize_blue_max, colorize_blue_min;
+    uint8_t clouds_threshold;
+} combo_params_t;
+
+/*****************************************************************************/
+
+void Channel_Images_Reset(channel_images_t *images);
+void Channel_Images_Grow(channel_images_t *images, uint32_t height);
+bool Channel_Images_Add_Apid(channel_images_t *images, uint32_t apid);
+uint8_t *Apid_Image_Row(
+        const channel_images_t *images,
+        uint32_t apid,
+        uint32_t y);
+uint8_t *Apid_Block_Map_Row(
+        const channel_images_t *images,
+        uint32_t apid,
+        uint32_t y);
+void Channel_Images_Export(
+        channel_images_t *images,
+        const uint8_t apid[CHANNEL_IMAGE_NUM]);
+double Channel_Image_Missing(const channel_images_t *images, uint32_t chn);
+void Fill_Image_Gaps(channel_images_t *images);
+void Normalize_Image(
+        uint8_t *image_buffer,
+        uint32_t image_size,
+        const uint8_t *block_map,
+        uint32_t width,
+        uint8_t range_low,
+        uint8_t range_high);
+void Flip_Image(uint8_t *image_buffer, uint32_t image_size);
+void Create_Combo_Image(
+        channel_images_t *images,
+        const combo_params_t *params,
+        uint8_t *combo_image);
+
+/*****************************************************************************/
+
+#endif
@@ -39,8 +39,9 @@
 
 #include "rectify_meteor.h"
 
-#include "../common/shared.h"
+#include "../common/common.h"
 #include "../glrpt/utils.h"
+#include "image.h"
 
 #include <math.h>
 #include <stddef.h>
@@ -56,35 +57,53 @@
 
 /*****************************************************************************/
 
+/* Pixel spacing data of the rectifying functions */
+typedef struct rectify_rec_t {
+    /* Gap between rectified pixels */
+    uint8_t *gap;
+
+    /* Array that holds buffer indices for the reference
+     * pixels that are the right ones to use to extrapolate
+     * the value of rectified image pixels */
+    uint32_t *indices;
+
+    /* Array of extrapolation factors needed to
+     * calculate rectified image's pixel values */
+    double *factors;
+} rectify_rec_t;
+
+/*****************************************************************************/
+
 static double Calculate_beta(double phi);
 static void Rectify_Grayscale_1(
+        const rectify_rec_t *rect,
         uint8_t *in_buff,
         uint32_t in_width,
         uint32_t in_height,
+        uint32_t rect_width,
         uint8_t *rect_buff);
-static void Calculate_Pixel_Spacing_1(uint32_t in_width, uint32_t *rect_width);
+static void Calculate_Pixel_Spacing_1(
+        rectify_rec_t *rect,
+        uint32_t in_width,
+        uint32_t *rect_width);
 static void Rectify_Grayscale_2(
+        const rectify_rec_t *rect,
         uint8_t *in_buff,
         uint32_t in_width,
         uint32_t in_height,
+        uint32_t rect_width,
         uint8_t *rect_buff);
 static void Calculate_Pixel_Spacing_2(
+        rectify_rec_t *rect,
         uint32_t orig_width,
         uint32_t *rect_width);
-
-/*****************************************************************************/
-
-/* Gap between rectified pixels */
-static uint8_t *gap = NULL;
-
-/* Array that holds buffer indices for the reference
- * pixels that are the right ones to use to extrapolate
- * the value of rectified image pixels */
-static uint32_t *indices = NULL;
-
-/* Array of extrapolation factors needed to
- * calculate rectified image's pixel values */
-static double *factors = NULL;
+static void Rectify_Buffer(
+        const rectify_rec_t *rect,
+        int function,
+        uint8_t *temp,
+        uint8_t **buffer,
+        uint32_t height,
+        uint32_t rect_width);
 
 /*****************************************************************************/
 
@@ -102,7 +121,7 @@ static double Calculate_beta(double phi) {
     sin_b, cos_b,    /* sin and cos of current beta_n */
     f_beta, df_beta; /* The function of beta and derivative */
 
-  static double beta_n = 0.1; /* Starting value of beta_n */
+  double beta_n = 0.1; /* Starting value of beta_n */
 
   double
     tan_phi, /* tan(phi), the scanner's angle */
@@ -138,9 +157,11 @@ static double Calculate_beta(double phi) {
  * of Earth's curvature on the raw Meteor-M images.
  */
 static void Rectify_Grayscale_1(
+        const rectify_rec_t *rect,
         uint8_t *in_buff,
         uint32_t in_width,
         uint32_t in_height,
+        uint32_t rect_width,
         uint8_t *rect_buff) {
   uint8_t
     byteA_right = 0,
@@ -161,11 +182,11 @@ static void Rectify_Grayscale_1(
 
   /* Rectify image buffer line by line */
   in_width2 = in_width / 2;
-  ch_width2 = channel_image_width / 2;
+  ch_width2 = rect_width / 2;
   for( line_count = 0; line_count < in_height; line_count++ )
   {
     /* Middle of each line in the rectified image */
-    rect_buff_right = line_count * channel_image_width + ch_width2;
+    rect_buff_right = line_count * rect_width + ch_width2;
     rect_buff_left  = rect_buff_right - 1;
 
     /* Middle of each line in the input image */
@@ -192,7 +213,7 @@ static void Rectify_Grayscale_1(
       byteB_left  = *( in_buff + in_buff_left-- );
 
       /* Fill the gap between the two pixels */
-      switch ( *(gap + idx) )
+      switch ( *(rect->gap + idx) )
       {
         case 0:
           break;
@@ -252,7 +273,10 @@ static void Rectify_Grayscale_1(
  * Calculates the correct pixel spacing of Meteor-M images taking into
  * account the Earth's curvature and the scanner's tangential distortion
  */
-static void Calculate_Pixel_Spacing_1(uint32_t in_width, uint32_t *rect_width) {
+static void Calculate_Pixel_Spacing_1(
+        rectify_rec_t *rect,
+        uint32_t in_width,
+        uint32_t *rect_width) {
   /* A little geometry of the satellite, Earth, and the scans */
   double
     phi,         // instantaneous scan angle from vertical
@@ -276,8 +300,7 @@ static void Calculate_Pixel_Spacing_1(uint32_t in_width, uint32_t *rect_width) {
     mem_alloc( (void **) &newposition, (size_t)in_width2 * sizeof(double) );
 
   /* Gap between pixels */
-  if( gap == NULL )
-    mem_alloc( (void **)&gap, (size_t)(in_width2 - 1) * sizeof(int) );
+  mem_alloc( (void **)&(rect->gap), (size_t)(in_width2 - 1) * sizeof(int) );
 
   /* Stride pixel-to-pixel of the scanner, in rad */
   delta_phi = 2.0 * PHI_MAX / (double)( in_width - 1 );
@@ -317,27 +340,27 @@ static void Calculate_Pixel_Spacing_1(uint32_t in_width, uint32_t *rect_width) {
     unusedspace += newposition[ idx + 1 ] - newposition[ idx ] - 1.0;
     if( unusedspace >= 4.0 )
     {
-      gap[ idx ]   = 4;
+      rect->gap[ idx ]   = 4;
       unusedspace -= 4.0;
     }
     else if( unusedspace >= 3.0 )
     {
-      gap[ idx ]   = 3;
+      rect->gap[ idx ]   = 3;
       unusedspace -= 3.0;
     }
     else if( unusedspace >= 2.0 )
     {
-      gap[ idx ]   = 2;
+      rect->gap[ idx ]   = 2;
       unusedspace -= 2.0;
     }
     else if( unusedspace >= 1.0 )
     {
-      gap[ idx ]   = 1;
+      rect->gap[ idx ]   = 1;
       unusedspace -= 1.0;
     }
     else
     {
-      gap[ idx ] = 0;
+      rect->gap[ idx ] = 0;
     }
   }
 
@@ -352,9 +375,11 @@ static void Calculate_Pixel_Spacing_1(uint32_t in_width, uint32_t *rect_width) {
  * of Earth's curvature on the raw Meteor-M scanner images.
  */
 static void Rectify_Grayscale_2(
+        const rectify_rec_t *rect,
         uint8_t *in_buff,
         uint32_t in_width,
         uint32_t in_height,
+        uint32_t rect_width,
         uint8_t *rect_buff) {
   uint32_t
     in_buff_idx,    /* Index to the unrectified input image buffer    */
@@ -373,13 +398,13 @@ static void Rectify_Grayscale_2(
 
   /* The center pixels (first to right of center) of images */
   in_width2   = in_width / 2;
-  rect_width2 = channel_image_width / 2;
+  rect_width2 = rect_width / 2;
 
   /* Rectify images lane by line */
   for( vert_cnt = 0; vert_cnt < in_height; vert_cnt++ )
   {
     /* Indices to input and output image buffers */
-    rect_buff_idx = rect_width2 + vert_cnt * channel_image_width;
+    rect_buff_idx = rect_width2 + vert_cnt * rect_width;
     in_stride     = in_width2   + vert_cnt * in_width;
 
     /* Extrapolate values of each pixel in output buffer.
@@ -388,7 +413,7 @@ static void Rectify_Grayscale_2(
     {
       /* This index points to pixel in input buffer that is to
        * be used as the reference for extrapolating pixel value */
-      in_buff_idx = indices[horiz_cnt] + in_stride;
+      in_buff_idx = rect->indices[horiz_cnt] + in_stride;
 
       /* This is the diff in values of the reference pixel and the one
        * before it, and it is to be used for linear extrapolation of the
@@ -397,19 +422,19 @@ static void Rectify_Grayscale_2(
 
       /* Pixel value is the reference input pixel value  plus a propotion
        * of the value diff above, according to the extrapolation factor */
-      pixel_value = in_buff[in_buff_idx] + pixel_value_diff * factors[horiz_cnt];
+      pixel_value = in_buff[in_buff_idx] + pixel_value_diff * rect->factors[horiz_cnt];
       rect_buff[rect_buff_idx] = (uint8_t)pixel_value;
       rect_buff_idx++;
     }
 
     /* Extrapolate values of each pixel in output buffer as above.
      * This is from the center left pixel to the left edges */
-    rect_buff_idx = rect_width2 + vert_cnt * channel_image_width;
+    rect_buff_idx = rect_width2 + vert_cnt * rect_width;
     for( horiz_cnt = 0; horiz_cnt < rect_width2; horiz_cnt++ )
     {
-      in_buff_idx = in_stride - indices[horiz_cnt];
+      in_buff_idx = in_stride - rect->indices[horiz_cnt];
       pixel_value_diff = in_buff[in_buff_idx - 1] - in_buff[in_buff_idx];
-      pixel_value = in_buff[in_buff_idx - 1] - pixel_value_diff * factors[horiz_cnt];
+      pixel_value = in_buff[in_buff_idx - 1] - pixel_value_diff * rect->factors[horiz_cnt];
       rect_buff_idx--;
       rect_buff[rect_buff_idx] = (uint8_t)pixel_value;
     }
@@ -425,6 +450,7 @@ static void Rectify_Grayscale_2(
  * and the scanner's tangential distortion
  */
 static void Calculate_Pixel_Spacing_2(
+        rectify_rec_t *rect,
         uint32_t orig_width,
         uint32_t *rect_width) {
   double
@@ -471,13 +497,13 @@ static void Calculate_Pixel_Spacing_2(
    * of the original image for the appropriate pixels to use
    * to extrapolate pixels values of the rectified image */
   req = (size_t)*rect_width * sizeof(uint32_t) / 2;
-  mem_alloc( (void **)&indices, req );
+  mem_alloc( (void **)&(rect->indices), req );
 
   /* Allocate the extrapolation factors buffer. It holds
    * the appropriate extrapolation factors to calculte
    * pixel values of the rectified image */
   req = (size_t)*rect_width * sizeof(double) / 2;
-  mem_alloc( (void **)&factors, req );
+  mem_alloc( (void **)&(rect->factors), req );
 
   /* Center pixel (first to right of sub-satellite point) of rectified image */
   rect_center = *rect_width / 2;
@@ -519,77 +545,104 @@ static void Calculate_Pixel_Spacing_2(
     /* If rectified pixel's center position is less than
      * the original pixel's position, save the original
      * pixel's index in the reference indices buffer */
-    indices[rect_idx] = orig_idx;
+    rect->indices[rect_idx] = orig_idx;
 
     /* The extrapolation factor is the distance of the rectified
      * pixel's center from the reference pixel's center, divided
      * by the distance between the centers of the reference pixel
      * and the previous one */
-    factors[rect_idx]  = rect_pixel_center - orig_pixel_center;
-    factors[rect_idx] /= prev_center - orig_pixel_center;
+    rect->factors[rect_idx]  = rect_pixel_center - orig_pixel_center;
+    rect->factors[rect_idx] /= prev_center - orig_pixel_center;
     rect_idx++;
   } /* while( rect_idx < rect_center ) */
 }
 
 /*****************************************************************************/
 
+/* Rectify_Buffer()
+ *
+ * Rectifies an image of the given height in place, reallocating
+ * it to rect_width. temp must hold the image before rectifying
+ */
+static void Rectify_Buffer(
+        const rectify_rec_t *rect,
+        int function,
+        uint8_t *temp,
+        uint8_t **buffer,
+        uint32_t height,
+        uint32_t rect_width) {
+  /* Save original image to temp */
+  memmove( temp, *buffer, (size_t)METEOR_IMAGE_WIDTH * height );
+
+  /* Re-allocate image buffer and rectify */
+  mem_realloc( (void **)buffer, (size_t)rect_width * height );
+  switch( function )
+  {
+    case R_W2RG:
+      Rectify_Grayscale_1(
+          rect, temp, METEOR_IMAGE_WIDTH, height, rect_width, *buffer );
+      break;
+
+    case R_5B4AZ:
+      Rectify_Grayscale_2(
+          rect, temp, METEOR_IMAGE_WIDTH, height, rect_width, *buffer );
+      break;
+  }
+}
+
+/*****************************************************************************/
+
 /* Rectify_Images()
  *
  * Rectifies (corrects geometric distortion) of Meteor images
+ * using the given rectifying function (R_W2RG or R_5B4AZ)
  */
-void Rectify_Images(void) {
+void Rectify_Images(channel_images_t *images, int function) {
+  rectify_rec_t rect = { NULL, NULL, NULL };
+  uint32_t rect_width = images->width;
+
   /* Create a temp image buffer to save original images
    * and re-allocate channel images to be rectified */
   uint8_t *temp_image = NULL;
-  size_t   orig_size  = (size_t)( channel_image_width * channel_image_height );
+  size_t   orig_size  = (size_t)( images->width * images->height );
   orig_size *= sizeof(uint8_t);
   mem_alloc( (void **) &temp_image, orig_size );
 
-  /* Initialize rectifying functions. channel_image_width
+  /* Initialize rectifying functions. rect_width
    * will become the new width of the rectified images */
-  switch( rc_data.rectify_function )
+  switch( function )
   {
-    case 1:
+    case R_W2RG:
       Show_Message( "Using Rectify Function 1 (W2RG)", "green" );
-      Calculate_Pixel_Spacing_1( METEOR_IMAGE_WIDTH, &channel_image_width );
+      Calculate_Pixel_Spacing_1( &rect, METEOR_IMAGE_WIDTH, &rect_width );
       break;
 
-    case 2:
+    case R_5B4AZ:
       Show_Message( "Using Rectify Function 2 (5B4AZ)", "green" );
-      Calculate_Pixel_Spacing_2( METEOR_IMAGE_WIDTH, &channel_image_width );
+      Calculate_Pixel_Spacing_2( &rect, METEOR_IMAGE_WIDTH, &rect_width );
       break;
   }
 
-  size_t new_size = (size_t)(channel_image_width * channel_image_height);
+  size_t new_size = (size_t)(rect_width * images->height);
   new_size *= sizeof(uint8_t);
 
   /* The size of the channel images will also increase */
-  channel_image_size = new_size;
+  images->width = rect_width;
+  images->size  = new_size;
 
-  /* Rectify image channels */
+  /* Rectify image channels, and their block maps
+   * as images of a line per row of MCUs */
   for( uint8_t idx = 0; idx < CHANNEL_IMAGE_NUM; idx++ )
   {
-    /* Save original image to temp */
-    memmove( temp_image, channel_image[idx], orig_size );
-
-    /* Re-allocate image buffer and rectify */
-    mem_realloc( (void **) &channel_image[idx], new_size );
-    switch( rc_data.rectify_function )
-    {
-      case 1:
-        Rectify_Grayscale_1(
-            temp_image, METEOR_IMAGE_WIDTH,
-            channel_image_height, channel_image[idx] );
-        break;
-
-      case 2:
-        Rectify_Grayscale_2(
-            temp_image, METEOR_IMAGE_WIDTH,
-            channel_image_height, channel_image[idx] );
-        break;
-    }
+    Rectify_Buffer( &rect, function, temp_image,
+        &(images->image[idx]), images->height, rect_width );
+    if( images->block_map[idx] )
+      Rectify_Buffer( &rect, function, temp_image, &(images->block_map[idx]),
+          images->height / BLOCK_MAP_LINES, rect_width );
   }
 
-  SetFlag( IMAGES_RECTIFIED );
   free_ptr( (void **) &temp_image );
+  free_ptr( (void **) &(rect.gap) );
+  free_ptr( (void **) &(rect.indices) );
+  free_ptr( (void **) &(rect.factors) );
 }
@@ -14,8 +14,12 @@
 
 /*****************************************************************************/
 
-#ifndef DECODER_RECTIFY_METEOR_H
-#define DECODER_RECTIFY_METEOR_H
+#ifndef IMAGE_RECTIFY_METEOR_H
+#define IMAGE_RECTIFY_METEOR_H
+
+/*****************************************************************************/
+
+#include "image.h"
 
 /*****************************************************************************/
 
@@ -28,7 +32,7 @@ enum {
 
 /*****************************************************************************/
 
-void Rectify_Images(void);
+void Rectify_Images(channel_images_t *images, int function);
 
 /*****************************************************************************/
 
@@ -12,26 +12,27 @@
  *  http://www.gnu.org/copyleft/gpl.txt
  */
 
+/*
+ * SoapySDR input of the demodulator. Drives a single device, so its
+ * state is module static. The host stops the streaming thread and
+ * follows the device state through the callbacks of sdr_params_t
+ */
+
 /*****************************************************************************/
 
 #include "SoapySDR.h"
 
 #include "../common/common.h"
-#include "../common/shared.h"
-#include "../glrpt/callback_func.h"
-#include "../glrpt/display.h"
-#include "../glrpt/interface.h"
 #include "../glrpt/utils.h"
-#include "ifft.h"
+#include "filters.h"
 
-#include <glib.h>
-#include <gtk/gtk.h>
 #include <SoapySDR/Device.h>
 #include <SoapySDR/Formats.h>
 
 #include <complex.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -53,6 +54,7 @@
 
 /*****************************************************************************/
 
+static void SoapySDR_Set_State(uint32_t state, bool set);
 static void SoapySDR_Close_Device(void);
 static void *SoapySDR_Stream(void *pid);
 
@@ -69,6 +71,39 @@ static double   data_scale;
 static uint32_t sdr_samplerate, sdr_buf_length;
 double demod_samplerate;
 
+/* Parameters given to SoapySDR_Init(), the
+ * driver name is filled in if auto-detected */
+static sdr_params_t sdr_params;
+
+/* Chebyshev filter data I/Q */
+static filter_data_t filter_data_i;
+static filter_data_t filter_data_q;
+
+/* Posted by the streaming thread when new samples are ready */
+static sem_t demod_semaphore;
+
+/* Device state, SDR_STATE_* flags */
+static atomic_uint sdr_state = 0;
+
+/* Status of the last SDR operation and the tuner's hardware name */
+static atomic_bool sdr_status = false;
+static char sdr_hardware[MESG_SIZE] = "";
+
+/*****************************************************************************/
+
+/* SoapySDR_Set_State()
+ *
+ * Sets or clears a device state and reports it to the host
+ */
+static void SoapySDR_Set_State(uint32_t state, bool set) {
+  if( set )
+    atomic_fetch_or( &sdr_state, state );
+  else
+    atomic_fetch_and( &sdr_state, ~state );
+
+  if( sdr_params.state_cb ) sdr_params.state_cb( state, set );
+}
+
 /*****************************************************************************/
 
 /* SoapySDR_Close_Device()
@@ -79,7 +114,7 @@ static void SoapySDR_Close_Device(void) {
   int ret;
 
   /* Deactivate and close the stream */
-  ClearFlag( STATUS_SOAPYSDR_INIT );
+  SoapySDR_Set_State( SDR_STATE_INIT, false );
   if( (rxStream != NULL) && (sdr != NULL) )
   {
     ret = SoapySDRDevice_deactivateStream( sdr, rxStream, 0, 0 );
@@ -124,9 +159,11 @@ static void SoapySDR_Close_Device(void) {
   /* De-initialize Low Pass filter */
   Deinit_Chebyshev_Filter( &filter_data_i );
   Deinit_Chebyshev_Filter( &filter_data_q );
+  filter_data_i.samples_buf = NULL;
+  filter_data_q.samples_buf = NULL;
 
-  ClearFlag( STATUS_STREAMING );
-  Display_Icon( status_icon, "gtk-no" );
+  SoapySDR_Set_State( SDR_STATE_STREAMING, false );
+  atomic_store( &sdr_status, false );
 }
 
 /*****************************************************************************/
@@ -159,7 +196,7 @@ static void *SoapySDR_Stream(void *pid) {
 
   /* Loop around SoapySDRDevice_readStream()
    * till reception stopped by the user */
-  while( isFlagSet(STATUS_RECEIVING) )
+  while( sdr_params.running_cb() )
   {
     /* We need sdr_decimate summations to decimate samples */
     while( samp_buf_idx < sdr_buf_length )
@@ -242,14 +279,13 @@ static void *SoapySDR_Stream(void *pid) {
     int sval;
     sem_getvalue( &demod_semaphore, &sval );
     if( !sval ) sem_post( &demod_semaphore );
-  } /* while( isFlagSet(STATUS_RECEIVING) ) */
+  } /* while( sdr_params.running_cb() ) */
 
   /* Close device when streaming is stopped */
   SoapySDR_Close_Device();
 
-  /* Will de-initialize systems and free
-   * buffers only if (hopefully) its safe */
-  Cleanup();
+  /* Let the host de-initialize systems and free buffers */
+  if( sdr_params.closed_cb ) sdr_params.closed_cb();
 
   return( NULL );
 }
@@ -269,17 +305,17 @@ bool SoapySDR_Set_Center_Freq(uint32_t center_freq) {
     Show_Message( "Failed to set Center Frequency", "red" );
     Show_Message( SoapySDRDevice_lastError(), "red" );
     Error_Dialog();
-    Display_Icon( status_icon, "gtk-no" );
+    atomic_store( &sdr_status, false );
     return( false );
   }
 
   /* Display center frequency in messages */
-  gchar mesg[ MESG_SIZE ];
+  char mesg[ MESG_SIZE ];
   snprintf( mesg, sizeof(mesg),
       "Set SDR Frequency to %0.1fkHz",
       (double)center_freq / 1000.0 );
   Show_Message( mesg, "green" );
-  Display_Icon( status_icon, "gtk-yes" );
+  atomic_store( &sdr_status, true );
 
   return( true );
 }
@@ -290,17 +326,17 @@ bool SoapySDR_Set_Center_Freq(uint32_t center_freq) {
  *
  * Sets the Tuner Gain mode to Auto or Manual
  */
-void SoapySDR_Set_Tuner_Gain_Mode(void) {
+void SoapySDR_Set_Tuner_Gain_Mode(bool gain_auto, double gain) {
   int ret;
 
-  if( isFlagSet(TUNER_GAIN_AUTO) )
+  if( gain_auto )
   {
     /* Check for support of auto gain control */
     if( !SoapySDRDevice_hasGainMode(sdr, SOAPY_SDR_RX, 0) )
     {
       Show_Message( "Device has no Auto Gain Control", "red" );
       Error_Dialog();
-      Display_Icon( status_icon, "gtk-no" );
+      atomic_store( &sdr_status, false );
       return;
     }
 
@@ -312,7 +348,7 @@ void SoapySDR_Set_Tuner_Gain_Mode(void) {
       Show_Message( "Failed to Set Auto Gain Control", "red" );
       Show_Message( SoapySDRDevice_lastError(), "red" );
       Error_Dialog();
-      Display_Icon( status_icon, "gtk-no" );
+      atomic_store( &sdr_status, false );
       return;
     }
 
@@ -326,14 +362,14 @@ void SoapySDR_Set_Tuner_Gain_Mode(void) {
     {
       Show_Message( "Failed to Set Manual Gain Control", "red" );
       Show_Message( SoapySDRDevice_lastError(), "red" );
-      Display_Icon( status_icon, "gtk-no" );
+      atomic_store( &sdr_status, false );
       Error_Dialog();
       return;
     }
 
     Show_Message( "Set Manual Gain Control", "green" );
-    Display_Icon( status_icon, "gtk-yes" );
-    SoapySDR_Set_Tuner_Gain( rc_data.tuner_gain );
+    atomic_store( &sdr_status, true );
+    SoapySDR_Set_Tuner_Gain( gain );
   }
 }
 
@@ -344,7 +380,7 @@ void SoapySDR_Set_Tuner_Gain_Mode(void) {
  * Set the Tuner Gain if in Manual mode
  */
 void SoapySDR_Set_Tuner_Gain(double gain) {
-  gchar mesg[MESG_SIZE];
+  char mesg[MESG_SIZE];
 
   /* Get range of available gains */
   SoapySDRRange range =
@@ -361,13 +397,13 @@ void SoapySDR_Set_Tuner_Gain(double gain) {
   {
     Show_Message( "Failed to set Tuner Gain", "red" );
     Show_Message( SoapySDRDevice_lastError(), "red" );
-    Display_Icon( status_icon, "gtk-no" );
+    atomic_store( &sdr_status, false );
     return;
   }
   snprintf( mesg, sizeof(mesg),
       "Set Tuner Gain to %d dB", (int)gain );
   Show_Message( mesg, "green" );
-  Display_Icon( status_icon, "gtk-yes" );
+  atomic_store( &sdr_status, true );
 }
 
 /*****************************************************************************/
@@ -376,39 +412,50 @@ void SoapySDR_Set_Tuner_Gain(double gain) {
  *
  * Initialize SoapySDR by finding the specified SDR device,
  * instance it and setting up its working parameters */
-bool SoapySDR_Init(void) {
+bool SoapySDR_Init(const sdr_params_t *params) {
   int ret = 0;
   size_t length, key, idx, mreq;
-  gchar mesg[ MESG_SIZE ];
+  char mesg[ MESG_SIZE ];
   SoapySDRKwargs *results;
   SoapySDRRange *range;
 
   uint32_t temp;
 
   /* Abort if already init */
-  if( isFlagSet(STATUS_SOAPYSDR_INIT) )
+  if( atomic_load(&sdr_state) & SDR_STATE_INIT )
     return( true );
 
+  /* The streaming thread can not be stopped otherwise */
+  if( params->running_cb == NULL )
+  {
+    Show_Message( "No SDR streaming control given", "red" );
+    Error_Dialog();
+    return( false );
+  }
+
+  sdr_params = *params;
+  sem_init( &demod_semaphore, 0, 0 );
+
   /* Enumerate SDR devices, abort if no devices found */
   results = SoapySDRDevice_enumerate( NULL, &length );
   if( length == 0 )
   {
     Show_Message( "No SoapySDR Device found", "red" );
     Error_Dialog();
-    Display_Icon( status_icon, "gtk-no" );
+    atomic_store( &sdr_status, false );
     return( false );
   }
 
   /* Use SDR device specified by index alone
    * if "auto" driver name specified in config */
-  if (isFlagSet(AUTO_DETECT_SDR)) {
+  if (sdr_params.auto_detect) {
       Show_Message("Will use Auto-Detected SDR Device", "orange");
-      idx = rc_data.device_index;
+      idx = sdr_params.device_index;
   }
   else {
       /* Look for device matching specified driver */
       snprintf(mesg, sizeof(mesg),
-              "Searching for SDR Device \"%s\"", rc_data.device_driver);
+              "Searching for SDR Device \"%s\"", sdr_params.device_driver);
       Show_Message(mesg, "green");
 
       for (idx = 0; idx < length; idx++) {
@@ -418,14 +465,14 @@ bool SoapySDR_Init(void) {
 
               if (ret == 0) {
                   /* Match driver to one specified in config */
-                  ret = strcmp(results[idx].vals[key], rc_data.device_driver);
+                  ret = strcmp(results[idx].vals[key], sdr_params.device_driver);
 
-                  if ((ret == 0) && (idx == rc_data.device_index))
+                  if ((ret == 0) && (idx == sdr_params.device_index))
                       break;
               }
           }
 
-          if ((ret == 0) && (idx == rc_data.device_index))
+          if ((ret == 0) && (idx == sdr_params.device_index))
               break;
       }
 
@@ -433,30 +480,30 @@ bool SoapySDR_Init(void) {
       if (idx == length) {
           snprintf(mesg, sizeof(mesg),
                   "No Device: \"%s\"  Index: %u found",
-                  rc_data.device_driver, rc_data.device_index);
+                  sdr_params.device_driver, sdr_params.device_index);
           Show_Message(mesg, "red");
-          Display_Icon(status_icon, "gtk-no");
+          atomic_store( &sdr_status, false );
           Error_Dialog();
           return false;
       }
   }
 
   /* Find SDR driver name for auto detect case */
-  if (isFlagSet(AUTO_DETECT_SDR)) {
+  if (sdr_params.auto_detect) {
       for (key = 0; key < results[idx].size; key++) {
           /* Look for "driver" key */
           ret = strcmp(results[idx].keys[key], "driver");
 
           if (ret == 0)
-              Strlcpy(rc_data.device_driver, results[idx].vals[key],
-                      sizeof(rc_data.device_driver));
+              Strlcpy(sdr_params.device_driver, results[idx].vals[key],
+                      sizeof(sdr_params.device_driver));
       }
   }
 
   /* Report SoapySDR driver to be used */
   snprintf( mesg, sizeof(mesg),
       "Using Driver: \"%s\"  Device: %d",
-      rc_data.device_driver, (int)idx );
+      sdr_params.device_driver, (int)idx );
   Show_Message( mesg, "black" );
 
   /* Create device instance, abort on error */
@@ -465,7 +512,7 @@ bool SoapySDR_Init(void) {
   {
     Show_Message( "SoapySDRDevice_make() failed:", "red" );
     Show_Message( SoapySDRDevice_lastError(), "red" );
-    Display_Icon( status_icon, "gtk-no" );
+    atomic_store( &sdr_status, false );
     Error_Dialog();
     return( false );
   }
@@ -473,38 +520,36 @@ bool SoapySDR_Init(void) {
 
   /* Display Tuner Type */
   char *hrd = SoapySDRDevice_getHardwareKey( sdr );
-  GtkEntry *entry = GTK_ENTRY(
-      Builder_Get_Object(main_window_builder, "sdr_tuner_entry") );
-  gtk_entry_set_text( entry, hrd );
+  Strlcpy( sdr_hardware, hrd, sizeof(sdr_hardware) );
   snprintf( mesg, sizeof(mesg), "Instantiated SDR Device \"%s\"", hrd );
   Show_Message( mesg, "green" );
-  Display_Icon( status_icon, "gtk-yes" );
+  atomic_store( &sdr_status, true );
   free_ptr( (void **)&hrd );
 
   /* Set the Center Frequency of the RTL_SDR Device */
-  if( !SoapySDR_Set_Center_Freq( rc_data.sdr_center_freq ) )
+  if( !SoapySDR_Set_Center_Freq( sdr_params.center_freq ) )
     return( false );
 
   /* Set the Frequency Correction factor for the device */
   if( SoapySDRDevice_hasFrequencyCorrection(sdr, SOAPY_SDR_RX, 0) )
   {
     Show_Message( "Device has Frequency Correction", "black" );
-    if (rc_data.freq_correction != 0.0) {
+    if (sdr_params.freq_correction != 0.0) {
       ret = SoapySDRDevice_setFrequencyCorrection(
-          sdr, SOAPY_SDR_RX, 0, rc_data.freq_correction );
+          sdr, SOAPY_SDR_RX, 0, sdr_params.freq_correction );
       if( ret != SUCCESS )
       {
         Show_Message( "Failed to set Frequency Correction", "red" );
         Error_Dialog();
-        Display_Icon( status_icon, "gtk-no" );
+        atomic_store( &sdr_status, false );
         return( false );
       }
 
       snprintf( mesg, sizeof(mesg),
           "Set Frequency Correction to %.1lf ppm",
-          rc_data.freq_correction );
+          sdr_params.freq_correction );
       Show_Message( mesg, "green" );
-      Display_Icon( status_icon, "gtk-yes" );
+      atomic_store( &sdr_status, true );
     }
   }
 
@@ -519,9 +564,9 @@ bool SoapySDR_Init(void) {
   /* This is the minimum prefered value for the demodulator
    * effective sample rate. It could have been 2 * symbol_rate
    * but this can result in unfavorable sampling rates */
-  temp = 4 * rc_data.symbol_rate;
+  temp = 4 * sdr_params.symbol_rate;
   snprintf( mesg, sizeof(mesg),
-      "QPSK Symbol Rate: %u Sy/s", rc_data.symbol_rate );
+      "QPSK Symbol Rate: %u Sy/s", sdr_params.symbol_rate );
   Show_Message( mesg, "green" );
 
   /* Select lowest sampling rate above minimum demod sampling rate */
@@ -548,7 +593,7 @@ bool SoapySDR_Init(void) {
   {
     Show_Message( "Failed to set ADC Sample Rate", "red" );
     Show_Message( SoapySDRDevice_lastError(), "red" );
-    Display_Icon( status_icon, "gtk-no" );
+    atomic_store( &sdr_status, false );
     Error_Dialog();
     return( false );
   }
@@ -589,7 +634,7 @@ bool SoapySDR_Init(void) {
   Show_Message( mesg, "green" );
 
   /* Set Tuner Gain Mode to auto or manual as per config file */
-  SoapySDR_Set_Tuner_Gain_Mode();
+  SoapySDR_Set_Tuner_Gain_Mode( sdr_params.gain_auto, sdr_params.tuner_gain );
 
   /* Set up receiving stream */
   Show_Message( "Setting up Receive Stream", "black" );
@@ -600,7 +645,7 @@ bool SoapySDR_Init(void) {
     Show_Message( "Failed to set up Receive Stream", "red" );
     Show_Message( SoapySDRDevice_lastError(), "red" );
     Error_Dialog();
-    Display_Icon( status_icon, "gtk-no" );
+    atomic_store( &sdr_status, false );
     return( false );
   }
   Show_Message( "Receive Stream set up OK", "green" );
@@ -628,7 +673,7 @@ bool SoapySDR_Init(void) {
   Init_Chebyshev_Filter(
       &filter_data_i,
       sdr_buf_length,
-      rc_data.sdr_filter_bw,
+      sdr_params.filter_bw,
       demod_samplerate,
       FILTER_RIPPLE,
       FILTER_POLES,
@@ -637,23 +682,17 @@ bool SoapySDR_Init(void) {
   Init_Chebyshev_Filter(
       &filter_data_q,
       sdr_buf_length,
-      rc_data.sdr_filter_bw,
+      sdr_params.filter_bw,
       demod_samplerate,
       FILTER_RIPPLE,
       FILTER_POLES,
       FILTER_LOWPASS );
 
-  /* Initialize ifft. Waterfall with is an odd number
-   * to provide a center line. IFFT requires a width
-   * that is a power of 2 */
-  if( !Initialize_IFFT((int16_t)wfall_width + 1) )
-    return( false );
-
   /* Wait a little for things to settle and set init OK flag */
   sleep( 1 );
-  SetFlag( STATUS_SOAPYSDR_INIT );
+  SoapySDR_Set_State( SDR_STATE_INIT, true );
   Show_Message( "SoapySDR Initialized OK", "green" );
-  Display_Icon( status_icon, "gtk-yes" );
+  atomic_store( &sdr_status, true );
 
   return( true );
 }
@@ -674,9 +713,9 @@ bool SoapySDR_Activate_Stream(void) {
   {
     Show_Message( "Failed to create Streaming thread", "red" );
     Show_Message( SoapySDRDevice_lastError(), "red" );
-    ClearFlag( STATUS_SOAPYSDR_INIT );
+    SoapySDR_Set_State( SDR_STATE_INIT, false );
     Error_Dialog();
-    Display_Icon( status_icon, "gtk-no" );
+    atomic_store( &sdr_status, false );
     return( false );
   }
 
@@ -687,12 +726,79 @@ bool SoapySDR_Activate_Stream(void) {
     Show_Message( "Failed to activate Receive Stream", "red" );
     Show_Message( SoapySDRDevice_lastError(), "red" );
     Error_Dialog();
-    Display_Icon( status_icon, "gtk-no" );
+    atomic_store( &sdr_status, false );
     return( false );
   }
   Show_Message( "Receive Stream activated OK", "green" );
-  SetFlag( STATUS_STREAMING );
-  Display_Icon( status_icon, "gtk-yes" );
+  SoapySDR_Set_State( SDR_STATE_STREAMING, true );
+  atomic_store( &sdr_status, true );
 
   return( true );
 }
+
+/*****************************************************************************/
+
+/* SoapySDR_Wait_Samples()
+ *
+ * Waits for the streaming thread to deliver a new buffer of
+ * samples, low-pass filters them and returns their number
+ */
+uint32_t SoapySDR_Wait_Samples(double **samples_i, double **samples_q) {
+  /* Wait on DSP data to be ready for processing */
+  sem_wait( &demod_semaphore );
+
+  /* Nothing yet or device already closed */
+  if( (filter_data_i.samples_buf == NULL) || (filter_data_i.a == NULL) )
+    return( 0 );
+
+  /* Filter samples from SDR receiver */
+  DSP_Filter( &filter_data_i );
+  DSP_Filter( &filter_data_q );
+
+  *samples_i = filter_data_i.samples_buf;
+  *samples_q = filter_data_q.samples_buf;
+
+  return( filter_data_i.samples_buf_len );
+}
+
+/*****************************************************************************/
+
+/* SoapySDR_Wakeup()
+ *
+ * Unblocks SoapySDR_Wait_Samples(), e.g. if the SDR has stalled.
+ * Async-signal-safe, so it can be used in signal handlers
+ */
+void SoapySDR_Wakeup(void) {
+  sem_post( &demod_semaphore );
+}
+
+/*****************************************************************************/
+
+/* SoapySDR_Status()
+ *
+ * Returns the status (success or failure) of the last SDR
+ * operation, for a status indicator. Safe from any thread
+ */
+bool SoapySDR_Status(void) {
+  return( atomic_load(&sdr_status) );
+}
+
+/*****************************************************************************/
+
+/* SoapySDR_Hardware()
+ *
+ * Returns the hardware name of the instantiated SDR tuner
+ */
+const char *SoapySDR_Hardware(void) {
+  return( sdr_hardware );
+}
+
+/*****************************************************************************/
+
+/* SoapySDR_Driver()
+ *
+ * Returns the driver name of the SDR device in use
+ */
+const char *SoapySDR_Driver(void) {
+  return( sdr_params.device_driver );
+}
@@ -19,20 +19,71 @@
 
 /*****************************************************************************/
 
+#include "../common/common.h"
+
 #include <stdbool.h>
 #include <stdint.h>
 
 /*****************************************************************************/
 
+/* Max length of SoapySDR driver names */
+#define SDR_DRIVER_LEN  80
+
+/* Device states reported to the host by state_cb() */
+#define SDR_STATE_INIT          0x01 /* Device set up          */
+#define SDR_STATE_STREAMING     0x02 /* Receive stream active  */
+
+/*****************************************************************************/
+
+/* SDR device and receiver parameters, copied at init */
+typedef struct sdr_params_t {
+    /* SoapySDR device driver and index, driver is
+     * ignored and found from the index if auto_detect */
+    char     device_driver[SDR_DRIVER_LEN + 1];
+    uint8_t  device_index;
+    bool     auto_detect;
+
+    /* RX frequency (Hz), frequency correction factor (ppm) */
+    uint32_t center_freq;
+    double   freq_correction;
+
+    /* QPSK symbol rate, sets the demodulator sampling rate */
+    uint32_t symbol_rate;
+
+    /* I/Q low-pass filter bandwidth (Hz) */
+    uint32_t filter_bw;
+
+    /* Auto or manual gain (0-100) */
+    bool     gain_auto;
+    double   tuner_gain;
+
+    /* The streaming thread reads samples while running_cb() returns
+     * true, then closes the device. Must be set */
+    bool (*running_cb)(void);
+
+    /* Called when a device state (SDR_STATE_*) is set or cleared */
+    void (*state_cb)(uint32_t state, bool set);
+
+    /* Called by the streaming thread after it closed the device */
+    void (*closed_cb)(void);
+} sdr_params_t;
+
+/*****************************************************************************/
+
 extern double demod_samplerate;
 
 /*****************************************************************************/
 
 bool SoapySDR_Set_Center_Freq(uint32_t center_freq);
-void SoapySDR_Set_Tuner_Gain_Mode(void);
+void SoapySDR_Set_Tuner_Gain_Mode(bool gain_auto, double gain);
 void SoapySDR_Set_Tuner_Gain(double gain);
-bool SoapySDR_Init(void);
+bool SoapySDR_Init(const sdr_params_t *params);
 bool SoapySDR_Activate_Stream(void);
+uint32_t SoapySDR_Wait_Samples(double **samples_i, double **samples_q);
+void SoapySDR_Wakeup(void);
+bool SoapySDR_Status(void);
+const char *SoapySDR_Hardware(void);
+const char *SoapySDR_Driver(void);
 
 /*****************************************************************************/
 
@@ -17,7 +17,6 @@
 #include "filters.h"
 
 #include "../common/common.h"
-#include "../common/shared.h"
 #include "../glrpt/utils.h"
 
 #include <math.h>
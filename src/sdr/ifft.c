@@ -50,9 +50,6 @@
 
 #include "ifft.h"
 
-#include "../common/shared.h"
-#include "../glrpt/callback_func.h"
-#include "../glrpt/display.h"
 #include "../glrpt/utils.h"
 
 #include <math.h>
@@ -72,6 +69,9 @@ static int16_t
 static int16_t *Sinewave = NULL;
 static char ifft_init = 0;
 
+/* Length of IFFT data, interleaved I/Q so 2 * ifft_width */
+static uint16_t ifft_data_length = 0;
+
 /*****************************************************************************/
 
 /* Initialize_IFFT()
@@ -104,10 +104,6 @@ bool Initialize_IFFT(int16_t width) {
     ifft_width = width;
     ifft_data_length = 2 * (uint16_t)ifft_width;
 
-    /* Allocate the IFFT input data buffer */
-    mreq = (size_t)ifft_data_length * sizeof( uint16_t );
-    mem_alloc((void **)&ifft_data, mreq );
-
     /* Allocate the Sine Wave table. This is twice the
      * length needed in IFFT() as it is also used in
      * IFFT_Real() which requires twice the resolution */
@@ -138,8 +134,8 @@ bool Initialize_IFFT(int16_t width) {
  */
 void Deinit_Ifft(void) {
   free_ptr( (void **)&Sinewave );
-  free_ptr( (void **)&ifft_data );
   ifft_width = 0;
+  ifft_data_length = 0;
 }
 
 /*****************************************************************************/
@@ -0,0 +1,438 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * Spectrum (waterfall) worker. The demodulator only hands over
+ * its filtered samples through a lossy tap, which is armed by
+ * the worker when it wants a new frame and is ignored otherwise.
+ * The worker runs at idle scheduling priority, averages a number
+ * of overlapping windowed FFTs (Welch's method) and hands each
+ * finished row of bin levels to the GUI by a callback. Frames are
+ * simply dropped if either the worker or the GUI can not keep up.
+ */
+
+/*****************************************************************************/
+
+#define _GNU_SOURCE /* For SCHED_IDLE */
+
+#include "spectrum.h"
+
+#include "../common/common.h"
+#include "../glrpt/utils.h"
+#include "ifft.h"
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/*****************************************************************************/
+
+/* Decimation of demodulator samples fed to the FFT */
+#define IFFT_DECIMATE   2
+
+#define NSEC_PER_SEC    1000000000L
+
+/*****************************************************************************/
+
+static void Spectrum_Resize(int16_t width);
+static void Spectrum_Welch(void);
+static void Spectrum_Make_Row(void);
+static void *Spectrum_Worker(void *arg);
+
+/*****************************************************************************/
+
+/* FFT width requested by the waterfall and width in use by the worker */
+static atomic_short req_width = 0;
+static int16_t fft_width = 0;
+
+/* Frame rate and number of Welch segments averaged per frame,
+ * requested by Spectrum_Init() and in use by the worker */
+static uint32_t frame_rate = 0;
+static uint32_t req_segments = 0, num_segments = 0;
+
+/* Lossy tap buffers, filled by the demodulator when armed */
+static double  *tap_buf_i = NULL, *tap_buf_q = NULL;
+static uint32_t tap_len = 0, tap_idx = 0;
+static atomic_bool tap_armed = false;
+static sem_t tap_semaphore;
+
+/* Welch window and averaged power spectrum */
+static double *window = NULL, *psd = NULL;
+
+/* Interleaved I/Q fixed-point data of the IFFT */
+static int16_t *fft_data = NULL;
+
+/* Finished row of bin levels, handed over to the GUI */
+static uint8_t *row = NULL;
+static int  row_len = 0;
+static bool row_pending = false;
+static pthread_mutex_t row_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Called by the worker when a row is pending */
+static void (*row_ready)(void) = NULL;
+
+static pthread_t worker_id;
+static atomic_bool worker_running = false;
+
+/*****************************************************************************/
+
+/* Spectrum_Set_Width()
+ *
+ * Sets the FFT width (number of bins) of the waterfall.
+ * The new width is picked up by the worker on its next frame
+ */
+bool Spectrum_Set_Width(int16_t width) {
+  /* Abort if width is not a power of 2 */
+  if( (width <= 0) || (width & (width - 1)) )
+  {
+    Show_Message( "FFT size is not a power of 2", "red" );
+    Error_Dialog();
+    return( false );
+  }
+
+  atomic_store( &req_width, width );
+  return( true );
+}
+
+/*****************************************************************************/
+
+/* Spectrum_Resize()
+ *
+ * (Re)allocates worker buffers to match the requested
+ * FFT width and number of Welch segments. Only called
+ * by the worker while the tap is disarmed and with a
+ * valid (power of 2) width set by Spectrum_Set_Width()
+ */
+static void Spectrum_Resize(int16_t width) {
+  size_t mreq;
+  int idx;
+
+  fft_width    = width;
+  num_segments = req_segments;
+  Initialize_IFFT( fft_width );
+
+  /* Segments overlap by half their length */
+  tap_len  = (num_segments + 1) * (uint32_t)fft_width / 2;
+  tap_len *= IFFT_DECIMATE;
+
+  mreq = (size_t)tap_len * sizeof( double );
+  mem_realloc( (void **)&tap_buf_i, mreq );
+  mem_realloc( (void **)&tap_buf_q, mreq );
+
+  /* Hann window for the Welch segments */
+  mreq = (size_t)fft_width * sizeof( double );
+  mem_realloc( (void **)&window, mreq );
+  mem_realloc( (void **)&psd, mreq );
+  mreq = 2 * (size_t)fft_width * sizeof( int16_t );
+  mem_realloc( (void **)&fft_data, mreq );
+  for( idx = 0; idx < fft_width; idx++ )
+    window[idx] = 0.5 - 0.5 * cos( M_2PI * (double)idx / (double)fft_width );
+
+  /* Row of bin levels matches the waterfall width */
+  pthread_mutex_lock( &row_lock );
+  row_len = fft_width - 1;
+  mem_realloc( (void **)&row, (size_t)row_len );
+  row_pending = false;
+  pthread_mutex_unlock( &row_lock );
+}
+
+/*****************************************************************************/
+
+/* Spectrum_Welch()
+ *
+ * Decimates the tapped samples and averages the power
+ * spectrum of overlapping, windowed FFT segments
+ */
+static void Spectrum_Welch(void) {
+  uint32_t idx, dec_len, seg, start;
+  double sum_i, sum_q;
+  int bin, dat;
+
+  /* Decimate tapped samples in place */
+  dec_len = tap_len / IFFT_DECIMATE;
+  for( idx = 0; idx < dec_len; idx++ )
+  {
+    sum_i = 0.0;
+    sum_q = 0.0;
+    for( dat = 0; dat < IFFT_DECIMATE; dat++ )
+    {
+      sum_i += tap_buf_i[idx * IFFT_DECIMATE + (uint32_t)dat];
+      sum_q += tap_buf_q[idx * IFFT_DECIMATE + (uint32_t)dat];
+    }
+    tap_buf_i[idx] = sum_i;
+    tap_buf_q[idx] = sum_q;
+  }
+
+  memset( psd, 0, (size_t)fft_width * sizeof(double) );
+
+  /* Average power of each overlapping segment */
+  for( seg = 0; seg < num_segments; seg++ )
+  {
+    start = seg * (uint32_t)fft_width / 2;
+
+    dat = 0;
+    for( bin = 0; bin < fft_width; bin++ )
+    {
+      fft_data[dat++] = (int16_t)dClamp(
+          tap_buf_i[start + (uint32_t)bin] * window[bin], -32768.0, 32767.0 );
+      fft_data[dat++] = (int16_t)dClamp(
+          tap_buf_q[start + (uint32_t)bin] * window[bin], -32768.0, 32767.0 );
+    }
+
+    IFFT( fft_data );
+
+    dat = 0;
+    for( bin = 0; bin < fft_width; bin++ )
+    {
+      double re = (double)fft_data[dat++];
+      double im = (double)fft_data[dat++];
+      psd[bin] += re * re + im * im;
+    }
+  } /* for( seg = 0; seg < num_segments; seg++ ) */
+}
+
+/*****************************************************************************/
+
+/* Spectrum_Make_Row()
+ *
+ * Scales the averaged power spectrum to 0-255 bin levels
+ * and stores them in the row for the waterfall display.
+ * The frame is skipped if the GUI has not taken the last one
+ */
+static void Spectrum_Make_Row(void) {
+  double max = 1.0;
+  int bin, half, idx;
+
+  /* Auto level control by maximum bin value */
+  for( bin = 1; bin < fft_width; bin++ )
+    if( max < psd[bin] ) max = psd[bin];
+
+  pthread_mutex_lock( &row_lock );
+  if( row_pending )
+  {
+    pthread_mutex_unlock( &row_lock );
+    return;
+  }
+
+  /* IFFT produces an output of positive and negative
+   * frequencies and it output is handled accordingly */
+  half = fft_width / 2;
+  idx  = 0;
+
+  /* Do the "positive" frequencies */
+  for( bin = half; bin < fft_width; bin++ )
+    row[idx++] = (uint8_t)( 255.0 * psd[bin] / max );
+
+  /* Do the "negative" frequencies */
+  for( bin = 1; bin < half; bin++ )
+    row[idx++] = (uint8_t)( 255.0 * psd[bin] / max );
+
+  row_pending = true;
+  pthread_mutex_unlock( &row_lock );
+
+  if( row_ready ) row_ready();
+}
+
+/*****************************************************************************/
+
+/* Spectrum_Worker()
+ *
+ * Runs in a low priority thread of its own, computing
+ * one waterfall row per frame period from tapped samples
+ */
+static void *Spectrum_Worker(void *arg) {
+  struct timespec deadline, now;
+  long period;
+  int16_t width;
+
+  /* Worker state is all module static */
+  (void)arg;
+
+#ifdef SCHED_IDLE
+  /* Visualisation must never take cycles from the demodulator */
+  struct sched_param param = { .sched_priority = 0 };
+  pthread_setschedparam( pthread_self(), SCHED_IDLE, &param );
+#endif
+
+  period = NSEC_PER_SEC / (long)frame_rate;
+  clock_gettime( CLOCK_MONOTONIC, &deadline );
+
+  while( atomic_load(&worker_running) )
+  {
+    /* Idle till the waterfall width is set, Spectrum_Init()
+     * may be called before the waterfall is first sized */
+    width = atomic_load( &req_width );
+    if( width > 0 )
+    {
+      /* Pick up a changed waterfall width */
+      if( (width != fft_width) || (req_segments != num_segments) )
+        Spectrum_Resize( width );
+
+      /* Arm the tap and wait for it to fill up */
+      tap_idx = 0;
+      atomic_store_explicit( &tap_armed, true, memory_order_release );
+      while( (sem_wait(&tap_semaphore) == -1) && (errno == EINTR) );
+      if( !atomic_load(&worker_running) ) break;
+
+      Spectrum_Welch();
+      Spectrum_Make_Row();
+    }
+
+    /* Sleep till next frame is due. Missed frames are skipped */
+    deadline.tv_nsec += period;
+    while( deadline.tv_nsec >= NSEC_PER_SEC )
+    {
+      deadline.tv_nsec -= NSEC_PER_SEC;
+      deadline.tv_sec++;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    if( (now.tv_sec > deadline.tv_sec) ||
+        ((now.tv_sec == deadline.tv_sec) && (now.tv_nsec > deadline.tv_nsec)) )
+      deadline = now;
+    else
+      while( clock_nanosleep(CLOCK_MONOTONIC,
+            TIMER_ABSTIME, &deadline, NULL) == EINTR );
+  } /* while( atomic_load(&worker_running) ) */
+
+  return( NULL );
+}
+
+/*****************************************************************************/
+
+/* Spectrum_Init()
+ *
+ * Starts the spectrum worker thread, producing fps rows per second
+ * of averaging FFTs each. Callback row_ready, if not NULL, is
+ * called by the worker thread when a new row is pending
+ */
+bool Spectrum_Init(
+        uint32_t fps,
+        uint32_t averaging,
+        void (*row_ready_cb)(void)) {
+  if( atomic_load(&worker_running) )
+    return( true );
+
+  frame_rate   = fps ? fps : 1;
+  req_segments = averaging ? averaging : 1;
+  row_ready    = row_ready_cb;
+
+  sem_init( &tap_semaphore, 0, 0 );
+  atomic_store( &tap_armed, false );
+  atomic_store( &worker_running, true );
+
+  int ret = pthread_create( &worker_id, NULL, Spectrum_Worker, NULL );
+  if( ret != SUCCESS )
+  {
+    atomic_store( &worker_running, false );
+    sem_destroy( &tap_semaphore );
+    Show_Message( "Failed to create Spectrum thread", "red" );
+    return( false );
+  }
+
+  return( true );
+}
+
+/*****************************************************************************/
+
+/* Spectrum_Deinit()
+ *
+ * Stops the spectrum worker thread and frees buffers
+ */
+void Spectrum_Deinit(void) {
+  if( !atomic_load(&worker_running) )
+    return;
+
+  /* Disarm tap and wake up the worker */
+  atomic_store( &tap_armed, false );
+  atomic_store( &worker_running, false );
+  sem_post( &tap_semaphore );
+  pthread_join( worker_id, NULL );
+  sem_destroy( &tap_semaphore );
+
+  free_ptr( (void **)&tap_buf_i );
+  free_ptr( (void **)&tap_buf_q );
+  free_ptr( (void **)&window );
+  free_ptr( (void **)&psd );
+  free_ptr( (void **)&fft_data );
+  Deinit_Ifft();
+  fft_width    = 0;
+  num_segments = 0;
+
+  pthread_mutex_lock( &row_lock );
+  free_ptr( (void **)&row );
+  row_len     = 0;
+  row_pending = false;
+  pthread_mutex_unlock( &row_lock );
+}
+
+/*****************************************************************************/
+
+/* Spectrum_Tap()
+ *
+ * Lossy tap of demodulator samples. Copies samples only
+ * while the worker is waiting for a frame, else it returns
+ */
+void Spectrum_Tap(const double *buf_i, const double *buf_q, uint32_t len) {
+  uint32_t cnt;
+
+  if( !atomic_load_explicit(&tap_armed, memory_order_acquire) )
+    return;
+
+  cnt = tap_len - tap_idx;
+  if( cnt > len ) cnt = len;
+  memcpy( tap_buf_i + tap_idx, buf_i, (size_t)cnt * sizeof(double) );
+  memcpy( tap_buf_q + tap_idx, buf_q, (size_t)cnt * sizeof(double) );
+  tap_idx += cnt;
+
+  /* Hand over to the worker */
+  if( tap_idx >= tap_len )
+  {
+    atomic_store_explicit( &tap_armed, false, memory_order_release );
+    sem_post( &tap_semaphore );
+  }
+}
+
+/*****************************************************************************/
+
+/* Spectrum_Row_Lock()
+ *
+ * Returns the pending row of bin levels and its length, or NULL
+ * if there is none. Must be followed by Spectrum_Row_Unlock()
+ */
+uint8_t *Spectrum_Row_Lock(int *len) {
+  pthread_mutex_lock( &row_lock );
+  *len = row_len;
+  if( !row_pending ) return( NULL );
+  return( row );
+}
+
+/*****************************************************************************/
+
+/* Spectrum_Row_Unlock()
+ *
+ * Releases the row so the worker can fill in the next frame
+ */
+void Spectrum_Row_Unlock(void) {
+  row_pending = false;
+  pthread_mutex_unlock( &row_lock );
+}
@@ -0,0 +1,39 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*****************************************************************************/
+
+#ifndef SDR_SPECTRUM_H
+#define SDR_SPECTRUM_H
+
+/*****************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*****************************************************************************/
+
+bool Spectrum_Set_Width(int16_t width);
+bool Spectrum_Init(
+        uint32_t fps,
+        uint32_t averaging,
+        void (*row_ready_cb)(void));
+void Spectrum_Deinit(void);
+void Spectrum_Tap(const double *buf_i, const double *buf_q, uint32_t len);
+uint8_t *Spectrum_Row_Lock(int *len);
+void Spectrum_Row_Unlock(void);
+
+/*****************************************************************************/
+
+#endif
@@ -0,0 +1,112 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*****************************************************************************/
+
+#include "awgn.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/* Code rate of the convolutional code */
+#define CODE_RATE   0.5
+
+/*****************************************************************************/
+
+/* Awgn_Init()
+ *
+ * Seeds the noise source, equal seeds give equal noise
+ */
+void Awgn_Init(awgn_t *self, uint32_t seed) {
+    self->state = 0x9E3779B97F4A7C15ULL ^ seed;
+    self->have_spare = false;
+
+    /* Discard the first outputs, they are poorly mixed */
+    for (int i = 0; i < 8; i++)
+        Awgn_Uniform(self);
+}
+
+/*****************************************************************************/
+
+/* Awgn_Uniform()
+ *
+ * Returns uniformly distributed 32 bit numbers (xorshift64*)
+ */
+uint32_t Awgn_Uniform(awgn_t *self) {
+    self->state ^= self->state >> 12;
+    self->state ^= self->state << 25;
+    self->state ^= self->state >> 27;
+
+    return (uint32_t)((self->state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+/*****************************************************************************/
+
+/* Awgn_Gauss()
+ *
+ * Returns normally distributed numbers of unit variance (Box-Muller)
+ */
+double Awgn_Gauss(awgn_t *self) {
+    if (self->have_spare) {
+        self->have_spare = false;
+        return self->spare;
+    }
+
+    /* u1 is in (0, 1] so that its log is finite */
+    double u1 = ((double)Awgn_Uniform(self) + 1.0) / 4294967296.0;
+    double u2 = (double)Awgn_Uniform(self) / 4294967296.0;
+    double r  = sqrt(-2.0 * log(u1));
+
+    self->spare = r * sin(2.0 * M_PI * u2);
+    self->have_spare = true;
+
+    return r * cos(2.0 * M_PI * u2);
+}
+
+/*****************************************************************************/
+
+/* Awgn_Soft_Sigma()
+ *
+ * Returns the noise deviation of soft symbols of amplitude ampl
+ * for a given Eb/N0 (dB) of the information bits, each soft
+ * symbol being a coded bit of energy Eb * CODE_RATE
+ */
+double Awgn_Soft_Sigma(double ebn0, double ampl) {
+    double ecn0 = CODE_RATE * pow(10.0, ebn0 / 10.0);
+
+    return ampl / sqrt(2.0 * ecn0);
+}
+
+/*****************************************************************************/
+
+/* Awgn_Soft()
+ *
+ * Adds noise of deviation sigma to soft symbols, clamping to int8
+ */
+void Awgn_Soft(awgn_t *self, int8_t *soft, size_t len, double sigma) {
+    for (size_t i = 0; i < len; i++) {
+        double x = round((double)soft[i] + sigma * Awgn_Gauss(self));
+
+        if (x > 127.0)
+            x = 127.0;
+        else if (x < -127.0)
+            x = -127.0;
+
+        soft[i] = (int8_t)x;
+    }
+}
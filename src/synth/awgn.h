@@ -14,38 +14,33 @@
 
 /*****************************************************************************/
 
-#ifndef GLRPT_IMAGE_H
-#define GLRPT_IMAGE_H
+#ifndef SYNTH_AWGN_H
+#define SYNTH_AWGN_H
 
 /*****************************************************************************/
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /*****************************************************************************/
 
-/* Normalized black value */
-#define NORM_BLACK  0
+/* Reproducible noise source */
+typedef struct awgn_t {
+    uint64_t state;
 
-/* Min and max values required in histogram normalization to leave behind
- * occasional black bands in images
- */
-#define MIN_BLACK   2
-#define MAX_WHITE   255
-
-/* TODO seems like unused */
-/* Minimum black value in blue APID image */
-#define BLUE_MIN_BLACK  64
+    /* Second value of the last Box-Muller pair */
+    double spare;
+    bool   have_spare;
+} awgn_t;
 
 /*****************************************************************************/
 
-void Normalize_Image(
-        uint8_t *image_buffer,
-        uint32_t image_size,
-        uint8_t range_low,
-        uint8_t range_high);
-void Flip_Image(uint8_t *image_buffer, uint32_t image_size);
-void Display_Scaled_Image(uint8_t *chan_image[], uint32_t apid, int current_y);
-void Create_Combo_Image(uint8_t *combo_image);
+void Awgn_Init(awgn_t *self, uint32_t seed);
+uint32_t Awgn_Uniform(awgn_t *self);
+double Awgn_Gauss(awgn_t *self);
+double Awgn_Soft_Sigma(double ebn0, double ampl);
+void Awgn_Soft(awgn_t *self, int8_t *soft, size_t len, double sigma);
 
 /*****************************************************************************/
 
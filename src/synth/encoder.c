@@ -0,0 +1,637 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*****************************************************************************/
+
+/*
+ * LRPT transmitter side of the decoder: JPEG compressed test pattern
+ * images in CCSDS source packets, multiplexed into VCDUs, Reed-Solomon
+ * coded, randomized, prefixed with the sync marker and convolutionally
+ * coded into soft symbols, in the layout the decoder expects
+ */
+
+/*****************************************************************************/
+
+#include "encoder.h"
+
+#include "../common/common.h"
+#include "../decoder/bitop.h"
+#include "../decoder/ecc.h"
+#include "../decoder/met_to_data.h"
+#include "../decoder/viterbi27.h"
+#include "../glrpt/utils.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*****************************************************************************/
+
+/* VCDU data length (4 interleaved RS codewords), header and packet zone */
+#define VCDU_LEN            892
+#define VCDU_HDR_LEN        10
+#define VCDU_ZONE_LEN       (VCDU_LEN - VCDU_HDR_LEN)
+
+/* Version and virtual channel of image VCDUs */
+#define VCDU_VERSION        0x40
+#define VCDU_VCID           5
+
+/* First header pointer of a VCDU without a packet start */
+#define FHP_NONE            0x07FF
+
+/* RS interleave depth and codeword lengths */
+#define RS_DEPTH            4
+#define RS_BLOCK_LEN        255
+#define RS_DATA_LEN         223
+
+/* Source packet primary, time and image headers */
+#define PCK_HDR_LEN         6
+#define PCK_TIME_LEN        8
+#define PCK_IMAGE_HDR_LEN   6
+#define PCK_DATA_OFF        (PCK_HDR_LEN + PCK_TIME_LEN)
+#define PCK_CNT_MASK        0x3FFF
+
+/* Telemetry APID, carries the onboard time */
+#define APID_TELEMETRY      70
+#define TELEMETRY_LEN       32
+
+/* MCUs per packet and packets per strip: 14 of each
+ * image channel followed by a telemetry packet */
+#define MCU_PER_PACKET      14
+#define MCU_PER_LINE        (METEOR_IMAGE_WIDTH / 8)
+#define IMAGE_PACKETS       (CHANNEL_IMAGE_NUM * MCU_PER_LINE / MCU_PER_PACKET)
+#define STRIP_PACKETS       (IMAGE_PACKETS + 1)
+
+/* Largest magnitude categories of DC differences and AC values */
+#define DC_CAT_MAX          11
+#define AC_CAT_MAX          10
+
+/*****************************************************************************/
+
+/* Huffman code of a JPEG symbol */
+typedef struct huff_code_t {
+    uint16_t code;
+    uint8_t  len;
+} huff_code_t;
+
+/* MSB first bit writer with a size limit */
+typedef struct bit_writer_t {
+    uint8_t *p;
+    size_t pos, max_bits;
+    bool overflow;
+} bit_writer_t;
+
+/*****************************************************************************/
+
+static void Make_Huff_Codes(
+        const uint8_t *bits,
+        const uint8_t *vals,
+        int num_vals,
+        huff_code_t *codes);
+static void Synth_Make_Tables(void);
+static void Fill_Dqt_by_Q(int *dqt, int q);
+static void Fdct_8x8(const double *in, double *out);
+static void Put_Bits(bit_writer_t *w, uint32_t bits, int len);
+static int Value_Category(int value);
+static void Put_Value(bit_writer_t *w, int value, int cat);
+static void Make_Strip(synth_encoder_t *self);
+static void Next_Packet(synth_encoder_t *self);
+
+/*****************************************************************************/
+
+/* CCSDS attached sync marker */
+static const uint8_t sync_marker[4] = { 0x1A, 0xCF, 0xFC, 0x1D };
+
+static const uint8_t standard_quantization_table[64] = {
+    16,  11,  10,  16,  24,  40,  51,  61,
+    12,  12,  14,  19,  26,  58,  60,  55,
+    14,  13,  16,  24,  40,  57,  69,  56,
+    14,  17,  22,  29,  51,  87,  80,  62,
+    18,  22,  37,  56,  68, 109, 103,  77,
+    24,  35,  55,  64,  81, 104, 113,  92,
+    49,  64,  78,  87, 103, 121, 120, 101,
+    72,  92,  95,  98, 112, 100, 103,  99
+};
+
+static const uint8_t zigzag[64] = {
+    0,  1,  5,  6, 14, 15, 27, 28,
+    2,  4,  7, 13, 16, 26, 29, 42,
+    3,  8, 12, 17, 25, 30, 41, 43,
+    9, 11, 18, 24, 31, 40, 44, 53,
+    10, 19, 23, 32, 39, 45, 52, 54,
+    20, 22, 33, 38, 46, 51, 55, 60,
+    21, 34, 37, 47, 50, 56, 59, 61,
+    35, 36, 48, 49, 57, 58, 62, 63
+};
+
+/* Standard luminance Huffman tables (JPEG Annex K.3),
+ * number of codes of each length and the symbols */
+static const uint8_t dc_bits[16] = {
+    0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0
+};
+
+static const uint8_t dc_vals[12] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11
+};
+
+static const uint8_t ac_bits[16] = {
+    0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 125
+};
+
+static const uint8_t ac_vals[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12,
+    0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08,
+    0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16,
+    0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+    0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+    0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+    0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98,
+    0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6,
+    0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4,
+    0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea,
+    0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+/*****************************************************************************/
+
+/* Encoder tables, shared by all encoders and built once */
+static huff_code_t dc_codes[DC_CAT_MAX + 1];
+static huff_code_t ac_codes[256];
+static double dct_cos[8][8];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+/*****************************************************************************/
+
+/* Make_Huff_Codes()
+ *
+ * Assigns the canonical Huffman codes of a table to its symbols
+ */
+static void Make_Huff_Codes(
+        const uint8_t *bits,
+        const uint8_t *vals,
+        int num_vals,
+        huff_code_t *codes) {
+    uint16_t code = 0;
+    int p = 0;
+
+    for (uint8_t len = 1; len <= 16; len++) {
+        for (int i = 0; (i < bits[len - 1]) && (p < num_vals); i++) {
+            codes[vals[p++]] = (huff_code_t){ code, len };
+            code++;
+        }
+
+        code <<= 1;
+    }
+}
+
+/*****************************************************************************/
+
+/* Synth_Make_Tables()
+ *
+ * Builds the Huffman codes and the DCT cosine table
+ */
+static void Synth_Make_Tables(void) {
+    Make_Huff_Codes(dc_bits, dc_vals, sizeof(dc_vals), dc_codes);
+    Make_Huff_Codes(ac_bits, ac_vals, sizeof(ac_vals), ac_codes);
+
+    for (int x = 0; x < 8; x++)
+        for (int u = 0; u < 8; u++)
+            dct_cos[x][u] = cos(M_PI / 16.0 * (2.0 * x + 1.0) * u);
+}
+
+/*****************************************************************************/
+
+/* Fill_Dqt_by_Q()
+ *
+ * Scales the standard quantization table by the quality factor,
+ * the same way as the decoder does
+ */
+static void Fill_Dqt_by_Q(int *dqt, int q) {
+    double f;
+
+    if ((q > 20) && (q < 50))
+        f = 5000.0 / (double)q;
+    else
+        f = 200.0 - 2.0 * (double)q;
+
+    for (int i = 0; i < 64; i++) {
+        dqt[i] = (int)round(f / 100.0 * (double)standard_quantization_table[i]);
+
+        if (dqt[i] < 1)
+            dqt[i] = 1;
+    }
+}
+
+/*****************************************************************************/
+
+/* Fdct_8x8()
+ *
+ * Forward DCT of a block, the inverse of Flt_Idct_8x8()
+ */
+static void Fdct_8x8(const double *in, double *out) {
+    double tmp[64];
+
+    /* Rows */
+    for (int y = 0; y < 8; y++)
+        for (int u = 0; u < 8; u++) {
+            double s = 0.0;
+
+            for (int x = 0; x < 8; x++)
+                s += in[y * 8 + x] * dct_cos[x][u];
+
+            tmp[y * 8 + u] = s;
+        }
+
+    /* Columns */
+    for (int v = 0; v < 8; v++)
+        for (int u = 0; u < 8; u++) {
+            double s = 0.0;
+
+            for (int y = 0; y < 8; y++)
+                s += tmp[y * 8 + u] * dct_cos[y][v];
+
+            if (u == 0)
+                s *= M_SQRT1_2;
+            if (v == 0)
+                s *= M_SQRT1_2;
+
+            out[v * 8 + u] = s / 4.0;
+        }
+}
+
+/*****************************************************************************/
+
+/* Put_Bits()
+ *
+ * Appends the len low bits of bits, MSB first
+ */
+static void Put_Bits(bit_writer_t *w, uint32_t bits, int len) {
+    if (w->pos + (size_t)len > w->max_bits) {
+        w->overflow = true;
+        return;
+    }
+
+    for (int i = len - 1; i >= 0; i--) {
+        if ((bits >> i) & 1)
+            w->p[w->pos >> 3] |= (uint8_t)(0x80 >> (w->pos & 7));
+
+        w->pos++;
+    }
+}
+
+/*****************************************************************************/
+
+/* Value_Category()
+ *
+ * Returns the JPEG magnitude category of a value
+ */
+static int Value_Category(int value) {
+    int cat = 0;
+
+    if (value < 0)
+        value = -value;
+
+    while (value) {
+        cat++;
+        value >>= 1;
+    }
+
+    return cat;
+}
+
+/*****************************************************************************/
+
+/* Put_Value()
+ *
+ * Appends the magnitude bits of a value, see Map_Range()
+ */
+static void Put_Value(bit_writer_t *w, int value, int cat) {
+    if (value < 0)
+        value += (1 << cat) - 1;
+
+    Put_Bits(w, (uint32_t)value, cat);
+}
+
+/*****************************************************************************/
+
+/* Synth_Encoder_Init()
+ *
+ * Creates an encoder that starts at the top of the test pattern
+ */
+synth_encoder_t *Synth_Encoder_Init(const synth_encoder_params_t *params) {
+    synth_encoder_t *self = NULL;
+
+    pthread_once(&tables_once, Synth_Make_Tables);
+
+    mem_alloc((void **)&self, sizeof(synth_encoder_t));
+    self->params = *params;
+
+    return self;
+}
+
+/*****************************************************************************/
+
+/* Synth_Encoder_Deinit()
+ *
+ * Frees an encoder
+ */
+void Synth_Encoder_Deinit(synth_encoder_t *self) {
+    free_ptr((void **)&self);
+}
+
+/*****************************************************************************/
+
+/* Synth_Pattern()
+ *
+ * Returns a pixel of the test pattern of an image channel: a
+ * horizontal gradient, diagonal stripes and a checkerboard
+ */
+uint8_t Synth_Pattern(int chn, uint32_t x, uint32_t y) {
+    switch (chn) {
+        case RED:
+            return (uint8_t)(x * 255 / (METEOR_IMAGE_WIDTH - 1));
+
+        case GREEN:
+            return (uint8_t)(((x + y) / 2) & 0xFF);
+
+        default:
+            return (((x / 64) ^ (y / 64)) & 1) ? 192 : 64;
+    }
+}
+
+/*****************************************************************************/
+
+/* Synth_Encode_Mcus()
+ *
+ * JPEG compresses the 14 MCUs of an image packet starting at mcu_id
+ * from a strip of 8 image lines, the way Mj_Dec_Mcus() decodes them.
+ * Returns the length of the compressed data or 0 if it exceeds max_len
+ */
+size_t Synth_Encode_Mcus(
+        const uint8_t *strip,
+        int mcu_id,
+        uint8_t quality,
+        uint8_t *out,
+        size_t max_len) {
+    bit_writer_t w = { out, 0, max_len * 8, false };
+    double block[64], coeff[64];
+    int dqt[64], zz[64];
+    int prev_dc = 0;
+
+    pthread_once(&tables_once, Synth_Make_Tables);
+
+    memset(out, 0, max_len);
+    Fill_Dqt_by_Q(dqt, quality);
+
+    for (int m = 0; m < MCU_PER_PACKET; m++) {
+        const uint8_t *pix = &strip[(mcu_id + m) * 8];
+
+        for (int y = 0; y < 8; y++)
+            for (int x = 0; x < 8; x++)
+                block[y * 8 + x] =
+                    (double)pix[y * METEOR_IMAGE_WIDTH + x] - 128.0;
+
+        Fdct_8x8(block, coeff);
+
+        /* Quantize in zigzag order */
+        for (int i = 0; i < 64; i++)
+            zz[zigzag[i]] = (int)round(coeff[i] / (double)dqt[i]);
+
+        /* DC difference to the previous MCU of the packet */
+        int diff = zz[0] - prev_dc;
+        int lim  = (1 << DC_CAT_MAX) - 1;
+
+        if (diff > lim)
+            diff = lim;
+        else if (diff < -lim)
+            diff = -lim;
+
+        prev_dc += diff;
+
+        int cat = Value_Category(diff);
+        Put_Bits(&w, dc_codes[cat].code, dc_codes[cat].len);
+        Put_Value(&w, diff, cat);
+
+        /* AC values, as runs of zeros and values */
+        int run = 0;
+        for (int k = 1; k < 64; k++) {
+            int value = zz[k];
+
+            if (value == 0) {
+                run++;
+                continue;
+            }
+
+            lim = (1 << AC_CAT_MAX) - 1;
+            if (value > lim)
+                value = lim;
+            else if (value < -lim)
+                value = -lim;
+
+            /* Runs of 16 zeros */
+            while (run > 15) {
+                Put_Bits(&w, ac_codes[0xF0].code, ac_codes[0xF0].len);
+                run -= 16;
+            }
+
+            cat = Value_Category(value);
+            huff_code_t c = ac_codes[(run << 4) | cat];
+            Put_Bits(&w, c.code, c.len);
+            Put_Value(&w, value, cat);
+            run = 0;
+        }
+
+        /* End of block */
+        if (run)
+            Put_Bits(&w, ac_codes[0x00].code, ac_codes[0x00].len);
+    }
+
+    if (w.overflow)
+        return 0;
+
+    return (w.pos + 7) / 8;
+}
+
+/*****************************************************************************/
+
+/* Make_Strip()
+ *
+ * Renders the test pattern of the current strip of all channels
+ */
+static void Make_Strip(synth_encoder_t *self) {
+    for (int chn = 0; chn < CHANNEL_IMAGE_NUM; chn++)
+        for (uint32_t y = 0; y < SYNTH_STRIP_LINES; y++)
+            for (uint32_t x = 0; x < METEOR_IMAGE_WIDTH; x++)
+                self->pixels[chn][y * METEOR_IMAGE_WIDTH + x] = Synth_Pattern(
+                        chn, x, self->strip * SYNTH_STRIP_LINES + y);
+}
+
+/*****************************************************************************/
+
+/* Next_Packet()
+ *
+ * Makes the next source packet of the strip. The packet counter
+ * runs over all APIDs, as the decoder derives image lines from it
+ */
+static void Next_Packet(synth_encoder_t *self) {
+    uint8_t *p = self->packet;
+    uint32_t apid;
+    size_t len;
+
+    if (self->strip_pck == 0)
+        Make_Strip(self);
+
+    memset(p, 0, PCK_DATA_OFF + PCK_IMAGE_HDR_LEN);
+
+    if (self->strip_pck < IMAGE_PACKETS) {
+        int chn = self->strip_pck / MCU_PER_PACKET;
+        int mcu_id = (self->strip_pck % MCU_PER_PACKET) * MCU_PER_PACKET;
+        uint8_t *img = &p[PCK_DATA_OFF];
+
+        apid = self->params.apid[chn];
+
+        /* MCU number, scan and segment headers and quality factor */
+        img[0] = (uint8_t)mcu_id;
+        img[3] = 0xFF;
+        img[4] = 0xF0;
+        img[5] = self->params.quality;
+
+        len = Synth_Encode_Mcus(self->pixels[chn], mcu_id,
+                self->params.quality, &img[PCK_IMAGE_HDR_LEN],
+                SYNTH_PACKET_MAX - PCK_DATA_OFF - PCK_IMAGE_HDR_LEN);
+        if (len == 0)
+            Show_Message("Image packet too large", "red");
+
+        len += PCK_DATA_OFF + PCK_IMAGE_HDR_LEN;
+    } else {
+        uint32_t sec = self->strip % 86400;
+        uint8_t *tlm = &p[PCK_DATA_OFF];
+
+        apid = APID_TELEMETRY;
+
+        /* Onboard time, a strip per second */
+        memset(tlm, 0, TELEMETRY_LEN);
+        tlm[8]  = (uint8_t)(sec / 3600);
+        tlm[9]  = (uint8_t)(sec / 60 % 60);
+        tlm[10] = (uint8_t)(sec % 60);
+
+        len = PCK_DATA_OFF + TELEMETRY_LEN;
+    }
+
+    /* Primary header: secondary header flag and APID, unsegmented
+     * packet and its counter, and the data length less one */
+    p[0] = (uint8_t)(0x08 | ((apid >> 8) & 0x07));
+    p[1] = (uint8_t)(apid & 0xFF);
+    p[2] = (uint8_t)(0xC0 | (self->pck_cnt >> 8));
+    p[3] = (uint8_t)(self->pck_cnt & 0xFF);
+    p[4] = (uint8_t)((len - PCK_HDR_LEN - 1) >> 8);
+    p[5] = (uint8_t)((len - PCK_HDR_LEN - 1) & 0xFF);
+
+    self->pck_len = len;
+    self->pck_off = 0;
+    self->pck_cnt = (self->pck_cnt + 1) & PCK_CNT_MASK;
+
+    if (++self->strip_pck == STRIP_PACKETS) {
+        self->strip_pck = 0;
+        self->strip++;
+    }
+}
+
+/*****************************************************************************/
+
+/* Synth_Cadu()
+ *
+ * Makes the next CADU: a VCDU filled with source packets, RS
+ * coded, randomized and prefixed with the sync marker
+ */
+void Synth_Cadu(synth_encoder_t *self, uint8_t *cadu) {
+    uint8_t vcdu[VCDU_LEN];
+    uint8_t block[RS_BLOCK_LEN];
+    uint16_t fhp = FHP_NONE;
+    size_t off = 0;
+
+    /* Primary header and the M_PDU header's first header pointer */
+    memset(vcdu, 0, VCDU_HDR_LEN);
+    vcdu[0] = VCDU_VERSION;
+    vcdu[1] = VCDU_VCID;
+    vcdu[2] = (uint8_t)(self->frame_cnt >> 16);
+    vcdu[3] = (uint8_t)(self->frame_cnt >> 8);
+    vcdu[4] = (uint8_t)(self->frame_cnt);
+    self->frame_cnt = (self->frame_cnt + 1) & 0xFFFFFF;
+
+    /* Packet zone, packets continue across VCDUs */
+    while (off < VCDU_ZONE_LEN) {
+        if (self->pck_off == self->pck_len)
+            Next_Packet(self);
+
+        if ((self->pck_off == 0) && (fhp == FHP_NONE))
+            fhp = (uint16_t)off;
+
+        size_t n = self->pck_len - self->pck_off;
+        if (n > VCDU_ZONE_LEN - off)
+            n = VCDU_ZONE_LEN - off;
+
+        memcpy(&vcdu[VCDU_HDR_LEN + off], &self->packet[self->pck_off], n);
+        self->pck_off += n;
+        off += n;
+    }
+
+    vcdu[8] = (uint8_t)(fhp >> 8);
+    vcdu[9] = (uint8_t)(fhp & 0xFF);
+
+    /* Interleaved RS codewords */
+    for (int j = 0; j < RS_DEPTH; j++) {
+        for (int i = 0; i < RS_DATA_LEN; i++)
+            block[i] = vcdu[i * RS_DEPTH + j];
+
+        Ecc_Encode(block, 0);
+        Ecc_Interleave(block, &cadu[4], j, RS_DEPTH);
+    }
+
+    Mtd_Randomize(&cadu[4], SYNTH_CADU_LEN - 4);
+    memcpy(cadu, sync_marker, sizeof(sync_marker));
+}
+
+/*****************************************************************************/
+
+/* Synth_Convolve()
+ *
+ * Rate 1/2, K=7 convolutional encoding of a CADU into soft symbols,
+ * a negative symbol being a 1. The encoder runs on across CADUs
+ */
+void Synth_Convolve(synth_encoder_t *self, const uint8_t *cadu, int8_t *soft) {
+    for (int i = 0; i < SYNTH_CADU_LEN * 8; i++) {
+        uint32_t bit = (cadu[i >> 3] >> (7 - (i & 7))) & 1;
+
+        self->conv_sh = ((self->conv_sh << 1) | bit) & 0x7F;
+
+        soft[2 * i] = (Bitop_CountBits(self->conv_sh & VITERBI27_POLYA) % 2) ?
+            -SYNTH_SOFT_AMPL : SYNTH_SOFT_AMPL;
+        soft[2 * i + 1] = (Bitop_CountBits(self->conv_sh & VITERBI27_POLYB) % 2) ?
+            -SYNTH_SOFT_AMPL : SYNTH_SOFT_AMPL;
+    }
+}
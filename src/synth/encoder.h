@@ -0,0 +1,92 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*****************************************************************************/
+
+#ifndef SYNTH_ENCODER_H
+#define SYNTH_ENCODER_H
+
+/*****************************************************************************/
+
+#include "../common/common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/* Length of a CADU (sync marker and RS coded VCDU) and its soft symbols */
+#define SYNTH_CADU_LEN      1024
+#define SYNTH_SOFT_LEN      (2 * 8 * SYNTH_CADU_LEN)
+
+/* Amplitude of noiseless soft symbols */
+#define SYNTH_SOFT_AMPL     64
+
+/* Maximum length of a source packet, the decoder's reassembly buffer */
+#define SYNTH_PACKET_MAX    2048
+
+/* Number of image lines in a strip of MCUs */
+#define SYNTH_STRIP_LINES   8
+
+/*****************************************************************************/
+
+/* Encoder parameters */
+typedef struct synth_encoder_params_t {
+    /* APIDs of the image channels, sent in this order */
+    uint32_t apid[CHANNEL_IMAGE_NUM];
+
+    /* JPEG quality factor of the images */
+    uint8_t quality;
+} synth_encoder_params_t;
+
+/* Encoder state, from image packets to convolutionally coded CADUs */
+typedef struct synth_encoder_t {
+    synth_encoder_params_t params;
+
+    /* VCDU and source packet counters */
+    uint32_t frame_cnt;
+    uint16_t pck_cnt;
+
+    /* Strip of MCUs being sent and the next packet in it */
+    uint32_t strip;
+    int strip_pck;
+
+    /* Test pattern pixels of the strip */
+    uint8_t pixels[CHANNEL_IMAGE_NUM][SYNTH_STRIP_LINES * METEOR_IMAGE_WIDTH];
+
+    /* Source packet being sent, its length and bytes already sent */
+    uint8_t packet[SYNTH_PACKET_MAX];
+    size_t pck_len, pck_off;
+
+    /* Shift register of the convolutional encoder */
+    uint32_t conv_sh;
+} synth_encoder_t;
+
+/*****************************************************************************/
+
+synth_encoder_t *Synth_Encoder_Init(const synth_encoder_params_t *params);
+void Synth_Encoder_Deinit(synth_encoder_t *self);
+uint8_t Synth_Pattern(int chn, uint32_t x, uint32_t y);
+size_t Synth_Encode_Mcus(
+        const uint8_t *strip,
+        int mcu_id,
+        uint8_t quality,
+        uint8_t *out,
+        size_t max_len);
+void Synth_Cadu(synth_encoder_t *self, uint8_t *cadu);
+void Synth_Convolve(synth_encoder_t *self, const uint8_t *cadu, int8_t *soft);
+
+/*****************************************************************************/
+
+#endif
@@ -0,0 +1,559 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * Synthetic LRPT signal generator. Writes a test pattern transmission
+ * as I/Q samples or soft symbols to a file, or measures the bit error
+ * rates and decoded frames of the decoder over a range of Eb/N0
+ */
+
+/*****************************************************************************/
+
+#include "../common/common.h"
+#include "../decoder/bitop.h"
+#include "../decoder/medet.h"
+#include "../decoder/viterbi27.h"
+#include "../demodulator/pll.h"
+#include "../glrpt/utils.h"
+#include "../image/image.h"
+#include "awgn.h"
+#include "encoder.h"
+#include "modulator.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*****************************************************************************/
+
+/* Defaults of the transmission (Meteor-M2) */
+#define SYNTH_SYMBOL_RATE   72000
+#define SYNTH_OVERSAMPLE    4
+#define SYNTH_RRC_ALPHA     0.6
+#define SYNTH_AMPLITUDE     0.25
+#define SYNTH_QUALITY       80
+#define SYNTH_FRAMES        1000
+
+/* Output sample formats */
+enum {
+    FORMAT_CF32 = 0,
+    FORMAT_CS16,
+    FORMAT_SOFT
+};
+
+/*****************************************************************************/
+
+static void Usage(void);
+static bool Parse_Mode(const char *arg, ModScheme *mode);
+static bool Parse_Sweep(const char *arg, double *from, double *to, double *step);
+static bool Write_Samples(
+        FILE *fp,
+        int format,
+        const double *samples_i,
+        const double *samples_q,
+        size_t len);
+static bool Generate(
+        const char *fname,
+        int format,
+        uint32_t frames,
+        const synth_encoder_params_t *enc_params,
+        const synth_mod_params_t *mod_params);
+static void Sweep_Point(
+        double ebn0,
+        uint32_t frames,
+        uint32_t seed,
+        const synth_encoder_params_t *enc_params);
+
+/*****************************************************************************/
+
+/* main()
+ *
+ * Generates a signal file or runs a bit error rate sweep
+ */
+int main(int argc, char *argv[]) {
+    synth_encoder_params_t enc_params = {
+        .apid    = { 64, 65, 66 },
+        .quality = SYNTH_QUALITY
+    };
+
+    synth_mod_params_t mod_params = {
+        .mode        = QPSK,
+        .symbol_rate = SYNTH_SYMBOL_RATE,
+        .rrc_alpha   = SYNTH_RRC_ALPHA,
+        .amplitude   = SYNTH_AMPLITUDE,
+        .seed        = 1
+    };
+
+    const char *fname = NULL;
+    int format = FORMAT_CF32;
+    uint32_t frames = SYNTH_FRAMES;
+    bool sweep = false;
+    double from = 0.0, to = 0.0, step = 0.0;
+
+    /* Process command line options */
+    int option;
+
+    while ((option = getopt(argc, argv, "m:r:s:n:e:d:D:t:p:a:q:S:f:o:B:hv")) != -1)
+        switch (option) {
+            case 'm': /* Modulation */
+                if (!Parse_Mode(optarg, &mod_params.mode)) {
+                    fprintf(stderr, "glrpt_synth: %s\n", "invalid modulation");
+                    exit(-1);
+                }
+
+                break;
+
+            case 'r': /* Symbol rate (Sym/s) */
+                mod_params.symbol_rate = (uint32_t)strtoul(optarg, NULL, 10);
+
+                break;
+
+            case 's': /* Sample rate (Hz) */
+                mod_params.samplerate = strtod(optarg, NULL);
+
+                break;
+
+            case 'n': /* Number of frames */
+                frames = (uint32_t)strtoul(optarg, NULL, 10);
+
+                break;
+
+            case 'e': /* Eb/N0 (dB) */
+                mod_params.ebn0  = strtod(optarg, NULL);
+                mod_params.noise = true;
+
+                break;
+
+            case 'd': /* Doppler shift (Hz) */
+                mod_params.doppler = strtod(optarg, NULL);
+
+                break;
+
+            case 'D': /* Doppler rate (Hz/s) */
+                mod_params.doppler_rate = strtod(optarg, NULL);
+
+                break;
+
+            case 't': /* Timing offset (symbols) */
+                mod_params.timing_offset = strtod(optarg, NULL);
+
+                break;
+
+            case 'p': /* Symbol clock error (ppm) */
+                mod_params.clock_error = strtod(optarg, NULL);
+
+                break;
+
+            case 'a': /* RRC filter alpha */
+                mod_params.rrc_alpha = strtod(optarg, NULL);
+
+                break;
+
+            case 'q': /* JPEG quality */
+                enc_params.quality = (uint8_t)strtoul(optarg, NULL, 10);
+
+                break;
+
+            case 'S': /* Noise seed */
+                mod_params.seed = (uint32_t)strtoul(optarg, NULL, 10);
+
+                break;
+
+            case 'f': /* Output format */
+                if (strcmp(optarg, "cf32") == 0)
+                    format = FORMAT_CF32;
+                else if (strcmp(optarg, "cs16") == 0)
+                    format = FORMAT_CS16;
+                else if (strcmp(optarg, "soft") == 0)
+                    format = FORMAT_SOFT;
+                else {
+                    fprintf(stderr, "glrpt_synth: %s\n", "invalid format");
+                    exit(-1);
+                }
+
+                break;
+
+            case 'o': /* Output file */
+                fname = optarg;
+
+                break;
+
+            case 'B': /* Bit error rate sweep */
+                if (!Parse_Sweep(optarg, &from, &to, &step)) {
+                    fprintf(stderr, "glrpt_synth: %s\n", "invalid sweep");
+                    exit(-1);
+                }
+
+                sweep = true;
+
+                break;
+
+            case 'h': /* Print help and exit */
+                Usage();
+                exit(0);
+
+                break;
+
+            case 'v': /* Print version info and exit */
+                puts(PACKAGE_STRING);
+                exit(0);
+
+                break;
+
+            default: /* Print help and exit */
+                Usage();
+                exit(-1);
+
+                break;
+        }
+
+    if ((frames == 0) || (mod_params.symbol_rate == 0) ||
+            (enc_params.quality == 0) || (enc_params.quality > 100)) {
+        fprintf(stderr, "glrpt_synth: %s\n", "invalid parameters");
+        exit(-1);
+    }
+
+    if (mod_params.samplerate == 0.0)
+        mod_params.samplerate =
+            SYNTH_OVERSAMPLE * (double)mod_params.symbol_rate;
+
+    if (mod_params.samplerate < 2.0 * mod_params.symbol_rate) {
+        fprintf(stderr, "glrpt_synth: %s\n", "sample rate too low");
+        exit(-1);
+    }
+
+    if (sweep) {
+        puts("ebn0_db,channel_ber,viterbi_ber,frames,frames_ok");
+
+        for (double ebn0 = from; ebn0 <= to + step / 2.0; ebn0 += step)
+            Sweep_Point(ebn0, frames, mod_params.seed, &enc_params);
+
+        exit(0);
+    }
+
+    if (!fname) {
+        Usage();
+        exit(-1);
+    }
+
+    if (!Generate(fname, format, frames, &enc_params, &mod_params))
+        exit(-1);
+
+    return 0;
+}
+
+/*****************************************************************************/
+
+/* Usage()
+ *
+ * Prints usage information
+ */
+static void Usage(void) {
+    fprintf(stderr, "%s\n",
+            "Usage: glrpt_synth [-hv] [-m mode] [-r rate] [-s samplerate]"
+            " [-n frames] [-e ebn0] [-d doppler] [-D rate] [-t offset]"
+            " [-p ppm] [-a alpha] [-q quality] [-S seed] [-f format]"
+            " -o file | -B from:to:step");
+
+    fprintf(stderr, "%s\n",
+            "       -m: Modulation, QPSK, DOQPSK or IDOQPSK. Default is QPSK");
+
+    fprintf(stderr, "%s\n",
+            "       -r: Symbol rate (Sym/s). Default is 72000");
+
+    fprintf(stderr, "%s\n",
+            "       -s: Sample rate (Hz). Default is 4 times the symbol rate");
+
+    fprintf(stderr, "%s\n",
+            "       -n: Number of frames (CADUs) to send. Default is 1000");
+
+    fprintf(stderr, "%s\n",
+            "       -e: Eb/N0 (dB) of added noise. Default is no noise");
+
+    fprintf(stderr, "%s\n",
+            "       -d: Doppler shift (Hz) and -D its rate (Hz/s)");
+
+    fprintf(stderr, "%s\n",
+            "       -t: Timing offset (symbols) and -p clock error (ppm)");
+
+    fprintf(stderr, "%s\n",
+            "       -a: RRC filter alpha. Default is 0.6");
+
+    fprintf(stderr, "%s\n",
+            "       -q: JPEG quality of the images. Default is 80");
+
+    fprintf(stderr, "%s\n",
+            "       -S: Noise seed. Default is 1");
+
+    fprintf(stderr, "%s\n",
+            "       -f: Output format: cf32 or cs16 I/Q samples, or 8-bit"
+            " soft symbols as decoded by the demodulator. Default is cf32");
+
+    fprintf(stderr, "%s\n",
+            "       -o: Output file");
+
+    fprintf(stderr, "%s\n",
+            "       -B: Instead of writing a file, decode -n frames of soft"
+            " symbols at each Eb/N0 (dB) of the range and print CSV:"
+            " ebn0_db,channel_ber,viterbi_ber,frames,frames_ok");
+
+    fprintf(stderr, "%s\n",
+            "       -h: Print this usage information and exit");
+
+    fprintf(stderr, "%s\n",
+            "       -v: Print version number and exit");
+}
+
+/*****************************************************************************/
+
+/* Parse_Mode()
+ *
+ * Parses the name of a modulation
+ */
+static bool Parse_Mode(const char *arg, ModScheme *mode) {
+    if (strcmp(arg, "QPSK") == 0)
+        *mode = QPSK;
+    else if (strcmp(arg, "DOQPSK") == 0)
+        *mode = DOQPSK;
+    else if (strcmp(arg, "IDOQPSK") == 0)
+        *mode = IDOQPSK;
+    else
+        return false;
+
+    return true;
+}
+
+/*****************************************************************************/
+
+/* Parse_Sweep()
+ *
+ * Parses an Eb/N0 range as from:to:step
+ */
+static bool Parse_Sweep(const char *arg, double *from, double *to, double *step) {
+    if (sscanf(arg, "%lf:%lf:%lf", from, to, step) != 3)
+        return false;
+
+    return (*step > 0.0) && (*to >= *from);
+}
+
+/*****************************************************************************/
+
+/* Write_Samples()
+ *
+ * Writes I/Q samples as interleaved floats or 16-bit integers
+ */
+static bool Write_Samples(
+        FILE *fp,
+        int format,
+        const double *samples_i,
+        const double *samples_q,
+        size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        size_t ret;
+
+        if (format == FORMAT_CF32) {
+            float iq[2] = { (float)samples_i[i], (float)samples_q[i] };
+
+            ret = fwrite(iq, sizeof(iq), 1, fp);
+        } else {
+            int16_t iq[2] = {
+                (int16_t)dClamp(round(samples_i[i] * 32767.0), -32767.0, 32767.0),
+                (int16_t)dClamp(round(samples_q[i] * 32767.0), -32767.0, 32767.0)
+            };
+
+            ret = fwrite(iq, sizeof(iq), 1, fp);
+        }
+
+        if (ret != 1)
+            return false;
+    }
+
+    return true;
+}
+
+/*****************************************************************************/
+
+/* Generate()
+ *
+ * Writes a transmission of the test pattern to a file
+ */
+static bool Generate(
+        const char *fname,
+        int format,
+        uint32_t frames,
+        const synth_encoder_params_t *enc_params,
+        const synth_mod_params_t *mod_params) {
+    uint8_t cadu[SYNTH_CADU_LEN];
+    int8_t soft[SYNTH_SOFT_LEN];
+    const double *samples_i, *samples_q;
+    uint64_t samples = 0;
+    size_t len;
+    bool ok = true;
+    FILE *fp = NULL;
+    awgn_t awgn;
+
+    if (!Open_File(&fp, fname, "w"))
+        return false;
+
+    synth_encoder_t *encoder = Synth_Encoder_Init(enc_params);
+    synth_mod_t *mod = NULL;
+
+    if (format == FORMAT_SOFT)
+        Awgn_Init(&awgn, mod_params->seed);
+    else
+        mod = Synth_Mod_Init(mod_params);
+
+    double sigma = Awgn_Soft_Sigma(mod_params->ebn0, SYNTH_SOFT_AMPL);
+
+    for (uint32_t f = 0; ok && (f < frames); f++) {
+        Synth_Cadu(encoder, cadu);
+        Synth_Convolve(encoder, cadu, soft);
+
+        if (format == FORMAT_SOFT) {
+            if (mod_params->noise)
+                Awgn_Soft(&awgn, soft, SYNTH_SOFT_LEN, sigma);
+
+            ok = fwrite(soft, SYNTH_SOFT_LEN, 1, fp) == 1;
+            continue;
+        }
+
+        len = Synth_Modulate(mod, soft, SYNTH_SOFT_LEN, &samples_i, &samples_q);
+        ok = Write_Samples(fp, format, samples_i, samples_q, len);
+        samples += len;
+    }
+
+    if (ok && mod) {
+        len = Synth_Mod_Flush(mod, &samples_i, &samples_q);
+        ok = Write_Samples(fp, format, samples_i, samples_q, len);
+        samples += len;
+    }
+
+    if (fclose(fp) != 0)
+        ok = false;
+
+    if (!ok)
+        fprintf(stderr, "glrpt_synth: failed to write %s\n", fname);
+    else if (mod)
+        fprintf(stderr, "glrpt_synth: %u frames, %llu samples at %.1f Hz\n",
+                frames, (unsigned long long)samples, mod_params->samplerate);
+    else
+        fprintf(stderr, "glrpt_synth: %u frames of soft symbols\n", frames);
+
+    Synth_Mod_Deinit(mod);
+    Synth_Encoder_Deinit(encoder);
+
+    return ok;
+}
+
+/*****************************************************************************/
+
+/* Sweep_Point()
+ *
+ * Decodes noisy soft symbols at an Eb/N0 and prints the error rate of
+ * the hard decided symbols, of the Viterbi decoder's output and the
+ * frames decoded by the complete decoder. Two more frames are sent
+ * at the end, the decoder looks that far ahead
+ */
+static void Sweep_Point(
+        double ebn0,
+        uint32_t frames,
+        uint32_t seed,
+        const synth_encoder_params_t *enc_params) {
+    uint8_t cadu[SYNTH_CADU_LEN];
+    int8_t clean[SYNTH_SOFT_LEN];
+    uint8_t hard[SYNTH_CADU_LEN];
+    int8_t *window = NULL;
+    uint64_t chan_err = 0, vit_err = 0;
+    channel_images_t images;
+    awgn_t awgn;
+
+    medet_params_t params = {
+        .apid = { enc_params->apid[0], enc_params->apid[1], enc_params->apid[2] },
+        .invert_palette = { 0, 0, 0 }
+    };
+
+    memset(&images, 0, sizeof(images));
+    medet_t *decoder = Medet_Init(&params, &images);
+    synth_encoder_t *encoder = Synth_Encoder_Init(enc_params);
+
+    viterbi27_rec_t *viterbi = NULL;
+    mem_alloc((void **)&viterbi, sizeof(viterbi27_rec_t));
+    Mk_Viterbi27(viterbi);
+
+    /* Soft symbols window of the decoder, as given by the demodulator */
+    mem_alloc((void **)&window, 3 * SOFT_FRAME_LEN);
+    int8_t *noisy = &window[2 * SOFT_FRAME_LEN];
+
+    Awgn_Init(&awgn, seed);
+    double sigma = Awgn_Soft_Sigma(ebn0, SYNTH_SOFT_AMPL);
+
+    for (uint32_t f = 0; f < frames + 2; f++) {
+        Synth_Cadu(encoder, cadu);
+        Synth_Convolve(encoder, cadu, clean);
+
+        memmove(window, &window[SOFT_FRAME_LEN], 2 * SOFT_FRAME_LEN);
+        memcpy(noisy, clean, SYNTH_SOFT_LEN);
+        Awgn_Soft(&awgn, noisy, SYNTH_SOFT_LEN, sigma);
+
+        if (f < frames) {
+            for (int i = 0; i < SYNTH_SOFT_LEN; i++)
+                if ((noisy[i] < 0) != (clean[i] < 0))
+                    chan_err++;
+
+            Vit_Decode(viterbi, (uint8_t *)noisy, hard);
+            for (int i = 0; i < SYNTH_CADU_LEN; i++)
+                vit_err += (uint64_t)Bitop_CountBits(hard[i] ^ cadu[i]);
+        }
+
+        if (f >= 2)
+            Decode_Image(decoder, (uint8_t *)window, SOFT_FRAME_LEN);
+    }
+
+    printf("%.2f,%.6e,%.6e,%u,%d\n", ebn0,
+            (double)chan_err / ((double)frames * SYNTH_SOFT_LEN),
+            (double)vit_err / ((double)frames * SYNTH_CADU_LEN * 8),
+            frames, decoder->ok_cnt);
+    fflush(stdout);
+
+    free_ptr((void **)&window);
+    free_ptr((void **)&viterbi);
+    Synth_Encoder_Deinit(encoder);
+    Medet_Deinit(decoder);
+    Channel_Images_Reset(&images);
+}
+
+/*****************************************************************************/
+
+/* Show_Message()
+ *
+ * Only errors are printed, to keep the output machine readable
+ */
+void Show_Message(const char *mesg, const char *attr) {
+    if (strcmp(attr, "red") == 0)
+        fprintf(stderr, "glrpt_synth: error: %s\n", mesg);
+}
+
+/*****************************************************************************/
+
+/* Error_Dialog()
+ *
+ * Errors are already reported by Show_Message(), nothing to do here
+ */
+void Error_Dialog(void) {
+}
@@ -0,0 +1,400 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*****************************************************************************/
+
+/*
+ * Modulates soft symbols into the I/Q samples the demodulator takes:
+ * QPSK, or offset QPSK with differential coding (DOQPSK) and also
+ * convolutional interleaving with sync words (IDOQPSK), the inverse
+ * of De_Diffcode() and De_Interleave(). RRC pulse shaping, carrier
+ * and timing offsets and white gaussian noise are applied on the way
+ */
+
+/*****************************************************************************/
+
+#include "modulator.h"
+
+#include "../common/common.h"
+#include "../demodulator/pll.h"
+#include "../glrpt/utils.h"
+#include "awgn.h"
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*****************************************************************************/
+
+/* Span of the RRC pulse each side of its peak (symbols)
+ * and the number of its samples per symbol in the table */
+#define RRC_SPAN            8
+#define RRC_RES             64
+#define RRC_LEN             (2 * RRC_SPAN * RRC_RES + 1)
+
+/* Interleaver geometry, see doqpsk.c */
+#define INTLV_BRANCHES      36
+#define INTLV_BASE_LEN      73728
+#define INTLV_MESG_LEN      2654208
+#define INTLV_DATA_LEN      72
+#define INTLV_SYNC_LEN      8
+
+/* Code rate of the convolutional code */
+#define CODE_RATE           0.5
+
+/* Initial allocation of the symbol and sample buffers */
+#define SYM_BUF_STEP        4096
+
+/*****************************************************************************/
+
+static double Rrc_Pulse(double tau, double alpha);
+static inline double Pulse_At(const synth_mod_t *self, double tau);
+static void Push_Symbol(synth_mod_t *self, double sym_i, double sym_q);
+static void Push_Value(synth_mod_t *self, int8_t value);
+static void Interleave(synth_mod_t *self, int8_t value);
+static size_t Generate(synth_mod_t *self);
+
+/*****************************************************************************/
+
+/* IDOQPSK sync word 00100111, sent LSB first, a 1 being positive */
+static const int8_t sync_word[INTLV_SYNC_LEN] = {
+    1, 1, 1, -1, -1, 1, -1, -1
+};
+
+/*****************************************************************************/
+
+/* Rrc_Pulse()
+ *
+ * Root raised cosine pulse at tau symbols from its peak
+ */
+static double Rrc_Pulse(double tau, double alpha) {
+    double x = 4.0 * alpha * tau;
+
+    if (fabs(tau) < 1e-9)
+        return 1.0 - alpha + 4.0 * alpha / M_PI;
+
+    if (fabs(fabs(x) - 1.0) < 1e-9)
+        return alpha / M_SQRT2 *
+            ((1.0 + 2.0 / M_PI) * sin(M_PI / (4.0 * alpha)) +
+             (1.0 - 2.0 / M_PI) * cos(M_PI / (4.0 * alpha)));
+
+    return (sin(M_PI * tau * (1.0 - alpha)) +
+            x * cos(M_PI * tau * (1.0 + alpha))) /
+        (M_PI * tau * (1.0 - x * x));
+}
+
+/*****************************************************************************/
+
+/* Pulse_At()
+ *
+ * Interpolates the pulse table at tau symbols from the peak
+ */
+static inline double Pulse_At(const synth_mod_t *self, double tau) {
+    if ((tau <= -RRC_SPAN) || (tau >= RRC_SPAN))
+        return 0.0;
+
+    double x = (tau + RRC_SPAN) * RRC_RES;
+    int idx = (int)x;
+    double frac = x - (double)idx;
+
+    return self->pulse[idx] + frac * (self->pulse[idx + 1] - self->pulse[idx]);
+}
+
+/*****************************************************************************/
+
+/* Push_Symbol()
+ *
+ * Appends a symbol to those waiting to be modulated
+ */
+static void Push_Symbol(synth_mod_t *self, double sym_i, double sym_q) {
+    if (self->sym_len == self->sym_size) {
+        self->sym_size += SYM_BUF_STEP;
+        mem_realloc((void **)&(self->sym_i), self->sym_size * sizeof(double));
+        mem_realloc((void **)&(self->sym_q), self->sym_size * sizeof(double));
+    }
+
+    self->sym_i[self->sym_len] = self->params.amplitude * sym_i;
+    self->sym_q[self->sym_len] = self->params.amplitude * sym_q;
+    self->sym_len++;
+}
+
+/*****************************************************************************/
+
+/* Push_Value()
+ *
+ * Pairs soft symbols into the I and Q components of symbols
+ */
+static void Push_Value(synth_mod_t *self, int8_t value) {
+    if (!self->have_value) {
+        self->value = value;
+        self->have_value = true;
+        return;
+    }
+
+    Push_Symbol(self, (double)self->value, (double)value);
+    self->have_value = false;
+}
+
+/*****************************************************************************/
+
+/* Interleave()
+ *
+ * Convolutional interleaver, the inverse of the one in De_Interleave().
+ * Branch b of the 36 delays its symbols by b * INTLV_BASE_LEN, the
+ * output before the delay lines fill up is random. A sync word is
+ * sent before each INTLV_DATA_LEN interleaved symbols
+ */
+static void Interleave(synth_mod_t *self, int8_t value) {
+    uint64_t idx = self->intlv_cnt++;
+    uint64_t delay = (idx % INTLV_BRANCHES) * INTLV_BASE_LEN;
+    int8_t out;
+
+    self->intlv[idx % INTLV_MESG_LEN] = value;
+
+    if (idx >= delay)
+        out = self->intlv[(idx - delay) % INTLV_MESG_LEN];
+    else
+        out = (Awgn_Uniform(&(self->awgn)) & 1) ? 1 : -1;
+
+    if (self->sync_cnt == 0)
+        for (int i = 0; i < INTLV_SYNC_LEN; i++)
+            Push_Value(self, sync_word[i]);
+
+    Push_Value(self, out);
+
+    if (++self->sync_cnt == INTLV_DATA_LEN)
+        self->sync_cnt = 0;
+}
+
+/*****************************************************************************/
+
+/* Generate()
+ *
+ * Makes the samples of all waiting symbols whose pulse is complete,
+ * Q being delayed by half a symbol in the offset QPSK modes
+ */
+static size_t Generate(synth_mod_t *self) {
+    double offset = (self->params.mode == QPSK) ? 0.0 : 0.5;
+    double end = (double)(self->sym_base + self->sym_len);
+    size_t cnt = 0;
+
+    while (self->t + offset + RRC_SPAN + 1.0 < end) {
+        if (cnt == self->out_size) {
+            self->out_size += SYM_BUF_STEP;
+            mem_realloc((void **)&(self->out_i), self->out_size * sizeof(double));
+            mem_realloc((void **)&(self->out_q), self->out_size * sizeof(double));
+        }
+
+        /* Pulse shaped symbols around the sample time */
+        int64_t first = (int64_t)floor(self->t - RRC_SPAN);
+        int64_t last  = (int64_t)ceil(self->t + offset + RRC_SPAN);
+        double si = 0.0, sq = 0.0;
+
+        if (first < (int64_t)self->sym_base)
+            first = (int64_t)self->sym_base;
+
+        for (int64_t k = first; k <= last; k++) {
+            size_t idx = (size_t)k - (size_t)self->sym_base;
+            double tau = self->t - (double)k;
+
+            si += self->sym_i[idx] * Pulse_At(self, tau);
+            sq += self->sym_q[idx] * Pulse_At(self, tau - offset);
+        }
+
+        /* Carrier offset */
+        complex double sample = (si + sq * I) * cexp(self->phase * I);
+        double freq = self->params.doppler + self->params.doppler_rate *
+            (double)self->sample_cnt / self->params.samplerate;
+
+        self->phase = fmod(self->phase +
+                M_2PI * freq / self->params.samplerate, M_2PI);
+
+        if (self->params.noise)
+            sample += self->noise_sigma *
+                (Awgn_Gauss(&(self->awgn)) + Awgn_Gauss(&(self->awgn)) * I);
+
+        self->out_i[cnt] = creal(sample);
+        self->out_q[cnt] = cimag(sample);
+        cnt++;
+
+        self->sample_cnt++;
+        self->t += self->t_step;
+    }
+
+    /* Drop the symbols that are no longer needed */
+    if (self->t > RRC_SPAN + 1.0) {
+        uint64_t base = (uint64_t)floor(self->t - RRC_SPAN) - 1;
+
+        if (base > self->sym_base) {
+            size_t drop = (size_t)(base - self->sym_base);
+
+            if (drop > self->sym_len)
+                drop = self->sym_len;
+
+            self->sym_len -= drop;
+            memmove(self->sym_i, &(self->sym_i[drop]),
+                    self->sym_len * sizeof(double));
+            memmove(self->sym_q, &(self->sym_q[drop]),
+                    self->sym_len * sizeof(double));
+            self->sym_base += drop;
+        }
+    }
+
+    return cnt;
+}
+
+/*****************************************************************************/
+
+/* Synth_Mod_Init()
+ *
+ * Creates a modulator
+ */
+synth_mod_t *Synth_Mod_Init(const synth_mod_params_t *params) {
+    synth_mod_t *self = NULL;
+    double energy = 0.0;
+
+    mem_alloc((void **)&self, sizeof(synth_mod_t));
+    self->params = *params;
+
+    Awgn_Init(&(self->awgn), params->seed);
+
+    /* Pulse of unit energy, so that a symbol's energy is
+     * the samples per symbol times its squared magnitude */
+    mem_alloc((void **)&(self->pulse), RRC_LEN * sizeof(double));
+
+    for (int i = 0; i < RRC_LEN; i++) {
+        self->pulse[i] = Rrc_Pulse(
+                (double)(i - RRC_SPAN * RRC_RES) / RRC_RES, params->rrc_alpha);
+        energy += self->pulse[i] * self->pulse[i];
+    }
+
+    energy /= RRC_RES;
+    for (int i = 0; i < RRC_LEN; i++)
+        self->pulse[i] /= sqrt(energy);
+
+    /* Each symbol carries 2 coded bits, IDOQPSK also sync words */
+    double sps  = params->samplerate / (double)params->symbol_rate;
+    double esn0 = 2.0 * CODE_RATE * pow(10.0, params->ebn0 / 10.0);
+
+    if (params->mode == IDOQPSK)
+        esn0 *= (double)INTLV_DATA_LEN / (INTLV_DATA_LEN + INTLV_SYNC_LEN);
+
+    self->noise_sigma = params->amplitude * sqrt(sps / esn0);
+
+    self->t = -params->timing_offset;
+    self->t_step = (double)params->symbol_rate *
+        (1.0 + params->clock_error * 1e-6) / params->samplerate;
+
+    self->prev_i = 1;
+    self->prev_q = 1;
+
+    if (params->mode == IDOQPSK)
+        mem_alloc((void **)&(self->intlv), INTLV_MESG_LEN);
+
+    return self;
+}
+
+/*****************************************************************************/
+
+/* Synth_Mod_Deinit()
+ *
+ * Frees a modulator
+ */
+void Synth_Mod_Deinit(synth_mod_t *self) {
+    if (!self)
+        return;
+
+    free_ptr((void **)&(self->pulse));
+    free_ptr((void **)&(self->sym_i));
+    free_ptr((void **)&(self->sym_q));
+    free_ptr((void **)&(self->intlv));
+    free_ptr((void **)&(self->out_i));
+    free_ptr((void **)&(self->out_q));
+    free_ptr((void **)&self);
+}
+
+/*****************************************************************************/
+
+/* Synth_Modulate()
+ *
+ * Modulates pairs of soft symbols, a negative one being a 1. Returns
+ * the number of samples made, which lag the symbols by the pulse
+ * span, and points samples_i/q to them until the next call
+ */
+size_t Synth_Modulate(
+        synth_mod_t *self,
+        const int8_t *soft,
+        size_t len,
+        const double **samples_i,
+        const double **samples_q) {
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        int8_t a = (soft[i] < 0) ? -1 : 1;
+        int8_t b = (soft[i + 1] < 0) ? -1 : 1;
+
+        /* The pairs are sent mirrored (I/Q swapped), then each phase
+         * the Costas loop may lock to gives one of the reflections
+         * that the decoder resolves with Fix_Packet() */
+        if (self->params.mode == QPSK) {
+            Push_Symbol(self, b, a);
+            continue;
+        }
+
+        /* Differential coding, De_Diffcode() inverts Q */
+        self->prev_i = (int8_t)(a * self->prev_i);
+        self->prev_q = (int8_t)(-b * self->prev_q);
+
+        if (self->params.mode == DOQPSK) {
+            Push_Symbol(self, self->prev_i, self->prev_q);
+        } else {
+            Interleave(self, self->prev_i);
+            Interleave(self, self->prev_q);
+        }
+    }
+
+    size_t cnt = Generate(self);
+
+    *samples_i = self->out_i;
+    *samples_q = self->out_q;
+
+    return cnt;
+}
+
+/*****************************************************************************/
+
+/* Synth_Mod_Flush()
+ *
+ * Ends the transmission: in IDOQPSK mode the interleaver is flushed
+ * with random symbols, then the last pulses are completed
+ */
+size_t Synth_Mod_Flush(
+        synth_mod_t *self,
+        const double **samples_i,
+        const double **samples_q) {
+    if (self->params.mode == IDOQPSK)
+        for (int i = 0; i < INTLV_MESG_LEN - INTLV_BASE_LEN; i++)
+            Interleave(self, (Awgn_Uniform(&(self->awgn)) & 1) ? 1 : -1);
+
+    for (int i = 0; i < RRC_SPAN + 2; i++)
+        Push_Symbol(self, 0.0, 0.0);
+
+    size_t cnt = Generate(self);
+
+    *samples_i = self->out_i;
+    *samples_q = self->out_q;
+
+    return cnt;
+}
@@ -0,0 +1,116 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details:
+ *
+ *  http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*****************************************************************************/
+
+#ifndef SYNTH_MODULATOR_H
+#define SYNTH_MODULATOR_H
+
+/*****************************************************************************/
+
+#include "../demodulator/pll.h"
+#include "awgn.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*****************************************************************************/
+
+/* Modulator parameters */
+typedef struct synth_mod_params_t {
+    /* Modulation (QPSK/DOQPSK/IDOQPSK) and symbol rate (Sym/s) */
+    ModScheme mode;
+    uint32_t  symbol_rate;
+
+    /* Rate of the output samples (Hz) and RRC filter alpha factor */
+    double samplerate;
+    double rrc_alpha;
+
+    /* Eb/N0 of the information bits (dB), if noise is added */
+    bool   noise;
+    double ebn0;
+
+    /* Carrier offset (Hz) and its rate of change (Hz/s) */
+    double doppler, doppler_rate;
+
+    /* Timing offset of the first symbol (symbols)
+     * and symbol clock error (ppm) */
+    double timing_offset;
+    double clock_error;
+
+    /* Amplitude of the I and Q components of the symbols and noise seed */
+    double   amplitude;
+    uint32_t seed;
+} synth_mod_params_t;
+
+/* Modulator state */
+typedef struct synth_mod_t {
+    synth_mod_params_t params;
+
+    /* Noise source and deviation of each component per sample */
+    awgn_t awgn;
+    double noise_sigma;
+
+    /* Unit energy RRC pulse, sampled finely over its span */
+    double *pulse;
+
+    /* Symbols not yet fully sent and the index of the first one */
+    double  *sym_i, *sym_q;
+    size_t   sym_len, sym_size;
+    uint64_t sym_base;
+
+    /* Symbol time of the next sample and its increment */
+    double t, t_step;
+
+    /* Carrier phase (rad) and count of samples sent */
+    double   phase;
+    uint64_t sample_cnt;
+
+    /* Differential encoder state (DOQPSK|IDOQPSK) */
+    int8_t prev_i, prev_q;
+
+    /* Soft symbol waiting for its pair to make a symbol */
+    int8_t value;
+    bool   have_value;
+
+    /* Convolutional interleaver history and count of
+     * its input, data symbols sent since the last sync */
+    int8_t  *intlv;
+    uint64_t intlv_cnt;
+    int      sync_cnt;
+
+    /* Modulated samples returned to the caller */
+    double *out_i, *out_q;
+    size_t  out_size;
+} synth_mod_t;
+
+/*****************************************************************************/
+
+synth_mod_t *Synth_Mod_Init(const synth_mod_params_t *params);
+void Synth_Mod_Deinit(synth_mod_t *self);
+size_t Synth_Modulate(
+        synth_mod_t *self,
+        const int8_t *soft,
+        size_t len,
+        const double **samples_i,
+        const double **samples_q);
+size_t Synth_Mod_Flush(
+        synth_mod_t *self,
+        const double **samples_i,
+        const double **samples_q);
+
+/*****************************************************************************/
+
+#endif